@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 
 #include <crypto/sha256.h>
+#include <crypto/sph_multi.h>
 #include <stacktraces.h>
 #include <util/strencodings.h>
 #include <util/system.h>
@@ -61,6 +62,9 @@ int main(int argc, char** argv)
     args.output_csv = gArgs.GetArg("-output_csv", "");
     args.output_json = gArgs.GetArg("-output_json", "");
 
+    // The Mike benchmarks should measure the sph implementations a node would pick
+    SphHash512AutoDetect();
+
     benchmark::BenchRunner::RunAll(args);
 
     return EXIT_SUCCESS;
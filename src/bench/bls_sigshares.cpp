@@ -0,0 +1,93 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bls/bls.h>
+#include <llmq/signing_shares.h>
+#include <random.h>
+
+#include <ctpl_stl.h>
+
+#include <cassert>
+
+/*
+ * Replays a burst of sig-share traffic, as seen by a quorum member while many
+ * signing sessions (e.g. InstantSend locks) are running at the same time. The
+ * shares of every session arrive from a handful of peers, the way batched sig
+ * shares are relayed, and are verified in one round like in
+ * CSigSharesManager::ProcessPendingSigShares.
+ */
+
+namespace {
+
+std::vector<llmq::CSigShareToVerify> BuildSigShareTraffic(size_t sessionCount, size_t badPeerCount)
+{
+    const size_t quorumSize = 60;
+    const size_t threshold = 48;
+    const size_t peerCount = 8;
+
+    BLSSecretKeyVector skShares(quorumSize);
+    BLSPublicKeyVector pkShares(quorumSize);
+    for (size_t i = 0; i < quorumSize; i++) {
+        skShares[i].MakeNewKey();
+        pkShares[i] = skShares[i].GetPublicKey();
+    }
+
+    FastRandomContext rng(uint256S("5a"));
+    std::vector<llmq::CSigShareToVerify> sigShares;
+    sigShares.reserve(sessionCount * threshold);
+    for (size_t i = 0; i < sessionCount; i++) {
+        uint256 signHash = rng.rand256();
+        for (size_t j = 0; j < threshold; j++) {
+            // members are picked in a different order for every session
+            uint16_t member = (j + i * 7) % quorumSize;
+            NodeId nodeId = rng.randrange(peerCount);
+            CBLSSignature sig = skShares[member].Sign(signHash);
+            if ((size_t)nodeId < badPeerCount && rng.randrange(16) == 0) {
+                // signed by the wrong member, which makes the whole batch fail
+                sig = skShares[(member + 1) % quorumSize].Sign(signHash);
+            }
+            sigShares.push_back({nodeId, {signHash, member}, signHash, sig, pkShares[member]});
+        }
+    }
+    return sigShares;
+}
+
+void ReplaySigShareTraffic(benchmark::Bench& bench, size_t sessionCount, size_t badPeerCount, ctpl::thread_pool* workerPool)
+{
+    auto sigShares = BuildSigShareTraffic(sessionCount, badPeerCount);
+    bench.batch(sigShares.size()).unit("share").minEpochIterations(1).run([&] {
+        auto badSources = llmq::VerifySigShares(sigShares, workerPool);
+        assert(badSources.size() <= badPeerCount);
+    });
+}
+
+} // namespace
+
+static void BLS_SigShares_Verify_Serial(benchmark::Bench& bench)
+{
+    ReplaySigShareTraffic(bench, 64, 0, nullptr);
+}
+
+static void BLS_SigShares_Verify_Parallel(benchmark::Bench& bench)
+{
+    ctpl::thread_pool workerPool(3);
+    ReplaySigShareTraffic(bench, 64, 0, &workerPool);
+}
+
+static void BLS_SigShares_Verify_BadPeer_Serial(benchmark::Bench& bench)
+{
+    ReplaySigShareTraffic(bench, 64, 1, nullptr);
+}
+
+static void BLS_SigShares_Verify_BadPeer_Parallel(benchmark::Bench& bench)
+{
+    ctpl::thread_pool workerPool(3);
+    ReplaySigShareTraffic(bench, 64, 1, &workerPool);
+}
+
+BENCHMARK(BLS_SigShares_Verify_Serial)
+BENCHMARK(BLS_SigShares_Verify_Parallel)
+BENCHMARK(BLS_SigShares_Verify_BadPeer_Serial)
+BENCHMARK(BLS_SigShares_Verify_BadPeer_Parallel)
@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 #include <coins.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <wallet/crypter.h>
 
 #include <vector>
@@ -85,4 +86,33 @@ static void CCoinsCaching(benchmark::Bench& bench)
     });
 }
 
+// A cache holding many coins, as with a large -dbcache during IBD. Every run
+// fills a fresh cache and then looks all coins up again.
+static void CCoinsCachingLarge(benchmark::Bench& bench)
+{
+    static const size_t COINS = 200000;
+
+    FastRandomContext rng(true);
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(COINS);
+    for (size_t i = 0; i < COINS; i++) {
+        outpoints.emplace_back(rng.rand256(), rng.randbits(4));
+    }
+    CTxOut out;
+    out.nValue = COIN;
+    out.scriptPubKey = GetScriptForDestination(CKeyID(uint160(rng.randbytes(20))));
+
+    CCoinsView coinsDummy;
+    bench.batch(COINS).unit("coin").run([&] {
+        CCoinsViewCache coins(&coinsDummy);
+        for (const COutPoint& outpoint : outpoints) {
+            coins.AddCoin(outpoint, Coin(out, 1, false), false);
+        }
+        for (const COutPoint& outpoint : outpoints) {
+            assert(!coins.AccessCoin(outpoint).IsSpent());
+        }
+    });
+}
+
 BENCHMARK(CCoinsCaching);
+BENCHMARK(CCoinsCachingLarge);
@@ -0,0 +1,220 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <dbwrapper.h>
+#include <random.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+/*
+ * Replays a fixed write/read workload against a database opened with a given
+ * LevelDB profile. Each workload imitates the access pattern of one of the
+ * databases, so that its own profile can be compared with the default one.
+ */
+
+namespace {
+
+/** Key written as is, so that a shorter key is a prefix of a longer one */
+struct RawKey {
+    std::vector<unsigned char> data;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s.write((const char*)data.data(), data.size());
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        data.resize(s.size());
+        s.read((char*)data.data(), data.size());
+    }
+};
+
+struct DBOp {
+    enum class Type { WRITE_BATCH, READ, SCAN, ERASE } type;
+    std::vector<std::pair<std::vector<unsigned char>, std::vector<unsigned char>>> entries;
+    std::vector<unsigned char> key;
+};
+
+using DBWorkload = std::vector<DBOp>;
+
+std::vector<unsigned char> MakeKey(char prefix, FastRandomContext& rng, size_t len = 32)
+{
+    std::vector<unsigned char> key{(unsigned char)prefix};
+    std::vector<unsigned char> body = rng.randbytes(len);
+    key.insert(key.end(), body.begin(), body.end());
+    return key;
+}
+
+/** Values stitched together from a small set of fragments, like serialized masternode lists */
+std::vector<unsigned char> MakeRepetitiveValue(FastRandomContext& rng, const std::vector<std::vector<unsigned char>>& fragments, size_t len)
+{
+    std::vector<unsigned char> value;
+    while (value.size() < len) {
+        const auto& fragment = fragments[rng.randrange(fragments.size())];
+        value.insert(value.end(), fragment.begin(), fragment.end());
+    }
+    value.resize(len);
+    return value;
+}
+
+/** Many small coins written per block, most of which are read or spent soon after */
+DBWorkload ChainstateWorkload()
+{
+    FastRandomContext rng(uint256S("c0"));
+    DBWorkload workload;
+    std::vector<std::vector<unsigned char>> keys;
+    for (int block = 0; block < 50; ++block) {
+        DBOp batch{DBOp::Type::WRITE_BATCH};
+        for (int i = 0; i < 400; ++i) {
+            keys.push_back(MakeKey('C', rng, 34));
+            batch.entries.emplace_back(keys.back(), rng.randbytes(30 + rng.randrange(40)));
+        }
+        workload.push_back(std::move(batch));
+        for (int i = 0; i < 400; ++i) {
+            // Mostly hits on recent coins, some misses
+            DBOp read{rng.randrange(4) ? DBOp::Type::READ : DBOp::Type::ERASE};
+            read.key = rng.randrange(8) ? keys[keys.size() - 1 - rng.randrange(std::min<size_t>(keys.size(), 2000))] : MakeKey('C', rng, 34);
+            workload.push_back(std::move(read));
+        }
+    }
+    return workload;
+}
+
+/** Few, large and repetitive values that are read back by their block hash */
+DBWorkload EvoDBWorkload()
+{
+    FastRandomContext rng(uint256S("e0"));
+    std::vector<std::vector<unsigned char>> fragments;
+    for (int i = 0; i < 64; ++i) {
+        fragments.push_back(rng.randbytes(48 + rng.randrange(32)));
+    }
+    DBWorkload workload;
+    std::vector<std::vector<unsigned char>> keys;
+    for (int block = 0; block < 200; ++block) {
+        DBOp batch{DBOp::Type::WRITE_BATCH};
+        keys.push_back(MakeKey('d', rng));
+        batch.entries.emplace_back(keys.back(), MakeRepetitiveValue(rng, fragments, 2000 + rng.randrange(30000)));
+        batch.entries.emplace_back(MakeKey('s', rng), MakeRepetitiveValue(rng, fragments, 200));
+        workload.push_back(std::move(batch));
+        for (int i = 0; i < 5; ++i) {
+            DBOp read{DBOp::Type::READ};
+            read.key = keys[rng.randrange(keys.size())];
+            workload.push_back(std::move(read));
+        }
+    }
+    return workload;
+}
+
+/** Small entries sharing a per-address prefix, read back by prefix scans */
+DBWorkload AddressIndexWorkload()
+{
+    FastRandomContext rng(uint256S("a0"));
+    std::vector<std::vector<unsigned char>> addresses;
+    for (int i = 0; i < 500; ++i) {
+        addresses.push_back(MakeKey('a', rng, 21));
+    }
+    DBWorkload workload;
+    for (int block = 0; block < 50; ++block) {
+        DBOp batch{DBOp::Type::WRITE_BATCH};
+        for (int i = 0; i < 400; ++i) {
+            std::vector<unsigned char> key = addresses[rng.randrange(addresses.size())];
+            std::vector<unsigned char> suffix = rng.randbytes(40);
+            key.insert(key.end(), suffix.begin(), suffix.end());
+            batch.entries.emplace_back(std::move(key), rng.randbytes(8));
+        }
+        workload.push_back(std::move(batch));
+        for (int i = 0; i < 20; ++i) {
+            DBOp scan{DBOp::Type::SCAN};
+            scan.key = addresses[rng.randrange(addresses.size())];
+            workload.push_back(std::move(scan));
+        }
+    }
+    return workload;
+}
+
+void ReplayWorkload(benchmark::Bench& bench, const DBWorkload& workload, DBProfileType profile)
+{
+    const fs::path path = GetDataDir() / ("bench_dbwrapper_" + DBProfileName(profile));
+    bench.batch(workload.size()).unit("op").run([&] {
+        CDBWrapper db(path, 8 << 20, false, true, false, profile);
+        for (const DBOp& op : workload) {
+            switch (op.type) {
+            case DBOp::Type::WRITE_BATCH: {
+                CDBBatch batch(db);
+                for (const auto& entry : op.entries) {
+                    batch.Write(RawKey{entry.first}, entry.second);
+                }
+                db.WriteBatch(batch);
+                break;
+            }
+            case DBOp::Type::READ: {
+                std::vector<unsigned char> value;
+                db.Read(RawKey{op.key}, value);
+                break;
+            }
+            case DBOp::Type::SCAN: {
+                std::unique_ptr<CDBIterator> it(db.NewIterator());
+                size_t count = 0;
+                for (it->Seek(RawKey{op.key}); it->Valid(); it->Next()) {
+                    RawKey key;
+                    if (!it->GetKey(key) || key.data.size() < op.key.size() || !std::equal(op.key.begin(), op.key.end(), key.data.begin())) break;
+                    ++count;
+                }
+                ankerl::nanobench::doNotOptimizeAway(count);
+                break;
+            }
+            case DBOp::Type::ERASE:
+                db.Erase(RawKey{op.key});
+                break;
+            }
+        }
+    });
+}
+
+} // namespace
+
+static void DBProfileChainstateDefault(benchmark::Bench& bench)
+{
+    ReplayWorkload(bench, ChainstateWorkload(), DBProfileType::DEFAULT);
+}
+
+static void DBProfileChainstate(benchmark::Bench& bench)
+{
+    ReplayWorkload(bench, ChainstateWorkload(), DBProfileType::CHAINSTATE);
+}
+
+static void DBProfileEvoDBDefault(benchmark::Bench& bench)
+{
+    ReplayWorkload(bench, EvoDBWorkload(), DBProfileType::DEFAULT);
+}
+
+static void DBProfileEvoDB(benchmark::Bench& bench)
+{
+    ReplayWorkload(bench, EvoDBWorkload(), DBProfileType::EVODB);
+}
+
+static void DBProfileAddressIndexDefault(benchmark::Bench& bench)
+{
+    ReplayWorkload(bench, AddressIndexWorkload(), DBProfileType::DEFAULT);
+}
+
+static void DBProfileAddressIndex(benchmark::Bench& bench)
+{
+    ReplayWorkload(bench, AddressIndexWorkload(), DBProfileType::BLOCK_INDEX);
+}
+
+BENCHMARK(DBProfileChainstateDefault);
+BENCHMARK(DBProfileChainstate);
+BENCHMARK(DBProfileEvoDBDefault);
+BENCHMARK(DBProfileEvoDB);
+BENCHMARK(DBProfileAddressIndexDefault);
+BENCHMARK(DBProfileAddressIndex);
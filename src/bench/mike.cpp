@@ -0,0 +1,240 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <crypto/sph_multi.h>
+#include <cryptonote/slow-hash.h>
+#include <hash.h>
+#include <hash_selection.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <tinyformat.h>
+#include <uint256.h>
+
+#include <array>
+#include <vector>
+
+/*
+ * Mike's own stages hash into fixed buffers, so the only heap memory of the
+ * hash path is the CryptoNight scratchpad and AES context, which the C code
+ * keeps per thread and counts in cn_slow_hash_allocations(). Hash a few
+ * headers before the timed run and add the number of those allocations per
+ * hash to the benchmark name, so that it shows up in nanobench's results.
+ */
+template <typename Func>
+static void ReportAllocations(benchmark::Bench& bench, Func func)
+{
+    static const int HASHES = 8;
+    const uint64_t before = crypto::cn_slow_hash_allocations();
+    for (int i = 0; i < HASHES; i++) {
+        func();
+    }
+    const double allocations = double(crypto::cn_slow_hash_allocations() - before) / HASHES;
+    bench.name(strprintf("%s (%.2f allocs/hash)", bench.name(), allocations));
+}
+
+/**
+ * Previous block hashes which, taken together, put every core hash at every
+ * core stage and every CryptoNight variant at every CryptoNight stage. Starts
+ * from the mainnet checkpoints and fills the gaps with deterministic random
+ * hashes.
+ */
+static std::vector<uint256> MikeSamplePrevHashes()
+{
+    std::vector<uint256> hashes = {
+        uint256S("0xef99ea0231cf5ccee64a5350f79d8b17348f9a72cc1899113c4082c9f6aa1987"),
+        uint256S("0xe4d19872655099a6c226cf144182dcf4cfc1986c65a9cf8156201480832b62de"),
+        uint256S("0xc4a3904f8d33c7d2c7f8c1b83de6def234951127189ceee59f3fa4a722437272"),
+        uint256S("0x1c8d5b532167ee48ea9521325cb6ac300f59dddb552768fd5dce95e0b00277c3"),
+        uint256S("0x9a50fb296b63dafba79e9c51fbe5315ae1c7d413d26209322bc639f002d3233b"),
+    };
+
+    std::array<std::array<bool, MIKE_CORE_HASHES>, MIKE_CORE_HASHES> coreSeen{};
+    std::array<std::array<bool, MIKE_CN_VARIANTS>, 3> cnSeen{};
+    size_t missing = MIKE_CORE_HASHES * MIKE_CORE_HASHES + 3 * MIKE_CN_VARIANTS;
+    auto cover = [&](const uint256& hash) {
+        const MikeSchedule schedule(hash);
+        bool useful = false;
+        for (size_t i = 0; i < MIKE_CORE_HASHES; i++) {
+            if (!coreSeen[i][schedule.coreHashIndexes[i]]) {
+                coreSeen[i][schedule.coreHashIndexes[i]] = true;
+                useful = true;
+                missing--;
+            }
+        }
+        for (size_t i = 0; i < 3; i++) {
+            if (!cnSeen[i][schedule.cnIndexes[i]]) {
+                cnSeen[i][schedule.cnIndexes[i]] = true;
+                useful = true;
+                missing--;
+            }
+        }
+        return useful;
+    };
+
+    for (const uint256& hash : hashes) {
+        cover(hash);
+    }
+    FastRandomContext rng(true);
+    while (missing > 0) {
+        const uint256 hash = rng.rand256();
+        if (cover(hash)) {
+            hashes.push_back(hash);
+        }
+    }
+    return hashes;
+}
+
+/* Single stages on 64 byte inputs, as they run inside Mike */
+
+static void MikeCoreStage(benchmark::Bench& bench, size_t selection)
+{
+    uint512 hash;
+    bench.run([&] {
+        CORE_HASH_FUNCTIONS[selection](&hash, 64, &hash);
+    });
+}
+
+static void MikeCnStage(benchmark::Bench& bench, size_t selection)
+{
+    uint512 hashIn;
+    uint512 hashOut;
+    bench.run([&] {
+        CN_HASH_FUNCTIONS[selection](&hashIn, &hashOut);
+        hashIn = hashOut;
+    });
+}
+
+static void MIKE_STAGE_Blake(benchmark::Bench& bench) { MikeCoreStage(bench, 0); }
+static void MIKE_STAGE_Bmw(benchmark::Bench& bench) { MikeCoreStage(bench, 1); }
+static void MIKE_STAGE_Groestl(benchmark::Bench& bench) { MikeCoreStage(bench, 2); }
+static void MIKE_STAGE_Jh(benchmark::Bench& bench) { MikeCoreStage(bench, 3); }
+static void MIKE_STAGE_Keccak(benchmark::Bench& bench) { MikeCoreStage(bench, 4); }
+static void MIKE_STAGE_Skein(benchmark::Bench& bench) { MikeCoreStage(bench, 5); }
+static void MIKE_STAGE_Luffa(benchmark::Bench& bench) { MikeCoreStage(bench, 6); }
+static void MIKE_STAGE_Cubehash(benchmark::Bench& bench) { MikeCoreStage(bench, 7); }
+static void MIKE_STAGE_Shavite(benchmark::Bench& bench) { MikeCoreStage(bench, 8); }
+static void MIKE_STAGE_Simd(benchmark::Bench& bench) { MikeCoreStage(bench, 9); }
+static void MIKE_STAGE_Echo(benchmark::Bench& bench) { MikeCoreStage(bench, 10); }
+static void MIKE_STAGE_Sha512(benchmark::Bench& bench) { MikeCoreStage(bench, 11); }
+
+/* Four lanes of the core hashes which have a multi-buffer implementation */
+
+static void MikeCoreStage4Way(benchmark::Bench& bench, SphAlgo algo)
+{
+    uint512 hashes[MIKE_MAX_LANES];
+    bench.batch(MIKE_MAX_LANES).unit("hash").run([&] {
+        SphHash512_64(algo, hashes[0].begin(), hashes[0].begin(), MIKE_MAX_LANES);
+    });
+}
+
+static void MIKE_STAGE_Blake_4WAY(benchmark::Bench& bench) { MikeCoreStage4Way(bench, SphAlgo::BLAKE); }
+static void MIKE_STAGE_Bmw_4WAY(benchmark::Bench& bench) { MikeCoreStage4Way(bench, SphAlgo::BMW); }
+static void MIKE_STAGE_Jh_4WAY(benchmark::Bench& bench) { MikeCoreStage4Way(bench, SphAlgo::JH); }
+static void MIKE_STAGE_Keccak_4WAY(benchmark::Bench& bench) { MikeCoreStage4Way(bench, SphAlgo::KECCAK); }
+static void MIKE_STAGE_Skein_4WAY(benchmark::Bench& bench) { MikeCoreStage4Way(bench, SphAlgo::SKEIN); }
+static void MIKE_STAGE_Sha512_4WAY(benchmark::Bench& bench) { MikeCoreStage4Way(bench, SphAlgo::SHA512); }
+
+static void MIKE_STAGE_CNDark(benchmark::Bench& bench) { MikeCnStage(bench, 0); }
+static void MIKE_STAGE_CNDarklite(benchmark::Bench& bench) { MikeCnStage(bench, 1); }
+static void MIKE_STAGE_CNFast(benchmark::Bench& bench) { MikeCnStage(bench, 2); }
+static void MIKE_STAGE_CNLite(benchmark::Bench& bench) { MikeCnStage(bench, 3); }
+static void MIKE_STAGE_CNTurtle(benchmark::Bench& bench) { MikeCnStage(bench, 4); }
+static void MIKE_STAGE_CNTurtlelite(benchmark::Bench& bench) { MikeCnStage(bench, 5); }
+
+/* Full headers across previous block hashes covering all stage selections */
+
+static void MIKE_HEADER_SAMPLE(benchmark::Bench& bench)
+{
+    const std::vector<uint256> prevHashes = MikeSamplePrevHashes();
+    CBlockHeader header;
+    header.nVersion = 0x20000000;
+    header.hashMerkleRoot = uint256S("0xc59206be1307154ab6090c3419137d292f11c2be5585d86447ad0e1ad42de43c");
+    header.nTime = 1656979667;
+    header.nBits = 0x1e0fffff;
+    size_t i = 0;
+
+    ReportAllocations(bench, [&] {
+        header.hashPrevBlock = prevHashes[i++ % prevHashes.size()];
+        header.GetPOWHash();
+    });
+
+    bench.run([&] {
+        header.hashPrevBlock = prevHashes[i++ % prevHashes.size()];
+        ++header.nNonce;
+        header.GetPOWHash();
+    });
+}
+
+static void MIKE_HEADER_4WAY(benchmark::Bench& bench)
+{
+    // Consecutive nonces of one header, as the miner hashes them
+    const std::vector<uint256> prevHashes = MikeSamplePrevHashes();
+    CBlockHeader headers[MIKE_MAX_LANES];
+    uint256 hashes[MIKE_MAX_LANES];
+    for (CBlockHeader& header : headers) {
+        header.nVersion = 0x20000000;
+        header.hashMerkleRoot = uint256S("0xc59206be1307154ab6090c3419137d292f11c2be5585d86447ad0e1ad42de43c");
+        header.nTime = 1656979667;
+        header.nBits = 0x1e0fffff;
+    }
+    size_t i = 0;
+    uint32_t nonce = 0;
+
+    bench.batch(MIKE_MAX_LANES).unit("hash").run([&] {
+        const uint256& prevHash = prevHashes[i++ % prevHashes.size()];
+        for (CBlockHeader& header : headers) {
+            header.hashPrevBlock = prevHash;
+            header.nNonce = nonce++;
+        }
+        CBlockHeader::GetPOWHashes(headers, MIKE_MAX_LANES, MikeSchedule(prevHash), hashes);
+    });
+}
+
+static void MIKE_SCHEDULE(benchmark::Bench& bench)
+{
+    const std::vector<uint256> prevHashes = MikeSamplePrevHashes();
+    size_t i = 0;
+    uint8_t sum = 0;
+
+    ReportAllocations(bench, [&] {
+        sum += MikeSchedule(prevHashes[i++ % prevHashes.size()]).cnIndexes[0];
+    });
+
+    bench.run([&] {
+        sum += MikeSchedule(prevHashes[i++ % prevHashes.size()]).cnIndexes[0];
+    });
+    ankerl::nanobench::doNotOptimizeAway(sum);
+}
+
+BENCHMARK(MIKE_STAGE_Blake);
+BENCHMARK(MIKE_STAGE_Bmw);
+BENCHMARK(MIKE_STAGE_Groestl);
+BENCHMARK(MIKE_STAGE_Jh);
+BENCHMARK(MIKE_STAGE_Keccak);
+BENCHMARK(MIKE_STAGE_Skein);
+BENCHMARK(MIKE_STAGE_Luffa);
+BENCHMARK(MIKE_STAGE_Cubehash);
+BENCHMARK(MIKE_STAGE_Shavite);
+BENCHMARK(MIKE_STAGE_Simd);
+BENCHMARK(MIKE_STAGE_Echo);
+BENCHMARK(MIKE_STAGE_Sha512);
+
+BENCHMARK(MIKE_STAGE_Blake_4WAY);
+BENCHMARK(MIKE_STAGE_Bmw_4WAY);
+BENCHMARK(MIKE_STAGE_Jh_4WAY);
+BENCHMARK(MIKE_STAGE_Keccak_4WAY);
+BENCHMARK(MIKE_STAGE_Skein_4WAY);
+BENCHMARK(MIKE_STAGE_Sha512_4WAY);
+
+BENCHMARK(MIKE_STAGE_CNDark);
+BENCHMARK(MIKE_STAGE_CNDarklite);
+BENCHMARK(MIKE_STAGE_CNFast);
+BENCHMARK(MIKE_STAGE_CNLite);
+BENCHMARK(MIKE_STAGE_CNTurtle);
+BENCHMARK(MIKE_STAGE_CNTurtlelite);
+
+BENCHMARK(MIKE_HEADER_SAMPLE);
+BENCHMARK(MIKE_HEADER_4WAY);
+BENCHMARK(MIKE_SCHEDULE);
@@ -0,0 +1,113 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chainparams.h>
+#include <consensus/consensus.h>
+#include <consensus/validation.h>
+#include <script/standard.h>
+#include <test/util.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <vector>
+
+/*
+ * Switches back and forth between two competing branches of the same length,
+ * so that every iteration disconnects and connects REORG_DEPTH blocks. Each
+ * block has a transaction spending all outputs of the one in the block before,
+ * so disconnecting a branch restores coins which the block before removes again.
+ */
+
+namespace {
+
+/** Blocks on each side of the fork */
+constexpr int REORG_DEPTH = 32;
+/** Outputs each transaction passes on to the next one */
+constexpr int REORG_TX_OUTPUTS = 50;
+
+const CScript REDEEM_SCRIPT = CScript() << OP_DROP << OP_TRUE;
+const CScript SCRIPT_PUB = CScript() << OP_HASH160 << ToByteVector(CScriptID(REDEEM_SCRIPT)) << OP_EQUAL;
+
+CBlockIndex* MineBranch(const CTxIn& coinbase_in)
+{
+    std::vector<CTxIn> vin{coinbase_in};
+    CAmount nValue = 100000;
+    for (int i = 0; i < REORG_DEPTH; ++i) {
+        CMutableTransaction tx;
+        tx.vin = vin;
+        for (CTxIn& txin : tx.vin) {
+            txin.scriptSig = CScript() << std::vector<uint8_t>(100, 0xff) << ToByteVector(REDEEM_SCRIPT);
+        }
+        nValue -= 1000;
+        for (int n = 0; n < REORG_TX_OUTPUTS; ++n) {
+            tx.vout.emplace_back(nValue, SCRIPT_PUB);
+        }
+        const CTransactionRef txr = MakeTransactionRef(tx);
+        {
+            LOCK(::cs_main);
+            CValidationState state;
+            bool ret{::AcceptToMemoryPool(::mempool, state, txr, nullptr /* pfMissingInputs */, false /* bypass_limits */, /* nAbsurdFee */ 0)};
+            assert(ret);
+        }
+        MineBlock(SCRIPT_PUB);
+
+        vin.clear();
+        for (int n = 0; n < REORG_TX_OUTPUTS; ++n) {
+            vin.emplace_back(txr->GetHash(), n);
+        }
+    }
+    return WITH_LOCK(::cs_main, return ::ChainActive().Tip());
+}
+
+void Reorg(benchmark::Bench& bench)
+{
+    const CChainParams& chainparams = Params();
+
+    std::vector<CTxIn> coinbases;
+    for (int i = 0; i < COINBASE_MATURITY + 2; ++i) {
+        coinbases.push_back(MineBlock(SCRIPT_PUB));
+    }
+    const int nForkHeight = WITH_LOCK(::cs_main, return ::ChainActive().Height());
+
+    CBlockIndex* pindexTipA = MineBranch(coinbases[0]);
+    CBlockIndex* pindexForkA = WITH_LOCK(::cs_main, return ::ChainActive()[nForkHeight + 1]);
+    {
+        CValidationState state;
+        bool ret{InvalidateBlock(state, chainparams, pindexForkA)};
+        assert(ret);
+    }
+    ::mempool.clear();
+    CBlockIndex* pindexTipB = MineBranch(coinbases[1]);
+    {
+        LOCK(::cs_main);
+        ResetBlockFailureFlags(pindexForkA);
+    }
+
+    bool fToA = true;
+    bench.batch(REORG_DEPTH).unit("block").run([&] {
+        CValidationState state;
+        bool ret{PreciousBlock(state, chainparams, fToA ? pindexTipA : pindexTipB)};
+        assert(ret);
+        assert(WITH_LOCK(::cs_main, return ::ChainActive().Tip()) == (fToA ? pindexTipA : pindexTipB));
+        fToA = !fToA;
+    });
+}
+
+} // namespace
+
+static void ReorgParallelReads(benchmark::Bench& bench)
+{
+    Reorg(bench);
+}
+
+static void ReorgSerialReads(benchmark::Bench& bench)
+{
+    g_parallel_undo_prefetch = false;
+    Reorg(bench);
+    g_parallel_undo_prefetch = true;
+}
+
+BENCHMARK(ReorgParallelReads);
+BENCHMARK(ReorgSerialReads);
@@ -832,6 +832,25 @@ bool CBLSWorker::IsAsyncVerifyInProgress()
     return sigVerifyBatchesInProgress != 0;
 }
 
+std::future<bool> CBLSWorker::AsyncVerifySecureAggregated(const CBLSSignature& sig, const BLSPublicKeyVector& pubKeys, const uint256& msgHash)
+{
+    if (!sig.IsValid() || pubKeys.empty()) {
+        auto p = BuildFutureDoneCallback<bool>();
+        p.first(false);
+        return std::move(p.second);
+    }
+
+    auto f = [sig, pubKeys, msgHash](int threadId) {
+        return sig.VerifySecureAggregated(pubKeys, msgHash);
+    };
+    return workerPool.push(f);
+}
+
+bool CBLSWorker::IsStarted()
+{
+    return workerPool.size() != 0;
+}
+
 // sigVerifyMutex must be held while calling
 void CBLSWorker::PushSigVerifyBatch()
 {
@@ -129,6 +129,13 @@ public:
     std::future<bool> AsyncVerifySig(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash, CancelCond cancelCond = [] { return false; });
     bool IsAsyncVerifyInProgress();
 
+    // Verifies a signature against a set of public keys that are aggregated in the secure way (e.g. the members
+    // signature of a final commitment). Each call is a single job on the worker pool
+    std::future<bool> AsyncVerifySecureAggregated(const CBLSSignature& sig, const BLSPublicKeyVector& pubKeys, const uint256& msgHash);
+
+    // The async functions above only make progress after Start() was called
+    bool IsStarted();
+
 private:
     void PushSigVerifyBatch();
 };
@@ -352,6 +352,9 @@ public:
             }
         };
 
+        // No snapshots of mainnet have been published yet, see doc/snapshots.md for how to pin one
+        m_snapshot_hashes = {};
+
         chainTxData = ChainTxData{
             1656979667, // * UNIX timestamp of last known number of transactions (Block 1884)
             2785,   // * total number of transactions between genesis and that timestamp
@@ -552,6 +555,9 @@ public:
             }
         };
 
+        // No snapshots of testnet have been published yet, see doc/snapshots.md for how to pin one
+        m_snapshot_hashes = {};
+
         chainTxData = ChainTxData{
             1655239440, // * UNIX timestamp of last known number of transactions (Block 477483)
             0,    // * total number of transactions between genesis and that timestamp
@@ -761,6 +767,9 @@ public:
             }
         };
 
+        // Snapshots of devnets are only trusted through -loadsnapshothash
+        m_snapshot_hashes = {};
+
         chainTxData = ChainTxData{
             devnetGenesis.GetBlockTime(), // * UNIX timestamp of devnet genesis block
             2,                            // * we only have 2 coinbase transactions when a devnet is started up
@@ -975,6 +984,9 @@ public:
             }
         };
 
+        // Snapshots of regtest chains are only trusted through -loadsnapshothash
+        m_snapshot_hashes = {};
+
         chainTxData = ChainTxData{
             0,
             0,
@@ -26,6 +26,9 @@ struct CCheckpointData {
     MapCheckpoints mapCheckpoints;
 };
 
+/** Hashes of dumpsnapshot files, by the height of their base block */
+typedef std::map<int, uint256> MapSnapshotHashes;
+
 /**
  * Holds various statistics on transactions within a chain. Used to estimate
  * verification progress during chain sync.
@@ -95,6 +98,8 @@ public:
     int ExtCoinType() const { return nExtCoinType; }
     const std::vector<SeedSpec6>& FixedSeeds() const { return vFixedSeeds; }
     const CCheckpointData& Checkpoints() const { return checkpointData; }
+    /** Snapshot files that -loadsnapshot trusts without -loadsnapshothash */
+    const MapSnapshotHashes& SnapshotHashes() const { return m_snapshot_hashes; }
     const ChainTxData& TxData() const { return chainTxData; }
     void UpdateDIP3Parameters(int nActivationHeight, int nEnforcementHeight);
     void UpdateDIP8Parameters(int nActivationHeight);
@@ -138,6 +143,7 @@ protected:
     bool miningRequiresPeers;
     int nLLMQConnectionRetryTimeout;
     CCheckpointData checkpointData;
+    MapSnapshotHashes m_snapshot_hashes;
     ChainTxData chainTxData;
     int nPoolMinParticipants;
     int nPoolMaxParticipants;
@@ -138,8 +138,8 @@ public:
     {
     }
 
-    //! Create a pool of new worker threads.
-    void StartWorkerThreads(const int threads_num)
+    //! Create a pool of new worker threads, named <thread_name>.<n>.
+    void StartWorkerThreads(const int threads_num, const std::string& thread_name = "scriptch")
     {
         {
             LOCK(m_mutex);
@@ -149,8 +149,8 @@ public:
         }
         assert(m_worker_threads.empty());
         for (int n = 0; n < threads_num; ++n) {
-            m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
+            m_worker_threads.emplace_back([this, n, thread_name]() {
+                util::ThreadRename(strprintf("%s.%i", thread_name, n));
                 Loop(false /* worker thread */);
             });
         }
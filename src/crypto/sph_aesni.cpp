@@ -0,0 +1,303 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// AES-NI implementations of the AES based sph hashes (ECHO-512, SHAvite-512
+// and Groestl-512), specialised for 64 byte inputs. Each function computes
+// exactly what the corresponding sph_*512 init/update/close sequence computes,
+// with the table based AES rounds replaced by AESENC/AESENCLAST.
+
+#ifdef ENABLE_AESNI
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+namespace sph_aesni {
+namespace {
+
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline Xor(__m128i x, __m128i y, __m128i z) { return Xor(Xor(x, y), z); }
+__m128i inline Load(const unsigned char* in) { return _mm_loadu_si128((const __m128i*)in); }
+void inline Store(unsigned char* out, __m128i x) { _mm_storeu_si128((__m128i*)out, x); }
+
+/** Multiply every byte by x in GF(2^8) with the AES polynomial. */
+__m128i inline XTime(__m128i x)
+{
+    const __m128i carry = _mm_and_si128(_mm_cmpgt_epi8(_mm_setzero_si128(), x), _mm_set1_epi8(0x1b));
+    return Xor(_mm_add_epi8(x, x), carry);
+}
+
+/* ----------- ECHO-512 ------------------------------------------------------ */
+
+void inline EchoMixColumn(__m128i* w, int ia, int ib, int ic, int id)
+{
+    const __m128i a = w[ia], b = w[ib], c = w[ic], d = w[id];
+    const __m128i ab = Xor(a, b), bc = Xor(b, c), cd = Xor(c, d);
+    const __m128i abx = XTime(ab), bcx = XTime(bc), cdx = XTime(cd);
+    w[ia] = Xor(abx, bc, d);
+    w[ib] = Xor(bcx, a, cd);
+    w[ic] = Xor(cdx, ab, d);
+    w[id] = Xor(Xor(abx, bcx), Xor(cdx, ab, c));
+}
+
+/* ----------- SHAvite-512 --------------------------------------------------- */
+
+const uint32_t SHAVITE_IV[16] = {
+    0x72FCCDD8, 0x79CA4727, 0x128A077B, 0x40D55AEC,
+    0xD1901A06, 0x430AE307, 0xB29F5CD1, 0xDF07FBFC,
+    0x8E45D73D, 0x681AB538, 0xBDE86578, 0xDD577E47,
+    0xE275EADE, 0x502D9FCD, 0xB9357178, 0x022A4B9A
+};
+
+/** Four AES rounds keyed by consecutive round keys, as C512_ELT does them. */
+__m128i inline ShaviteF(__m128i x, const __m128i* rk)
+{
+    x = _mm_aesenc_si128(Xor(x, rk[0]), rk[1]);
+    x = _mm_aesenc_si128(x, rk[2]);
+    x = _mm_aesenc_si128(x, rk[3]);
+    return _mm_aesenc_si128(x, _mm_setzero_si128());
+}
+
+/* ----------- Groestl-512 --------------------------------------------------- */
+
+/*
+ * The Groestl state is kept as eight rows of sixteen bytes, so that MixBytes
+ * only combines whole registers. SubBytes uses AESENCLAST with a zero key,
+ * whose ShiftRows step is undone in advance by the same byte shuffle that
+ * implements ShiftBytes.
+ */
+
+/*
+ * pshufb masks that rotate row i left by its ShiftBytes offset and then apply
+ * AES InvShiftRows, for the P and the Q permutation. Byte j of the mask for a
+ * rotation by s is (4 * ((j / 4 - j % 4) mod 4) + j % 4 + s) mod 16.
+ */
+alignas(16) const uint8_t GROESTL_MASK_P[8][16] = {
+    {0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03},
+    {0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04},
+    {0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05},
+    {0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06},
+    {0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07},
+    {0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08},
+    {0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09},
+    {0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e},
+};
+
+alignas(16) const uint8_t GROESTL_MASK_Q[8][16] = {
+    {0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04},
+    {0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06},
+    {0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08},
+    {0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e},
+    {0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03},
+    {0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05},
+    {0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09, 0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07},
+    {0x06, 0x03, 0x00, 0x0d, 0x0a, 0x07, 0x04, 0x01, 0x0e, 0x0b, 0x08, 0x05, 0x02, 0x0f, 0x0c, 0x09},
+};
+
+/** SubBytes and ShiftBytes of all eight rows. */
+void inline __attribute__((always_inline)) GroestlSubShift(__m128i* a, const uint8_t (*mask)[16])
+{
+    const __m128i zero = _mm_setzero_si128();
+    for (int i = 0; i < 8; i++) {
+        a[i] = _mm_aesenclast_si128(_mm_shuffle_epi8(a[i], _mm_load_si128((const __m128i*)mask[i])), zero);
+    }
+}
+
+/**
+ * MixBytes with the circulant matrix (02 02 03 04 05 03 05 07), written as
+ * b_i = 02 * (x_i + 02 * y_i) + z_i over pairwise sums t_i = a_i + a_{i+1}.
+ */
+void inline __attribute__((always_inline)) GroestlMixRow(__m128i* b, const __m128i* a, const __m128i* t, int i)
+{
+    const __m128i x = Xor(Xor(t[i], a[(i + 2) & 7]), Xor(a[(i + 5) & 7], a[(i + 7) & 7]));
+    const __m128i y = Xor(t[(i + 3) & 7], t[(i + 6) & 7]);
+    const __m128i z = Xor(a[(i + 2) & 7], t[(i + 4) & 7], t[(i + 6) & 7]);
+    b[i] = Xor(XTime(Xor(x, XTime(y))), z);
+}
+
+void inline __attribute__((always_inline)) GroestlMixBytes(__m128i* a)
+{
+    __m128i t[8], b[8];
+    t[0] = Xor(a[0], a[1]);
+    t[1] = Xor(a[1], a[2]);
+    t[2] = Xor(a[2], a[3]);
+    t[3] = Xor(a[3], a[4]);
+    t[4] = Xor(a[4], a[5]);
+    t[5] = Xor(a[5], a[6]);
+    t[6] = Xor(a[6], a[7]);
+    t[7] = Xor(a[7], a[0]);
+    GroestlMixRow(b, a, t, 0);
+    GroestlMixRow(b, a, t, 1);
+    GroestlMixRow(b, a, t, 2);
+    GroestlMixRow(b, a, t, 3);
+    GroestlMixRow(b, a, t, 4);
+    GroestlMixRow(b, a, t, 5);
+    GroestlMixRow(b, a, t, 6);
+    GroestlMixRow(b, a, t, 7);
+    a[0] = b[0]; a[1] = b[1]; a[2] = b[2]; a[3] = b[3];
+    a[4] = b[4]; a[5] = b[5]; a[6] = b[6]; a[7] = b[7];
+}
+
+/** Run the P permutation on p and, if Q is set, the Q permutation on q, interleaved. */
+template <bool Q>
+void GroestlPerm(__m128i* p, __m128i* q)
+{
+    const __m128i ones = _mm_set1_epi8((char)0xff);
+    const __m128i columns = _mm_setr_epi8(0x00, 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70,
+        (char)0x80, (char)0x90, (char)0xa0, (char)0xb0, (char)0xc0, (char)0xd0, (char)0xe0, (char)0xf0);
+
+    for (int r = 0; r < 14; r++) {
+        const __m128i rc = Xor(columns, _mm_set1_epi8((char)r));
+        p[0] = Xor(p[0], rc);
+        GroestlSubShift(p, GROESTL_MASK_P);
+        GroestlMixBytes(p);
+        if (Q) {
+            for (int i = 0; i < 7; i++) {
+                q[i] = Xor(q[i], ones);
+            }
+            q[7] = Xor(q[7], Xor(rc, ones));
+            GroestlSubShift(q, GROESTL_MASK_Q);
+            GroestlMixBytes(q);
+        }
+    }
+}
+
+} // namespace
+
+void Echo512(unsigned char* out, const unsigned char* in)
+{
+    alignas(16) unsigned char buf[128] = {0};
+    memcpy(buf, in, 64);
+    buf[64] = 0x80;
+    buf[110] = 0x00;
+    buf[111] = 0x02;
+    buf[112] = 0x00;
+    buf[113] = 0x02;
+
+    __m128i v[8], w[16];
+    for (int i = 0; i < 8; i++) {
+        v[i] = _mm_set_epi64x(0, 512);
+        w[i] = v[i];
+        w[i + 8] = Load(buf + 16 * i);
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t k = 512;
+    for (int r = 0; r < 10; r++) {
+        for (int n = 0; n < 16; n++) {
+            w[n] = _mm_aesenc_si128(_mm_aesenc_si128(w[n], _mm_set_epi32(0, 0, 0, k++)), zero);
+        }
+        __m128i t = w[1];
+        w[1] = w[5]; w[5] = w[9]; w[9] = w[13]; w[13] = t;
+        t = w[2]; w[2] = w[10]; w[10] = t;
+        t = w[6]; w[6] = w[14]; w[14] = t;
+        t = w[15]; w[15] = w[11]; w[11] = w[7]; w[7] = w[3]; w[3] = t;
+        EchoMixColumn(w, 0, 1, 2, 3);
+        EchoMixColumn(w, 4, 5, 6, 7);
+        EchoMixColumn(w, 8, 9, 10, 11);
+        EchoMixColumn(w, 12, 13, 14, 15);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        Store(out + 16 * i, Xor(Xor(v[i], Load(buf + 16 * i)), Xor(w[i], w[i + 8])));
+    }
+}
+
+void Shavite512(unsigned char* out, const unsigned char* in)
+{
+    alignas(16) unsigned char buf[128] = {0};
+    memcpy(buf, in, 64);
+    buf[64] = 0x80;
+    buf[111] = 0x02; // bit count 512, little endian at offset 110
+    buf[127] = 0x02; // digest size 512 >> 8, the low byte is truncated to zero
+
+    /* Key schedule, 448 32-bit words held as 112 four-word vectors */
+    __m128i rk[112];
+    for (int i = 0; i < 8; i++) {
+        rk[i] = Load(buf + 16 * i);
+    }
+    const __m128i zero = _mm_setzero_si128();
+    int u = 8;
+    for (;;) {
+        for (int s = 0; s < 8; s++, u++) {
+            rk[u] = Xor(_mm_aesenc_si128(_mm_shuffle_epi32(rk[u - 8], 0x39), zero), rk[u - 1]);
+            switch (u) {
+            case 8: rk[u] = Xor(rk[u], _mm_setr_epi32(512, 0, 0, -1)); break;
+            case 41: rk[u] = Xor(rk[u], _mm_setr_epi32(0, 0, 0, ~512)); break;
+            case 79: rk[u] = Xor(rk[u], _mm_setr_epi32(0, 0, 512, -1)); break;
+            case 110: rk[u] = Xor(rk[u], _mm_setr_epi32(0, 512, 0, -1)); break;
+            }
+        }
+        if (u == 112) break;
+        for (int s = 0; s < 8; s++, u++) {
+            /* Words u - 7 onwards: the top three words of rk[u - 2] and the bottom one of rk[u - 1] */
+            const __m128i r7 = _mm_alignr_epi8(rk[u - 1], rk[u - 2], 4);
+            rk[u] = Xor(rk[u - 8], r7);
+        }
+    }
+
+    __m128i h[4], p[4];
+    for (int i = 0; i < 4; i++) {
+        h[i] = _mm_loadu_si128((const __m128i*)&SHAVITE_IV[4 * i]);
+        p[i] = h[i];
+    }
+    const __m128i* k = rk;
+    for (int r = 0; r < 14; r++) {
+        p[0] = Xor(p[0], ShaviteF(p[1], k));
+        p[2] = Xor(p[2], ShaviteF(p[3], k + 4));
+        k += 8;
+        const __m128i t = p[3];
+        p[3] = p[2];
+        p[2] = p[1];
+        p[1] = p[0];
+        p[0] = t;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        Store(out + 16 * i, Xor(h[i], p[i]));
+    }
+}
+
+void Groestl512(unsigned char* out, const unsigned char* in)
+{
+    /* Row r holds byte r of every column; the padded block is the input, 0x80 and a block count of 1 */
+    alignas(16) unsigned char rows[8][16] = {{0}};
+    for (int c = 0; c < 8; c++) {
+        for (int r = 0; r < 8; r++) {
+            rows[r][c] = in[8 * c + r];
+        }
+    }
+    rows[0][8] = 0x80;
+    rows[7][15] = 0x01;
+
+    __m128i h[8], m[8], g[8];
+    for (int r = 0; r < 8; r++) {
+        h[r] = _mm_setzero_si128();
+        m[r] = _mm_load_si128((const __m128i*)rows[r]);
+    }
+    h[6] = _mm_insert_epi16(h[6], 0x0200, 7); // digest size 512, big endian at the end of the IV
+    for (int r = 0; r < 8; r++) {
+        g[r] = Xor(h[r], m[r]);
+    }
+    GroestlPerm<true>(g, m);
+    for (int r = 0; r < 8; r++) {
+        h[r] = Xor(h[r], g[r], m[r]);
+        g[r] = h[r];
+    }
+
+    /* Output transformation */
+    GroestlPerm<false>(g, nullptr);
+    for (int r = 0; r < 8; r++) {
+        _mm_store_si128((__m128i*)rows[r], Xor(g[r], h[r]));
+    }
+    for (int c = 8; c < 16; c++) {
+        for (int r = 0; r < 8; r++) {
+            out[8 * (c - 8) + r] = rows[r][c];
+        }
+    }
+}
+
+} // namespace sph_aesni
+
+#endif // ENABLE_AESNI
@@ -0,0 +1,718 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// 4-way AVX2 implementations of the 512 bit sph hashes built on 64 bit words,
+// specialised for 64 byte inputs. Lane k of every vector belongs to the k-th
+// input, and each function computes exactly what the corresponding sph_*512
+// init/update/close sequence computes for each of the four inputs.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/common.h>
+
+namespace sph_avx2 {
+namespace {
+
+__m256i inline K(uint64_t x) { return _mm256_set1_epi64x(x); }
+
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi64(x, y); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z) { return Add(Add(x, y), z); }
+__m256i inline Sub(__m256i x, __m256i y) { return _mm256_sub_epi64(x, y); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Xor(__m256i x, __m256i y, __m256i z) { return Xor(Xor(x, y), z); }
+__m256i inline Or(__m256i x, __m256i y) { return _mm256_or_si256(x, y); }
+__m256i inline And(__m256i x, __m256i y) { return _mm256_and_si256(x, y); }
+/** ~x & y */
+__m256i inline AndNot(__m256i x, __m256i y) { return _mm256_andnot_si256(x, y); }
+__m256i inline Not(__m256i x) { return Xor(x, K(~uint64_t{0})); }
+__m256i inline ShR(__m256i x, int n) { return _mm256_srli_epi64(x, n); }
+__m256i inline ShL(__m256i x, int n) { return _mm256_slli_epi64(x, n); }
+__m256i inline RotL(__m256i x, int n) { return Or(ShL(x, n), ShR(x, 64 - n)); }
+__m256i inline RotR(__m256i x, int n) { return Or(ShR(x, n), ShL(x, 64 - n)); }
+
+/** Word i of each of four consecutive 64 byte inputs. */
+__m256i inline LoadLE(const unsigned char* in, int i)
+{
+    return _mm256_set_epi64x(ReadLE64(in + 192 + 8 * i), ReadLE64(in + 128 + 8 * i), ReadLE64(in + 64 + 8 * i), ReadLE64(in + 8 * i));
+}
+
+__m256i inline LoadBE(const unsigned char* in, int i)
+{
+    return _mm256_set_epi64x(ReadBE64(in + 192 + 8 * i), ReadBE64(in + 128 + 8 * i), ReadBE64(in + 64 + 8 * i), ReadBE64(in + 8 * i));
+}
+
+void inline StoreLE(unsigned char* out, int i, __m256i v)
+{
+    alignas(32) uint64_t w[4];
+    _mm256_store_si256((__m256i*)w, v);
+    WriteLE64(out + 8 * i, w[0]);
+    WriteLE64(out + 64 + 8 * i, w[1]);
+    WriteLE64(out + 128 + 8 * i, w[2]);
+    WriteLE64(out + 192 + 8 * i, w[3]);
+}
+
+void inline StoreBE(unsigned char* out, int i, __m256i v)
+{
+    alignas(32) uint64_t w[4];
+    _mm256_store_si256((__m256i*)w, v);
+    WriteBE64(out + 8 * i, w[0]);
+    WriteBE64(out + 64 + 8 * i, w[1]);
+    WriteBE64(out + 128 + 8 * i, w[2]);
+    WriteBE64(out + 192 + 8 * i, w[3]);
+}
+
+/* ----------- BLAKE-512 ----------------------------------------------------- */
+
+const uint64_t BLAKE_IV[8] = {
+    0x6A09E667F3BCC908, 0xBB67AE8584CAA73B,
+    0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+    0x510E527FADE682D1, 0x9B05688C2B3E6C1F,
+    0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179
+};
+
+const uint64_t BLAKE_C[16] = {
+    0x243F6A8885A308D3, 0x13198A2E03707344,
+    0xA4093822299F31D0, 0x082EFA98EC4E6C89,
+    0x452821E638D01377, 0xBE5466CF34E90C6C,
+    0xC0AC29B7C97C50DD, 0x3F84D5B5B5470917,
+    0x9216D5D98979FB1B, 0xD1310BA698DFB5AC,
+    0x2FFD72DBD01ADFB7, 0xB8E1AFED6A267E96,
+    0xBA7C9045F12C7F99, 0x24A19947B3916CF7,
+    0x0801F2E2858EFC16, 0x636920D871574E69
+};
+
+const uint8_t BLAKE_SIGMA[10][16] = {
+    { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+    {14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3},
+    {11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4},
+    { 7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8},
+    { 9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13},
+    { 2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9},
+    {12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11},
+    {13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10},
+    { 6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5},
+    {10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0}
+};
+
+void inline __attribute__((always_inline)) BlakeG(__m256i* v, const __m256i* m, const uint8_t* s, int i, int a, int b, int c, int d)
+{
+    v[a] = Add(v[a], v[b], Xor(m[s[2 * i]], K(BLAKE_C[s[2 * i + 1]])));
+    v[d] = RotR(Xor(v[d], v[a]), 32);
+    v[c] = Add(v[c], v[d]);
+    v[b] = RotR(Xor(v[b], v[c]), 25);
+    v[a] = Add(v[a], v[b], Xor(m[s[2 * i + 1]], K(BLAKE_C[s[2 * i]])));
+    v[d] = RotR(Xor(v[d], v[a]), 16);
+    v[c] = Add(v[c], v[d]);
+    v[b] = RotR(Xor(v[b], v[c]), 11);
+}
+
+/* ----------- BMW-512 ------------------------------------------------------- */
+
+const uint64_t BMW_IV[16] = {
+    0x8081828384858687, 0x88898A8B8C8D8E8F,
+    0x9091929394959697, 0x98999A9B9C9D9E9F,
+    0xA0A1A2A3A4A5A6A7, 0xA8A9AAABACADAEAF,
+    0xB0B1B2B3B4B5B6B7, 0xB8B9BABBBCBDBEBF,
+    0xC0C1C2C3C4C5C6C7, 0xC8C9CACBCCCDCECF,
+    0xD0D1D2D3D4D5D6D7, 0xD8D9DADBDCDDDEDF,
+    0xE0E1E2E3E4E5E6E7, 0xE8E9EAEBECEDEEEF,
+    0xF0F1F2F3F4F5F6F7, 0xF8F9FAFBFCFDFEFF
+};
+
+__m256i inline sb0(__m256i x) { return Xor(Xor(ShR(x, 1), ShL(x, 3)), Xor(RotL(x, 4), RotL(x, 37))); }
+__m256i inline sb1(__m256i x) { return Xor(Xor(ShR(x, 1), ShL(x, 2)), Xor(RotL(x, 13), RotL(x, 43))); }
+__m256i inline sb2(__m256i x) { return Xor(Xor(ShR(x, 2), ShL(x, 1)), Xor(RotL(x, 19), RotL(x, 53))); }
+__m256i inline sb3(__m256i x) { return Xor(Xor(ShR(x, 2), ShL(x, 2)), Xor(RotL(x, 28), RotL(x, 59))); }
+__m256i inline sb4(__m256i x) { return Xor(ShR(x, 1), x); }
+__m256i inline sb5(__m256i x) { return Xor(ShR(x, 2), x); }
+
+__m256i inline BmwAddElt(const __m256i* m, const __m256i* h, int j)
+{
+    const int j0 = j & 15, j3 = (j + 3) & 15, j10 = (j + 10) & 15;
+    return Xor(Add(Sub(Add(RotL(m[j0], j0 + 1), RotL(m[j3], j3 + 1)), RotL(m[j10], j10 + 1)), K((uint64_t)(j + 16) * 0x0555555555555555)), h[(j + 7) & 15]);
+}
+
+void BmwCompress(const __m256i* m, const __m256i* h, __m256i* dh)
+{
+    __m256i w[16], q[32];
+    __m256i mh[16];
+    for (int i = 0; i < 16; i++) {
+        mh[i] = Xor(m[i], h[i]);
+    }
+    w[0] = Add(Add(Sub(mh[5], mh[7]), mh[10]), Add(mh[13], mh[14]));
+    w[1] = Sub(Add(Add(Sub(mh[6], mh[8]), mh[11]), mh[14]), mh[15]);
+    w[2] = Add(Sub(Add(Add(mh[0], mh[7]), mh[9]), mh[12]), mh[15]);
+    w[3] = Add(Sub(Add(Sub(mh[0], mh[1]), mh[8]), mh[10]), mh[13]);
+    w[4] = Sub(Sub(Add(Add(mh[1], mh[2]), mh[9]), mh[11]), mh[14]);
+    w[5] = Add(Sub(Add(Sub(mh[3], mh[2]), mh[10]), mh[12]), mh[15]);
+    w[6] = Add(Sub(Sub(Sub(mh[4], mh[0]), mh[3]), mh[11]), mh[13]);
+    w[7] = Sub(Sub(Sub(Sub(mh[1], mh[4]), mh[5]), mh[12]), mh[14]);
+    w[8] = Sub(Add(Sub(Sub(mh[2], mh[5]), mh[6]), mh[13]), mh[15]);
+    w[9] = Add(Sub(Add(Sub(mh[0], mh[3]), mh[6]), mh[7]), mh[14]);
+    w[10] = Add(Sub(Sub(Sub(mh[8], mh[1]), mh[4]), mh[7]), mh[15]);
+    w[11] = Add(Sub(Sub(Sub(mh[8], mh[0]), mh[2]), mh[5]), mh[9]);
+    w[12] = Add(Sub(Sub(Add(mh[1], mh[3]), mh[6]), mh[9]), mh[10]);
+    w[13] = Add(Add(Add(Add(mh[2], mh[4]), mh[7]), mh[10]), mh[11]);
+    w[14] = Sub(Sub(Add(Sub(mh[3], mh[5]), mh[8]), mh[11]), mh[12]);
+    w[15] = Add(Sub(Sub(Sub(mh[12], mh[4]), mh[6]), mh[9]), mh[13]);
+
+    for (int j = 0; j < 15; j += 5) {
+        q[j + 0] = Add(sb0(w[j + 0]), h[j + 1]);
+        q[j + 1] = Add(sb1(w[j + 1]), h[j + 2]);
+        q[j + 2] = Add(sb2(w[j + 2]), h[j + 3]);
+        q[j + 3] = Add(sb3(w[j + 3]), h[j + 4]);
+        q[j + 4] = Add(sb4(w[j + 4]), h[j + 5]);
+    }
+    q[15] = Add(sb0(w[15]), h[0]);
+
+    for (int i = 16; i < 18; i++) {
+        __m256i sum = BmwAddElt(m, h, i - 16);
+        for (int k = 0; k < 16; k += 4) {
+            sum = Add(sum, Add(Add(sb1(q[i - 16 + k]), sb2(q[i - 15 + k])), Add(sb3(q[i - 14 + k]), sb0(q[i - 13 + k]))));
+        }
+        q[i] = sum;
+    }
+    for (int i = 18; i < 32; i++) {
+        __m256i sum = BmwAddElt(m, h, i - 16);
+        sum = Add(sum, Add(Add(q[i - 16], RotL(q[i - 15], 5)), Add(q[i - 14], RotL(q[i - 13], 11))));
+        sum = Add(sum, Add(Add(q[i - 12], RotL(q[i - 11], 27)), Add(q[i - 10], RotL(q[i - 9], 32))));
+        sum = Add(sum, Add(Add(q[i - 8], RotL(q[i - 7], 37)), Add(q[i - 6], RotL(q[i - 5], 43))));
+        sum = Add(sum, Add(Add(q[i - 4], RotL(q[i - 3], 53)), Add(sb4(q[i - 2]), sb5(q[i - 1]))));
+        q[i] = sum;
+    }
+
+    const __m256i xl = Xor(Xor(Xor(q[16], q[17]), Xor(q[18], q[19])), Xor(Xor(q[20], q[21]), Xor(q[22], q[23])));
+    const __m256i xh = Xor(xl, Xor(Xor(Xor(q[24], q[25]), Xor(q[26], q[27])), Xor(Xor(q[28], q[29]), Xor(q[30], q[31]))));
+    dh[0] = Add(Xor(ShL(xh, 5), ShR(q[16], 5), m[0]), Xor(xl, q[24], q[0]));
+    dh[1] = Add(Xor(ShR(xh, 7), ShL(q[17], 8), m[1]), Xor(xl, q[25], q[1]));
+    dh[2] = Add(Xor(ShR(xh, 5), ShL(q[18], 5), m[2]), Xor(xl, q[26], q[2]));
+    dh[3] = Add(Xor(ShR(xh, 1), ShL(q[19], 5), m[3]), Xor(xl, q[27], q[3]));
+    dh[4] = Add(Xor(ShR(xh, 3), q[20], m[4]), Xor(xl, q[28], q[4]));
+    dh[5] = Add(Xor(ShL(xh, 6), ShR(q[21], 6), m[5]), Xor(xl, q[29], q[5]));
+    dh[6] = Add(Xor(ShR(xh, 4), ShL(q[22], 6), m[6]), Xor(xl, q[30], q[6]));
+    dh[7] = Add(Xor(ShR(xh, 11), ShL(q[23], 2), m[7]), Xor(xl, q[31], q[7]));
+    dh[8] = Add(RotL(dh[4], 9), Xor(xh, q[24], m[8]), Xor(ShL(xl, 8), q[23], q[8]));
+    dh[9] = Add(RotL(dh[5], 10), Xor(xh, q[25], m[9]), Xor(ShR(xl, 6), q[16], q[9]));
+    dh[10] = Add(RotL(dh[6], 11), Xor(xh, q[26], m[10]), Xor(ShL(xl, 6), q[17], q[10]));
+    dh[11] = Add(RotL(dh[7], 12), Xor(xh, q[27], m[11]), Xor(ShL(xl, 4), q[18], q[11]));
+    dh[12] = Add(RotL(dh[0], 13), Xor(xh, q[28], m[12]), Xor(ShR(xl, 3), q[19], q[12]));
+    dh[13] = Add(RotL(dh[1], 14), Xor(xh, q[29], m[13]), Xor(ShR(xl, 4), q[20], q[13]));
+    dh[14] = Add(RotL(dh[2], 15), Xor(xh, q[30], m[14]), Xor(ShR(xl, 7), q[21], q[14]));
+    dh[15] = Add(RotL(dh[3], 16), Xor(xh, q[31], m[15]), Xor(ShR(xl, 2), q[22], q[15]));
+}
+
+/* ----------- JH-512 -------------------------------------------------------- */
+
+/** The sph tables hold JH constants as bytes; on little endian machines that is a byte swapped word */
+constexpr uint64_t C64e(uint64_t x)
+{
+    return ((x >> 56) & 0x00000000000000FF) | ((x >> 40) & 0x000000000000FF00) |
+           ((x >> 24) & 0x0000000000FF0000) | ((x >> 8) & 0x00000000FF000000) |
+           ((x << 8) & 0x000000FF00000000) | ((x << 24) & 0x0000FF0000000000) |
+           ((x << 40) & 0x00FF000000000000) | ((x << 56) & 0xFF00000000000000);
+}
+
+const uint64_t JH_IV[16] = {
+    C64e(0x6fd14b963e00aa17), C64e(0x636a2e057a15d543),
+    C64e(0x8a225e8d0c97ef0b), C64e(0xe9341259f2b3c361),
+    C64e(0x891da0c1536f801e), C64e(0x2aa9056bea2b6d80),
+    C64e(0x588eccdb2075baa6), C64e(0xa90f3a76baf83bf7),
+    C64e(0x0169e60541e34a69), C64e(0x46b58a8e2e6fe65a),
+    C64e(0x1047a7d0c1843c24), C64e(0x3b6e71b12d5ac199),
+    C64e(0xcf57f6ec9db1f856), C64e(0xa706887c5716b156),
+    C64e(0xe3c2fcdfe68517fb), C64e(0x545a4678cc8cdd4b)
+};
+
+const uint64_t JH_C[168] = {
+    C64e(0x72d5dea2df15f867), C64e(0x7b84150ab7231557),
+    C64e(0x81abd6904d5a87f6), C64e(0x4e9f4fc5c3d12b40),
+    C64e(0xea983ae05c45fa9c), C64e(0x03c5d29966b2999a),
+    C64e(0x660296b4f2bb538a), C64e(0xb556141a88dba231),
+    C64e(0x03a35a5c9a190edb), C64e(0x403fb20a87c14410),
+    C64e(0x1c051980849e951d), C64e(0x6f33ebad5ee7cddc),
+    C64e(0x10ba139202bf6b41), C64e(0xdc786515f7bb27d0),
+    C64e(0x0a2c813937aa7850), C64e(0x3f1abfd2410091d3),
+    C64e(0x422d5a0df6cc7e90), C64e(0xdd629f9c92c097ce),
+    C64e(0x185ca70bc72b44ac), C64e(0xd1df65d663c6fc23),
+    C64e(0x976e6c039ee0b81a), C64e(0x2105457e446ceca8),
+    C64e(0xeef103bb5d8e61fa), C64e(0xfd9697b294838197),
+    C64e(0x4a8e8537db03302f), C64e(0x2a678d2dfb9f6a95),
+    C64e(0x8afe7381f8b8696c), C64e(0x8ac77246c07f4214),
+    C64e(0xc5f4158fbdc75ec4), C64e(0x75446fa78f11bb80),
+    C64e(0x52de75b7aee488bc), C64e(0x82b8001e98a6a3f4),
+    C64e(0x8ef48f33a9a36315), C64e(0xaa5f5624d5b7f989),
+    C64e(0xb6f1ed207c5ae0fd), C64e(0x36cae95a06422c36),
+    C64e(0xce2935434efe983d), C64e(0x533af974739a4ba7),
+    C64e(0xd0f51f596f4e8186), C64e(0x0e9dad81afd85a9f),
+    C64e(0xa7050667ee34626a), C64e(0x8b0b28be6eb91727),
+    C64e(0x47740726c680103f), C64e(0xe0a07e6fc67e487b),
+    C64e(0x0d550aa54af8a4c0), C64e(0x91e3e79f978ef19e),
+    C64e(0x8676728150608dd4), C64e(0x7e9e5a41f3e5b062),
+    C64e(0xfc9f1fec4054207a), C64e(0xe3e41a00cef4c984),
+    C64e(0x4fd794f59dfa95d8), C64e(0x552e7e1124c354a5),
+    C64e(0x5bdf7228bdfe6e28), C64e(0x78f57fe20fa5c4b2),
+    C64e(0x05897cefee49d32e), C64e(0x447e9385eb28597f),
+    C64e(0x705f6937b324314a), C64e(0x5e8628f11dd6e465),
+    C64e(0xc71b770451b920e7), C64e(0x74fe43e823d4878a),
+    C64e(0x7d29e8a3927694f2), C64e(0xddcb7a099b30d9c1),
+    C64e(0x1d1b30fb5bdc1be0), C64e(0xda24494ff29c82bf),
+    C64e(0xa4e7ba31b470bfff), C64e(0x0d324405def8bc48),
+    C64e(0x3baefc3253bbd339), C64e(0x459fc3c1e0298ba0),
+    C64e(0xe5c905fdf7ae090f), C64e(0x947034124290f134),
+    C64e(0xa271b701e344ed95), C64e(0xe93b8e364f2f984a),
+    C64e(0x88401d63a06cf615), C64e(0x47c1444b8752afff),
+    C64e(0x7ebb4af1e20ac630), C64e(0x4670b6c5cc6e8ce6),
+    C64e(0xa4d5a456bd4fca00), C64e(0xda9d844bc83e18ae),
+    C64e(0x7357ce453064d1ad), C64e(0xe8a6ce68145c2567),
+    C64e(0xa3da8cf2cb0ee116), C64e(0x33e906589a94999a),
+    C64e(0x1f60b220c26f847b), C64e(0xd1ceac7fa0d18518),
+    C64e(0x32595ba18ddd19d3), C64e(0x509a1cc0aaa5b446),
+    C64e(0x9f3d6367e4046bba), C64e(0xf6ca19ab0b56ee7e),
+    C64e(0x1fb179eaa9282174), C64e(0xe9bdf7353b3651ee),
+    C64e(0x1d57ac5a7550d376), C64e(0x3a46c2fea37d7001),
+    C64e(0xf735c1af98a4d842), C64e(0x78edec209e6b6779),
+    C64e(0x41836315ea3adba8), C64e(0xfac33b4d32832c83),
+    C64e(0xa7403b1f1c2747f3), C64e(0x5940f034b72d769a),
+    C64e(0xe73e4e6cd2214ffd), C64e(0xb8fd8d39dc5759ef),
+    C64e(0x8d9b0c492b49ebda), C64e(0x5ba2d74968f3700d),
+    C64e(0x7d3baed07a8d5584), C64e(0xf5a5e9f0e4f88e65),
+    C64e(0xa0b8a2f436103b53), C64e(0x0ca8079e753eec5a),
+    C64e(0x9168949256e8884f), C64e(0x5bb05c55f8babc4c),
+    C64e(0xe3bb3b99f387947b), C64e(0x75daf4d6726b1c5d),
+    C64e(0x64aeac28dc34b36d), C64e(0x6c34a550b828db71),
+    C64e(0xf861e2f2108d512a), C64e(0xe3db643359dd75fc),
+    C64e(0x1cacbcf143ce3fa2), C64e(0x67bbd13c02e843b0),
+    C64e(0x330a5bca8829a175), C64e(0x7f34194db416535c),
+    C64e(0x923b94c30e794d1e), C64e(0x797475d7b6eeaf3f),
+    C64e(0xeaa8d4f7be1a3921), C64e(0x5cf47e094c232751),
+    C64e(0x26a32453ba323cd2), C64e(0x44a3174a6da6d5ad),
+    C64e(0xb51d3ea6aff2c908), C64e(0x83593d98916b3c56),
+    C64e(0x4cf87ca17286604d), C64e(0x46e23ecc086ec7f6),
+    C64e(0x2f9833b3b1bc765e), C64e(0x2bd666a5efc4e62a),
+    C64e(0x06f4b6e8bec1d436), C64e(0x74ee8215bcef2163),
+    C64e(0xfdc14e0df453c969), C64e(0xa77d5ac406585826),
+    C64e(0x7ec1141606e0fa16), C64e(0x7e90af3d28639d3f),
+    C64e(0xd2c9f2e3009bd20c), C64e(0x5faace30b7d40c30),
+    C64e(0x742a5116f2e03298), C64e(0x0deb30d8e3cef89a),
+    C64e(0x4bc59e7bb5f17992), C64e(0xff51e66e048668d3),
+    C64e(0x9b234d57e6966731), C64e(0xcce6a6f3170a7505),
+    C64e(0xb17681d913326cce), C64e(0x3c175284f805a262),
+    C64e(0xf42bcbb378471547), C64e(0xff46548223936a48),
+    C64e(0x38df58074e5e6565), C64e(0xf2fc7c89fc86508e),
+    C64e(0x31702e44d00bca86), C64e(0xf04009a23078474e),
+    C64e(0x65a0ee39d1f73883), C64e(0xf75ee937e42c3abd),
+    C64e(0x2197b2260113f86f), C64e(0xa344edd1ef9fdee7),
+    C64e(0x8ba0df15762592d9), C64e(0x3c85f7f612dc42be),
+    C64e(0xd8a7ec7cab27b07e), C64e(0x538d7ddaaa3ea8de),
+    C64e(0xaa25ce93bd0269d8), C64e(0x5af643fd1a7308f9),
+    C64e(0xc05fefda174a19a5), C64e(0x974d66334cfd216a),
+    C64e(0x35b49831db411570), C64e(0xea1e0fbbedcd549b),
+    C64e(0x9ad063a151974072), C64e(0xf6759dbf91476fe2)
+};
+
+void inline __attribute__((always_inline)) JhSb(__m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3, __m256i c)
+{
+    x3 = Not(x3);
+    x0 = Xor(x0, AndNot(x2, c));
+    const __m256i tmp = Xor(c, And(x0, x1));
+    x0 = Xor(x0, And(x2, x3));
+    x3 = Xor(x3, AndNot(x1, x2));
+    x1 = Xor(x1, And(x0, x2));
+    x2 = Xor(x2, AndNot(x3, x0));
+    x0 = Xor(x0, Or(x1, x3));
+    x3 = Xor(x3, And(x1, x2));
+    x1 = Xor(x1, And(tmp, x0));
+    x2 = Xor(x2, tmp);
+}
+
+void inline __attribute__((always_inline)) JhLb(__m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3, __m256i& x4, __m256i& x5, __m256i& x6, __m256i& x7)
+{
+    x4 = Xor(x4, x1);
+    x5 = Xor(x5, x2);
+    x6 = Xor(x6, x3, x0);
+    x7 = Xor(x7, x0);
+    x0 = Xor(x0, x5);
+    x1 = Xor(x1, x6);
+    x2 = Xor(x2, x7, x4);
+    x3 = Xor(x3, x4);
+}
+
+__m256i inline JhSwap(__m256i x, uint64_t c, int n) { return Or(And(ShR(x, n), K(c)), ShL(And(x, K(c)), n)); }
+
+/** The JH state as eight (high, low) pairs of words, in the same order as the sph code */
+void JhE8(__m256i h[8][2])
+{
+    for (int r = 0; r < 42; r++) {
+        for (int k = 0; k < 2; k++) {
+            JhSb(h[0][k], h[2][k], h[4][k], h[6][k], K(JH_C[4 * r + k]));
+            JhSb(h[1][k], h[3][k], h[5][k], h[7][k], K(JH_C[4 * r + 2 + k]));
+            JhLb(h[0][k], h[2][k], h[4][k], h[6][k], h[1][k], h[3][k], h[5][k], h[7][k]);
+        }
+        for (int i = 1; i < 8; i += 2) {
+            for (int k = 0; k < 2; k++) {
+                switch (r % 7) {
+                case 0: h[i][k] = JhSwap(h[i][k], 0x5555555555555555, 1); break;
+                case 1: h[i][k] = JhSwap(h[i][k], 0x3333333333333333, 2); break;
+                case 2: h[i][k] = JhSwap(h[i][k], 0x0F0F0F0F0F0F0F0F, 4); break;
+                case 3: h[i][k] = JhSwap(h[i][k], 0x00FF00FF00FF00FF, 8); break;
+                case 4: h[i][k] = JhSwap(h[i][k], 0x0000FFFF0000FFFF, 16); break;
+                case 5: h[i][k] = JhSwap(h[i][k], 0x00000000FFFFFFFF, 32); break;
+                }
+            }
+            if (r % 7 == 6) {
+                const __m256i t = h[i][0];
+                h[i][0] = h[i][1];
+                h[i][1] = t;
+            }
+        }
+    }
+}
+
+/** One JH block: the message is added to the first half of the state before E8 and to the second half after it */
+void JhBlock(__m256i h[8][2], const __m256i m[8])
+{
+    for (int i = 0; i < 8; i++) {
+        h[i / 2][i % 2] = Xor(h[i / 2][i % 2], m[i]);
+    }
+    JhE8(h);
+    for (int i = 0; i < 8; i++) {
+        h[4 + i / 2][i % 2] = Xor(h[4 + i / 2][i % 2], m[i]);
+    }
+}
+
+/* ----------- Keccak-512 ---------------------------------------------------- */
+
+const uint64_t KECCAK_RC[24] = {
+    0x0000000000000001, 0x0000000000008082,
+    0x800000000000808A, 0x8000000080008000,
+    0x000000000000808B, 0x0000000080000001,
+    0x8000000080008081, 0x8000000000008009,
+    0x000000000000008A, 0x0000000000000088,
+    0x0000000080008009, 0x000000008000000A,
+    0x000000008000808B, 0x800000000000008B,
+    0x8000000000008089, 0x8000000000008003,
+    0x8000000000008002, 0x8000000000000080,
+    0x000000000000800A, 0x800000008000000A,
+    0x8000000080008081, 0x8000000000008080,
+    0x0000000080000001, 0x8000000080008008
+};
+
+/** Rotation offsets of the rho step, by lane index x + 5 * y */
+const int KECCAK_RHO[25] = {
+     0,  1, 62, 28, 27,
+    36, 44,  6, 55, 20,
+     3, 10, 43, 25, 39,
+    41, 45, 15, 21,  8,
+    18,  2, 61, 56, 14
+};
+
+void KeccakF(__m256i a[25])
+{
+    __m256i b[25], c[5];
+    for (int round = 0; round < 24; round++) {
+        for (int x = 0; x < 5; x++) {
+            c[x] = Xor(Xor(a[x], a[x + 5]), Xor(a[x + 10], a[x + 15]), a[x + 20]);
+        }
+        for (int x = 0; x < 5; x++) {
+            const __m256i d = Xor(c[(x + 4) % 5], RotL(c[(x + 1) % 5], 1));
+            for (int y = 0; y < 25; y += 5) {
+                a[x + y] = Xor(a[x + y], d);
+            }
+        }
+        for (int x = 0; x < 5; x++) {
+            for (int y = 0; y < 5; y++) {
+                const int rho = KECCAK_RHO[x + 5 * y];
+                b[y + 5 * ((2 * x + 3 * y) % 5)] = rho ? RotL(a[x + 5 * y], rho) : a[x + 5 * y];
+            }
+        }
+        for (int y = 0; y < 25; y += 5) {
+            for (int x = 0; x < 5; x++) {
+                a[x + y] = Xor(b[x + y], AndNot(b[(x + 1) % 5 + y], b[(x + 2) % 5 + y]));
+            }
+        }
+        a[0] = Xor(a[0], K(KECCAK_RC[round]));
+    }
+}
+
+/* ----------- Skein-512 ----------------------------------------------------- */
+
+const uint64_t SKEIN_IV[8] = {
+    0x4903ADFF749C51CE, 0x0D95DE399746DF03,
+    0x8FD1934127C79BCE, 0x9A255629FF352CB1,
+    0x5DB62599DF6CA7B0, 0xEABE394CA9D5C3F4,
+    0x991112C71A75B523, 0xAE18A40B660FCC33
+};
+
+/** Threefish-512 rotation constants, four rounds of four mixes, for even and odd groups */
+const int SKEIN_R[2][4][4] = {
+    {{46, 36, 19, 37}, {33, 27, 14, 42}, {17, 49, 36, 39}, {44,  9, 54, 56}},
+    {{39, 30, 34, 24}, {13, 50, 10, 17}, {25, 29, 39, 43}, { 8, 35, 56, 22}}
+};
+
+/** Words mixed together in each of the four rounds of a group, in pairs */
+const int SKEIN_MIX[4][8] = {
+    {0, 1, 2, 3, 4, 5, 6, 7},
+    {2, 1, 4, 7, 6, 5, 0, 3},
+    {4, 1, 6, 3, 0, 5, 2, 7},
+    {6, 1, 0, 7, 2, 5, 4, 3}
+};
+
+/** One UBI block: Threefish-512 keyed with h and tweaked with (t0, t1) over m, fed forward with m */
+void SkeinUbi(__m256i h[8], const __m256i m[8], uint64_t t0, uint64_t t1)
+{
+    __m256i k[9], p[8];
+    const uint64_t t[3] = {t0, t1, t0 ^ t1};
+    k[8] = K(0x1BD11BDAA9FC1A22);
+    for (int i = 0; i < 8; i++) {
+        k[i] = h[i];
+        k[8] = Xor(k[8], h[i]);
+        p[i] = m[i];
+    }
+    for (int s = 0; s <= 18; s++) {
+        for (int i = 0; i < 8; i++) {
+            p[i] = Add(p[i], k[(s + i) % 9]);
+        }
+        p[5] = Add(p[5], K(t[s % 3]));
+        p[6] = Add(p[6], K(t[(s + 1) % 3]));
+        p[7] = Add(p[7], K(s));
+        if (s == 18) break;
+        for (int round = 0; round < 4; round++) {
+            for (int j = 0; j < 4; j++) {
+                __m256i& x0 = p[SKEIN_MIX[round][2 * j]];
+                __m256i& x1 = p[SKEIN_MIX[round][2 * j + 1]];
+                x0 = Add(x0, x1);
+                x1 = Xor(RotL(x1, SKEIN_R[s % 2][round][j]), x0);
+            }
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        h[i] = Xor(p[i], m[i]);
+    }
+}
+
+/* ----------- SHA-512 ------------------------------------------------------- */
+
+const uint64_t SHA512_IV[8] = {
+    0x6A09E667F3BCC908, 0xBB67AE8584CAA73B,
+    0x3C6EF372FE94F82B, 0xA54FF53A5F1D36F1,
+    0x510E527FADE682D1, 0x9B05688C2B3E6C1F,
+    0x1F83D9ABFB41BD6B, 0x5BE0CD19137E2179
+};
+
+const uint64_t SHA512_K[80] = {
+    0x428A2F98D728AE22, 0x7137449123EF65CD,
+    0xB5C0FBCFEC4D3B2F, 0xE9B5DBA58189DBBC,
+    0x3956C25BF348B538, 0x59F111F1B605D019,
+    0x923F82A4AF194F9B, 0xAB1C5ED5DA6D8118,
+    0xD807AA98A3030242, 0x12835B0145706FBE,
+    0x243185BE4EE4B28C, 0x550C7DC3D5FFB4E2,
+    0x72BE5D74F27B896F, 0x80DEB1FE3B1696B1,
+    0x9BDC06A725C71235, 0xC19BF174CF692694,
+    0xE49B69C19EF14AD2, 0xEFBE4786384F25E3,
+    0x0FC19DC68B8CD5B5, 0x240CA1CC77AC9C65,
+    0x2DE92C6F592B0275, 0x4A7484AA6EA6E483,
+    0x5CB0A9DCBD41FBD4, 0x76F988DA831153B5,
+    0x983E5152EE66DFAB, 0xA831C66D2DB43210,
+    0xB00327C898FB213F, 0xBF597FC7BEEF0EE4,
+    0xC6E00BF33DA88FC2, 0xD5A79147930AA725,
+    0x06CA6351E003826F, 0x142929670A0E6E70,
+    0x27B70A8546D22FFC, 0x2E1B21385C26C926,
+    0x4D2C6DFC5AC42AED, 0x53380D139D95B3DF,
+    0x650A73548BAF63DE, 0x766A0ABB3C77B2A8,
+    0x81C2C92E47EDAEE6, 0x92722C851482353B,
+    0xA2BFE8A14CF10364, 0xA81A664BBC423001,
+    0xC24B8B70D0F89791, 0xC76C51A30654BE30,
+    0xD192E819D6EF5218, 0xD69906245565A910,
+    0xF40E35855771202A, 0x106AA07032BBD1B8,
+    0x19A4C116B8D2D0C8, 0x1E376C085141AB53,
+    0x2748774CDF8EEB99, 0x34B0BCB5E19B48A8,
+    0x391C0CB3C5C95A63, 0x4ED8AA4AE3418ACB,
+    0x5B9CCA4F7763E373, 0x682E6FF3D6B2B8A3,
+    0x748F82EE5DEFB2FC, 0x78A5636F43172F60,
+    0x84C87814A1F0AB72, 0x8CC702081A6439EC,
+    0x90BEFFFA23631E28, 0xA4506CEBDE82BDE9,
+    0xBEF9A3F7B2C67915, 0xC67178F2E372532B,
+    0xCA273ECEEA26619C, 0xD186B8C721C0C207,
+    0xEADA7DD6CDE0EB1E, 0xF57D4F7FEE6ED178,
+    0x06F067AA72176FBA, 0x0A637DC5A2C898A6,
+    0x113F9804BEF90DAE, 0x1B710B35131C471B,
+    0x28DB77F523047D84, 0x32CAAB7B40C72493,
+    0x3C9EBE0A15C9BEBC, 0x431D67C49C100D4C,
+    0x4CC5D4BECB3E42B6, 0x597F299CFC657E2A,
+    0x5FCB6FAB3AD6FAEC, 0x6C44198C4A475817
+};
+
+__m256i inline Ch(__m256i x, __m256i y, __m256i z) { return Xor(z, And(x, Xor(y, z))); }
+__m256i inline Maj(__m256i x, __m256i y, __m256i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__m256i inline Sigma0(__m256i x) { return Xor(RotR(x, 28), RotR(x, 34), RotR(x, 39)); }
+__m256i inline Sigma1(__m256i x) { return Xor(RotR(x, 14), RotR(x, 18), RotR(x, 41)); }
+__m256i inline sigma0(__m256i x) { return Xor(RotR(x, 1), RotR(x, 8), ShR(x, 7)); }
+__m256i inline sigma1(__m256i x) { return Xor(RotR(x, 19), RotR(x, 61), ShR(x, 6)); }
+
+} // namespace
+
+void Blake512_4way(unsigned char* out, const unsigned char* in)
+{
+    __m256i m[16], v[16];
+    for (int i = 0; i < 8; i++) {
+        m[i] = LoadBE(in, i);
+        v[i] = K(BLAKE_IV[i]);
+    }
+    // Padding of a 512 bit message: a one bit, zeros, the final one bit of
+    // the 512 bit variant and the 128 bit message length.
+    m[8] = K(0x8000000000000000);
+    m[9] = m[10] = m[11] = m[12] = K(0);
+    m[13] = K(1);
+    m[14] = K(0);
+    m[15] = K(512);
+    for (int i = 0; i < 4; i++) {
+        v[8 + i] = K(BLAKE_C[i]);
+    }
+    v[12] = K(512 ^ BLAKE_C[4]);
+    v[13] = K(512 ^ BLAKE_C[5]);
+    v[14] = K(BLAKE_C[6]);
+    v[15] = K(BLAKE_C[7]);
+
+    for (int r = 0; r < 16; r++) {
+        const uint8_t* s = BLAKE_SIGMA[r % 10];
+        BlakeG(v, m, s, 0, 0, 4, 8, 12);
+        BlakeG(v, m, s, 1, 1, 5, 9, 13);
+        BlakeG(v, m, s, 2, 2, 6, 10, 14);
+        BlakeG(v, m, s, 3, 3, 7, 11, 15);
+        BlakeG(v, m, s, 4, 0, 5, 10, 15);
+        BlakeG(v, m, s, 5, 1, 6, 11, 12);
+        BlakeG(v, m, s, 6, 2, 7, 8, 13);
+        BlakeG(v, m, s, 7, 3, 4, 9, 14);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        StoreBE(out, i, Xor(K(BLAKE_IV[i]), v[i], v[i + 8]));
+    }
+}
+
+void Bmw512_4way(unsigned char* out, const unsigned char* in)
+{
+    __m256i m[16], h[16], h2[16];
+    for (int i = 0; i < 8; i++) {
+        m[i] = LoadLE(in, i);
+    }
+    m[8] = K(0x80);
+    for (int i = 9; i < 15; i++) {
+        m[i] = K(0);
+    }
+    m[15] = K(512);
+    for (int i = 0; i < 16; i++) {
+        h[i] = K(BMW_IV[i]);
+    }
+    BmwCompress(m, h, h2);
+
+    // Final compression, keyed with the constant 0xaaaaaaaaaaaaaaa0 + i
+    for (int i = 0; i < 16; i++) {
+        h[i] = K(0xaaaaaaaaaaaaaaa0 + i);
+    }
+    BmwCompress(h2, h, m);
+    for (int i = 0; i < 8; i++) {
+        StoreLE(out, i, m[8 + i]);
+    }
+}
+
+void Jh512_4way(unsigned char* out, const unsigned char* in)
+{
+    __m256i h[8][2], m[8];
+    for (int i = 0; i < 16; i++) {
+        h[i / 2][i % 2] = K(JH_IV[i]);
+    }
+    for (int i = 0; i < 8; i++) {
+        m[i] = LoadLE(in, i);
+    }
+    JhBlock(h, m);
+
+    // Padding block: a one bit, zeros and the big endian 128 bit message length
+    m[0] = K(0x80);
+    for (int i = 1; i < 7; i++) {
+        m[i] = K(0);
+    }
+    m[7] = K(0x0002000000000000);
+    JhBlock(h, m);
+
+    for (int i = 0; i < 8; i++) {
+        StoreLE(out, i, h[4 + i / 2][i % 2]);
+    }
+}
+
+void Keccak512_4way(unsigned char* out, const unsigned char* in)
+{
+    __m256i a[25];
+    for (int i = 0; i < 8; i++) {
+        a[i] = LoadLE(in, i);
+    }
+    // Keccak padding fills the 72 byte rate with 0x01, zeros, 0x80
+    a[8] = K(0x8000000000000001);
+    for (int i = 9; i < 25; i++) {
+        a[i] = K(0);
+    }
+    KeccakF(a);
+    for (int i = 0; i < 8; i++) {
+        StoreLE(out, i, a[i]);
+    }
+}
+
+void Skein512_4way(unsigned char* out, const unsigned char* in)
+{
+    __m256i h[8], m[8];
+    for (int i = 0; i < 8; i++) {
+        h[i] = K(SKEIN_IV[i]);
+        m[i] = LoadLE(in, i);
+    }
+    // Message block (first and final, 64 bytes), then the output block over a zero counter
+    SkeinUbi(h, m, 64, 0xF000000000000000);
+    for (int i = 0; i < 8; i++) {
+        m[i] = K(0);
+    }
+    SkeinUbi(h, m, 8, 0xFF00000000000000);
+    for (int i = 0; i < 8; i++) {
+        StoreLE(out, i, h[i]);
+    }
+}
+
+void Sha512_4way(unsigned char* out, const unsigned char* in)
+{
+    __m256i w[16], s[8];
+    for (int i = 0; i < 8; i++) {
+        w[i] = LoadBE(in, i);
+        s[i] = K(SHA512_IV[i]);
+    }
+    w[8] = K(0x8000000000000000);
+    for (int i = 9; i < 15; i++) {
+        w[i] = K(0);
+    }
+    w[15] = K(512);
+
+    for (int t = 0; t < 80; t++) {
+        if (t >= 16) {
+            w[t & 15] = Add(Add(w[t & 15], sigma0(w[(t + 1) & 15])), Add(w[(t + 9) & 15], sigma1(w[(t + 14) & 15])));
+        }
+        const __m256i t1 = Add(Add(s[7], Sigma1(s[4])), Add(Ch(s[4], s[5], s[6]), Add(K(SHA512_K[t]), w[t & 15])));
+        const __m256i t2 = Add(Sigma0(s[0]), Maj(s[0], s[1], s[2]));
+        s[7] = s[6];
+        s[6] = s[5];
+        s[5] = s[4];
+        s[4] = Add(s[3], t1);
+        s[3] = s[2];
+        s[2] = s[1];
+        s[1] = s[0];
+        s[0] = Add(t1, t2);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        StoreBE(out, i, Add(s[i], K(SHA512_IV[i])));
+    }
+}
+
+} // namespace sph_avx2
+
+#endif // ENABLE_AVX2
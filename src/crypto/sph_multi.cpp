@@ -0,0 +1,224 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/sph_multi.h>
+#include <crypto/common.h>
+
+#include <crypto/sph_blake.h>
+#include <crypto/sph_bmw.h>
+#include <crypto/sph_cubehash.h>
+#include <crypto/sph_echo.h>
+#include <crypto/sph_groestl.h>
+#include <crypto/sph_jh.h>
+#include <crypto/sph_keccak.h>
+#include <crypto/sph_luffa.h>
+#include <crypto/sph_shavite.h>
+#include <crypto/sph_simd.h>
+#include <crypto/sph_skein.h>
+extern "C" {
+#include <crypto/sph_sha2.h>
+}
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#if defined(USE_ASM)
+#include <cpuid.h>
+#endif
+#endif
+
+namespace sph_avx2
+{
+void Blake512_4way(unsigned char* out, const unsigned char* in);
+void Bmw512_4way(unsigned char* out, const unsigned char* in);
+void Jh512_4way(unsigned char* out, const unsigned char* in);
+void Keccak512_4way(unsigned char* out, const unsigned char* in);
+void Skein512_4way(unsigned char* out, const unsigned char* in);
+void Sha512_4way(unsigned char* out, const unsigned char* in);
+}
+
+namespace sph_aesni
+{
+void Groestl512(unsigned char* out, const unsigned char* in);
+void Shavite512(unsigned char* out, const unsigned char* in);
+void Echo512(unsigned char* out, const unsigned char* in);
+}
+
+// Internal implementation code.
+namespace
+{
+/** Number of sph hashes in SphAlgo */
+constexpr size_t SPH_HASHES = 12;
+
+typedef void (*TransformType)(unsigned char*, const unsigned char*);
+
+/** The portable sph implementation of a hash of 64 bytes. */
+template <typename Context, void (*Init)(void*), void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+void Standard(unsigned char* out, const unsigned char* in)
+{
+    Context ctx;
+    Init(&ctx);
+    Update(&ctx, in, 64);
+    Close(&ctx, out);
+}
+
+const TransformType STANDARD[SPH_HASHES] = {
+    Standard<sph_blake512_context, sph_blake512_init, sph_blake512, sph_blake512_close>,
+    Standard<sph_bmw512_context, sph_bmw512_init, sph_bmw512, sph_bmw512_close>,
+    Standard<sph_groestl512_context, sph_groestl512_init, sph_groestl512, sph_groestl512_close>,
+    Standard<sph_jh512_context, sph_jh512_init, sph_jh512, sph_jh512_close>,
+    Standard<sph_keccak512_context, sph_keccak512_init, sph_keccak512, sph_keccak512_close>,
+    Standard<sph_skein512_context, sph_skein512_init, sph_skein512, sph_skein512_close>,
+    Standard<sph_luffa512_context, sph_luffa512_init, sph_luffa512, sph_luffa512_close>,
+    Standard<sph_cubehash512_context, sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close>,
+    Standard<sph_shavite512_context, sph_shavite512_init, sph_shavite512, sph_shavite512_close>,
+    Standard<sph_simd512_context, sph_simd512_init, sph_simd512, sph_simd512_close>,
+    Standard<sph_echo512_context, sph_echo512_init, sph_echo512, sph_echo512_close>,
+    Standard<sph_sha512_context, sph_sha512_init, sph_sha512, sph_sha512_close>,
+};
+
+/** Best single hash implementation of every sph hash. */
+TransformType Transform[SPH_HASHES] = {
+    STANDARD[0], STANDARD[1], STANDARD[2], STANDARD[3], STANDARD[4], STANDARD[5],
+    STANDARD[6], STANDARD[7], STANDARD[8], STANDARD[9], STANDARD[10], STANDARD[11],
+};
+
+/** Four hashes at once, for the sph hashes which have a multi-buffer implementation. */
+TransformType Transform_4way[SPH_HASHES] = {nullptr};
+
+bool SelfTest()
+{
+    // Distinct inputs for every lane, so that lane mixups are caught
+    unsigned char in[4 * 64];
+    for (size_t i = 0; i < sizeof(in); i++) {
+        in[i] = (unsigned char)(i * 7 + 1);
+    }
+
+    for (size_t algo = 0; algo < SPH_HASHES; algo++) {
+        unsigned char expected[4 * 64];
+        for (size_t lane = 0; lane < 4; lane++) {
+            STANDARD[algo](expected + 64 * lane, in + 64 * lane);
+        }
+
+        unsigned char out[4 * 64];
+        for (size_t lane = 0; lane < 4; lane++) {
+            Transform[algo](out + 64 * lane, in + 64 * lane);
+        }
+        if (memcmp(out, expected, sizeof(out)) != 0) return false;
+
+        if (Transform_4way[algo]) {
+            Transform_4way[algo](out, in);
+            if (memcmp(out, expected, sizeof(out)) != 0) return false;
+        }
+    }
+    return true;
+}
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+// We can't use cpuid.h's __get_cpuid as it does not support subleafs.
+void inline cpuid(uint32_t leaf, uint32_t subleaf, uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
+{
+#ifdef __GNUC__
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+#else
+  __asm__ ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(leaf), "2"(subleaf));
+#endif
+}
+
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+} // namespace
+
+
+std::string SphHash512AutoDetect()
+{
+    std::string ret = "standard";
+    for (size_t algo = 0; algo < SPH_HASHES; algo++) {
+        Transform[algo] = STANDARD[algo];
+        Transform_4way[algo] = nullptr;
+    }
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    bool have_ssse3 = false;
+    bool have_aesni = false;
+    bool have_xsave = false;
+    bool have_avx = false;
+    bool have_avx2 = false;
+    bool enabled_avx = false;
+
+    (void)AVXEnabled;
+    (void)have_ssse3;
+    (void)have_aesni;
+    (void)have_avx;
+    (void)have_xsave;
+    (void)have_avx2;
+    (void)enabled_avx;
+
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, 0, eax, ebx, ecx, edx);
+    have_ssse3 = (ecx >> 9) & 1;
+    have_aesni = (ecx >> 25) & 1;
+    have_xsave = (ecx >> 27) & 1;
+    have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        enabled_avx = AVXEnabled();
+    }
+    cpuid(0, 0, eax, ebx, ecx, edx);
+    if (eax >= 7) {
+        cpuid(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+    }
+
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_ssse3 && have_aesni) {
+        Transform[(size_t)SphAlgo::GROESTL] = sph_aesni::Groestl512;
+        Transform[(size_t)SphAlgo::SHAVITE] = sph_aesni::Shavite512;
+        Transform[(size_t)SphAlgo::ECHO] = sph_aesni::Echo512;
+        ret = "aesni(groestl,shavite,echo)";
+    }
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && have_avx && enabled_avx) {
+        Transform_4way[(size_t)SphAlgo::BLAKE] = sph_avx2::Blake512_4way;
+        Transform_4way[(size_t)SphAlgo::BMW] = sph_avx2::Bmw512_4way;
+        Transform_4way[(size_t)SphAlgo::JH] = sph_avx2::Jh512_4way;
+        Transform_4way[(size_t)SphAlgo::KECCAK] = sph_avx2::Keccak512_4way;
+        Transform_4way[(size_t)SphAlgo::SKEIN] = sph_avx2::Skein512_4way;
+        Transform_4way[(size_t)SphAlgo::SHA512] = sph_avx2::Sha512_4way;
+        ret = (ret == "standard" ? "" : ret + ",") + "avx2(4way)";
+    }
+#endif
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
+
+void SphHash512_64(SphAlgo algo, unsigned char* out, const unsigned char* in, size_t blocks)
+{
+    const size_t index = (size_t)algo;
+    assert(index < SPH_HASHES);
+    if (Transform_4way[index]) {
+        while (blocks >= 4) {
+            Transform_4way[index](out, in);
+            out += 256;
+            in += 256;
+            blocks -= 4;
+        }
+    }
+    while (blocks) {
+        Transform[index](out, in);
+        out += 64;
+        in += 64;
+        --blocks;
+    }
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_SPH_MULTI_H
+#define BITCOIN_CRYPTO_SPH_MULTI_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/** The 512 bit sph hashes, in the order of Mike's core hashes. */
+enum class SphAlgo : uint8_t {
+    BLAKE,
+    BMW,
+    GROESTL,
+    JH,
+    KECCAK,
+    SKEIN,
+    LUFFA,
+    CUBEHASH,
+    SHAVITE,
+    SIMD,
+    ECHO,
+    SHA512,
+};
+
+/** Autodetect the best available implementations of the 512 bit sph hashes.
+ *  Returns the name of the implementation.
+ */
+std::string SphHash512AutoDetect();
+
+/** Compute multiple 512 bit sph hashes of 64-byte blobs.
+ *  output:  pointer to a blocks*64 byte output buffer, which may be the input buffer
+ *  input:   pointer to a blocks*64 byte input buffer
+ *  blocks:  the number of hashes to compute.
+ */
+void SphHash512_64(SphAlgo algo, unsigned char* output, const unsigned char* input, size_t blocks);
+
+#endif // BITCOIN_CRYPTO_SPH_MULTI_H
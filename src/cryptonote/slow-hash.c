@@ -5,120 +5,32 @@
 // Portions Copyright (c) 2018 The Monero developers
 // Portions Copyright (c) 2018 The TurtleCoin Developers
 
-#include <stddef.h>
-#include <stdint.h>
-#include <string.h>
-#include <stdio.h>
-#include <unistd.h>
+#if defined(HAVE_CONFIG_H)
+#include <config/dash-config.h>
+#endif
+
 #include <cryptonote/slow-hash.h>
+#include <cryptonote/slow-hash-internal.h>
 #include <cryptonote/oaes_lib.h>
 #include <cryptonote/c_keccak.h>
 #include <cryptonote/c_groestl.h>
 #include <cryptonote/c_blake256.h>
 #include <cryptonote/c_jh.h>
 #include <cryptonote/c_skein.h>
-#include <cryptonote/int-util.h>
-#include <cryptonote/variant2_int_sqrt.h>
 
-#if defined(_MSC_VER)
-#include <malloc.h>
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
 #endif
 
-#define AES_BLOCK_SIZE  16
-#define AES_KEY_SIZE    32 /*16*/
-#define INIT_SIZE_BLK   8
-#define INIT_SIZE_BYTE  (INIT_SIZE_BLK * AES_BLOCK_SIZE)
-
-#define VARIANT1_1(p) \
-  do if (variant == 1) \
-  { \
-    const uint8_t tmp = ((const uint8_t*)(p))[11]; \
-    static const uint32_t table = 0x75310; \
-    const uint8_t index = (((tmp >> 3) & 6) | (tmp & 1)) << 1; \
-    ((uint8_t*)(p))[11] = tmp ^ ((table >> index) & 0x30); \
-  } while(0)
-
-#define VARIANT1_2(p) \
-   do if (variant == 1) \
-   { \
-     ((uint64_t*)p)[1] ^= tweak1_2; \
-   } while(0)
-
-#define VARIANT1_INIT() \
-  if (variant == 1 && len < 43) \
-  { \
-    fprintf(stderr, "Cryptonight variant 1 needs at least 43 bytes of data"); \
-    _exit(1); \
-  } \
-  const uint64_t tweak1_2 = (variant == 1) ? *(const uint64_t*)(((const uint8_t*)input)+35) ^ state.hs.w[24] : 0
-
-#define U64(p) ((uint64_t*)(p))
-
-#define VARIANT2_INIT(b, state) \
-  uint64_t division_result; \
-  uint64_t sqrt_result; \
-  do if (variant >= 2) \
-  { \
-    U64(b)[2] = state.hs.w[8] ^ state.hs.w[10]; \
-    U64(b)[3] = state.hs.w[9] ^ state.hs.w[11]; \
-    division_result = state.hs.w[12]; \
-    sqrt_result = state.hs.w[13]; \
-  } while (0)
-
-#define VARIANT2_SHUFFLE_ADD(base_ptr, offset, a, b) \
-  do if (variant >= 2) \
-  { \
-    uint64_t* chunk1 = U64((base_ptr) + ((offset) ^ 0x10)); \
-    uint64_t* chunk2 = U64((base_ptr) + ((offset) ^ 0x20)); \
-    uint64_t* chunk3 = U64((base_ptr) + ((offset) ^ 0x30)); \
-    \
-    const uint64_t chunk1_old[2] = { chunk1[0], chunk1[1] }; \
-    \
-    chunk1[0] = chunk3[0] + U64(b + 16)[0]; \
-    chunk1[1] = chunk3[1] + U64(b + 16)[1]; \
-    \
-    chunk3[0] = chunk2[0] + U64(a)[0]; \
-    chunk3[1] = chunk2[1] + U64(a)[1]; \
-    \
-    chunk2[0] = chunk1_old[0] + U64(b)[0]; \
-    chunk2[1] = chunk1_old[1] + U64(b)[1]; \
-    } while (0)
-
-#define VARIANT2_INTEGER_MATH_DIVISION_STEP(b, ptr) \
-  ((uint64_t*)(b))[0] ^= division_result ^ (sqrt_result << 32); \
-  { \
-    const uint64_t dividend = ((uint64_t*)(ptr))[1]; \
-    const uint32_t divisor = (((uint32_t*)(ptr))[0] + (uint32_t)(sqrt_result << 1)) | 0x80000001UL; \
-    division_result = ((uint32_t)(dividend / divisor)) + \
-                     (((uint64_t)(dividend % divisor)) << 32); \
-  } \
-  const uint64_t sqrt_input = ((uint64_t*)(ptr))[0] + division_result
-
-#define VARIANT2_INTEGER_MATH(b, ptr) \
-    do if (variant >= 2) \
-    { \
-      VARIANT2_INTEGER_MATH_DIVISION_STEP(b, ptr); \
-      VARIANT2_INTEGER_MATH_SQRT_STEP_FP64(); \
-      VARIANT2_INTEGER_MATH_SQRT_FIXUP(sqrt_result); \
-    } while (0)
-
-#define VARIANT2_2() \
-  do if (variant >= 2) { \
-    ((uint64_t*)(long_state + ((j * AES_BLOCK_SIZE) ^ 0x10)))[0] ^= hi; \
-    ((uint64_t*)(long_state + ((j * AES_BLOCK_SIZE) ^ 0x10)))[1] ^= lo; \
-    hi ^= ((uint64_t*)(long_state + ((j * AES_BLOCK_SIZE) ^ 0x20)))[0]; \
-    lo ^= ((uint64_t*)(long_state + ((j * AES_BLOCK_SIZE) ^ 0x20)))[1]; \
-  } while (0)
-
-#pragma pack(push, 1)
-union cn_slow_hash_state {
-    union hash_state hs;
-    struct {
-        uint8_t k[64];
-        uint8_t init[INIT_SIZE_BYTE];
-    };
-};
-#pragma pack(pop)
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+#if defined(_MSC_VER)
+#define THREADV __declspec(thread)
+#else
+#define THREADV __thread
+#endif
 
 static void do_blake_hash(const void* input, size_t len, char* output) {
     blake256_hash((uint8_t*)output, input, len);
@@ -145,10 +57,6 @@ static void (* const extra_hashes[4])(const void *, size_t, char *) = {
 extern int aesb_single_round(const uint8_t *in, uint8_t *out, const uint8_t *expandedKey);
 extern int aesb_pseudo_round(const uint8_t *in, uint8_t *out, const uint8_t *expandedKey);
 
-static inline size_t e2i(const uint8_t* a, size_t count) {
-    return (*((uint64_t*) a) / AES_BLOCK_SIZE) & (count - 1);
-}
-
 static void mul(const uint8_t* a, const uint8_t* b, uint8_t* res) {
     ((uint64_t*) res)[1] = mul128(((uint64_t*) a)[0], ((uint64_t*) b)[0], (uint64_t*) res);
 }
@@ -166,11 +74,6 @@ static void sum_half_blocks(uint8_t* a, const uint8_t* b) {
     ((uint64_t*) a)[1] = SWAP64LE(a1);
 }
 
-static inline void copy_block(uint8_t* dst, const uint8_t* src) {
-    ((uint64_t*) dst)[0] = ((uint64_t*) src)[0];
-    ((uint64_t*) dst)[1] = ((uint64_t*) src)[1];
-}
-
 static void swap_blocks(uint8_t* a, uint8_t* b) {
     size_t i;
     uint8_t t;
@@ -181,17 +84,124 @@ static void swap_blocks(uint8_t* a, uint8_t* b) {
     }
 }
 
-static inline void xor_blocks(uint8_t* a, const uint8_t* b) {
-    ((uint64_t*) a)[0] ^= ((uint64_t*) b)[0];
-    ((uint64_t*) a)[1] ^= ((uint64_t*) b)[1];
+void cn_slow_hash_extra(union cn_slow_hash_state* state, char* output)
+{
+  extra_hashes[state->hs.b[0] & 3](state, 200, output);
 }
 
-static inline void xor_blocks_dst(const uint8_t* a, const uint8_t* b, uint8_t* dst) {
-    ((uint64_t*) dst)[0] = ((uint64_t*) a)[0] ^ ((uint64_t*) b)[0];
-    ((uint64_t*) dst)[1] = ((uint64_t*) a)[1] ^ ((uint64_t*) b)[1];
+/*
+ * Per-thread scratchpad. It is sized for the largest variant (CN_PAGE_SIZE),
+ * or for several of them when cn_slow_hash_multi is used, and reused by every
+ * hash made on the thread, so hashing doesn't fault in a fresh page and go
+ * through the allocator each time. Where the platform allows it the
+ * scratchpad is backed by 2 MB huge pages. cn_slow_hash_free_state()
+ * releases it again.
+ */
+static THREADV uint8_t* hp_state = NULL;
+static THREADV size_t hp_size = 0;
+static THREADV int hp_mapped = 0;
+static THREADV oaes_ctx* hp_aes_ctx = NULL;
+static THREADV uint64_t hp_allocations = 0;
+
+#if !defined(_WIN32)
+/* size is a multiple of CN_PAGE_SIZE */
+static void* cn_slow_hash_map_state(size_t size)
+{
+  void* p = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+  /* Only succeeds if the administrator reserved huge pages (vm.nr_hugepages) */
+  p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (p != MAP_FAILED) {
+    return p;
+  }
+#endif
+  /* Map an extra CN_PAGE_SIZE and trim it to an aligned region, so transparent huge pages can back it */
+  uint8_t* base = (uint8_t*)mmap(NULL, size + CN_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if ((void*)base == MAP_FAILED) {
+    return NULL;
+  }
+  uint8_t* aligned = (uint8_t*)(((uintptr_t)base + CN_PAGE_SIZE - 1) & ~(uintptr_t)(CN_PAGE_SIZE - 1));
+  size_t head = aligned - base;
+  if (head > 0) {
+    munmap(base, head);
+  }
+  if (CN_PAGE_SIZE - head > 0) {
+    munmap(aligned + size, CN_PAGE_SIZE - head);
+  }
+#if defined(MADV_HUGEPAGE)
+  madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+  return aligned;
 }
+#endif
 
-void cn_slow_hash(const char* input, char* output, int len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds)
+static void cn_slow_hash_release_scratchpad(void)
+{
+  if (hp_state != NULL) {
+#if !defined(_WIN32)
+    if (hp_mapped) {
+      munmap(hp_state, hp_size);
+    } else
+#endif
+    {
+      free(hp_state);
+    }
+    hp_state = NULL;
+    hp_size = 0;
+    hp_mapped = 0;
+  }
+}
+
+uint8_t* cn_slow_hash_scratchpad(size_t size)
+{
+  if (hp_state != NULL && size <= hp_size) {
+    return hp_state;
+  }
+  cn_slow_hash_release_scratchpad();
+  /* Round up to whole CN_PAGE_SIZE pages */
+  size = (size + CN_PAGE_SIZE - 1) & ~(size_t)(CN_PAGE_SIZE - 1);
+  if (size == 0) {
+    size = CN_PAGE_SIZE;
+  }
+#if !defined(_WIN32)
+  hp_state = (uint8_t*)cn_slow_hash_map_state(size);
+  hp_mapped = hp_state != NULL;
+#endif
+  if (hp_state == NULL) {
+    hp_state = (uint8_t*)malloc(size);
+  }
+  if (hp_state == NULL) {
+    fprintf(stderr, "Cryptonight failed to allocate its scratchpad");
+    _exit(1);
+  }
+  hp_size = size;
+  hp_allocations++;
+  return hp_state;
+}
+
+static oaes_ctx* cn_slow_hash_aes_ctx(void)
+{
+  if (hp_aes_ctx == NULL) {
+    hp_aes_ctx = (oaes_ctx*) oaes_alloc();
+    hp_allocations++;
+  }
+  return hp_aes_ctx;
+}
+
+uint64_t cn_slow_hash_allocations(void)
+{
+  return hp_allocations;
+}
+
+void cn_slow_hash_free_state(void)
+{
+  cn_slow_hash_release_scratchpad();
+  if (hp_aes_ctx != NULL) {
+    oaes_free((OAES_CTX **) &hp_aes_ctx);
+  }
+}
+
+static void cn_slow_hash_portable(const char* input, char* output, int len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds)
 {
   union cn_slow_hash_state state;
   uint8_t text[INIT_SIZE_BYTE];
@@ -203,19 +213,12 @@ void cn_slow_hash(const char* input, char* output, int len, int variant, uint32_
 
   size_t init_rounds = (page_size / INIT_SIZE_BYTE);
 
-#if defined(_MSC_VER)
-  uint8_t *long_state = (uint8_t *)_malloca(page_size);
-#else
-#if defined(__APPLE__)
-  uint8_t *long_state = (uint8_t *)calloc(page_size, sizeof(uint8_t));
-#else
-  uint8_t *long_state = (uint8_t *)malloc(page_size);
-#endif
-#endif
+  assert(page_size <= CN_PAGE_SIZE);
+  uint8_t *long_state = cn_slow_hash_scratchpad(page_size);
   hash_process(&state.hs, (const uint8_t*) input, len);
   memcpy(text, state.init, INIT_SIZE_BYTE);
   memcpy(aes_key, state.hs.b, AES_KEY_SIZE);
-  aes_ctx = (oaes_ctx*) oaes_alloc();
+  aes_ctx = cn_slow_hash_aes_ctx();
   size_t i, j;
 
   VARIANT1_INIT();
@@ -289,9 +292,192 @@ void cn_slow_hash(const char* input, char* output, int len, int variant, uint32_
   memcpy(state.init, text, INIT_SIZE_BYTE);
   hash_permutation(&state.hs);
   /*memcpy(hash, &state, 32);*/
-  extra_hashes[state.hs.b[0] & 3](&state, 200, output);
-  oaes_free((OAES_CTX **) &aes_ctx);
-  free(long_state);
+  cn_slow_hash_extra(&state, output);
+}
+
+/*
+ * Interleaved variant of cn_slow_hash_portable. Each step of the main loop is
+ * done for all hashes before the next one, so the scratchpad reads of one hash
+ * are in flight while the others compute. Variant 2 is not interleaved, see
+ * cn_slow_hash_multi.
+ */
+static void cn_slow_hash_multi_portable(const char* const* input, char* const* output, int len, size_t ways, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds)
+{
+  union cn_slow_hash_state state[CN_MAX_WAYS];
+  uint8_t* long_state[CN_MAX_WAYS];
+  uint64_t tweak1_2[CN_MAX_WAYS];
+  uint8_t text[INIT_SIZE_BYTE];
+  uint8_t a[CN_MAX_WAYS][AES_BLOCK_SIZE];
+  uint8_t b[CN_MAX_WAYS][AES_BLOCK_SIZE];
+  uint8_t c[CN_MAX_WAYS][AES_BLOCK_SIZE];
+  oaes_ctx* aes_ctx = cn_slow_hash_aes_ctx();
+
+  size_t init_rounds = (page_size / INIT_SIZE_BYTE);
+  size_t i, j, l;
+
+  assert(page_size <= CN_PAGE_SIZE);
+  uint8_t *scratchpad = cn_slow_hash_scratchpad(ways * page_size);
+  for (l = 0; l < ways; l++) {
+    long_state[l] = scratchpad + l * page_size;
+    hash_process(&state[l].hs, (const uint8_t*) input[l], len);
+    tweak1_2[l] = variant1_tweak(input[l], len, variant, &state[l]);
+
+    memcpy(text, state[l].init, INIT_SIZE_BYTE);
+    oaes_key_import_data(aes_ctx, state[l].hs.b, AES_KEY_SIZE);
+    for (i = 0; i < init_rounds; i++) {
+      for (j = 0; j < INIT_SIZE_BLK; j++) {
+        aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
+      }
+      memcpy(&long_state[l][i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
+    }
+
+    for (i = 0; i < 16; i++) {
+      a[l][i] = state[l].k[i] ^ state[l].k[32 + i];
+      b[l][i] = state[l].k[16 + i] ^ state[l].k[48 + i];
+    }
+  }
+
+  for (i = 0; i < iterations; i++) {
+    /* Iteration 1 */
+    for (l = 0; l < ways; l++) {
+      uint8_t* p = &long_state[l][e2i(a[l], aes_rounds) * AES_BLOCK_SIZE];
+      aesb_single_round(p, c[l], a[l]);
+      xor_blocks_dst(c[l], b[l], p);
+      VARIANT1_1(p);
+    }
+    /* Iteration 2 */
+    for (l = 0; l < ways; l++) {
+      uint64_t* dst = (uint64_t*)&long_state[l][e2i(c[l], aes_rounds) * AES_BLOCK_SIZE];
+      uint64_t t[2];
+      t[0] = dst[0];
+      t[1] = dst[1];
+
+      uint64_t hi;
+      uint64_t lo = mul128(((uint64_t*)c[l])[0], t[0], &hi);
+
+      ((uint64_t*)a[l])[0] += hi;
+      ((uint64_t*)a[l])[1] += lo;
+
+      dst[0] = ((uint64_t*)a[l])[0];
+      dst[1] = ((uint64_t*)a[l])[1] ^ tweak1_2[l];
+
+      ((uint64_t*)a[l])[0] ^= t[0];
+      ((uint64_t*)a[l])[1] ^= t[1];
+
+      copy_block(b[l], c[l]);
+    }
+  }
+
+  for (l = 0; l < ways; l++) {
+    memcpy(text, state[l].init, INIT_SIZE_BYTE);
+    oaes_key_import_data(aes_ctx, &state[l].hs.b[32], AES_KEY_SIZE);
+    for (i = 0; i < init_rounds; i++) {
+      for (j = 0; j < INIT_SIZE_BLK; j++) {
+        xor_blocks(&text[j * AES_BLOCK_SIZE], &long_state[l][i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
+        aesb_pseudo_round(&text[j * AES_BLOCK_SIZE], &text[j * AES_BLOCK_SIZE], aes_ctx->key->exp_data);
+      }
+    }
+    memcpy(state[l].init, text, INIT_SIZE_BYTE);
+    hash_permutation(&state[l].hs);
+    cn_slow_hash_extra(&state[l], output[l]);
+  }
+}
+
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL)
+void cn_slow_hash_aesni(const char* input, char* output, int len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds);
+void cn_slow_hash_multi_aesni(const char* const* input, char* const* output, int len, size_t ways, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds);
+#endif
+
+typedef void (*cn_slow_hash_fn)(const char*, char*, int, int, uint32_t, uint32_t, size_t);
+static cn_slow_hash_fn cn_slow_hash_impl = cn_slow_hash_portable;
+typedef void (*cn_slow_hash_multi_fn)(const char* const*, char* const*, int, size_t, int, uint32_t, uint32_t, size_t);
+static cn_slow_hash_multi_fn cn_slow_hash_multi_impl = cn_slow_hash_multi_portable;
+
+void cn_slow_hash(const char* input, char* output, int len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds)
+{
+  cn_slow_hash_impl(input, output, len, variant, page_size, iterations, aes_rounds);
+}
+
+void cn_slow_hash_multi(const char* const* input, char* const* output, int len, size_t ways, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds)
+{
+  size_t l;
+  assert(ways > 0 && ways <= CN_MAX_WAYS);
+  if (ways == 1 || variant >= 2) {
+    /* The variant 2 state does not gain from interleaving enough to justify a second copy of it */
+    for (l = 0; l < ways; l++) {
+      cn_slow_hash_impl(input[l], output[l], len, variant, page_size, iterations, aes_rounds);
+    }
+    return;
+  }
+  cn_slow_hash_multi_impl(input, output, len, ways, variant, page_size, iterations, aes_rounds);
+}
+
+/* Known answer for the first input of the cn_slow_hash test vectors (CryptoNight Turtle) */
+static int cn_slow_hash_selftest(void)
+{
+  static const uint8_t expected[HASH_SIZE] = {
+    0xa9, 0x5a, 0xd1, 0x13, 0x6b, 0x39, 0xf2, 0x48, 0xcc, 0xe9, 0x6a, 0xd5, 0x1b, 0x0d, 0x3d, 0xca,
+    0x00, 0x82, 0xbe, 0x6f, 0xe0, 0xf1, 0xba, 0xc8, 0x89, 0xf0, 0x9d, 0xe7, 0xbf, 0xe6, 0x8f, 0x81
+  };
+  uint8_t input[64];
+  char output[HASH_SIZE];
+  size_t i;
+  for (i = 0; i < sizeof(input); i++) {
+    input[i] = (uint8_t)(i * 7);
+  }
+  cn_slow_hash((const char*)input, output, sizeof(input), 1, CN_TURTLE_PAGE_SIZE, CN_TURTLE_ITERATIONS, CN_TURTLE_AES_ROUNDS);
+  if (memcmp(output, expected, HASH_SIZE) != 0) {
+    return 0;
+  }
+
+  /* Every lane of an interleaved hash must match; the other lanes get different inputs */
+  uint8_t multi_input[CN_MAX_WAYS][64];
+  char multi_output[CN_MAX_WAYS][HASH_SIZE];
+  const char* inputs[CN_MAX_WAYS];
+  char* outputs[CN_MAX_WAYS];
+  for (i = 0; i < CN_MAX_WAYS; i++) {
+    memcpy(multi_input[i], input, sizeof(input));
+    multi_input[i][0] ^= (uint8_t)i;
+    inputs[i] = (const char*)multi_input[i];
+    outputs[i] = multi_output[i];
+  }
+  cn_slow_hash_multi(inputs, outputs, sizeof(input), CN_MAX_WAYS, 1, CN_TURTLE_PAGE_SIZE, CN_TURTLE_ITERATIONS, CN_TURTLE_AES_ROUNDS);
+  for (i = 0; i < CN_MAX_WAYS; i++) {
+    cn_slow_hash(inputs[i], output, sizeof(input), 1, CN_TURTLE_PAGE_SIZE, CN_TURTLE_ITERATIONS, CN_TURTLE_AES_ROUNDS);
+    if (memcmp(multi_output[i], output, HASH_SIZE) != 0) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+const char* cn_slow_hash_autodetect(void)
+{
+  const char* ret = "standard";
+  cn_slow_hash_impl = cn_slow_hash_portable;
+  cn_slow_hash_multi_impl = cn_slow_hash_multi_portable;
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+  uint32_t eax, ebx, ecx, edx;
+  __cpuid(1, eax, ebx, ecx, edx);
+  int have_sse2 = (edx >> 26) & 1;
+  int have_ssse3 = (ecx >> 9) & 1;
+  int have_aesni = (ecx >> 25) & 1;
+  (void)have_sse2;
+  (void)have_ssse3;
+  (void)have_aesni;
+
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL)
+  /* The AES-NI library is built with SSSE3 enabled as well */
+  if (have_sse2 && have_ssse3 && have_aesni) {
+    cn_slow_hash_impl = cn_slow_hash_aesni;
+    cn_slow_hash_multi_impl = cn_slow_hash_multi_aesni;
+    ret = "aesni";
+  }
+#endif
+#endif
+
+  assert(cn_slow_hash_selftest());
+  return ret;
 }
 
 void cn_fast_hash(const char* input, char* output, uint32_t len) {
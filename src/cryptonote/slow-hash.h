@@ -28,6 +28,9 @@
 
 #define CN_TURTLE_LITE_AES_ROUNDS 8192
 
+/** Maximum number of hashes cn_slow_hash_multi interleaves */
+#define CN_MAX_WAYS 4
+
 typedef unsigned char BitSequence;
 typedef unsigned long long DataLength;
 
@@ -48,6 +51,19 @@ extern "C" {
 #pragma pack(pop)
 
   void cn_slow_hash(const char* input, char* output, uint32_t len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds);
+  /**
+   * cn_slow_hash of ways (1 to CN_MAX_WAYS) independent inputs of len bytes each.
+   * Every hash gets its own scratchpad and the main loops run interleaved, so
+   * the dependent scratchpad reads of the hashes overlap. The thread's
+   * scratchpad grows to ways * page_size bytes.
+   */
+  void cn_slow_hash_multi(const char* const* inputs, char* const* outputs, uint32_t len, size_t ways, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds);
+  /** Autodetect the best available cn_slow_hash implementation. Returns the name of the implementation. */
+  const char* cn_slow_hash_autodetect(void);
+  /** Release the calling thread's cn_slow_hash scratchpad. Hashing threads should call this before they exit. */
+  void cn_slow_hash_free_state(void);
+  /** Number of scratchpad and AES context allocations made by the calling thread so far */
+  uint64_t cn_slow_hash_allocations(void);
   void cn_fast_hash(const char* input, char* output, uint32_t len);
 
 //-----------------------------------------------------------------------------------
@@ -100,7 +116,42 @@ extern "C" {
     cn_slow_hash(input, output, len, 1, CN_TURTLE_PAGE_SIZE, CN_TURTLE_ITERATIONS, CN_TURTLE_LITE_AES_ROUNDS);
   }
 
+//-----------------------------------------------------------------------------------
+  inline void cryptonight_dark_hash_multi(const char* const* inputs, char* const* outputs, uint32_t len, size_t ways, int variant) {
+    cn_slow_hash_multi(inputs, outputs, len, ways, 1, CN_DARK_PAGE_SIZE, CN_DARK_ITERATIONS, CN_DARK_AES_ROUNDS);
+  }
+
+  inline void cryptonight_darklite_hash_multi(const char* const* inputs, char* const* outputs, uint32_t len, size_t ways, int variant) {
+    cn_slow_hash_multi(inputs, outputs, len, ways, 1, CN_DARK_PAGE_SIZE, CN_DARK_ITERATIONS, CN_DARK_LITE_AES_ROUNDS);
+  }
+
+  inline void cryptonight_cnfast_hash_multi(const char* const* inputs, char* const* outputs, uint32_t len, size_t ways, int variant) {
+    cn_slow_hash_multi(inputs, outputs, len, ways, 1, CN_FAST_PAGE_SIZE, CN_FAST_ITERATIONS, CN_FAST_AES_ROUNDS);
+  }
+
+  inline void cryptonight_cnlite_hash_multi(const char* const* inputs, char* const* outputs, uint32_t len, size_t ways, int variant) {
+    cn_slow_hash_multi(inputs, outputs, len, ways, 1, CN_LITE_PAGE_SIZE, CN_LITE_ITERATIONS, CN_LITE_AES_ROUNDS);
+  }
+
+  inline void cryptonight_turtle_hash_multi(const char* const* inputs, char* const* outputs, uint32_t len, size_t ways, int variant) {
+    cn_slow_hash_multi(inputs, outputs, len, ways, 1, CN_TURTLE_PAGE_SIZE, CN_TURTLE_ITERATIONS, CN_TURTLE_AES_ROUNDS);
+  }
+
+  inline void cryptonight_turtlelite_hash_multi(const char* const* inputs, char* const* outputs, uint32_t len, size_t ways, int variant) {
+    cn_slow_hash_multi(inputs, outputs, len, ways, 1, CN_TURTLE_PAGE_SIZE, CN_TURTLE_ITERATIONS, CN_TURTLE_LITE_AES_ROUNDS);
+  }
+
 } // extern
+
+  /** Releases the calling thread's cn_slow_hash scratchpad when it goes out of scope. */
+  class slow_hash_thread_guard {
+  public:
+    slow_hash_thread_guard() = default;
+    slow_hash_thread_guard(const slow_hash_thread_guard&) = delete;
+    slow_hash_thread_guard& operator=(const slow_hash_thread_guard&) = delete;
+    ~slow_hash_thread_guard() { cn_slow_hash_free_state(); }
+  };
+
 } // namespace
 
 #endif
\ No newline at end of file
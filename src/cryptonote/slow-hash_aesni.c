@@ -0,0 +1,276 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Copyright (c) 2012-2013 The Cryptonote developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+// Portions Copyright (c) 2018 The Monero developers
+
+// AES-NI implementation of cn_slow_hash. It computes exactly the same function
+// as the portable implementation in slow-hash.c, but uses the AESENC
+// instruction instead of the table based aesb_*_round functions and expands
+// the AES key with AESKEYGENASSIST instead of an oaes_ctx.
+
+#ifdef ENABLE_AESNI
+
+#include <cryptonote/slow-hash.h>
+#include <cryptonote/slow-hash-internal.h>
+
+#include <wmmintrin.h>
+#include <emmintrin.h>
+
+#define AESNI_ROUND_KEYS 10
+
+static inline void aes_256_assist1(__m128i* t1, __m128i* t2)
+{
+  __m128i t4;
+  *t2 = _mm_shuffle_epi32(*t2, 0xff);
+  t4 = _mm_slli_si128(*t1, 0x04);
+  *t1 = _mm_xor_si128(*t1, t4);
+  t4 = _mm_slli_si128(t4, 0x04);
+  *t1 = _mm_xor_si128(*t1, t4);
+  t4 = _mm_slli_si128(t4, 0x04);
+  *t1 = _mm_xor_si128(*t1, t4);
+  *t1 = _mm_xor_si128(*t1, *t2);
+}
+
+static inline void aes_256_assist2(__m128i* t1, __m128i* t3)
+{
+  __m128i t2, t4;
+  t4 = _mm_aeskeygenassist_si128(*t1, 0x00);
+  t2 = _mm_shuffle_epi32(t4, 0xaa);
+  t4 = _mm_slli_si128(*t3, 0x04);
+  *t3 = _mm_xor_si128(*t3, t4);
+  t4 = _mm_slli_si128(t4, 0x04);
+  *t3 = _mm_xor_si128(*t3, t4);
+  t4 = _mm_slli_si128(t4, 0x04);
+  *t3 = _mm_xor_si128(*t3, t4);
+  *t3 = _mm_xor_si128(*t3, t2);
+}
+
+/* Expand a 256 bit AES key into the first 10 round keys, which is all the pseudo rounds use */
+static void aes_expand_key(const uint8_t* key, __m128i* ek)
+{
+  __m128i t1, t2, t3;
+
+  t1 = _mm_loadu_si128((const __m128i*)key);
+  t3 = _mm_loadu_si128((const __m128i*)(key + 16));
+
+  ek[0] = t1;
+  ek[1] = t3;
+
+  t2 = _mm_aeskeygenassist_si128(t3, 0x01);
+  aes_256_assist1(&t1, &t2);
+  ek[2] = t1;
+  aes_256_assist2(&t1, &t3);
+  ek[3] = t3;
+
+  t2 = _mm_aeskeygenassist_si128(t3, 0x02);
+  aes_256_assist1(&t1, &t2);
+  ek[4] = t1;
+  aes_256_assist2(&t1, &t3);
+  ek[5] = t3;
+
+  t2 = _mm_aeskeygenassist_si128(t3, 0x04);
+  aes_256_assist1(&t1, &t2);
+  ek[6] = t1;
+  aes_256_assist2(&t1, &t3);
+  ek[7] = t3;
+
+  t2 = _mm_aeskeygenassist_si128(t3, 0x08);
+  aes_256_assist1(&t1, &t2);
+  ek[8] = t1;
+  aes_256_assist2(&t1, &t3);
+  ek[9] = t3;
+}
+
+/* Ten AES rounds without the initial key whitening, applied to all eight blocks of text at once */
+static inline void aes_pseudo_round_8(__m128i* x, const __m128i* ek)
+{
+  size_t i, k;
+  for (k = 0; k < AESNI_ROUND_KEYS; k++) {
+    for (i = 0; i < INIT_SIZE_BLK; i++) {
+      x[i] = _mm_aesenc_si128(x[i], ek[k]);
+    }
+  }
+}
+
+void cn_slow_hash_aesni(const char* input, char* output, int len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds)
+{
+  union cn_slow_hash_state state;
+  uint8_t a[AES_BLOCK_SIZE];
+  uint8_t b[AES_BLOCK_SIZE * 2];
+  uint8_t c[AES_BLOCK_SIZE];
+  __m128i ek[AESNI_ROUND_KEYS];
+  __m128i x[INIT_SIZE_BLK];
+
+  size_t init_rounds = (page_size / INIT_SIZE_BYTE);
+
+  assert(page_size <= CN_PAGE_SIZE);
+  uint8_t *long_state = cn_slow_hash_scratchpad(page_size);
+  hash_process(&state.hs, (const uint8_t*) input, len);
+  size_t i, j;
+
+  VARIANT1_INIT();
+  VARIANT2_INIT(b, state);
+
+  aes_expand_key(state.hs.b, ek);
+  for (j = 0; j < INIT_SIZE_BLK; j++) {
+    x[j] = _mm_loadu_si128((const __m128i*)&state.init[j * AES_BLOCK_SIZE]);
+  }
+  for (i = 0; i < init_rounds; i++) {
+    aes_pseudo_round_8(x, ek);
+    for (j = 0; j < INIT_SIZE_BLK; j++) {
+      _mm_storeu_si128((__m128i*)&long_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE], x[j]);
+    }
+  }
+
+  for (i = 0; i < 16; i++) {
+    a[i] = state.k[i] ^ state.k[32 + i];
+    b[i] = state.k[16 + i] ^ state.k[48 + i];
+  }
+
+  for (i = 0; i < iterations; i++) {
+    /* Iteration 1 */
+    j = e2i(a, aes_rounds);
+    _mm_storeu_si128((__m128i*)c, _mm_aesenc_si128(_mm_loadu_si128((const __m128i*)&long_state[j * AES_BLOCK_SIZE]),
+                                                   _mm_loadu_si128((const __m128i*)a)));
+    VARIANT2_SHUFFLE_ADD(long_state, j * AES_BLOCK_SIZE, a, b);
+    xor_blocks_dst(c, b, &long_state[j * AES_BLOCK_SIZE]);
+    VARIANT1_1((uint8_t*)&long_state[j * AES_BLOCK_SIZE]);
+    /* Iteration 2 */
+    j = e2i(c, aes_rounds);
+
+    uint64_t* dst = (uint64_t*)&long_state[j * AES_BLOCK_SIZE];
+
+    uint64_t t[2];
+    t[0] = dst[0];
+    t[1] = dst[1];
+
+    VARIANT2_INTEGER_MATH(t, c);
+
+    uint64_t hi;
+    uint64_t lo = mul128(((uint64_t*)c)[0], t[0], &hi);
+
+    VARIANT2_2();
+    VARIANT2_SHUFFLE_ADD(long_state, j * AES_BLOCK_SIZE, a, b);
+
+    ((uint64_t*)a)[0] += hi;
+    ((uint64_t*)a)[1] += lo;
+
+    dst[0] = ((uint64_t*)a)[0];
+    dst[1] = ((uint64_t*)a)[1];
+
+    ((uint64_t*)a)[0] ^= t[0];
+    ((uint64_t*)a)[1] ^= t[1];
+
+    VARIANT1_2((uint8_t*)&long_state[j * AES_BLOCK_SIZE]);
+    copy_block(b + AES_BLOCK_SIZE, b);
+    copy_block(b, c);
+  }
+
+  aes_expand_key(&state.hs.b[32], ek);
+  for (j = 0; j < INIT_SIZE_BLK; j++) {
+    x[j] = _mm_loadu_si128((const __m128i*)&state.init[j * AES_BLOCK_SIZE]);
+  }
+  for (i = 0; i < init_rounds; i++) {
+    for (j = 0; j < INIT_SIZE_BLK; j++) {
+      x[j] = _mm_xor_si128(x[j], _mm_loadu_si128((const __m128i*)&long_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]));
+    }
+    aes_pseudo_round_8(x, ek);
+  }
+  for (j = 0; j < INIT_SIZE_BLK; j++) {
+    _mm_storeu_si128((__m128i*)&state.init[j * AES_BLOCK_SIZE], x[j]);
+  }
+  hash_permutation(&state.hs);
+  cn_slow_hash_extra(&state, output);
+}
+
+/* Interleaved variant of cn_slow_hash_aesni, see cn_slow_hash_multi_portable */
+void cn_slow_hash_multi_aesni(const char* const* input, char* const* output, int len, size_t ways, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds)
+{
+  union cn_slow_hash_state state[CN_MAX_WAYS];
+  uint8_t* long_state[CN_MAX_WAYS];
+  uint64_t tweak1_2[CN_MAX_WAYS];
+  uint8_t a[CN_MAX_WAYS][AES_BLOCK_SIZE];
+  uint8_t b[CN_MAX_WAYS][AES_BLOCK_SIZE];
+  uint8_t c[CN_MAX_WAYS][AES_BLOCK_SIZE];
+  __m128i ek[AESNI_ROUND_KEYS];
+  __m128i x[INIT_SIZE_BLK];
+
+  size_t init_rounds = (page_size / INIT_SIZE_BYTE);
+  size_t i, j, l;
+
+  assert(page_size <= CN_PAGE_SIZE);
+  uint8_t *scratchpad = cn_slow_hash_scratchpad(ways * page_size);
+  for (l = 0; l < ways; l++) {
+    long_state[l] = scratchpad + l * page_size;
+    hash_process(&state[l].hs, (const uint8_t*) input[l], len);
+    tweak1_2[l] = variant1_tweak(input[l], len, variant, &state[l]);
+
+    aes_expand_key(state[l].hs.b, ek);
+    for (j = 0; j < INIT_SIZE_BLK; j++) {
+      x[j] = _mm_loadu_si128((const __m128i*)&state[l].init[j * AES_BLOCK_SIZE]);
+    }
+    for (i = 0; i < init_rounds; i++) {
+      aes_pseudo_round_8(x, ek);
+      for (j = 0; j < INIT_SIZE_BLK; j++) {
+        _mm_storeu_si128((__m128i*)&long_state[l][i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE], x[j]);
+      }
+    }
+
+    for (i = 0; i < 16; i++) {
+      a[l][i] = state[l].k[i] ^ state[l].k[32 + i];
+      b[l][i] = state[l].k[16 + i] ^ state[l].k[48 + i];
+    }
+  }
+
+  for (i = 0; i < iterations; i++) {
+    /* Iteration 1 */
+    for (l = 0; l < ways; l++) {
+      uint8_t* p = &long_state[l][e2i(a[l], aes_rounds) * AES_BLOCK_SIZE];
+      _mm_storeu_si128((__m128i*)c[l], _mm_aesenc_si128(_mm_loadu_si128((const __m128i*)p), _mm_loadu_si128((const __m128i*)a[l])));
+      xor_blocks_dst(c[l], b[l], p);
+      VARIANT1_1(p);
+    }
+    /* Iteration 2 */
+    for (l = 0; l < ways; l++) {
+      uint64_t* dst = (uint64_t*)&long_state[l][e2i(c[l], aes_rounds) * AES_BLOCK_SIZE];
+      uint64_t t[2];
+      t[0] = dst[0];
+      t[1] = dst[1];
+
+      uint64_t hi;
+      uint64_t lo = mul128(((uint64_t*)c[l])[0], t[0], &hi);
+
+      ((uint64_t*)a[l])[0] += hi;
+      ((uint64_t*)a[l])[1] += lo;
+
+      dst[0] = ((uint64_t*)a[l])[0];
+      dst[1] = ((uint64_t*)a[l])[1] ^ tweak1_2[l];
+
+      ((uint64_t*)a[l])[0] ^= t[0];
+      ((uint64_t*)a[l])[1] ^= t[1];
+
+      copy_block(b[l], c[l]);
+    }
+  }
+
+  for (l = 0; l < ways; l++) {
+    aes_expand_key(&state[l].hs.b[32], ek);
+    for (j = 0; j < INIT_SIZE_BLK; j++) {
+      x[j] = _mm_loadu_si128((const __m128i*)&state[l].init[j * AES_BLOCK_SIZE]);
+    }
+    for (i = 0; i < init_rounds; i++) {
+      for (j = 0; j < INIT_SIZE_BLK; j++) {
+        x[j] = _mm_xor_si128(x[j], _mm_loadu_si128((const __m128i*)&long_state[l][i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]));
+      }
+      aes_pseudo_round_8(x, ek);
+    }
+    for (j = 0; j < INIT_SIZE_BLK; j++) {
+      _mm_storeu_si128((__m128i*)&state[l].init[j * AES_BLOCK_SIZE], x[j]);
+    }
+    hash_permutation(&state[l].hs);
+    cn_slow_hash_extra(&state[l], output[l]);
+  }
+}
+
+#endif // ENABLE_AESNI
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <random.h>
+#include <util/strencodings.h>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -97,13 +98,97 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+std::string DBProfileName(DBProfileType type)
+{
+    switch (type) {
+    case DBProfileType::DEFAULT: return "default";
+    case DBProfileType::CHAINSTATE: return "chainstate";
+    case DBProfileType::BLOCK_INDEX: return "blockindex";
+    case DBProfileType::EVODB: return "evodb";
+    case DBProfileType::LLMQ: return "llmq";
+    case DBProfileType::INDEX: return "index";
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
+static DBProfile GetBuiltinDBProfile(DBProfileType type)
+{
+    DBProfile profile;
+    switch (type) {
+    case DBProfileType::DEFAULT:
+        break;
+    case DBProfileType::CHAINSTATE:
+        // Point reads of small, obfuscated (and thus incompressible) coins.
+        // Larger files keep the file count and the number of compactions of
+        // a multi-GiB database down.
+        profile.max_file_size = 32 * 1024 * 1024;
+        break;
+    case DBProfileType::BLOCK_INDEX:
+        // Block index entries are read sequentially at startup and the
+        // address indexes are scanned by prefix, which bigger blocks favour.
+        profile.block_size = 16 * 1024;
+        profile.max_file_size = 32 * 1024 * 1024;
+        profile.compression = true;
+        break;
+    case DBProfileType::EVODB:
+        // Few, large values: serialized masternode lists and diffs, which
+        // repeat a lot of scripts and keys between entries.
+        profile.block_size = 32 * 1024;
+        profile.max_file_size = 8 * 1024 * 1024;
+        profile.compression = true;
+        break;
+    case DBProfileType::LLMQ:
+        // Small, short-lived entries that are written and cleaned up all
+        // the time. The defaults suit that best.
+        break;
+    case DBProfileType::INDEX:
+        profile.max_file_size = 32 * 1024 * 1024;
+        break;
+    }
+    return profile;
+}
+
+DBProfile GetDBProfile(DBProfileType type)
+{
+    DBProfile profile = GetBuiltinDBProfile(type);
+    const std::string name = DBProfileName(type);
+    for (const std::string& arg : gArgs.GetArgs("-dbprofile")) {
+        // <db>:<option>=<value>
+        const size_t colon = arg.find(':');
+        const size_t equals = arg.find('=', colon);
+        int64_t value;
+        if (colon == std::string::npos || equals == std::string::npos || !ParseInt64(arg.substr(equals + 1), &value) || value < 0) {
+            LogPrintf("Ignoring invalid -dbprofile=%s\n", arg);
+            continue;
+        }
+        if (arg.substr(0, colon) != name) continue;
+        const std::string option = arg.substr(colon + 1, equals - colon - 1);
+        if (option == "blocksize" && value > 0) {
+            profile.block_size = value;
+        } else if (option == "bloombits") {
+            profile.bloom_bits = value;
+        } else if (option == "writebufferdivisor" && value > 0) {
+            profile.write_buffer_divisor = value;
+        } else if (option == "maxfilesize" && value > 0) {
+            profile.max_file_size = value;
+        } else if (option == "compression") {
+            profile.compression = value != 0;
+        } else {
+            LogPrintf("Ignoring invalid -dbprofile=%s\n", arg);
+        }
+    }
+    return profile;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const DBProfile& profile)
 {
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    options.write_buffer_size = nCacheSize / profile.write_buffer_divisor; // up to two write buffers may be held in memory simultaneously
+    options.block_size = profile.block_size;
+    options.max_file_size = profile.max_file_size;
+    options.filter_policy = profile.bloom_bits > 0 ? leveldb::NewBloomFilterPolicy(profile.bloom_bits) : nullptr;
+    options.compression = profile.compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -114,7 +199,7 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, DBProfileType profile_type)
     : m_name{path.stem().string()}
 {
     penv = nullptr;
@@ -122,7 +207,10 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    const DBProfile profile = GetDBProfile(profile_type);
+    options = GetOptions(nCacheSize, profile);
+    LogPrint(BCLog::LEVELDB, "LevelDB using profile %s: block_size=%u bloom_bits=%d write_buffer_size=%u max_file_size=%u compression=%d\n",
+             DBProfileName(profile_type), profile.block_size, profile.bloom_bits, options.write_buffer_size, profile.max_file_size, profile.compression);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -26,6 +26,37 @@ public:
     explicit dbwrapper_error(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+/** Kinds of databases, each of which gets its own LevelDB tuning */
+enum class DBProfileType {
+    DEFAULT,     //!< Anything without a dedicated profile
+    CHAINSTATE,  //!< chainstate/, the UTXO set
+    BLOCK_INDEX, //!< blocks/index/, including the address, spent and timestamp indexes
+    EVODB,       //!< evodb/, deterministic masternode lists and special transaction data
+    LLMQ,        //!< llmq/, recovered sigs, InstantSend locks and DKG data
+    INDEX,       //!< indexes/, the transaction and block filter indexes
+};
+
+/** LevelDB tuning of one database */
+struct DBProfile {
+    //! Approximate size of user data packed per block
+    size_t block_size{4 * 1024};
+    //! Bits per key of the bloom filter, 0 disables it
+    int bloom_bits{10};
+    //! Each of the (up to two) write buffers gets the cache size divided by this.
+    //! Larger write buffers mean fewer level-0 files and fewer compactions.
+    size_t write_buffer_divisor{4};
+    //! Size of a table file before LevelDB starts the next one
+    size_t max_file_size{2 * 1024 * 1024};
+    //! Compress blocks with Snappy, if LevelDB was built with it
+    bool compression{false};
+};
+
+/** Name of a profile, as used by -dbprofile */
+std::string DBProfileName(DBProfileType type);
+
+/** The built-in profile of a database type with the -dbprofile overrides applied */
+DBProfile GetDBProfile(DBProfileType type);
+
 class CDBWrapper;
 
 /** These should be considered an implementation detail of the specific database.
@@ -240,8 +271,9 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] profile     Which LevelDB tuning to use, see GetDBProfile.
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, DBProfileType profile = DBProfileType::DEFAULT);
     ~CDBWrapper();
 
     CDBWrapper(const CDBWrapper&) = delete;
@@ -14,6 +14,7 @@
 
 #include <evo/deterministicmns.h>
 #include <evo/mnauth.h>
+#include <evo/simplifiedmns.h>
 
 #include <llmq/quorums.h>
 #include <llmq/chainlocks.h>
@@ -72,6 +73,8 @@ void CDSNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, con
     llmq::quorumManager->UpdatedBlockTip(pindexNew, fInitialDownload);
     llmq::quorumDKGSessionManager->UpdatedBlockTip(pindexNew, fInitialDownload);
 
+    UpdateSimplifiedMNListDiffCache(pindexNew);
+
     if (!fDisableGovernance) governance.UpdatedBlockTip(pindexNew, connman);
 }
 
@@ -25,6 +25,7 @@
 #include <uint256.h>
 
 #include <memory>
+#include <optional>
 
 static const std::string DB_LIST_SNAPSHOT = "dmn_S";
 static const std::string DB_LIST_DIFF = "dmn_D";
@@ -162,19 +163,51 @@ static int CompareByLastPaid_GetHeight(const CDeterministicMN& dmn)
     return height;
 }
 
-static bool CompareByLastPaid(const CDeterministicMN& _a, const CDeterministicMN& _b)
+static bool CompareByLastPaid(const CDeterministicMNListColumns& columns, size_t a, size_t b)
 {
-    int ah = CompareByLastPaid_GetHeight(_a);
-    int bh = CompareByLastPaid_GetHeight(_b);
+    int ah = columns.lastPaidHeights[a];
+    int bh = columns.lastPaidHeights[b];
     if (ah == bh) {
-        return _a.proTxHash < _b.proTxHash;
+        return columns.proTxHashes[a] < columns.proTxHashes[b];
     } else {
         return ah < bh;
     }
 }
-static bool CompareByLastPaid(const CDeterministicMN* _a, const CDeterministicMN* _b)
+
+CDeterministicMNListColumns::CDeterministicMNListColumns(const CDeterministicMNList& mnList)
 {
-    return CompareByLastPaid(*_a, *_b);
+    mnList.ForEachMNShared(false, [&](const CDeterministicMNCPtr& dmn) {
+        dmns.emplace_back(dmn);
+    });
+    std::sort(dmns.begin(), dmns.end(), [](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
+        return a->proTxHash < b->proTxHash;
+    });
+
+    const size_t count = dmns.size();
+    proTxHashes.reserve(count);
+    valid.reserve(count);
+    confirmed.reserve(count);
+    confirmedHashesWithProRegTxHash.reserve(count);
+    lastPaidHeights.reserve(count);
+    for (const auto& dmn : dmns) {
+        const auto& state = *dmn->pdmnState;
+        proTxHashes.emplace_back(dmn->proTxHash);
+        valid.emplace_back(CDeterministicMNList::IsMNValid(*dmn));
+        confirmed.emplace_back(!state.confirmedHash.IsNull());
+        confirmedHashesWithProRegTxHash.emplace_back(state.confirmedHashWithProRegTxHash);
+        lastPaidHeights.emplace_back(CompareByLastPaid_GetHeight(*dmn));
+    }
+}
+
+std::shared_ptr<const CDeterministicMNListColumns> CDeterministicMNList::GetColumns() const
+{
+    auto columns = columnsCache.Get();
+    if (!columns) {
+        // concurrent callers might both build it, which is harmless as the result is the same
+        columns = std::make_shared<const CDeterministicMNListColumns>(*this);
+        columnsCache.Set(columns);
+    }
+    return columns;
 }
 
 CDeterministicMNCPtr CDeterministicMNList::GetMNPayee() const
@@ -183,14 +216,16 @@ CDeterministicMNCPtr CDeterministicMNList::GetMNPayee() const
         return nullptr;
     }
 
-    CDeterministicMNCPtr best;
-    ForEachMNShared(true, [&](const CDeterministicMNCPtr& dmn) {
-        if (!best || CompareByLastPaid(dmn.get(), best.get())) {
-            best = dmn;
+    // columns are sorted by proTxHash, so keeping the first of equal heights matches CompareByLastPaid
+    const auto columns = GetColumns();
+    std::optional<size_t> best;
+    for (size_t i = 0; i < columns->size(); i++) {
+        if (columns->valid[i] && (!best || columns->lastPaidHeights[i] < columns->lastPaidHeights[*best])) {
+            best = i;
         }
-    });
+    }
 
-    return best;
+    return best ? columns->dmns[*best] : nullptr;
 }
 
 std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int nCount) const
@@ -198,19 +233,25 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::GetProjectedMNPayees(int
     if (nCount < 0 ) {
         return {};
     }
-    nCount = std::min(nCount, int(GetValidMNsCount()));
-
-    std::vector<CDeterministicMNCPtr> result;
-    result.reserve(nCount);
 
-    ForEachMNShared(true, [&](const CDeterministicMNCPtr& dmn) {
-        result.emplace_back(dmn);
-    });
-    std::sort(result.begin(), result.end(), [&](const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b) {
-        return CompareByLastPaid(a.get(), b.get());
+    const auto columns = GetColumns();
+    std::vector<size_t> order;
+    order.reserve(columns->size());
+    for (size_t i = 0; i < columns->size(); i++) {
+        if (columns->valid[i]) {
+            order.emplace_back(i);
+        }
+    }
+    nCount = std::min(nCount, int(order.size()));
+    std::partial_sort(order.begin(), order.begin() + nCount, order.end(), [&](size_t a, size_t b) {
+        return CompareByLastPaid(*columns, a, b);
     });
 
-    result.resize(nCount);
+    std::vector<CDeterministicMNCPtr> result;
+    result.reserve(nCount);
+    for (int i = 0; i < nCount; i++) {
+        result.emplace_back(columns->dmns[order[i]]);
+    }
 
     return result;
 }
@@ -239,13 +280,17 @@ std::vector<CDeterministicMNCPtr> CDeterministicMNList::CalculateQuorum(size_t m
 
 std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList::CalculateScores(const uint256& modifier) const
 {
+    const auto columns = GetColumns();
     std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> scores;
-    scores.reserve(GetAllMNsCount());
-    ForEachMNShared(true, [&](const CDeterministicMNCPtr& dmn) {
-        if (dmn->pdmnState->confirmedHash.IsNull()) {
+    scores.reserve(columns->size());
+    for (size_t i = 0; i < columns->size(); i++) {
+        if (!columns->valid[i]) {
+            continue;
+        }
+        if (!columns->confirmed[i]) {
             // we only take confirmed MNs into account to avoid hash grinding on the ProRegTxHash to sneak MNs into a
             // future quorums
-            return;
+            continue;
         }
         // calculate sha256(sha256(proTxHash, confirmedHash), modifier) per MN
         // Please note that this is not a double-sha256 but a single-sha256
@@ -253,12 +298,13 @@ std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> CDeterministicMNList
         // TODO When https://github.com/bitcoin/bitcoin/pull/13191 gets backported, implement something that is similar but for single-sha256
         uint256 h;
         CSHA256 sha256;
-        sha256.Write(dmn->pdmnState->confirmedHashWithProRegTxHash.begin(), dmn->pdmnState->confirmedHashWithProRegTxHash.size());
+        const uint256& confirmedHashWithProRegTxHash = columns->confirmedHashesWithProRegTxHash[i];
+        sha256.Write(confirmedHashWithProRegTxHash.begin(), confirmedHashWithProRegTxHash.size());
         sha256.Write(modifier.begin(), modifier.size());
         sha256.Finalize(h.begin());
 
-        scores.emplace_back(UintToArith256(h), dmn);
-    });
+        scores.emplace_back(UintToArith256(h), columns->dmns[i]);
+    }
 
     return scores;
 }
@@ -357,24 +403,24 @@ CSimplifiedMNListDiff CDeterministicMNList::BuildSimplifiedDiff(const CDetermini
     diffRet.baseBlockHash = blockHash;
     diffRet.blockHash = to.blockHash;
 
-    to.ForEachMN(false, [&](auto& toPtr) {
-        auto fromPtr = GetMN(toPtr.proTxHash);
-        if (fromPtr == nullptr) {
-            diffRet.mnList.emplace_back(toPtr);
+    // both column sets are sorted by proTxHash, which turns the diff into a single merge pass
+    const auto fromColumns = GetColumns();
+    const auto toColumns = to.GetColumns();
+    size_t i = 0, j = 0;
+    while (i < fromColumns->size() || j < toColumns->size()) {
+        if (j == toColumns->size() || (i < fromColumns->size() && fromColumns->proTxHashes[i] < toColumns->proTxHashes[j])) {
+            diffRet.deletedMNs.emplace_back(fromColumns->proTxHashes[i++]);
+        } else if (i == fromColumns->size() || toColumns->proTxHashes[j] < fromColumns->proTxHashes[i]) {
+            diffRet.mnList.emplace_back(*toColumns->dmns[j++]);
         } else {
-            CSimplifiedMNListEntry sme1(toPtr);
-            CSimplifiedMNListEntry sme2(*fromPtr);
-            if (sme1 != sme2) {
-                diffRet.mnList.emplace_back(toPtr);
+            // unchanged masternodes are shared between the lists
+            const auto& fromPtr = fromColumns->dmns[i++];
+            const auto& toPtr = toColumns->dmns[j++];
+            if (fromPtr != toPtr && CSimplifiedMNListEntry(*toPtr) != CSimplifiedMNListEntry(*fromPtr)) {
+                diffRet.mnList.emplace_back(*toPtr);
             }
         }
-    });
-    ForEachMN(false, [&](auto& fromPtr) {
-        auto toPtr = to.GetMN(fromPtr.proTxHash);
-        if (toPtr == nullptr) {
-            diffRet.deletedMNs.emplace_back(fromPtr.proTxHash);
-        }
-    });
+    }
 
     return diffRet;
 }
@@ -406,6 +452,7 @@ CDeterministicMNList CDeterministicMNList::ApplyDiff(const CBlockIndex* pindex,
 void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn, bool fBumpTotalCount)
 {
     assert(dmn != nullptr);
+    columnsCache.Reset();
 
     if (mnMap.find(dmn->proTxHash)) {
         throw(std::runtime_error(strprintf("%s: Can't add a masternode with a duplicate proTxHash=%s", __func__, dmn->proTxHash.ToString())));
@@ -449,6 +496,7 @@ void CDeterministicMNList::AddMN(const CDeterministicMNCPtr& dmn, bool fBumpTota
 
 void CDeterministicMNList::UpdateMN(const CDeterministicMN& oldDmn, const std::shared_ptr<const CDeterministicMNState>& pdmnState)
 {
+    columnsCache.Reset();
     auto dmn = std::make_shared<CDeterministicMN>(oldDmn);
     auto oldState = dmn->pdmnState;
     dmn->pdmnState = pdmnState;
@@ -495,6 +543,7 @@ void CDeterministicMNList::UpdateMN(const CDeterministicMN& oldDmn, const CDeter
 
 void CDeterministicMNList::RemoveMN(const uint256& proTxHash)
 {
+    columnsCache.Reset();
     auto dmn = GetMN(proTxHash);
     if (!dmn) {
         throw(std::runtime_error(strprintf("%s: Can't find a masternode with proTxHash=%s", __func__, proTxHash.ToString())));
@@ -18,6 +18,8 @@
 
 #include <immer/map.hpp>
 
+#include <atomic>
+#include <memory>
 #include <unordered_map>
 #include <utility>
 
@@ -94,8 +96,36 @@ public:
 };
 using CDeterministicMNCPtr = std::shared_ptr<const CDeterministicMN>;
 
+class CDeterministicMNList;
 class CDeterministicMNListDiff;
 
+/**
+ * Read-only, columnar copy of a CDeterministicMNList. All columns are sorted by proTxHash and indexed the same way,
+ * so that scans over the whole list (payee selection, quorum scores, diffs) walk contiguous arrays instead of
+ * chasing the shared pointers of the list and the states. Only the fields these scans read are copied, anything
+ * else (e.g. the simplified entries of masternodes that changed between two lists) is read through dmns. Never
+ * modified after construction.
+ */
+class CDeterministicMNListColumns
+{
+public:
+    explicit CDeterministicMNListColumns(const CDeterministicMNList& mnList);
+
+    size_t size() const
+    {
+        return dmns.size();
+    }
+
+    std::vector<CDeterministicMNCPtr> dmns;
+    std::vector<uint256> proTxHashes;
+
+    // derived from the state
+    std::vector<uint8_t> valid;
+    std::vector<uint8_t> confirmed;
+    std::vector<uint256> confirmedHashesWithProRegTxHash;
+    std::vector<int> lastPaidHeights; // as used for payee ordering, i.e. including revival and registration
+};
+
 template <typename Stream, typename K, typename T, typename Hash, typename Equal>
 void SerializeImmerMap(Stream& os, const immer::map<K, T, Hash, Equal>& m)
 {
@@ -155,6 +185,27 @@ private:
     // we keep track of this as checking for duplicates would otherwise be painfully slow
     MnUniquePropertyMap mnUniquePropertyMap;
 
+    // Lazily built by GetColumns() and shared by copies of the list, until a copy is modified
+    class ColumnsCache
+    {
+    private:
+        std::shared_ptr<const CDeterministicMNListColumns> columns;
+
+    public:
+        ColumnsCache() = default;
+        ColumnsCache(const ColumnsCache& r) : columns(std::atomic_load(&r.columns)) {}
+        ColumnsCache& operator=(const ColumnsCache& r)
+        {
+            std::atomic_store(&columns, std::atomic_load(&r.columns));
+            return *this;
+        }
+
+        std::shared_ptr<const CDeterministicMNListColumns> Get() const { return std::atomic_load(&columns); }
+        void Set(std::shared_ptr<const CDeterministicMNListColumns> _columns) { std::atomic_store(&columns, std::move(_columns)); }
+        void Reset() { Set(nullptr); }
+    };
+    mutable ColumnsCache columnsCache;
+
 public:
     CDeterministicMNList() = default;
     explicit CDeterministicMNList(const uint256& _blockHash, int _height, uint32_t _totalRegisteredCount) :
@@ -188,6 +239,7 @@ public:
         mnMap = MnMap();
         mnUniquePropertyMap = MnUniquePropertyMap();
         mnInternalIdMap = MnInternalIdMap();
+        columnsCache.Reset();
 
         SerializationOpBase(s, CSerActionUnserialize());
 
@@ -261,6 +313,12 @@ public:
         return nTotalRegisteredCount;
     }
 
+    /**
+     * Columnar snapshot of this list, built on first use. Prefer it over ForEachMN for scans over the whole list
+     * that only need a few fields of each masternode.
+     */
+    std::shared_ptr<const CDeterministicMNListColumns> GetColumns() const;
+
     bool IsMNValid(const uint256& proTxHash) const;
     bool IsMNPoSeBanned(const uint256& proTxHash) const;
     static bool IsMNValid(const CDeterministicMN& dmn);
@@ -12,7 +12,10 @@
 #include <evo/specialtx.h>
 
 #include <pubkey.h>
+#include <saltedhasher.h>
 #include <serialize.h>
+#include <sync.h>
+#include <unordered_lru_cache.h>
 #include <version.h>
 
 #include <base58.h>
@@ -22,6 +25,31 @@
 #include <validation.h>
 #include <key_io.h>
 
+#include <list>
+#include <map>
+#include <optional>
+#include <set>
+
+/** Number of diffs kept for repeated requests of the same (base, block) pair */
+static const size_t MNLISTDIFF_CACHE_SIZE = 32;
+/** Number of base blocks whose diff to the tip is carried forward when a new tip is connected */
+static const size_t MAX_MNLISTDIFF_TIP_BASES = 8;
+
+namespace {
+struct CachedSimplifiedMNListDiff
+{
+    std::shared_ptr<const CSimplifiedMNListDiff> diff;
+    // Entries in the base list of the masternodes in diff->mnList, empty for the ones that were not in the base list.
+    // Needed to carry the diff forward without loading the base list again
+    std::map<uint256, std::optional<CSimplifiedMNListEntry>> baseEntries;
+};
+} // namespace
+
+static CCriticalSection cs_mnlistdiff_cache;
+static unordered_lru_cache<uint256, CachedSimplifiedMNListDiff, StaticSaltedHasher> mnListDiffCache GUARDED_BY(cs_mnlistdiff_cache){MNLISTDIFF_CACHE_SIZE};
+// Base block hashes, as requested, of the most recent requests for a diff to the tip. Most recent last
+static std::list<uint256> mnListDiffTipBases GUARDED_BY(cs_mnlistdiff_cache);
+
 CSimplifiedMNListEntry::CSimplifiedMNListEntry(const CDeterministicMN& dmn) :
     proRegTxHash(dmn.proTxHash),
     confirmedHash(dmn.pdmnState->confirmedHash),
@@ -186,7 +214,173 @@ void CSimplifiedMNListDiff::ToJson(UniValue& obj) const
     }
 }
 
-bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet)
+static uint256 GetMNListDiffCacheKey(const uint256& baseBlockHash, const uint256& blockHash)
+{
+    return ::SerializeHash(std::make_pair(baseBlockHash, blockHash));
+}
+
+static void AddMNListDiffTipBase(const uint256& baseBlockHash) EXCLUSIVE_LOCKS_REQUIRED(cs_mnlistdiff_cache)
+{
+    mnListDiffTipBases.remove(baseBlockHash);
+    mnListDiffTipBases.emplace_back(baseBlockHash);
+    if (mnListDiffTipBases.size() > MAX_MNLISTDIFF_TIP_BASES) {
+        mnListDiffTipBases.pop_front();
+    }
+}
+
+// Combines the diff from some base to the previous tip with the diff from the previous tip to the new one. The result
+// is the same as a diff built from the base list, including the order of all entries
+static CachedSimplifiedMNListDiff ExtendMNListDiff(const CachedSimplifiedMNListDiff& cached, const CDeterministicMNList& prevList, const CSimplifiedMNListDiff& stepDiff)
+{
+    const auto& prevDiff = *cached.diff;
+    auto baseEntries = cached.baseEntries;
+    std::map<uint256, CSimplifiedMNListEntry> mnList;
+    for (const auto& sme : prevDiff.mnList) {
+        mnList.emplace(sme.proRegTxHash, sme);
+    }
+    std::set<uint256> deletedMNs(prevDiff.deletedMNs.begin(), prevDiff.deletedMNs.end());
+
+    for (const auto& proTxHash : stepDiff.deletedMNs) {
+        auto it = baseEntries.find(proTxHash);
+        if (it == baseEntries.end()) {
+            // unchanged since the base
+            deletedMNs.emplace(proTxHash);
+            continue;
+        }
+        if (it->second) {
+            deletedMNs.emplace(proTxHash);
+        }
+        mnList.erase(proTxHash);
+        baseEntries.erase(it);
+    }
+    for (const auto& sme : stepDiff.mnList) {
+        auto it = baseEntries.find(sme.proRegTxHash);
+        if (it == baseEntries.end()) {
+            // unchanged since the base, so the base entry is the one in the previous list, if any
+            auto dmn = prevList.GetMN(sme.proRegTxHash);
+            it = baseEntries.emplace(sme.proRegTxHash, dmn ? std::make_optional(CSimplifiedMNListEntry(*dmn)) : std::nullopt).first;
+        }
+        if (it->second && *it->second == sme) {
+            // back to the state of the base
+            mnList.erase(sme.proRegTxHash);
+            baseEntries.erase(it);
+        } else {
+            mnList.insert_or_assign(sme.proRegTxHash, sme);
+        }
+    }
+
+    std::set<std::pair<uint8_t, uint256>> deletedQuorums(prevDiff.deletedQuorums.begin(), prevDiff.deletedQuorums.end());
+    std::map<std::pair<uint8_t, uint256>, llmq::CFinalCommitment> newQuorums;
+    for (const auto& qc : prevDiff.newQuorums) {
+        newQuorums.emplace(std::make_pair((uint8_t)qc.llmqType, qc.quorumHash), qc);
+    }
+    for (const auto& p : stepDiff.deletedQuorums) {
+        if (newQuorums.erase(p) == 0) {
+            deletedQuorums.emplace(p);
+        }
+    }
+    for (const auto& qc : stepDiff.newQuorums) {
+        auto p = std::make_pair((uint8_t)qc.llmqType, qc.quorumHash);
+        if (deletedQuorums.erase(p) == 0) {
+            newQuorums.emplace(p, qc);
+        }
+    }
+
+    auto diff = std::make_shared<CSimplifiedMNListDiff>();
+    diff->baseBlockHash = prevDiff.baseBlockHash;
+    diff->blockHash = stepDiff.blockHash;
+    diff->cbTxMerkleTree = stepDiff.cbTxMerkleTree;
+    diff->cbTx = stepDiff.cbTx;
+    diff->deletedMNs.assign(deletedMNs.begin(), deletedMNs.end());
+    diff->mnList.reserve(mnList.size());
+    for (auto& p : mnList) {
+        diff->mnList.emplace_back(std::move(p.second));
+    }
+    diff->deletedQuorums.assign(deletedQuorums.begin(), deletedQuorums.end());
+    diff->newQuorums.reserve(newQuorums.size());
+    for (auto& p : newQuorums) {
+        diff->newQuorums.emplace_back(std::move(p.second));
+    }
+    return CachedSimplifiedMNListDiff{std::move(diff), std::move(baseEntries)};
+}
+
+// Builds the diff between two blocks of the active chain from the base list, without going through the cache
+static bool BuildSimplifiedMNListDiffUncached(const CBlockIndex* baseBlockIndex, const CBlockIndex* blockIndex, const CDeterministicMNList& baseDmnList, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+
+    LOCK(deterministicMNManager->cs);
+
+    auto dmnList = deterministicMNManager->GetListForBlock(blockIndex);
+    mnListDiffRet = baseDmnList.BuildSimplifiedDiff(dmnList);
+
+    if (!mnListDiffRet.BuildQuorumsDiff(baseBlockIndex, blockIndex)) {
+        errorRet = strprintf("failed to build quorums diff");
+        return false;
+    }
+
+    // TODO store coinbase TX in CBlockIndex
+    CBlock block;
+    if (!ReadBlockFromDisk(block, blockIndex, Params().GetConsensus())) {
+        errorRet = strprintf("failed to read block %s from disk", blockIndex->GetBlockHash().ToString());
+        return false;
+    }
+
+    mnListDiffRet.cbTx = block.vtx[0];
+
+    std::vector<uint256> vHashes;
+    std::vector<bool> vMatch(block.vtx.size(), false);
+    for (const auto& tx : block.vtx) {
+        vHashes.emplace_back(tx->GetHash());
+    }
+    vMatch[0] = true; // only coinbase matches
+    mnListDiffRet.cbTxMerkleTree = CPartialMerkleTree(vHashes, vMatch);
+
+    return true;
+}
+
+void UpdateSimplifiedMNListDiffCache(const CBlockIndex* pindexNew)
+{
+    if (pindexNew->pprev == nullptr) {
+        return;
+    }
+    const uint256 blockHash = pindexNew->GetBlockHash();
+
+    std::vector<std::pair<uint256, CachedSimplifiedMNListDiff>> toExtend;
+    {
+        LOCK(cs_mnlistdiff_cache);
+        for (const auto& baseBlockHash : mnListDiffTipBases) {
+            CachedSimplifiedMNListDiff cached;
+            if (mnListDiffCache.get(GetMNListDiffCacheKey(baseBlockHash, pindexNew->pprev->GetBlockHash()), cached)) {
+                toExtend.emplace_back(baseBlockHash, std::move(cached));
+            }
+        }
+    }
+    if (toExtend.empty()) {
+        return;
+    }
+
+    LOCK(cs_main);
+    if (!::ChainActive().Contains(pindexNew)) {
+        // the new tip has already been reorged away
+        return;
+    }
+    // The one-block step is only needed here, it is not kept in the cache
+    auto prevList = deterministicMNManager->GetListForBlock(pindexNew->pprev);
+    CSimplifiedMNListDiff stepDiff;
+    std::string strError;
+    if (!BuildSimplifiedMNListDiffUncached(pindexNew->pprev, pindexNew, prevList, stepDiff, strError)) {
+        return;
+    }
+
+    for (const auto& p : toExtend) {
+        auto extended = ExtendMNListDiff(p.second, prevList, stepDiff);
+        LOCK(cs_mnlistdiff_cache);
+        mnListDiffCache.insert(GetMNListDiffCacheKey(p.first, blockHash), extended);
+    }
+}
+
+bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet, bool fUseCache)
 {
     AssertLockHeld(cs_main);
     mnListDiffRet = CSimplifiedMNListDiff();
@@ -215,38 +409,57 @@ bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& bloc
         return false;
     }
 
-    LOCK(deterministicMNManager->cs);
+    // The diff only depends on the two blocks, which are both in the active chain
+    const uint256 cacheKey = GetMNListDiffCacheKey(baseBlockHash, blockHash);
+    const bool fTrackAsTipBase = blockIndex == ::ChainActive().Tip();
+    if (fUseCache) {
+        LOCK(cs_mnlistdiff_cache);
+        CachedSimplifiedMNListDiff cached;
+        if (mnListDiffCache.get(cacheKey, cached)) {
+            if (fTrackAsTipBase) {
+                AddMNListDiffTipBase(baseBlockHash);
+            }
+            mnListDiffRet = *cached.diff;
+            return true;
+        }
+    }
 
     auto baseDmnList = deterministicMNManager->GetListForBlock(baseBlockIndex);
-    auto dmnList = deterministicMNManager->GetListForBlock(blockIndex);
-    mnListDiffRet = baseDmnList.BuildSimplifiedDiff(dmnList);
+    if (!BuildSimplifiedMNListDiffUncached(baseBlockIndex, blockIndex, baseDmnList, mnListDiffRet, errorRet)) {
+        return false;
+    }
 
     // We need to return the value that was provided by the other peer as it otherwise won't be able to recognize the
     // response. This will usually be identical to the block found in baseBlockIndex. The only difference is when a
     // null block hash was provided to get the diff from the genesis block.
     mnListDiffRet.baseBlockHash = baseBlockHash;
 
-    if (!mnListDiffRet.BuildQuorumsDiff(baseBlockIndex, blockIndex)) {
-        errorRet = strprintf("failed to build quorums diff");
-        return false;
+    if (!fUseCache) {
+        return true;
     }
 
-    // TODO store coinbase TX in CBlockIndex
-    CBlock block;
-    if (!ReadBlockFromDisk(block, blockIndex, Params().GetConsensus())) {
-        errorRet = strprintf("failed to read block %s from disk", blockHash.ToString());
-        return false;
+    CachedSimplifiedMNListDiff cached;
+    cached.diff = std::make_shared<const CSimplifiedMNListDiff>(mnListDiffRet);
+    for (const auto& sme : mnListDiffRet.mnList) {
+        auto dmn = baseDmnList.GetMN(sme.proRegTxHash);
+        cached.baseEntries.emplace(sme.proRegTxHash, dmn ? std::make_optional(CSimplifiedMNListEntry(*dmn)) : std::nullopt);
+    }
+    LOCK(cs_mnlistdiff_cache);
+    mnListDiffCache.insert(cacheKey, cached);
+    if (fTrackAsTipBase) {
+        AddMNListDiffTipBase(baseBlockHash);
     }
 
-    mnListDiffRet.cbTx = block.vtx[0];
+    return true;
+}
 
-    std::vector<uint256> vHashes;
-    std::vector<bool> vMatch(block.vtx.size(), false);
-    for (const auto& tx : block.vtx) {
-        vHashes.emplace_back(tx->GetHash());
+bool GetCachedSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet)
+{
+    LOCK(cs_mnlistdiff_cache);
+    CachedSimplifiedMNListDiff cached;
+    if (!mnListDiffCache.get(GetMNListDiffCacheKey(baseBlockHash, blockHash), cached)) {
+        return false;
     }
-    vMatch[0] = true; // only coinbase matches
-    mnListDiffRet.cbTxMerkleTree = CPartialMerkleTree(vHashes, vMatch);
-
+    mnListDiffRet = *cached.diff;
     return true;
 }
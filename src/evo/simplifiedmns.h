@@ -119,6 +119,17 @@ public:
     void ToJson(UniValue& obj) const;
 };
 
-bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet);
+/**
+ * Builds the diff between the masternode lists of two blocks of the active chain. Recent diffs are served from and kept
+ * in a cache unless fUseCache is false.
+ */
+bool BuildSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet, std::string& errorRet, bool fUseCache = true);
+/** Looks a diff up in the cache of recent diffs only */
+bool GetCachedSimplifiedMNListDiff(const uint256& baseBlockHash, const uint256& blockHash, CSimplifiedMNListDiff& mnListDiffRet);
+/**
+ * Carries the cached diffs of the most recently requested base blocks to the previous tip forward to pindexNew, so
+ * that light clients asking for the new tip don't need the base lists to be loaded again.
+ */
+void UpdateSimplifiedMNListDiffCache(const CBlockIndex* pindexNew);
 
 #endif // BITCOIN_EVO_SIMPLIFIEDMNS_H
@@ -159,6 +159,50 @@ bool ProcessSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex, CV
     return true;
 }
 
+bool CheckSpecialTxsInMinedBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, const CCoinsViewCache& view)
+{
+    AssertLockHeld(cs_main);
+
+    try {
+        for (const auto& ptr_tx : block.vtx) {
+            if (!CheckSpecialTx(*ptr_tx, pindex->pprev, state, view, true)) {
+                // pass the state returned by the function above
+                return false;
+            }
+        }
+
+        if (!llmq::quorumBlockProcessor->CheckMinedBlock(block, pindex, state)) {
+            // pass the state returned by the function above
+            return false;
+        }
+
+        // The masternode list evodb holds for the block must be the one the block builds from the list before it
+        if (pindex->nHeight >= Params().GetConsensus().DIP0003Height) {
+            LOCK(deterministicMNManager->cs);
+            CDeterministicMNList newList;
+            if (!deterministicMNManager->BuildNewListFromBlock(block, pindex->pprev, state, view, newList, false)) {
+                // pass the state returned by the function above
+                return false;
+            }
+            const auto minedList = deterministicMNManager->GetListForBlock(pindex);
+            if (minedList.BuildDiff(newList).HasChanges() || minedList.GetTotalRegisteredCount() != newList.GetTotalRegisteredCount()) {
+                return state.DoS(100, false, REJECT_INVALID, "bad-dmn-mined-list");
+            }
+        }
+
+        // Both merkle roots of the coinbase are always checked, they are what ties evodb to the blocks
+        if (!CheckCbTxMerkleRoots(block, pindex, state, view)) {
+            // pass the state returned by the function above
+            return false;
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("%s -- failed: %s\n", __func__, e.what());
+        return state.DoS(100, false, REJECT_INVALID, "failed-chkspectxsinblock");
+    }
+
+    return true;
+}
+
 bool UndoSpecialTxsInBlock(const CBlock& block, const CBlockIndex* pindex)
 {
     AssertLockHeld(cs_main);
@@ -7,9 +7,64 @@
 
 #include <flatfile.h>
 #include <logging.h>
+#include <sync.h>
 #include <tinyformat.h>
+#include <unordered_lru_cache.h>
 #include <util/system.h>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using MappedFlatFileCache = unordered_lru_cache<std::string, std::shared_ptr<const MappedFlatFile>, std::hash<std::string>>;
+
+static Mutex g_mapped_files_mutex;
+static std::unique_ptr<MappedFlatFileCache> g_mapped_files GUARDED_BY(g_mapped_files_mutex);
+
+MappedFlatFile::MappedFlatFile(const fs::path& path)
+{
+#ifndef WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            m_data = static_cast<const unsigned char*>(data);
+            m_size = st.st_size;
+        } else {
+            LogPrintf("Unable to map file %s\n", path.string());
+        }
+    }
+    // The mapping keeps its own reference to the file
+    close(fd);
+#endif
+}
+
+MappedFlatFile::~MappedFlatFile()
+{
+#ifndef WIN32
+    if (m_data) {
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+    }
+#endif
+}
+
+void SetMappedFlatFileLimit(size_t max_files)
+{
+    LOCK(g_mapped_files_mutex);
+    if (max_files == 0) {
+        g_mapped_files.reset();
+    } else {
+        g_mapped_files = std::make_unique<MappedFlatFileCache>(max_files, max_files);
+    }
+}
+
 FlatFileSeq::FlatFileSeq(fs::path dir, const char* prefix, size_t chunk_size) :
     m_dir(std::move(dir)),
     m_prefix(prefix),
@@ -52,6 +107,39 @@ FILE* FlatFileSeq::Open(const FlatFilePos& pos, bool read_only)
     return file;
 }
 
+std::shared_ptr<const MappedFlatFile> FlatFileSeq::Map(const FlatFilePos& pos, size_t size)
+{
+    if (pos.IsNull()) {
+        return nullptr;
+    }
+    const std::string key = FileName(pos).string();
+
+    LOCK(g_mapped_files_mutex);
+    if (!g_mapped_files) {
+        return nullptr;
+    }
+    std::shared_ptr<const MappedFlatFile> file;
+    if (g_mapped_files->get(key, file) && (uint64_t)pos.nPos + size <= file->size()) {
+        return file;
+    }
+    // Not mapped yet, or the file grew since it was
+    file = std::make_shared<const MappedFlatFile>(FileName(pos));
+    if (file->IsNull() || (uint64_t)pos.nPos + size > file->size()) {
+        g_mapped_files->erase(key);
+        return nullptr;
+    }
+    g_mapped_files->insert(key, file);
+    return file;
+}
+
+void FlatFileSeq::Unmap(const FlatFilePos& pos)
+{
+    LOCK(g_mapped_files_mutex);
+    if (g_mapped_files) {
+        g_mapped_files->erase(FileName(pos).string());
+    }
+}
+
 size_t FlatFileSeq::Allocate(const FlatFilePos& pos, size_t add_size, bool& out_of_space)
 {
     out_of_space = false;
@@ -84,9 +172,13 @@ bool FlatFileSeq::Flush(const FlatFilePos& pos, bool finalize)
     if (!file) {
         return error("%s: failed to open file %d", __func__, pos.nFile);
     }
-    if (finalize && !TruncateFile(file, pos.nPos)) {
-        fclose(file);
-        return error("%s: failed to truncate file %d", __func__, pos.nFile);
+    if (finalize) {
+        if (!TruncateFile(file, pos.nPos)) {
+            fclose(file);
+            return error("%s: failed to truncate file %d", __func__, pos.nFile);
+        }
+        // Don't keep a mapping of the pre-allocated space that was cut off
+        Unmap(pos);
     }
     if (!FileCommit(file)) {
         fclose(file);
@@ -6,10 +6,12 @@
 #ifndef BITCOIN_FLATFILE_H
 #define BITCOIN_FLATFILE_H
 
+#include <memory>
 #include <string>
 
 #include <fs.h>
 #include <serialize.h>
+#include <span.h>
 
 struct FlatFilePos
 {
@@ -42,6 +44,36 @@ struct FlatFilePos
     std::string ToString() const;
 };
 
+/**
+ * A read-only memory mapping of a whole flat file. The mapping stays valid
+ * while the file is appended to or deleted, but only covers the bytes the
+ * file had when it was mapped.
+ */
+class MappedFlatFile
+{
+private:
+    const unsigned char* m_data{nullptr};
+    size_t m_size{0};
+
+public:
+    /** Map the file at path, or leave the mapping null if that fails. */
+    explicit MappedFlatFile(const fs::path& path);
+    ~MappedFlatFile();
+
+    MappedFlatFile(const MappedFlatFile&) = delete;
+    MappedFlatFile& operator=(const MappedFlatFile&) = delete;
+
+    bool IsNull() const { return m_data == nullptr; }
+    size_t size() const { return m_size; }
+    Span<const unsigned char> GetSpan() const { return {m_data, m_size}; }
+};
+
+/**
+ * Set the number of flat files that are kept mapped by FlatFileSeq::Map, the
+ * least recently used one being unmapped first. 0 disables mapping.
+ */
+void SetMappedFlatFileLimit(size_t max_files);
+
 /**
  * FlatFileSeq represents a sequence of numbered files storing raw data. This class facilitates
  * access to and efficient management of these files.
@@ -69,6 +101,19 @@ public:
     /** Open a handle to the file at the given position. */
     FILE* Open(const FlatFilePos& pos, bool read_only = false);
 
+    /**
+     * Get a memory mapping of the file at the given position, which covers at least the given
+     * number of bytes from pos.nPos on. Mappings are shared between all sequences and remapped
+     * when the file has grown past them.
+     *
+     * @return The mapping, or nullptr if mapping is disabled or failed; read the file with Open
+     *         in that case.
+     */
+    std::shared_ptr<const MappedFlatFile> Map(const FlatFilePos& pos, size_t size);
+
+    /** Drop the mapping of the file at the given position, if there is one. */
+    void Unmap(const FlatFilePos& pos);
+
     /**
      * Allocate additional space in a file after the given starting position. The amount allocated
      * will be the minimum multiple of the sequence chunk size greater than add_size.
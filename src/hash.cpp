@@ -6,6 +6,8 @@
 #include <crypto/common.h>
 #include <crypto/hmac_sha512.h>
 
+#include <algorithm>
+
 
 inline uint32_t ROTL32(uint32_t x, int8_t r)
 {
@@ -75,3 +77,56 @@ void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char he
     CHMAC_SHA512(chainCode.begin(), chainCode.size()).Write(&header, 1).Write(data, 32).Write(num, 4).Finalize(output);
 }
 
+MikeCnWays GetMikeCnWays(size_t maxWays, size_t cacheBytes)
+{
+    MikeCnWays cnWays;
+    for (size_t variant = 0; variant < MIKE_CN_VARIANTS; ++variant) {
+        size_t ways = std::min<size_t>(std::max<size_t>(maxWays, 1), CN_MAX_WAYS);
+        while (ways > 1 && ways * CN_PAGE_SIZES[variant] > cacheBytes / 2) {
+            --ways;
+        }
+        cnWays.ways[variant] = ways;
+    }
+    return cnWays;
+}
+
+void MikeMulti(uint256* output, const unsigned char* const* input, size_t len, size_t count, const MikeSchedule& schedule, const MikeCnWays& cnWays)
+{
+    static_assert(!MIKE_CN_STAGES[0], "the first stage hashes the input with a core hash");
+    static constexpr size_t LAST = MIKE_CN_STAGES.size() - 1;
+
+    while (count > 0) {
+        const size_t lanes = std::min(count, MIKE_MAX_LANES);
+        // The hashes of all lanes are kept back to back, alternating between two buffers
+        uint512 hash[2][MIKE_MAX_LANES];
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            CORE_HASH_FUNCTIONS[schedule.coreHashIndexes[0]](input[lane], len, &hash[0][lane]);
+        }
+        size_t core = 1;
+        size_t cn = 0;
+        for (size_t i = 1; i < MIKE_CN_STAGES.size(); ++i) {
+            const uint512* in = hash[(i - 1) & 1];
+            uint512* out = hash[i & 1];
+            if (MIKE_CN_STAGES[i]) {
+                const uint8_t variant = schedule.cnIndexes[cn++];
+                for (size_t lane = 0; lane < lanes; ++lane) {
+                    // CryptoNight only writes the lower half, the upper half has to be zero as in Mike
+                    out[lane].SetNull();
+                }
+                for (size_t lane = 0; lane < lanes;) {
+                    const size_t ways = std::min<size_t>(cnWays[variant], lanes - lane);
+                    CN_MULTI_HASH_FUNCTIONS[variant](&in[lane], &out[lane], ways);
+                    lane += ways;
+                }
+            } else {
+                SphHash512_64(static_cast<SphAlgo>(schedule.coreHashIndexes[core++]), out[0].begin(), in[0].begin(), lanes);
+            }
+        }
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            output[lane] = hash[LAST & 1][lane].trim256();
+        }
+        output += lanes;
+        input += lanes;
+        count -= lanes;
+    }
+}
@@ -16,6 +16,7 @@
 #include <version.h>
 #include <hash_selection.h>
 
+#include <array>
 #include <vector>
 
 typedef uint256 ChainCode;
@@ -267,45 +268,70 @@ void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char he
 
 
 /* ----------- Mike Hash ------------------------------------------------ */
+/** Stages of the Mike chain which run a CryptoNight variant; all others run a core hash */
+static constexpr std::array<bool, 14> MIKE_CN_STAGES{{
+    false, false, false, false, false, true,
+    false, false, false, false, false, true,
+    false, true
+}};
+
 template <typename T1>
-inline uint256 Mike(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
+inline uint256 Mike(const T1 pbegin, const T1 pend, const MikeSchedule& schedule)
 {
     static unsigned char pblank[1];
 
-    uint512 hash[14];
-    HashSelection hashSelection(PrevBlockHash, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10}, {0, 1, 2, 3, 4, 5});
-    std::vector<int> randomCNs(hashSelection.getCnIndexes());
-    std::vector<int> coreHashIndexes(hashSelection.getAlgoIndexes());
-    for (int i = 0; i < 14; ++i) {
-        const void* toHash;
-        int lenToHash;
-        if (i == 0) {
-            toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
-            lenToHash = (pend - pbegin) * sizeof(pbegin[0]);
+    // Zero initialized: CryptoNight stages only write the lower half of their hash
+    uint512 hash[MIKE_CN_STAGES.size()];
+    const void* toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
+    size_t lenToHash = (pend - pbegin) * sizeof(pbegin[0]);
+    size_t core = 0;
+    size_t cn = 0;
+    for (size_t i = 0; i < MIKE_CN_STAGES.size(); ++i) {
+        if (MIKE_CN_STAGES[i]) {
+            CN_HASH_FUNCTIONS[schedule.cnIndexes[cn++]](&hash[i - 1], &hash[i]);
         } else {
-            toHash = static_cast<const void*>(&hash[i - 1]);
-            lenToHash = 64;
+            CORE_HASH_FUNCTIONS[schedule.coreHashIndexes[core++]](toHash, lenToHash, &hash[i]);
         }
-        int coreSelection = -1;
-        int cnSelection   = -1;
-        if (i < 5) {
-            coreSelection = coreHashIndexes[i];
-        } else if (i == 5) {
-            cnSelection = randomCNs[0];
-        } else if (i < 11) {
-            coreSelection = coreHashIndexes[i - 1];
-        } else if (i == 11) {
-            cnSelection = randomCNs[1];
-        } else if (i < 13) {
-            coreSelection = coreHashIndexes[i - 2];
-        } else if (i == 13) {
-            cnSelection = randomCNs[2];
-        }
-
-        coreHash(toHash, &hash[i], lenToHash, coreSelection);
-        cnHash(&hash[i - 1], &hash[i], lenToHash, cnSelection);
+        toHash = &hash[i];
+        lenToHash = 64;
     }
-    return hash[13].trim256();
+    return hash[MIKE_CN_STAGES.size() - 1].trim256();
 }
 
+template <typename T1>
+inline uint256 Mike(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
+{
+    return Mike(pbegin, pend, MikeSchedule(PrevBlockHash));
+}
+
+/** Number of inputs MikeMulti runs side by side */
+static constexpr size_t MIKE_MAX_LANES = 4;
+
+/** Number of CryptoNight hashes MikeMulti interleaves, by CryptoNight variant */
+struct MikeCnWays
+{
+    std::array<uint8_t, MIKE_CN_VARIANTS> ways;
+
+    uint8_t operator[](size_t variant) const { return ways[variant]; }
+};
+
+/** No interleaving: every CryptoNight hash runs on its own */
+static constexpr MikeCnWays MIKE_CN_SINGLE{{{1, 1, 1, 1, 1, 1}}};
+
+/**
+ * Pick how many hashes of every CryptoNight variant to interleave: the most,
+ * up to maxWays, whose scratchpads together take at most half of cacheBytes.
+ * A cacheBytes of 0 (unknown) disables interleaving.
+ */
+MikeCnWays GetMikeCnWays(size_t maxWays, size_t cacheBytes);
+
+/**
+ * Mike over several inputs of len bytes that share a schedule, e.g. headers
+ * which only differ in nNonce. Every core stage after the first hashes all
+ * lanes with one SphHash512_64 call, so the multi-buffer sph implementations
+ * are used, and the CryptoNight stages interleave up to cnWays lanes; inputs
+ * are processed MIKE_MAX_LANES at a time.
+ */
+void MikeMulti(uint256* output, const unsigned char* const* input, size_t len, size_t count, const MikeSchedule& schedule, const MikeCnWays& cnWays = MIKE_CN_SINGLE);
+
 #endif // BITCOIN_HASH_H
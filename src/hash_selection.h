@@ -13,9 +13,14 @@
 #define RAPTOREUM_SELECTION_H_
 
 #include <uint256.h>
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
 #include <string>
-#include <vector>
 
+#include <cryptonote/slow-hash.h>
+#include <crypto/sph_multi.h>
 #include <crypto/sph_blake.h>
 #include <crypto/sph_bmw.h>
 #include <crypto/sph_groestl.h>
@@ -31,56 +36,147 @@ extern "C" {
 #include "crypto/sph_sha2.h"
 }
 
-extern std::vector<std::vector<int>> GR_GROUP;
+/** Number of core hashes Mike selects from (Sha512 is available, but never selected) */
+static constexpr size_t MIKE_CORE_HASHES = 11;
+/** Number of CryptoNight variants Mike selects from */
+static constexpr size_t MIKE_CN_VARIANTS = 6;
+
+typedef void (*CoreHashFunction)(const void* toHash, size_t lenToHash, uint512* hash);
+typedef void (*CnHashFunction)(const uint512* toHash, uint512* hash);
+typedef void (*CnMultiHashFunction)(const uint512* toHash, uint512* hash, size_t ways);
+
+/**
+ * One-shot 512 bit sph_* hash, instantiated for every core hash. The 64 byte
+ * inputs of all stages but the first go through SphHash512_64, which uses the
+ * fastest implementation detected by SphHash512AutoDetect.
+ */
+template <SphAlgo Algo, typename Context, void (*Init)(void*), void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+void SphHash512(const void* toHash, size_t lenToHash, uint512* hash)
+{
+    if (lenToHash == 64) {
+        SphHash512_64(Algo, hash->begin(), static_cast<const unsigned char*>(toHash), 1);
+        return;
+    }
+    Context ctx;
+    Init(&ctx);
+    Update(&ctx, toHash, lenToHash);
+    Close(&ctx, static_cast<void*>(hash));
+}
+
+/** CryptoNight over the full 64 bytes of the previous stage. Only the lower 32 bytes of the output are written. */
+template <void (*Hash)(const char*, char*, uint32_t, int)>
+void CnHash512(const uint512* toHash, uint512* hash)
+{
+    Hash(reinterpret_cast<const char*>(toHash->begin()), reinterpret_cast<char*>(hash->begin()), 64, 1);
+}
+
+/** CnHash512 over ways consecutive inputs and outputs, interleaved by cn_slow_hash_multi. */
+template <void (*Hash)(const char* const*, char* const*, uint32_t, size_t, int)>
+void CnHash512Multi(const uint512* toHash, uint512* hash, size_t ways)
+{
+    const char* inputs[CN_MAX_WAYS];
+    char* outputs[CN_MAX_WAYS];
+    for (size_t i = 0; i < ways; ++i) {
+        inputs[i] = reinterpret_cast<const char*>(toHash[i].begin());
+        outputs[i] = reinterpret_cast<char*>(hash[i].begin());
+    }
+    Hash(inputs, outputs, 64, ways, 1);
+}
+
+/** Core hashes by selection index, which is also their SphAlgo */
+static constexpr std::array<CoreHashFunction, 12> CORE_HASH_FUNCTIONS{{
+    &SphHash512<SphAlgo::BLAKE, sph_blake512_context, sph_blake512_init, sph_blake512, sph_blake512_close>,                //0
+    &SphHash512<SphAlgo::BMW, sph_bmw512_context, sph_bmw512_init, sph_bmw512, sph_bmw512_close>,                          //1
+    &SphHash512<SphAlgo::GROESTL, sph_groestl512_context, sph_groestl512_init, sph_groestl512, sph_groestl512_close>,      //2
+    &SphHash512<SphAlgo::JH, sph_jh512_context, sph_jh512_init, sph_jh512, sph_jh512_close>,                               //3
+    &SphHash512<SphAlgo::KECCAK, sph_keccak512_context, sph_keccak512_init, sph_keccak512, sph_keccak512_close>,           //4
+    &SphHash512<SphAlgo::SKEIN, sph_skein512_context, sph_skein512_init, sph_skein512, sph_skein512_close>,                //5
+    &SphHash512<SphAlgo::LUFFA, sph_luffa512_context, sph_luffa512_init, sph_luffa512, sph_luffa512_close>,                //6
+    &SphHash512<SphAlgo::CUBEHASH, sph_cubehash512_context, sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close>, //7
+    &SphHash512<SphAlgo::SHAVITE, sph_shavite512_context, sph_shavite512_init, sph_shavite512, sph_shavite512_close>,      //8
+    &SphHash512<SphAlgo::SIMD, sph_simd512_context, sph_simd512_init, sph_simd512, sph_simd512_close>,                     //9
+    &SphHash512<SphAlgo::ECHO, sph_echo512_context, sph_echo512_init, sph_echo512, sph_echo512_close>,                     //A
+    &SphHash512<SphAlgo::SHA512, sph_sha512_context, sph_sha512_init, sph_sha512, sph_sha512_close>,                       //B
+}};
+
+/** CryptoNight variants by selection index */
+static constexpr std::array<CnHashFunction, MIKE_CN_VARIANTS> CN_HASH_FUNCTIONS{{
+    &CnHash512<crypto::cryptonight_dark_hash>,       //0
+    &CnHash512<crypto::cryptonight_darklite_hash>,   //1
+    &CnHash512<crypto::cryptonight_cnfast_hash>,     //2
+    &CnHash512<crypto::cryptonight_cnlite_hash>,     //3
+    &CnHash512<crypto::cryptonight_turtle_hash>,     //4
+    &CnHash512<crypto::cryptonight_turtlelite_hash>, //5
+}};
+
+/** Interleaved CryptoNight variants by selection index */
+static constexpr std::array<CnMultiHashFunction, MIKE_CN_VARIANTS> CN_MULTI_HASH_FUNCTIONS{{
+    &CnHash512Multi<crypto::cryptonight_dark_hash_multi>,       //0
+    &CnHash512Multi<crypto::cryptonight_darklite_hash_multi>,   //1
+    &CnHash512Multi<crypto::cryptonight_cnfast_hash_multi>,     //2
+    &CnHash512Multi<crypto::cryptonight_cnlite_hash_multi>,     //3
+    &CnHash512Multi<crypto::cryptonight_turtle_hash_multi>,     //4
+    &CnHash512Multi<crypto::cryptonight_turtlelite_hash_multi>, //5
+}};
+
+/** Scratchpad size of the CryptoNight variants by selection index */
+static constexpr std::array<uint32_t, MIKE_CN_VARIANTS> CN_PAGE_SIZES{{
+    CN_DARK_PAGE_SIZE,   //0
+    CN_DARK_PAGE_SIZE,   //1
+    CN_FAST_PAGE_SIZE,   //2
+    CN_LITE_PAGE_SIZE,   //3
+    CN_TURTLE_PAGE_SIZE, //4
+    CN_TURTLE_PAGE_SIZE, //5
+}};
 
 void coreHash(const void *toHash, uint512* hash, int lenToHash, int hashSelection);
 void cnHash(uint512* toHash, uint512* hash, int lenToHash, int hashSelection);
 
-class HashSelection {
-public:
-	HashSelection(const uint256 prevBlockHash, const std::vector<int> algoIndexes, std::vector<int> cnIndexes) {
-		this->PrevBlockHash = prevBlockHash;
-		this->algoMap = {
-				"Blake-",      //0
-				"Bmw-",        //1
-				"Groestl-",    //2
-				"Jh-",         //3
-				"Keccak-",     //4
-				"Skein-",      //5
-				"Luffa-",      //6
-				"Cubehash-",   //7
-				"Shavite-",    //8
-				"Simd-",       //9
-				"Echo-",
-                                "Sha512-"
-		};
-		this->cnVariantMap = {
-				"CNDark-",        //0
-				"CNDarklite-",    //1
-				"CNFast-",        //2
-				"CNLite-",        //3
-				"CNTurtle-",      //4
-				"CNTurtlelite-"   //5
-
-		};
-		//printf("before getRandomIndexes cnIndexes\n");
-		this->cnIndexes = this->getRandomIndexes(cnIndexes);
-		//printf("before getRandomIndexes cnIndexes\n");
-		this->algoIndexes = this->getRandomIndexes(algoIndexes);
-	}
-//	int getHashSelection(int index);
-//	static int getGroupHashSelection(uint256 blockHash);
-	std::vector<int> getRandomIndexes(std::vector<int> indexes);
-	std::string getHashSelectionString();
-	std::vector<int> getCnIndexes() {return  this->cnIndexes;}
-	std::vector<int> getAlgoIndexes() {return this->algoIndexes;}
-protected:
-	uint256 PrevBlockHash;
-	std::vector<int> algoIndexes;
-	std::vector<int> cnIndexes;
-	std::vector<std::string> cnVariantMap;
-	std::vector<std::string> algoMap;
+/**
+ * Order N algorithms by the nibbles of the previous block hash: walking from
+ * nibble 63 down to 0, each nibble (mod N) picks the next algorithm unless it
+ * was picked before. Algorithms never picked are appended in ascending order.
+ */
+template <size_t N>
+std::array<uint8_t, N> GetHashOrder(const uint256& prevBlockHash)
+{
+    static_assert(N > 0 && N <= 16, "selection is done by nibble");
+    std::array<uint8_t, N> order{};
+    std::array<bool, N> picked{};
+    size_t count = 0;
+    for (int i = 63; i >= 0 && count < N; i--) {
+        const size_t selection = prevBlockHash.GetNibble(i) % N;
+        if (!picked[selection]) {
+            picked[selection] = true;
+            order[count++] = selection;
+        }
+    }
+    for (size_t selection = 0; selection < N && count < N; selection++) {
+        if (!picked[selection]) {
+            order[count++] = selection;
+        }
+    }
+    return order;
+}
+
+/**
+ * The order in which Mike applies its core hashes and CryptoNight variants.
+ * It only depends on the previous block hash, so callers hashing many headers
+ * on top of the same block (e.g. the miner) should build it once and reuse it.
+ */
+struct MikeSchedule
+{
+    std::array<uint8_t, MIKE_CORE_HASHES> coreHashIndexes;
+    std::array<uint8_t, MIKE_CN_VARIANTS> cnIndexes;
+
+    explicit MikeSchedule(const uint256& prevBlockHash) :
+        coreHashIndexes(GetHashOrder<MIKE_CORE_HASHES>(prevBlockHash)),
+        cnIndexes(GetHashOrder<MIKE_CN_VARIANTS>(prevBlockHash))
+    {
+    }
 
+    /** Human readable list of the stages, e.g. "Blake-Bmw-...-CNTurtle-" */
+    std::string ToString() const;
 };
 
-#endif /* RAPTOREUM_SELECTION_H_ */
\ No newline at end of file
+#endif /* RAPTOREUM_SELECTION_H_ */
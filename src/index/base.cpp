@@ -27,7 +27,7 @@ static void FatalError(const char* fmt, const Args&... args)
 }
 
 BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate) :
-    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate)
+    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate, DBProfileType::INDEX)
 {}
 
 bool BaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
@@ -63,6 +63,11 @@ bool BaseIndex::Init()
     } else {
         m_best_block_index = FindForkInGlobalIndex(::ChainActive(), locator);
     }
+    // Blocks before a loaded snapshot are not available, start indexing after it
+    if (pindexSnapshotBase && ::ChainActive().Contains(pindexSnapshotBase) &&
+            (!m_best_block_index.load() || m_best_block_index.load()->nHeight < pindexSnapshotBase->nHeight)) {
+        m_best_block_index = pindexSnapshotBase;
+    }
     m_synced = m_best_block_index.load() == ::ChainActive().Tip();
     return true;
 }
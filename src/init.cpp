@@ -20,6 +20,8 @@
 #include <node/coinstats.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
+#include <crypto/sph_multi.h>
+#include <cryptonote/slow-hash.h>
 #include <fs.h>
 #include <hash.h>
 #include <httpserver.h>
@@ -38,6 +40,7 @@
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
+#include <powcache.h>
 #include <rpc/blockchain.h>
 #include <rpc/register.h>
 #include <rpc/server.h>
@@ -195,6 +198,7 @@ void Interrupt()
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+    InterruptSnapshotHistoryValidation();
     llmq::InterruptLLMQSystem();
     InterruptMapPort();
     if (g_connman)
@@ -250,7 +254,12 @@ void PrepareShutdown(InitInterfaces& interfaces)
     scheduler.stop();
     threadGroup.interrupt_all();
     threadGroup.join_all();
+    StopSnapshotHistoryValidation();
     StopScriptCheckWorkerThreads();
+    StopPowCheckWorkerThreads();
+    StopBlockCheckWorkerThreads();
+    StopCoinPrefetchWorkerThreads();
+    StopUndoPrefetchWorkerThreads();
 
     // After there are no more peers/RPC left to give us new data which may generate
     // CValidationInterface callbacks, flush them...
@@ -326,6 +335,7 @@ void PrepareShutdown(InitInterfaces& interfaces)
         llmq::quorumSnapshotManager.reset();
         deterministicMNManager.reset();
         evoDb.reset();
+        powCache.reset();
     }
     for (const auto& client : interfaces.chain_clients) {
         client->stop();
@@ -482,16 +492,21 @@ void SetupServerArgs()
     gArgs.AddArg("-conf=<file>", strprintf("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-dbprofile=<db>:<option>=<n>", "Override the LevelDB tuning of a database. <db> is one of chainstate, blockindex, evodb, llmq, index or default. <option> is one of blocksize, bloombits, writebufferdivisor, maxfilesize or compression (0/1). Can be specified multiple times", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbcache=<n>", strprintf("Maximum database cache size <n> MiB (%d to %d, default: %d). In addition, unused mempool memory is shared for this cache (see -maxmempool).", nMinDbCache, nMaxDbCache, nDefaultDbCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-debuglogfile=<file>", strprintf("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (-nodebuglogfile to disable; default: %s)", DEFAULT_DEBUGLOGFILE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-loadblock=<file>", "Imports blocks from external blk000??.dat file on startup", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-loadsnapshot=<file>", "Load the chainstate from a snapshot file written by dumpsnapshot into an empty chainstate on startup. The file must match a snapshot hash built into the client or -loadsnapshothash. The blocks before the snapshot are downloaded and validated in the background and can't be reorganized", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-loadsnapshothash=<hash>", "Expected hash of a -loadsnapshot file that is not built into the client, as reported by dumpsnapshot on a trusted node", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxorphantxsize=<n>", strprintf("Maximum total size of all orphan transactions in megabytes (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxrecsigsage=<n>", strprintf("Number of seconds to keep LLMQ recovery sigs (default: %u)", llmq::DEFAULT_MAX_RECOVERED_SIGS_AGE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
-    gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+    gArgs.AddArg("-mmapblockfiles=<n>", strprintf("Read blocks and undo data through memory mappings of up to <n> block and undo files, instead of opening the file for every read (0 = disabled, default: %u)", DEFAULT_MMAP_BLOCK_FILES), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-partialflush", strprintf("Write the coins cache to disk in the background when it grows large and keep recently created coins cached, instead of writing and dropping it all at once (default: %u)", DEFAULT_PARTIAL_FLUSH), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-par=<n>", strprintf("Set the number of block verification threads, shared by script checks, header PoW checks, imported block checks and input and undo prefetching (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #ifndef WIN32
@@ -723,6 +738,7 @@ void SetupServerArgs()
 
     gArgs.AddArg("-blockmaxsize=<n>", strprintf("Set maximum block size in bytes (default: %d)", DEFAULT_BLOCK_MAX_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-blockmintxfee=<amt>", strprintf("Set lowest fee rate (in %s/kB) for transactions to be included in block creation. (default: %s)", CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
+    gArgs.AddArg("-minercnways=<n>", strprintf("Number of CryptoNight hashes each mining thread interleaves, 1 to %u (default: %u, picks the number for each variant by the L2 cache size)", MIKE_MAX_LANES, DEFAULT_MINER_CN_WAYS), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     gArgs.AddArg("-blockversion=<n>", "Override block version to test forking scenarios", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::BLOCK_CREATION);
 
     gArgs.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
@@ -864,6 +880,7 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
     const CChainParams& chainparams = Params();
     util::ThreadRename("loadblk");
     ScheduleBatchPriority();
+    crypto::slow_hash_thread_guard slowHashGuard;
 
     {
     CImportingNow imp;
@@ -1310,6 +1327,22 @@ bool AppInitParameterInteraction()
         nLocalServices = ServiceFlags(nLocalServices | NODE_COMPACT_FILTERS);
     }
 
+    if (gArgs.IsArgSet("-loadsnapshothash")) {
+        const std::string snapshot_hash = gArgs.GetArg("-loadsnapshothash", "");
+        if (snapshot_hash.size() != 64 || !IsHex(snapshot_hash)) {
+            return InitError(_("Invalid -loadsnapshothash, expected the hash of the snapshot file as reported by dumpsnapshot."));
+        }
+        // The history of the snapshot is still validated, but the node follows its chain until then
+        if (chainparams.NetworkIDString() != CBaseChainParams::REGTEST && chainparams.NetworkIDString() != CBaseChainParams::DEVNET) {
+            InitWarning(_("-loadsnapshothash is set, the loaded chainstate is trusted until its history has been validated in the background. Only use hashes of snapshots written by a node you trust."));
+        }
+    }
+    if (gArgs.IsArgSet("-loadsnapshot")) {
+        if (gArgs.GetBoolArg("-reindex", false) || gArgs.GetBoolArg("-reindex-chainstate", false)) {
+            return InitError(_("-loadsnapshot is incompatible with -reindex and -reindex-chainstate."));
+        }
+    }
+
     // if using block pruning, then disallow txindex and require disabling governance validation
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
@@ -1580,6 +1613,8 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    LogPrintf("Using the '%s' CryptoNight implementation\n", crypto::cn_slow_hash_autodetect());
+    LogPrintf("Using the '%s' sph implementation\n", SphHash512AutoDetect());
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1658,6 +1693,7 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     InitSignatureCache();
     InitScriptExecutionCache();
+    SetMappedFlatFileLimit(std::max<int64_t>(gArgs.GetArg("-mmapblockfiles", DEFAULT_MMAP_BLOCK_FILES), 0));
 
     int script_threads = gArgs.GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
     if (script_threads <= 0) {
@@ -1672,11 +1708,42 @@ bool AppInitMain(InitInterfaces& interfaces)
     // Number of script-checking threads <= MAX_SCRIPTCHECK_THREADS
     script_threads = std::min(script_threads, MAX_SCRIPTCHECK_THREADS);
 
-    LogPrintf("Script verification uses %d additional threads\n", script_threads);
+    // Connect the stats client before the worker threads report timings
+    statsClient.init();
+
+    // -par bounds the threads of all check queues together. Header PoW checks, imported
+    // block checks and undo prefetching are each busy in a different phase (header sync,
+    // -reindex and -loadblock, reorgs) and input prefetching mostly waits on the disk, so
+    // script checks keep the largest share.
+    const int pow_threads = script_threads / 4;
+    const int prefetch_threads = script_threads / 4;
+    const int block_threads = script_threads / 8;
+    const int undo_prefetch_threads = script_threads / 8;
+    const int par_threads = script_threads;
+    script_threads -= pow_threads + prefetch_threads + block_threads + undo_prefetch_threads;
+
+    LogPrintf("Block verification uses %d additional threads: %d for scripts, %d for header PoW, %d for imported blocks, %d for input prefetching, %d for undo prefetching\n",
+        par_threads, script_threads, pow_threads, block_threads, prefetch_threads, undo_prefetch_threads);
     if (script_threads >= 1) {
         g_parallel_script_checks = true;
         StartScriptCheckWorkerThreads(script_threads);
     }
+    if (pow_threads >= 1) {
+        g_parallel_pow_checks = true;
+        StartPowCheckWorkerThreads(pow_threads);
+    }
+    if (block_threads >= 1) {
+        g_parallel_block_checks = true;
+        StartBlockCheckWorkerThreads(block_threads);
+    }
+    if (prefetch_threads >= 1) {
+        g_parallel_coin_prefetch = true;
+        StartCoinPrefetchWorkerThreads(prefetch_threads);
+    }
+    if (undo_prefetch_threads >= 1) {
+        g_parallel_undo_prefetch = true;
+        StartUndoPrefetchWorkerThreads(undo_prefetch_threads);
+    }
 
     std::vector<std::string> vSporkAddresses;
     if (gArgs.IsArgSet("-sporkaddr")) {
@@ -1944,6 +2011,11 @@ bool AppInitMain(InitInterfaces& interfaces)
     }
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1f MiB for PoW hash cache database\n", nPowCacheDBCache * (1.0 / 1024 / 1024));
+
+    // PoW hashes are keyed by block hash and stay valid across reindexing, so
+    // the cache is neither wiped nor recreated in the loading loop below
+    powCache.reset(new CPowCache(nPowCacheDBCache));
 
     bool fLoaded = false;
 
@@ -2031,11 +2103,27 @@ bool AppInitMain(InitInterfaces& interfaces)
 
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
-                if (fHavePruned && !fPruneMode) {
+                if (fHavePruned && !fPruneMode && !pindexSnapshotBase) {
                     strLoadError = _("You need to rebuild the database using -reindex to go back to unpruned mode.  This will redownload the entire blockchain");
                     break;
                 }
 
+                // A snapshot that was not loaded completely leaves an inconsistent chainstate behind
+                bool fSnapshotLoading = false;
+                pblocktree->ReadFlag("snapshotloading", fSnapshotLoading);
+                if (fSnapshotLoading) {
+                    strLoadError = _("Loading a snapshot was interrupted. You need to rebuild the database using -reindex");
+                    break;
+                }
+
+                // So does a snapshot whose history turned out to be invalid
+                bool fSnapshotInvalid = false;
+                pblocktree->ReadFlag("snapshotinvalid", fSnapshotInvalid);
+                if (fSnapshotInvalid) {
+                    strLoadError = _("The snapshot the chainstate was loaded from is invalid. You need to rebuild the database using -reindex");
+                    break;
+                }
+
                 // At this point blocktree args are consistent with what's on disk.
                 // If we're not mid-reindex (based on disk + args), add a genesis block on disk
                 // (otherwise we use the one already on disk).
@@ -2082,6 +2170,19 @@ bool AppInitMain(InitInterfaces& interfaces)
                     break;
                 }
 
+                if (gArgs.IsArgSet("-loadsnapshot")) {
+                    if (WITH_LOCK(cs_main, return pindexSnapshotBase != nullptr)) {
+                        LogPrintf("Chainstate was already loaded from a snapshot, ignoring -loadsnapshot\n");
+                    } else {
+                        uiInterface.InitMessage(_("Loading snapshot...").translated);
+                        if (!::ChainstateActive().LoadSnapshot(chainparams, gArgs.GetArg("-loadsnapshot", ""), uint256S(gArgs.GetArg("-loadsnapshothash", "")))) {
+                            if (ShutdownRequested()) break;
+                            strLoadError = _("Error loading snapshot, see debug.log for details");
+                            break;
+                        }
+                    }
+                }
+
                 is_coinsview_empty = fReset || fReindexChainState ||
                     ::ChainstateActive().CoinsTip().GetBestBlock().IsNull();
                 if (!is_coinsview_empty) {
@@ -2176,6 +2277,10 @@ bool AppInitMain(InitInterfaces& interfaces)
     fFeeEstimatesInitialized = true;
 
     // ********************************************************* Step 8: start indexers
+    // filters are chained to the ones of earlier blocks, which a snapshot doesn't provide
+    if (!g_enabled_filter_types.empty() && WITH_LOCK(cs_main, return pindexSnapshotBase != nullptr)) {
+        return InitError(_("-blockfilterindex is not available after loading a snapshot."));
+    }
     if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         g_txindex = MakeUnique<TxIndex>(nTxIndexCache, false, fReindex);
         g_txindex->Start();
@@ -2213,6 +2318,11 @@ bool AppInitMain(InitInterfaces& interfaces)
             ::ChainstateActive().PruneAndFlush();
         }
     }
+    // the blocks before a loaded snapshot can't be served either
+    if (WITH_LOCK(cs_main, return pindexSnapshotBase != nullptr) && (nLocalServices & NODE_NETWORK)) {
+        LogPrintf("Unsetting NODE_NETWORK, chainstate was loaded from a snapshot\n");
+        nLocalServices = ServiceFlags(nLocalServices & ~NODE_NETWORK);
+    }
 
     // As PruneAndFlush can take several minutes, it's possible the user
     // requested to kill the GUI during the last operation. If so, exit.
@@ -2372,6 +2482,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     }
 
     threadGroup.create_thread(std::bind(&ThreadImport, vImportFiles));
+    StartSnapshotHistoryValidation(chainparams);
 
     // Wait for genesis block to be processed
     {
@@ -5,6 +5,8 @@
 #include <llmq/blockprocessor.h>
 #include <llmq/commitment.h>
 
+#include <bls/bls_worker.h>
+#include <evo/deterministicmns.h>
 #include <evo/evodb.h>
 #include <evo/specialtx.h>
 
@@ -20,6 +22,7 @@
 #include <saltedhasher.h>
 #include <sync.h>
 
+#include <future>
 #include <map>
 
 namespace llmq
@@ -33,8 +36,9 @@ static const std::string DB_MINED_COMMITMENT_BY_INVERSED_HEIGHT_Q_INDEXED = "q_m
 
 static const std::string DB_BEST_BLOCK_UPGRADE = "q_bbu2";
 
-CQuorumBlockProcessor::CQuorumBlockProcessor(CEvoDB &_evoDb) :
-    evoDb(_evoDb)
+CQuorumBlockProcessor::CQuorumBlockProcessor(CEvoDB &_evoDb, CBLSWorker& _blsWorker) :
+    evoDb(_evoDb),
+    blsWorker(_blsWorker)
 {
     CLLMQUtils::InitQuorumsCache(mapHasMinedCommitmentCache);
 }
@@ -134,6 +138,7 @@ bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex*
     }
 
     llmq::CLLMQUtils::PreComputeQuorumMembers(pindex);
+    llmq::CLLMQUtils::CleanupQuorumMembersDb(pindex);
 
     std::multimap<Consensus::LLMQType, CFinalCommitment> qcs;
     if (!GetCommitmentsFromBlock(block, pindex, qcs, state)) {
@@ -167,9 +172,17 @@ bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex*
         }
     }
 
+    // Signature checks are by far the most expensive part of processing commitments, so they are all started at once
+    // and the results are handed to the serial checks below
+    std::vector<std::optional<bool>> sigsValid(qcs.size());
+    if (fBLSChecks) {
+        sigsValid = VerifyCommitmentSigs(pindex, qcs);
+    }
+
+    size_t i = 0;
     for (const auto& p : qcs) {
         const auto& qc = p.second;
-        if (!ProcessCommitment(pindex->nHeight, blockHash, qc, state, fJustCheck, fBLSChecks)) {
+        if (!ProcessCommitment(pindex->nHeight, blockHash, qc, state, fJustCheck, fBLSChecks, sigsValid[i++])) {
             LogPrintf("[ProcessBlock] failed h[%d] llmqType[%d] version[%d] quorumIndex[%d] quorumHash[%s]\n", pindex->nHeight, static_cast<int>(qc.llmqType), qc.nVersion, qc.quorumIndex, qc.quorumHash.ToString());
             return false;
         }
@@ -180,6 +193,47 @@ bool CQuorumBlockProcessor::ProcessBlock(const CBlock& block, const CBlockIndex*
     return true;
 }
 
+// A block whose commitments evodb holds already can't go through ProcessBlock, which would find them mined. Instead,
+// every commitment of the block must be valid for the quorum expected at its height and must be the one evodb recorded
+// as mined in this very block. Which blocks had to carry commitments is covered by the quorums merkle root of the
+// coinbase of the blocks after it, as that root is built from the same evodb records.
+bool CQuorumBlockProcessor::CheckMinedBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state) const
+{
+    AssertLockHeld(cs_main);
+
+    std::multimap<Consensus::LLMQType, CFinalCommitment> qcs;
+    if (!GetCommitmentsFromBlock(block, pindex, qcs, state)) {
+        return false;
+    }
+
+    for (const auto& p : qcs) {
+        const auto& qc = p.second;
+        const auto& llmq_params = GetLLMQParams(qc.llmqType);
+        if (qc.quorumHash.IsNull() || qc.quorumHash != GetQuorumBlockHash(llmq_params, pindex->nHeight, qc.quorumIndex)) {
+            return state.DoS(100, false, REJECT_INVALID, "bad-qc-block");
+        }
+        if (qc.IsNull()) {
+            if (!qc.VerifyNull()) {
+                return state.DoS(100, false, REJECT_INVALID, "bad-qc-invalid-null");
+            }
+            continue;
+        }
+        if (!IsMiningPhase(llmq_params, pindex->nHeight)) {
+            return state.DoS(100, false, REJECT_INVALID, "bad-qc-height");
+        }
+        if (!qc.Verify(LookupBlockIndex(qc.quorumHash), true)) {
+            return state.DoS(100, false, REJECT_INVALID, "bad-qc-invalid");
+        }
+        uint256 minedBlockHash;
+        const auto minedQc = GetMinedCommitment(qc.llmqType, qc.quorumHash, minedBlockHash);
+        if (minedQc == nullptr || minedBlockHash != pindex->GetBlockHash() || ::SerializeHash(*minedQc) != ::SerializeHash(qc)) {
+            return state.DoS(100, false, REJECT_INVALID, "bad-qc-not-mined");
+        }
+    }
+
+    return true;
+}
+
 // We store a mapping from minedHeight->quorumHeight in the DB
 // minedHeight is inversed so that entries are traversable in reversed order
 static std::tuple<std::string, Consensus::LLMQType, uint32_t> BuildInversedHeightKey(Consensus::LLMQType llmqType, int nMinedHeight)
@@ -194,7 +248,63 @@ static std::tuple<std::string, Consensus::LLMQType, int, uint32_t> BuildInversed
     return std::make_tuple(DB_MINED_COMMITMENT_BY_INVERSED_HEIGHT_Q_INDEXED, llmqType, quorumIndex, htobe32(std::numeric_limits<uint32_t>::max() - nMinedHeight));
 }
 
-bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state, bool fJustCheck, bool fBLSChecks)
+// Verifies the members and quorum signatures of all non-null commitments of the block at pindex in parallel on the BLS
+// worker. Only commitments for the quorum that is expected at this height are verified, so that quorum members are
+// never computed for a quorumHash that ProcessCommitment would reject anyway. Commitments that are malformed in a way
+// that Verify() rejects before checking signatures are skipped, as are all commitments if the worker is not running
+// yet (e.g. while replaying blocks during init). Skipped entries are left empty, so that they are checked serially by
+// ProcessCommitment
+std::vector<std::optional<bool>> CQuorumBlockProcessor::VerifyCommitmentSigs(const CBlockIndex* pindex, const std::multimap<Consensus::LLMQType, CFinalCommitment>& qcs) const
+{
+    AssertLockHeld(cs_main);
+
+    std::vector<std::optional<bool>> ret(qcs.size());
+    if (!blsWorker.IsStarted() || !::ChainActive().Tip()) {
+        return ret;
+    }
+
+    std::vector<std::pair<std::future<bool>, std::future<bool>>> futures(qcs.size());
+    size_t i = 0;
+    for (const auto& p : qcs) {
+        const auto& qc = p.second;
+        auto& f = futures[i++];
+        if (qc.IsNull() || !Params().HasLLMQ(qc.llmqType) || !qc.quorumPublicKey.IsValid() || !qc.quorumSig.IsValid()) {
+            continue;
+        }
+        const auto& llmq_params = GetLLMQParams(qc.llmqType);
+        if (qc.signers.size() != size_t(llmq_params.size) || qc.validMembers.size() != size_t(llmq_params.size)) {
+            continue;
+        }
+        if (!IsMiningPhase(llmq_params, pindex->nHeight) || qc.quorumHash != GetQuorumBlockHash(llmq_params, pindex->nHeight, qc.quorumIndex)) {
+            continue;
+        }
+        const auto pQuorumBaseBlockIndex = LookupBlockIndex(qc.quorumHash);
+        if (pQuorumBaseBlockIndex == nullptr || pindex->GetAncestor(pQuorumBaseBlockIndex->nHeight) != pQuorumBaseBlockIndex) {
+            continue;
+        }
+        auto memberPubKeys = qc.GetSignerPubKeys(CLLMQUtils::GetAllQuorumMembers(qc.llmqType, pQuorumBaseBlockIndex));
+        if (memberPubKeys.empty()) {
+            continue;
+        }
+        const uint256 commitmentHash = qc.BuildCommitmentHash();
+        f.first = blsWorker.AsyncVerifySecureAggregated(qc.membersSig, memberPubKeys, commitmentHash);
+        f.second = blsWorker.AsyncVerifySig(qc.quorumSig, qc.quorumPublicKey, commitmentHash);
+    }
+
+    for (i = 0; i < futures.size(); i++) {
+        auto& f = futures[i];
+        if (!f.first.valid()) {
+            continue;
+        }
+        // always wait for both, the jobs must not outlive this call
+        const bool membersSigValid = f.first.get();
+        const bool quorumSigValid = f.second.get();
+        ret[i] = membersSigValid && quorumSigValid;
+    }
+    return ret;
+}
+
+bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state, bool fJustCheck, bool fBLSChecks, std::optional<bool> sigsValid)
 {
     AssertLockHeld(cs_main);
 
@@ -242,7 +352,8 @@ bool CQuorumBlockProcessor::ProcessCommitment(int nHeight, const uint256& blockH
 
     auto pQuorumBaseBlockIndex = LookupBlockIndex(qc.quorumHash);
 
-    if (!qc.Verify(pQuorumBaseBlockIndex, fBLSChecks)) {
+    // signatures that were already checked by VerifyCommitmentSigs are not checked again
+    if (!qc.Verify(pQuorumBaseBlockIndex, fBLSChecks && !sigsValid.has_value()) || (fBLSChecks && sigsValid.has_value() && !*sigsValid)) {
         LogPrint(BCLog::LLMQ, "CQuorumBlockProcessor::%s height=%d, type=%d, quorumIndex=%d, quorumHash=%s, signers=%s, validMembers=%d, quorumPublicKey=%s qc verify failed.\n", __func__,
                  nHeight, uint8_t(qc.llmqType), qc.quorumIndex, quorumHash.ToString(), qc.CountSigners(), qc.CountValidMembers(), qc.quorumPublicKey.ToString());
         return state.DoS(100, false, REJECT_INVALID, "bad-qc-invalid");
@@ -17,6 +17,7 @@
 
 #include <unordered_map>
 
+class CBLSWorker;
 class CNode;
 class CConnman;
 class CValidationState;
@@ -34,6 +35,7 @@ class CQuorumBlockProcessor
 {
 private:
     CEvoDB& evoDb;
+    CBLSWorker& blsWorker;
 
     // TODO cleanup
     mutable CCriticalSection minableCommitmentsCs;
@@ -43,7 +45,7 @@ private:
     mutable std::map<Consensus::LLMQType, unordered_lru_cache<uint256, bool, StaticSaltedHasher>> mapHasMinedCommitmentCache GUARDED_BY(minableCommitmentsCs);
 
 public:
-    explicit CQuorumBlockProcessor(CEvoDB& _evoDb);
+    CQuorumBlockProcessor(CEvoDB& _evoDb, CBLSWorker& _blsWorker);
 
     bool UpgradeDB();
 
@@ -51,6 +53,8 @@ public:
 
     bool ProcessBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state, bool fJustCheck, bool fBLSChecks) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool UndoBlock(const CBlock& block, const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    //! Check the commitments of a block that evodb already recorded as mined, e.g. one below a snapshot base
+    bool CheckMinedBlock(const CBlock& block, const CBlockIndex* pindex, CValidationState& state) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     void AddMineableCommitment(const CFinalCommitment& fqc);
     bool HasMineableCommitment(const uint256& hash) const;
@@ -66,9 +70,12 @@ public:
     std::vector<const CBlockIndex*> GetMinedCommitmentsIndexedUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t maxCount) const;
     std::vector<std::pair<int, const CBlockIndex*>> GetLastMinedCommitmentsPerQuorumIndexUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, size_t cycle) const;
     std::optional<const CBlockIndex*> GetLastMinedCommitmentsByQuorumIndexUntilBlock(Consensus::LLMQType llmqType, const CBlockIndex* pindex, int quorumIndex, size_t cycle) const;
+
+    // Signature checks of a block's commitments, which ProcessBlock runs on the BLS worker. Public for the unit tests
+    std::vector<std::optional<bool>> VerifyCommitmentSigs(const CBlockIndex* pindex, const std::multimap<Consensus::LLMQType, CFinalCommitment>& qcs) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 private:
     static bool GetCommitmentsFromBlock(const CBlock& block, const CBlockIndex* pindex, std::multimap<Consensus::LLMQType, CFinalCommitment>& ret, CValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
-    bool ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state, bool fJustCheck, bool fBLSChecks) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool ProcessCommitment(int nHeight, const uint256& blockHash, const CFinalCommitment& qc, CValidationState& state, bool fJustCheck, bool fBLSChecks, std::optional<bool> sigsValid) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool IsMiningPhase(const Consensus::LLMQParams& llmqParams, int nHeight) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     size_t GetNumCommitmentsRequired(const Consensus::LLMQParams& llmqParams, int nHeight) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     static uint256 GetQuorumBlockHash(const Consensus::LLMQParams& llmqParams, int nHeight, int quorumIndex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -102,21 +102,13 @@ bool CFinalCommitment::Verify(const CBlockIndex* pQuorumBaseBlockIndex, bool che
 
     // sigs are only checked when the block is processed
     if (checkSigs) {
-        uint256 commitmentHash = CLLMQUtils::BuildCommitmentHash(llmq_params.type, quorumHash, validMembers, quorumPublicKey, quorumVvecHash);
+        uint256 commitmentHash = BuildCommitmentHash();
         std::stringstream ss3;
         for (const auto& mn : members) {
             ss3 << mn->proTxHash.ToString().substr(0, 4) << " | ";
         }
         LogPrintfFinalCommitment("CFinalCommitment::%s members[%s] quorumPublicKey[%s] commitmentHash[%s]\n", __func__, ss3.str(), quorumPublicKey.ToString(), commitmentHash.ToString());
-        std::vector<CBLSPublicKey> memberPubKeys;
-        for (size_t i = 0; i < members.size(); i++) {
-            if (!signers[i]) {
-                continue;
-            }
-            memberPubKeys.emplace_back(members[i]->pdmnState->pubKeyOperator.Get());
-        }
-
-        if (!membersSig.VerifySecureAggregated(memberPubKeys, commitmentHash)) {
+        if (!membersSig.VerifySecureAggregated(GetSignerPubKeys(members), commitmentHash)) {
             LogPrintfFinalCommitment("q[%s] invalid aggregated members signature\n", quorumHash.ToString());
             return false;
         }
@@ -132,6 +124,23 @@ bool CFinalCommitment::Verify(const CBlockIndex* pQuorumBaseBlockIndex, bool che
     return true;
 }
 
+uint256 CFinalCommitment::BuildCommitmentHash() const
+{
+    return CLLMQUtils::BuildCommitmentHash(llmqType, quorumHash, validMembers, quorumPublicKey, quorumVvecHash);
+}
+
+std::vector<CBLSPublicKey> CFinalCommitment::GetSignerPubKeys(const std::vector<CDeterministicMNCPtr>& members) const
+{
+    std::vector<CBLSPublicKey> memberPubKeys;
+    for (size_t i = 0; i < members.size() && i < signers.size(); i++) {
+        if (!signers[i]) {
+            continue;
+        }
+        memberPubKeys.emplace_back(members[i]->pdmnState->pubKeyOperator.Get());
+    }
+    return memberPubKeys;
+}
+
 bool CFinalCommitment::VerifyNull() const
 {
     if (!Params().HasLLMQ(llmqType)) {
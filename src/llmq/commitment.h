@@ -52,6 +52,10 @@ public:
     }
 
     bool Verify(const CBlockIndex* pQuorumBaseBlockIndex, bool checkSigs) const;
+    // Hash signed by the members and by the quorum
+    uint256 BuildCommitmentHash() const;
+    // Operator keys of the signing members, the ones membersSig has to verify against
+    std::vector<CBLSPublicKey> GetSignerPubKeys(const std::vector<CDeterministicMNCPtr>& members) const;
     bool VerifyNull() const;
     bool VerifySizes(const Consensus::LLMQParams& params) const;
 
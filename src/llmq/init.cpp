@@ -28,7 +28,7 @@ void InitLLMQSystem(CEvoDB& evoDb, bool unitTests, bool fWipe)
     blsWorker = new CBLSWorker();
 
     quorumDKGDebugManager = new CDKGDebugManager();
-    quorumBlockProcessor = new CQuorumBlockProcessor(evoDb);
+    quorumBlockProcessor = new CQuorumBlockProcessor(evoDb, *blsWorker);
     quorumDKGSessionManager = new CDKGSessionManager(*blsWorker, unitTests, fWipe);
     quorumManager = new CQuorumManager(evoDb, *blsWorker, *quorumDKGSessionManager);
     quorumSigSharesManager = new CSigSharesManager();
@@ -97,7 +97,7 @@ private:
 
 public:
     explicit CInstantSendDb(bool unitTests, bool fWipe) :
-            db(std::make_unique<CDBWrapper>(unitTests ? "" : (GetDataDir() / "llmq/isdb"), 32 << 20, unitTests, fWipe))
+            db(std::make_unique<CDBWrapper>(unitTests ? "" : (GetDataDir() / "llmq/isdb"), 32 << 20, unitTests, fWipe, false, DBProfileType::LLMQ))
     {}
 
     void Upgrade();
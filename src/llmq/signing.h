@@ -85,7 +85,7 @@ private:
 
 public:
     explicit CRecoveredSigsDb(bool fMemory, bool fWipe) :
-            db(std::make_unique<CDBWrapper>(fMemory ? "" : (GetDataDir() / "llmq/recsigdb"), 8 << 20, fMemory, fWipe))
+            db(std::make_unique<CDBWrapper>(fMemory ? "" : (GetDataDir() / "llmq/recsigdb"), 8 << 20, fMemory, fWipe, false, DBProfileType::LLMQ))
     {
         MigrateRecoveredSigs();
     }
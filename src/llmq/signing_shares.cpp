@@ -19,6 +19,8 @@
 
 #include <cxxtimer.hpp>
 
+#include <algorithm>
+
 namespace llmq
 {
 
@@ -189,6 +191,13 @@ void CSigSharesManager::StartWorkerThread()
         assert(false);
     }
 
+    // the work thread verifies one shard itself, so only spawn helpers if there is more than one core to spare
+    int verifyThreads = std::clamp(int(std::thread::hardware_concurrency() / 2), 1, MAX_VERIFY_THREADS);
+    if (verifyThreads > 1) {
+        verifyWorkerPool.resize(verifyThreads - 1);
+        RenameThreadPool(verifyWorkerPool, "sigsh-verify");
+    }
+
     workThread = std::thread(&TraceThread<std::function<void()> >,
         "sigshares",
         std::function<void()>(std::bind(&CSigSharesManager::WorkThreadMain, this)));
@@ -204,6 +213,9 @@ void CSigSharesManager::StopWorkerThread()
     if (workThread.joinable()) {
         workThread.join();
     }
+
+    verifyWorkerPool.clear_queue();
+    verifyWorkerPool.stop(true);
 }
 
 void CSigSharesManager::RegisterAsRecoveredSigsListener()
@@ -610,23 +622,71 @@ void CSigSharesManager::CollectPendingSigSharesToVerify(
     }
 }
 
+std::set<NodeId> VerifySigShares(const std::vector<CSigShareToVerify>& sigShares, ctpl::thread_pool* workerPool)
+{
+    // below this, the fixed cost of a batch outweighs what is gained by verifying in parallel
+    static constexpr size_t MIN_SIG_SHARES_PER_SHARD{16};
+
+    auto verifyShard = [&sigShares](size_t shard, size_t shardCount) {
+        // It's ok to perform insecure batched verification here as we verify against the quorum public key shares,
+        // which are not craftable by individual entities, making the rogue public key attack impossible
+        CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier(false, true);
+        for (const auto& sigShare : sigShares) {
+            if (sigShare.signHash.GetCheapHash() % shardCount == shard) {
+                batchVerifier.PushMessage(sigShare.nodeId, sigShare.key, sigShare.signHash, sigShare.sig, sigShare.pubKeyShare);
+            }
+        }
+        batchVerifier.Verify();
+        return std::move(batchVerifier.badSources);
+    };
+
+    size_t shardCount = 1;
+    if (workerPool != nullptr) {
+        // the calling thread verifies one of the shards itself
+        shardCount = std::min<size_t>(workerPool->size() + 1, sigShares.size() / MIN_SIG_SHARES_PER_SHARD);
+    }
+    if (shardCount <= 1) {
+        return verifyShard(0, 1);
+    }
+
+    std::vector<std::future<std::set<NodeId>>> futures;
+    futures.reserve(shardCount - 1);
+    for (size_t i = 1; i < shardCount; i++) {
+        futures.emplace_back(workerPool->push([&verifyShard, i, shardCount](int) {
+            return verifyShard(i, shardCount);
+        }));
+    }
+    std::set<NodeId> badSources;
+    try {
+        badSources = verifyShard(0, shardCount);
+    } catch (...) {
+        // the other shards still use sigShares and verifyShard, which must outlive them
+        for (auto& f : futures) {
+            f.wait();
+        }
+        throw;
+    }
+    for (auto& f : futures) {
+        auto shardBadSources = f.get();
+        badSources.insert(shardBadSources.begin(), shardBadSources.end());
+    }
+    return badSources;
+}
+
 bool CSigSharesManager::ProcessPendingSigShares(const CConnman& connman)
 {
     std::unordered_map<NodeId, std::vector<CSigShare>> sigSharesByNodes;
     std::unordered_map<std::pair<Consensus::LLMQType, uint256>, CQuorumCPtr, StaticSaltedHasher> quorums;
 
-    const size_t nMaxBatchSize{32};
+    const size_t nMaxBatchSize{MAX_VERIFY_SESSIONS_PER_THREAD * (verifyWorkerPool.size() + 1)};
     CollectPendingSigSharesToVerify(nMaxBatchSize, sigSharesByNodes, quorums);
     if (sigSharesByNodes.empty()) {
         return false;
     }
 
-    // It's ok to perform insecure batched verification here as we verify against the quorum public key shares,
-    // which are not craftable by individual entities, making the rogue public key attack impossible
-    CBLSBatchVerifier<NodeId, SigShareKey> batchVerifier(false, true);
+    std::vector<CSigShareToVerify> sigSharesToVerify;
 
     cxxtimer::Timer prepareTimer(true);
-    size_t verifyCount = 0;
     for (const auto& [nodeId, v] : sigSharesByNodes) {
         for (const auto& sigShare : v) {
             if (quorumSigningManager->HasRecoveredSigForId(sigShare.llmqType, sigShare.id)) {
@@ -651,20 +711,20 @@ bool CSigSharesManager::ProcessPendingSigShares(const CConnman& connman)
                 assert(false);
             }
 
-            batchVerifier.PushMessage(nodeId, sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare.Get(), pubKeyShare);
-            verifyCount++;
+            sigSharesToVerify.push_back({nodeId, sigShare.GetKey(), sigShare.GetSignHash(), sigShare.sigShare.Get(), pubKeyShare});
         }
     }
     prepareTimer.stop();
 
+    // none of this needs cs, results are only merged back through ProcessPendingSigShares below
     cxxtimer::Timer verifyTimer(true);
-    batchVerifier.Verify();
+    auto badSources = VerifySigShares(sigSharesToVerify, &verifyWorkerPool);
     verifyTimer.stop();
 
-    LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- verified sig shares. count=%d, pt=%d, vt=%d, nodes=%d\n", __func__, verifyCount, prepareTimer.count(), verifyTimer.count(), sigSharesByNodes.size());
+    LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- verified sig shares. count=%d, pt=%d, vt=%d, nodes=%d\n", __func__, sigSharesToVerify.size(), prepareTimer.count(), verifyTimer.count(), sigSharesByNodes.size());
 
     for (const auto& [nodeId, v] : sigSharesByNodes) {
-        if (batchVerifier.badSources.count(nodeId)) {
+        if (badSources.count(nodeId)) {
             LogPrint(BCLog::LLMQ_SIGS, "CSigSharesManager::%s -- invalid sig shares from other node, banning peer=%d\n",
                      __func__, nodeId);
             // this will also cause re-requesting of the shares that were sent by this node
@@ -14,6 +14,9 @@
 #include <sync.h>
 #include <uint256.h>
 
+#include <ctpl_stl.h>
+
+#include <set>
 #include <thread>
 #include <unordered_map>
 #include <utility>
@@ -330,6 +333,22 @@ public:
     int attempt{0};
 };
 
+// A sig share that is ready for verification, with its signature already deserialized
+struct CSigShareToVerify {
+    NodeId nodeId;
+    SigShareKey key;
+    uint256 signHash;
+    CBLSSignature sig;
+    CBLSPublicKey pubKeyShare;
+};
+
+/**
+ * Batch verifies sig shares and returns the nodes that sent at least one invalid share. If a worker pool is passed,
+ * the shares are sharded by signHash onto its threads, so that all shares of a signing session end up in the same
+ * batch. Every batch falls back to per-message verification when it fails as a whole.
+ */
+std::set<NodeId> VerifySigShares(const std::vector<CSigShareToVerify>& sigShares, ctpl::thread_pool* workerPool);
+
 class CSigSharesManager : public CRecoveredSigsListener
 {
 private:
@@ -347,10 +366,15 @@ private:
     static constexpr int64_t MAX_SEND_FOR_RECOVERY_TIMEOUT{10000};
     static constexpr size_t MAX_MSGS_SIG_SHARES{32};
 
+    // number of signing sessions verified per round and per verification thread
+    static constexpr size_t MAX_VERIFY_SESSIONS_PER_THREAD{32};
+    static constexpr int MAX_VERIFY_THREADS{4};
+
     CCriticalSection cs;
 
     std::thread workThread;
     CThreadInterrupt workInterrupt;
+    ctpl::thread_pool verifyWorkerPool;
 
     SigShareMap<CSigShare> sigShares GUARDED_BY(cs);
     std::unordered_map<uint256, CSignedSession, StaticSaltedHasher> signedSessions GUARDED_BY(cs);
@@ -21,6 +21,9 @@ namespace llmq {
 
 static const std::string DB_QUORUM_SNAPSHOT = "llmq_S";
 
+/** Number of qrinfo responses kept for repeated requests */
+static const size_t QRINFO_CACHE_SIZE = 16;
+
 std::unique_ptr<CQuorumSnapshotManager> quorumSnapshotManager;
 
 void CQuorumSnapshot::ToJson(UniValue& obj) const
@@ -115,10 +118,48 @@ void CQuorumRotationInfo::ToJson(UniValue& obj) const
     obj.pushKV("mnListDiffList", mnlistdifflist);
 }
 
+// Responses for the same request and tip are identical, light clients reconnecting at the same time can share them
+static CCriticalSection cs_qrinfo_cache;
+static unordered_lru_cache<uint256, std::shared_ptr<const CQuorumRotationInfo>, StaticSaltedHasher> qrinfoCache GUARDED_BY(cs_qrinfo_cache){QRINFO_CACHE_SIZE};
+
+static bool BuildQuorumRotationInfoUncached(const CGetQuorumRotationInfo& request, CQuorumRotationInfo& response, std::string& errorRet) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+uint256 GetQuorumRotationInfoCacheKey(const CGetQuorumRotationInfo& request, const uint256& tipBlockHash)
+{
+    return ::SerializeHash(std::make_pair(request, tipBlockHash));
+}
+
 bool BuildQuorumRotationInfo(const CGetQuorumRotationInfo& request, CQuorumRotationInfo& response, std::string& errorRet)
 {
     AssertLockHeld(cs_main);
 
+    // The response only depends on the request and on the active chain, which the tip stands for
+    const CBlockIndex* tipBlockIndex = ::ChainActive().Tip();
+    if (!tipBlockIndex) {
+        return BuildQuorumRotationInfoUncached(request, response, errorRet);
+    }
+    const uint256 cacheKey = GetQuorumRotationInfoCacheKey(request, tipBlockIndex->GetBlockHash());
+    {
+        LOCK(cs_qrinfo_cache);
+        std::shared_ptr<const CQuorumRotationInfo> cached;
+        if (qrinfoCache.get(cacheKey, cached)) {
+            response = *cached;
+            return true;
+        }
+    }
+
+    if (!BuildQuorumRotationInfoUncached(request, response, errorRet)) {
+        return false;
+    }
+    LOCK(cs_qrinfo_cache);
+    qrinfoCache.insert(cacheKey, std::make_shared<const CQuorumRotationInfo>(response));
+    return true;
+}
+
+static bool BuildQuorumRotationInfoUncached(const CGetQuorumRotationInfo& request, CQuorumRotationInfo& response, std::string& errorRet)
+{
+    AssertLockHeld(cs_main);
+
     std::vector<const CBlockIndex*> baseBlockIndexes;
     if (request.baseBlockHashes.size() == 0) {
         const CBlockIndex* blockIndex = ::ChainActive().Genesis();
@@ -205,6 +205,8 @@ public:
 };
 
 bool BuildQuorumRotationInfo(const CGetQuorumRotationInfo& request, CQuorumRotationInfo& quorumRotationInfoRet, std::string& errorRet);
+// Key of a cached response, which covers every field of the request and the tip it was built at
+uint256 GetQuorumRotationInfoCacheKey(const CGetQuorumRotationInfo& request, const uint256& tipBlockHash);
 uint256 GetLastBaseBlockHash(const std::vector<const CBlockIndex*>& baseBlockIndexes, const CBlockIndex* blockIndex);
 
 class CQuorumSnapshotManager
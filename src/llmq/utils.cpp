@@ -11,6 +11,7 @@
 
 #include <bls/bls.h>
 #include <chainparams.h>
+#include <compat/endian.h>
 #include <evo/deterministicmns.h>
 #include <evo/evodb.h>
 #include <masternode/meta.h>
@@ -30,11 +31,98 @@ namespace llmq
 CCriticalSection cs_llmq_vbc;
 VersionBitsCache llmq_versionbitscache;
 
+static const std::string DB_QUORUM_MEMBERS = "q_Qm";
+
+// Quorum members are persisted so that they don't have to be recomputed from historic masternode lists after a
+// restart. They are written and erased while blocks are connected and disconnected, as part of the block's evodb
+// transaction. Keys are ordered by height to allow cleaning up old quorums
+static std::tuple<std::string, Consensus::LLMQType, uint32_t, uint256> BuildQuorumMembersKey(Consensus::LLMQType llmqType, const CBlockIndex* pQuorumBaseBlockIndex)
+{
+    return std::make_tuple(DB_QUORUM_MEMBERS, llmqType, htobe32(pQuorumBaseBlockIndex->nHeight), pQuorumBaseBlockIndex->GetBlockHash());
+}
+
+// Quorums below this height are too old to be used for signing or connections at nHeight
+static int GetQuorumMembersDbCutoffHeight(const Consensus::LLMQParams& llmqParams, int nHeight)
+{
+    return nHeight - (llmqParams.keepOldConnections + 1) * llmqParams.dkgInterval;
+}
+
+// Only quorums that are still in use at the best known header are persisted, to not write out the members of every
+// historic quorum while syncing
+static bool ShouldPersistQuorumMembers(const Consensus::LLMQParams& llmqParams, const CBlockIndex* pQuorumBaseBlockIndex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    return evoDb && pindexBestHeader && pQuorumBaseBlockIndex->nHeight >= GetQuorumMembersDbCutoffHeight(llmqParams, pindexBestHeader->nHeight);
+}
+
+bool CLLMQUtils::ReadQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pQuorumBaseBlockIndex, std::vector<CDeterministicMNCPtr>& members)
+{
+    return evoDb && evoDb->Read(BuildQuorumMembersKey(llmqType, pQuorumBaseBlockIndex), members);
+}
+
+void CLLMQUtils::WriteQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pQuorumBaseBlockIndex, const std::vector<CDeterministicMNCPtr>& members)
+{
+    evoDb->Write(BuildQuorumMembersKey(llmqType, pQuorumBaseBlockIndex), members);
+}
+
+void CLLMQUtils::CleanupQuorumMembersDb(const CBlockIndex* pindex)
+{
+    if (!evoDb) {
+        return;
+    }
+    LOCK(evoDb->cs);
+    auto& dbTx = evoDb->GetCurTransaction();
+    for (const auto& params : Params().GetConsensus().llmqs) {
+        const int cutoffHeight = GetQuorumMembersDbCutoffHeight(params, pindex->nHeight);
+        if (cutoffHeight <= 0) {
+            continue;
+        }
+
+        auto firstKey = std::make_tuple(DB_QUORUM_MEMBERS, params.type, htobe32(0), uint256());
+        std::vector<decltype(firstKey)> vecKeys;
+        auto dbIt = dbTx.NewIteratorUniquePtr();
+        dbIt->Seek(firstKey);
+        while (dbIt->Valid()) {
+            decltype(firstKey) curKey;
+            if (!dbIt->GetKey(curKey) || std::get<0>(curKey) != DB_QUORUM_MEMBERS || std::get<1>(curKey) != params.type) {
+                break;
+            }
+            if (int(be32toh(std::get<2>(curKey))) >= cutoffHeight) {
+                break;
+            }
+            vecKeys.emplace_back(curKey);
+            dbIt->Next();
+        }
+        dbIt.reset();
+
+        for (const auto& key : vecKeys) {
+            dbTx.Erase(key);
+        }
+    }
+}
+
 void CLLMQUtils::PreComputeQuorumMembers(const CBlockIndex* pQuorumBaseBlockIndex, bool reset_cache)
 {
+    AssertLockHeld(cs_main);
+
     for (const Consensus::LLMQParams& params : CLLMQUtils::GetEnabledQuorumParams(pQuorumBaseBlockIndex->pprev)) {
-        if (llmq::CLLMQUtils::IsQuorumRotationEnabled(params.type, pQuorumBaseBlockIndex) && (pQuorumBaseBlockIndex->nHeight % params.dkgInterval == 0)) {
-            CLLMQUtils::GetAllQuorumMembers(params.type, pQuorumBaseBlockIndex, reset_cache);
+        const bool fRotation = llmq::CLLMQUtils::IsQuorumRotationEnabled(params.type, pQuorumBaseBlockIndex);
+        const int quorumIndex = pQuorumBaseBlockIndex->nHeight % params.dkgInterval;
+        if (quorumIndex >= (fRotation ? params.signingActiveQuorumCount : 1)) {
+            continue;
+        }
+        if (reset_cache) {
+            // the block is disconnected, its quorum is not used anymore
+            if (evoDb) {
+                evoDb->Erase(BuildQuorumMembersKey(params.type, pQuorumBaseBlockIndex));
+            }
+            if (fRotation && quorumIndex == 0) {
+                CLLMQUtils::GetAllQuorumMembers(params.type, pQuorumBaseBlockIndex, reset_cache);
+            }
+        } else if (ShouldPersistQuorumMembers(params, pQuorumBaseBlockIndex)) {
+            WriteQuorumMembers(params.type, pQuorumBaseBlockIndex, CLLMQUtils::GetAllQuorumMembers(params.type, pQuorumBaseBlockIndex));
+        } else if (fRotation && quorumIndex == 0) {
+            CLLMQUtils::GetAllQuorumMembers(params.type, pQuorumBaseBlockIndex);
         }
     }
 }
@@ -95,14 +183,19 @@ std::vector<CDeterministicMNCPtr> CLLMQUtils::GetAllQuorumMembers(Consensus::LLM
             return quorumMembers;
         }
 
-        auto q = ComputeQuorumMembersByQuarterRotation(llmqType, pCycleQuorumBaseBlockIndex);
-        LOCK(cs_indexed_members);
-        for (int i = 0; i < static_cast<int>(q.size()); ++i) {
-            mapIndexedQuorumMembers[llmqType].insert(std::make_pair(pCycleQuorumBaseBlockIndex->GetBlockHash(), i), q[i]);
-        }
+        if (!reset_cache && ReadQuorumMembers(llmqType, pQuorumBaseBlockIndex, quorumMembers)) {
+            LOCK(cs_indexed_members);
+            mapIndexedQuorumMembers[llmqType].insert(std::make_pair(pCycleQuorumBaseBlockIndex->GetBlockHash(), quorumIndex), quorumMembers);
+        } else {
+            auto q = ComputeQuorumMembersByQuarterRotation(llmqType, pCycleQuorumBaseBlockIndex);
+            LOCK(cs_indexed_members);
+            for (int i = 0; i < static_cast<int>(q.size()); ++i) {
+                mapIndexedQuorumMembers[llmqType].insert(std::make_pair(pCycleQuorumBaseBlockIndex->GetBlockHash(), i), q[i]);
+            }
 
-        quorumMembers = q[quorumIndex];
-    } else {
+            quorumMembers = q[quorumIndex];
+        }
+    } else if (reset_cache || !ReadQuorumMembers(llmqType, pQuorumBaseBlockIndex, quorumMembers)) {
         quorumMembers = ComputeQuorumMembers(llmqType, pQuorumBaseBlockIndex);
     }
 
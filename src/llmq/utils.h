@@ -54,7 +54,14 @@ public:
     // includes members which failed DKG
     static std::vector<CDeterministicMNCPtr> GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pQuorumBaseBlockIndex, bool reset_cache = false);
 
+    // Called while the block is connected (or disconnected with reset_cache), persists (or erases) the members of
+    // quorums based on it as part of the block's evodb transaction
     static void PreComputeQuorumMembers(const CBlockIndex* pQuorumBaseBlockIndex, bool reset_cache = false);
+    // Removes persisted members of quorums that are too old to be used for signing or connections at pindex, as part
+    // of the evodb transaction connecting pindex
+    static void CleanupQuorumMembersDb(const CBlockIndex* pindex);
+    static bool ReadQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pQuorumBaseBlockIndex, std::vector<CDeterministicMNCPtr>& members);
+    static void WriteQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pQuorumBaseBlockIndex, const std::vector<CDeterministicMNCPtr>& members);
     static std::vector<CDeterministicMNCPtr> ComputeQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pQuorumBaseBlockIndex);
     static std::vector<std::vector<CDeterministicMNCPtr>> ComputeQuorumMembersByQuarterRotation(Consensus::LLMQType llmqType, const CBlockIndex* pCycleQuorumBaseBlockIndex);
 
@@ -14,6 +14,8 @@
 #include <consensus/merkle.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <cryptonote/slow-hash.h>
+#include <hash.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
 #include <pow.h>
@@ -36,12 +38,33 @@
 #include <wallet/rpcwallet.h>
 
 #include <algorithm>
+#include <atomic>
+#include <limits>
 #include <utility>
 #include <boost/thread.hpp>
 
-uint64_t nMiningTimeStart = 0;
-double nHashesPerSec = 0;
-uint64_t nHashesDone = 0;
+// Hash rate accounting of the miner threads. Each thread counts locally and
+// only publishes its count once per nonce batch.
+static std::atomic<int64_t> nMiningTimeStart{0};
+static std::atomic<uint64_t> nHashesDone{0};
+
+static double GetMinerHashesPerSec()
+{
+    const double nSeconds = (GetTimeMicros() - nMiningTimeStart.load(std::memory_order_relaxed)) / 1000000.00;
+    return nHashesDone.load(std::memory_order_relaxed) / (nSeconds + 1);
+}
+
+/** Size of a core's L2 cache in bytes, or 0 if it is not known */
+static size_t GetL2CacheSize()
+{
+#if defined(_SC_LEVEL2_CACHE_SIZE)
+    const long nSize = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (nSize > 0) {
+        return nSize;
+    }
+#endif
+    return 0;
+}
 
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
 {
@@ -499,6 +522,11 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
         hashPrevBlock = pblock->hashPrevBlock;
     }
     ++nExtraNonce;
+    SetExtraNonce(pblock, pindexPrev, nExtraNonce);
+}
+
+void SetExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int nExtraNonce)
+{
     unsigned int nHeight = pindexPrev->nHeight+1; // Height first in coinbase required for block.version=2
     CMutableTransaction txCoinbase(*pblock->vtx[0]);
     txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce));
@@ -535,13 +563,31 @@ static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainpar
     return true;
 }
 
-void static BitcoinMiner(const CChainParams& chainparams)
+void static BitcoinMiner(const CChainParams& chainparams, const unsigned int nThreadIndex, const unsigned int nThreadCount)
 {
     LogPrintf("VkaxMiner -- started\n");
     SetThreadPriority(THREAD_PRIORITY_LOWEST);
     util::ThreadRename("vkax-miner");
-
+    crypto::slow_hash_thread_guard slowHashGuard;
+
+    // Every thread scans its own slice of the nonce space and walks its own
+    // extranonce sequence, so no two threads ever hash the same header. Slices
+    // are a multiple of 256 nonces, which are hashed MIKE_MAX_LANES at a time
+    const uint32_t nNonceRange = (0xffff0000 / nThreadCount) & ~0xffu;
+    const uint32_t nNonceBegin = nThreadIndex * nNonceRange;
+    const uint32_t nNonceEnd = nNonceBegin + nNonceRange;
     unsigned int nExtraNonce = 0;
+    uint256 hashPrevExtraNonce;
+
+    // Interleave as many CryptoNight hashes as the L2 cache holds the scratchpads
+    // of, unless -minercnways sets the number
+    const int nCnWays = gArgs.GetArg("-minercnways", DEFAULT_MINER_CN_WAYS);
+    const MikeCnWays cnWays = nCnWays > 0 ? GetMikeCnWays(nCnWays, std::numeric_limits<size_t>::max())
+                                          : GetMikeCnWays(MIKE_MAX_LANES, GetL2CacheSize());
+    if (nThreadIndex == 0) {
+        LogPrintf("VkaxMiner -- interleaving %u/%u/%u/%u/%u/%u CryptoNight hashes\n",
+            cnWays[0], cnWays[1], cnWays[2], cnWays[3], cnWays[4], cnWays[5]);
+    }
 
 
     CWallet * pWallet = NULL;
@@ -607,10 +653,23 @@ void static BitcoinMiner(const CChainParams& chainparams)
                 return;
             }
             CBlock *pblock = &pblocktemplate->block;
-            IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
+            if (hashPrevExtraNonce != pblock->hashPrevBlock) {
+                hashPrevExtraNonce = pblock->hashPrevBlock;
+                nExtraNonce = nThreadIndex + 1;
+            } else {
+                nExtraNonce += nThreadCount;
+            }
+            SetExtraNonce(pblock, pindexPrev, nExtraNonce);
+            pblock->nNonce = nNonceBegin;
+
+            // The algorithm schedule only depends on hashPrevBlock, which is fixed for this template
+            const MikeSchedule schedule(pblock->hashPrevBlock);
 
             LogPrintf("VkaxMiner -- Running miner with %u transactions in block (%u bytes)\n", pblock->vtx.size(),
                 ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
+            if (nThreadIndex == 0) {
+                LogPrintf("VkaxMiner -- hashrate %.2f hashes/s\n", GetMinerHashesPerSec());
+            }
 
             //
             // Search
@@ -619,41 +678,55 @@ void static BitcoinMiner(const CChainParams& chainparams)
             arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
             while (true)
             {
-                uint256 hash;
-                while (true)
+                // Hash MIKE_MAX_LANES consecutive nonces at a time, so that the core hashes run multi-buffer
+                CBlockHeader headers[MIKE_MAX_LANES];
+                uint256 hashes[MIKE_MAX_LANES];
+                for (CBlockHeader& header : headers) {
+                    header = pblock->GetBlockHeader();
+                }
+                uint64_t nHashes = 0;
+                bool fFound = false;
+                while (!fFound)
                 {
-                    hash = pblock->GetPOWHash();
-                    if (UintToArith256(hash) <= hashTarget)
-                    {
-                        // Found a solution
-                        SetThreadPriority(THREAD_PRIORITY_NORMAL);
-                        LogPrintf("VkaxMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
-                        ProcessBlockFound(pblock, chainparams, hash);
-                        SetThreadPriority(THREAD_PRIORITY_LOWEST);
-                        coinbaseScript->KeepScript();
-                        // In regression test mode, stop mining after a block is found. This
-                        // allows developers to controllably generate a block on demand.
-                        if (chainparams.MineBlocksOnDemand())
-                            throw boost::thread_interrupted();
-
-                        break;
+                    for (size_t lane = 0; lane < MIKE_MAX_LANES; ++lane) {
+                        headers[lane].nNonce = pblock->nNonce + lane;
                     }
-                    pblock->nNonce += 1;
-                    nHashesDone += 1;
-                    if (nHashesDone % 1000 == 0) {   //Calculate hashing speed
-                        nHashesPerSec = nHashesDone / (((GetTimeMicros() - nMiningTimeStart) / 1000000.00) + 1);
-                        LogPrintf("nNonce: %d, hashRate %f\n",pblock->nNonce, nHashesPerSec);
+                    CBlockHeader::GetPOWHashes(headers, MIKE_MAX_LANES, schedule, hashes, cnWays);
+                    nHashes += MIKE_MAX_LANES;
+                    for (size_t lane = 0; lane < MIKE_MAX_LANES; ++lane) {
+                        uint256& hash = hashes[lane];
+                        if (UintToArith256(hash) <= hashTarget)
+                        {
+                            // Found a solution
+                            pblock->nNonce = headers[lane].nNonce;
+                            SetThreadPriority(THREAD_PRIORITY_NORMAL);
+                            LogPrintf("VkaxMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
+                            ProcessBlockFound(pblock, chainparams, hash);
+                            SetThreadPriority(THREAD_PRIORITY_LOWEST);
+                            coinbaseScript->KeepScript();
+                            // In regression test mode, stop mining after a block is found. This
+                            // allows developers to controllably generate a block on demand.
+                            if (chainparams.MineBlocksOnDemand())
+                                throw boost::thread_interrupted();
+
+                            fFound = true;
+                            break;
+                        }
                     }
+                    if (fFound)
+                        break;
+                    pblock->nNonce += MIKE_MAX_LANES;
                     if ((pblock->nNonce & 0xFF) == 0)
                         break;
                 }
+                nHashesDone.fetch_add(nHashes, std::memory_order_relaxed);
 
                 // Check for stop or if block needs to be rebuilt
                 boost::this_thread::interruption_point();
                 // Regtest mode doesn't require peers
                 //if (vNodes.empty() && chainparams.MiningRequiresPeers())
                 //    break;
-                if (pblock->nNonce >= 0xffff0000)
+                if (pblock->nNonce >= nNonceEnd)
                     break;
                 if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
                     break;
@@ -709,10 +782,9 @@ int GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainpara
     //Reset metrics
     nMiningTimeStart = GetTimeMicros();
     nHashesDone = 0;
-    nHashesPerSec = 0;
 
     for (int i = 0; i < nThreads; i++){
-        minerThreads->create_thread(boost::bind(&BitcoinMiner, boost::cref(chainparams)));
+        minerThreads->create_thread(boost::bind(&BitcoinMiner, boost::cref(chainparams), i, nThreads));
     }
     return(numCores);
 }
@@ -25,6 +25,8 @@ class CScript;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Default for -minercnways, 0 picks the number by the L2 cache size */
+static const int DEFAULT_MINER_CN_WAYS = 0;
 
 struct CBlockTemplate
 {
@@ -200,6 +202,8 @@ private:
 
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
+/** Put the given extranonce into the coinbase and update the merkle root */
+void SetExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
 int GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainparams);
@@ -27,6 +27,7 @@
 #include <tinyformat.h>
 #include <index/txindex.h>
 #include <txmempool.h>
+#include <unordered_lru_cache.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <util/validation.h>
@@ -120,6 +121,10 @@ static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 static const int MAX_CMPCTBLOCK_DEPTH = 5;
 /** Maximum depth of blocks we're willing to respond to GETBLOCKTXN requests for. */
 static const int MAX_BLOCKTXN_DEPTH = 10;
+/** Number of recent blocks kept serialized after they were read from disk for a GETDATA request. */
+static const size_t MAX_RAW_BLOCK_CACHE_SIZE = 8;
+/** Maximum depth of blocks that are kept in the serialized block cache. */
+static const int MAX_RAW_BLOCK_CACHE_DEPTH = 10;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
  *  degree of disordering of blocks on disk (which make reindexing and pruning harder). We'll probably
@@ -652,6 +657,35 @@ static bool PeerHasHeader(CNodeState *state, const CBlockIndex *pindex) EXCLUSIV
     return false;
 }
 
+/** Add not-in-flight blocks below the snapshot base that the snapshot history validation needs
+ *  next to vBlocks, until it has at most count entries. FindNextBlocksToDownload skips them as
+ *  they are in the active chain already. */
+static void FindNextSnapshotHistoryBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<const CBlockIndex*>& vBlocks) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const CBlockIndex* pindexHistoryTip = GetSnapshotHistoryTip();
+    if (count == 0 || pindexHistoryTip == nullptr)
+        return;
+
+    CNodeState *state = State(nodeid);
+    assert(state != nullptr);
+
+    ProcessBlockAvailability(nodeid);
+    if (state->pindexBestKnownBlock == nullptr || state->pindexBestKnownBlock->GetAncestor(pindexSnapshotBase->nHeight) != pindexSnapshotBase) {
+        // The peer may not have the blocks of our snapshot
+        return;
+    }
+
+    const int nMaxHeight = std::min(pindexHistoryTip->nHeight + (int)BLOCK_DOWNLOAD_WINDOW, pindexSnapshotBase->nHeight);
+    for (int nHeight = pindexHistoryTip->nHeight + 1; nHeight <= nMaxHeight && count > 0; nHeight++) {
+        const CBlockIndex* pindex = ::ChainActive()[nHeight];
+        if (pindex->nStatus & BLOCK_HAVE_DATA || mapBlocksInFlight.count(pindex->GetBlockHash())) {
+            continue;
+        }
+        vBlocks.push_back(pindex);
+        count--;
+    }
+}
+
 /** Update pindexLastCommonBlock and add not-in-flight missing successors to vBlocks, until it has
  *  at most count entries. */
 static void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, NodeId& nodeStaller, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
@@ -1232,6 +1266,10 @@ static std::shared_ptr<const CBlock> most_recent_block GUARDED_BY(cs_most_recent
 static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_block GUARDED_BY(cs_most_recent_block);
 static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
 
+// Recent blocks as stored on disk, which are sent to peers unchanged
+static CCriticalSection cs_raw_block_cache;
+static unordered_lru_cache<uint256, std::shared_ptr<const std::vector<uint8_t>>, StaticSaltedHasher> raw_block_cache GUARDED_BY(cs_raw_block_cache){MAX_RAW_BLOCK_CACHE_SIZE, MAX_RAW_BLOCK_CACHE_SIZE};
+
 /**
  * Maintain state about the best-seen block and fast-announce a compact block
  * to compatible peers.
@@ -1563,9 +1601,33 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
     // it's available before trying to send.
     if (send && (pindex->nStatus & BLOCK_HAVE_DATA))
     {
+        // If a peer is asking for old blocks, we're almost guaranteed
+        // they won't have a useful mempool to match against a compact block,
+        // and we don't feel like constructing the object for them, so
+        // instead we respond with the full, non-compact block.
+        const bool send_full_block = inv.type == MSG_BLOCK ||
+            (inv.type == MSG_CMPCT_BLOCK && !(CanDirectFetch(consensusParams) && pindex->nHeight >= ::ChainActive().Height() - MAX_CMPCTBLOCK_DEPTH));
         std::shared_ptr<const CBlock> pblock;
+        std::shared_ptr<const std::vector<uint8_t>> raw_block;
         if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
             pblock = a_recent_block;
+        } else if (send_full_block) {
+            // The block is sent as stored on disk, there is no need to parse and reserialize it
+            {
+                LOCK(cs_raw_block_cache);
+                raw_block_cache.get(pindex->GetBlockHash(), raw_block);
+            }
+            if (!raw_block) {
+                std::vector<uint8_t> raw_block_read;
+                if (!ReadRawBlockFromDisk(raw_block_read, pindex, chainparams.MessageStart()))
+                    assert(!"cannot load block from disk");
+                raw_block = std::make_shared<const std::vector<uint8_t>>(std::move(raw_block_read));
+                // Don't let peers syncing old blocks push the tip out of the cache
+                if (pindex->nHeight >= ::ChainActive().Height() - MAX_RAW_BLOCK_CACHE_DEPTH) {
+                    LOCK(cs_raw_block_cache);
+                    raw_block_cache.insert(pindex->GetBlockHash(), raw_block);
+                }
+            }
         } else {
             // Send block from disk
             std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
@@ -1573,8 +1635,10 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
                 assert(!"cannot load block from disk");
             pblock = pblockRead;
         }
-        if (pblock) {
-            if (inv.type == MSG_BLOCK)
+        if (raw_block) {
+            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(*raw_block)));
+        } else if (pblock) {
+            if (send_full_block)
                 connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
             else if (inv.type == MSG_FILTERED_BLOCK) {
                 bool sendMerkleBlock = false;
@@ -1608,21 +1672,12 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
                 // else
                 // no response
             } else if (inv.type == MSG_CMPCT_BLOCK) {
-                // If a peer is asking for old blocks, we're almost guaranteed
-                // they won't have a useful mempool to match against a compact block,
-                // and we don't feel like constructing the object for them, so
-                // instead we respond with the full, non-compact block.
-                if (CanDirectFetch(consensusParams) &&
-                    pindex->nHeight >= ::ChainActive().Height() - MAX_CMPCTBLOCK_DEPTH) {
-                    if (a_recent_compact_block &&
-                        a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
-                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
-                    } else {
-                        CBlockHeaderAndShortTxIDs cmpctblock(*pblock);
-                        connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
-                    }
+                if (a_recent_compact_block &&
+                    a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
+                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
                 } else {
-                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+                    CBlockHeaderAndShortTxIDs cmpctblock(*pblock);
+                    connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
                 }
             }
         }
@@ -4849,6 +4904,9 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
             FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller, consensusParams);
+            if (!pto->m_limited_node) {
+                FindNextSnapshotHistoryBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight - vToDownload.size(), vToDownload);
+            }
             for (const CBlockIndex *pindex : vToDownload) {
                 vGetData.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
                 MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), pindex);
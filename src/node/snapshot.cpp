@@ -0,0 +1,30 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/snapshot.h>
+
+#include <hash.h>
+
+#include <cstdio>
+
+bool HashSnapshotFile(const fs::path& path, uint256& hash)
+{
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    CHash256 hasher;
+    std::vector<unsigned char> buf(1 << 20);
+    size_t read;
+    while ((read = fread(buf.data(), 1, buf.size(), file)) > 0) {
+        hasher.Write(MakeUCharSpan(buf).first(read));
+    }
+    const bool error = ferror(file);
+    fclose(file);
+    if (error) {
+        return false;
+    }
+    hasher.Finalize(hash);
+    return true;
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_SNAPSHOT_H
+#define BITCOIN_NODE_SNAPSHOT_H
+
+#include <fs.h>
+#include <protocol.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <cstdint>
+#include <vector>
+
+/** Version of the snapshot file format */
+static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+/**
+ * Header of a chainstate snapshot file. It is followed by the block headers
+ * from height 1 up to the base block, the coins of the UTXO set as of the
+ * base block and the contents of the evodb (deterministic masternode lists,
+ * LLMQ commitments and snapshots) as of the same block.
+ */
+struct SnapshotMetadata
+{
+    uint32_t nVersion{SNAPSHOT_VERSION};
+    CMessageHeader::MessageStartChars pchMessageStart{};
+    uint256 base_blockhash;
+    int32_t base_height{0};
+    uint64_t base_chain_tx{0};
+    uint64_t coins_count{0};
+    uint64_t evodb_count{0};
+
+    SERIALIZE_METHODS(SnapshotMetadata, obj)
+    {
+        READWRITE(obj.nVersion, obj.pchMessageStart, obj.base_blockhash, obj.base_height, obj.base_chain_tx, obj.coins_count, obj.evodb_count);
+    }
+};
+
+/** Database key or value that is (de)serialized as is, without a length prefix */
+struct SnapshotRawData
+{
+    std::vector<unsigned char> data;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s.write((const char*)data.data(), data.size());
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        data.resize(s.size());
+        s.read((char*)data.data(), data.size());
+    }
+};
+
+/** Compute the double SHA256 of a whole snapshot file */
+bool HashSnapshotFile(const fs::path& path, uint256& hash);
+
+#endif // BITCOIN_NODE_SNAPSHOT_H
@@ -0,0 +1,87 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <powcache.h>
+
+#include <chain.h>
+#include <primitives/block.h>
+#include <util/system.h>
+
+static const char DB_POWHASH = 'p';
+
+std::unique_ptr<CPowCache> powCache;
+
+CPowCache::CPowCache(size_t nCacheSize, bool fMemory, bool fWipe) :
+    db(fMemory ? "" : (GetDataDir() / "blocks" / "powcache"), nCacheSize, fMemory, fWipe)
+{
+}
+
+bool CPowCache::Get(const uint256& blockHash, uint256& powHash) const
+{
+    {
+        LOCK(cs);
+        if (mapCache.get(blockHash, powHash)) {
+            return true;
+        }
+    }
+
+    if (!db.Read(std::make_pair(DB_POWHASH, blockHash), powHash)) {
+        return false;
+    }
+
+    LOCK(cs);
+    mapCache.insert(blockHash, powHash);
+    return true;
+}
+
+void CPowCache::Insert(const uint256& blockHash, const uint256& powHash)
+{
+    LOCK(cs);
+    mapCache.insert(blockHash, powHash);
+}
+
+void CPowCache::Write(const uint256& blockHash, const uint256& powHash)
+{
+    db.Write(std::make_pair(DB_POWHASH, blockHash), powHash);
+
+    LOCK(cs);
+    mapCache.insert(blockHash, powHash);
+}
+
+bool CPowCache::Persist(const uint256& blockHash)
+{
+    uint256 powHash;
+    {
+        LOCK(cs);
+        if (!mapCache.get(blockHash, powHash)) {
+            return false;
+        }
+    }
+    db.Write(std::make_pair(DB_POWHASH, blockHash), powHash);
+    return true;
+}
+
+void CPowCache::Erase(const uint256& blockHash)
+{
+    {
+        LOCK(cs);
+        mapCache.erase(blockHash);
+    }
+    db.Erase(std::make_pair(DB_POWHASH, blockHash));
+}
+
+uint256 GetBlockPOWHash(const CBlockIndex* pindex)
+{
+    const CBlockHeader header = pindex->GetBlockHeader();
+    if (!powCache) {
+        return header.GetPOWHash();
+    }
+
+    uint256 powHash;
+    if (!powCache->Get(pindex->GetBlockHash(), powHash)) {
+        powHash = header.GetPOWHash();
+        powCache->Write(pindex->GetBlockHash(), powHash);
+    }
+    return powHash;
+}
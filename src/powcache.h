@@ -0,0 +1,66 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POWCACHE_H
+#define BITCOIN_POWCACHE_H
+
+#include <dbwrapper.h>
+#include <saltedhasher.h>
+#include <sync.h>
+#include <uint256.h>
+#include <unordered_lru_cache.h>
+
+#include <memory>
+
+class CBlockHeader;
+class CBlockIndex;
+
+/** Cache size of the PoW hash database (bytes) */
+static const int64_t nPowCacheDBCache = 8 << 20;
+
+/**
+ * Persistent cache of Mike PoW hashes, keyed by block (header) hash.
+ *
+ * The block hash commits to every header field, so a PoW hash stored for a
+ * block hash never goes stale and survives reorgs and reindexing. Results are
+ * written to a dedicated LevelDB in blocks/powcache and fronted by a small
+ * in-memory LRU for recently accessed headers.
+ *
+ * Hashes of headers which only passed CheckPOW are kept in memory. They are
+ * written to disk once the header was accepted into the block index, so that
+ * the database can't grow beyond the block index by feeding it junk headers.
+ */
+class CPowCache
+{
+private:
+    mutable CCriticalSection cs;
+    CDBWrapper db;
+    mutable unordered_lru_cache<uint256, uint256, StaticSaltedHasher, 10000> mapCache GUARDED_BY(cs);
+
+public:
+    explicit CPowCache(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+
+    bool Get(const uint256& blockHash, uint256& powHash) const;
+    /** Remember a hash in memory only, see Persist */
+    void Insert(const uint256& blockHash, const uint256& powHash);
+    /** Remember a hash in memory and on disk */
+    void Write(const uint256& blockHash, const uint256& powHash);
+    /** Write a hash remembered by Insert to disk. Returns false if it isn't in memory (anymore). */
+    bool Persist(const uint256& blockHash);
+    void Erase(const uint256& blockHash);
+};
+
+/** The global PoW hash cache. May be null (e.g. in unit tests), in which case hashes are always computed. */
+extern std::unique_ptr<CPowCache> powCache;
+
+/**
+ * Return the PoW hash of a block in the block index, for RPC and REST.
+ * Headers only enter the block index after passing CheckPOW, so a hash that
+ * isn't cached yet (e.g. for blocks validated before the cache existed) is
+ * computed once and written to disk. Endpoints returning many headers call it
+ * after releasing cs_main for that reason.
+ */
+uint256 GetBlockPOWHash(const CBlockIndex* pindex);
+
+#endif // BITCOIN_POWCACHE_H
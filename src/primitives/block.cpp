@@ -13,6 +13,8 @@
 #include <util/system.h>
 #include <util/strencodings.h>
 
+#include <algorithm>
+
 uint256 CBlockHeader::GetHash() const
 {
     return SerializeHash(*this);
@@ -23,6 +25,31 @@ uint256 CBlockHeader::GetPOWHash() const
 	return Mike(BEGIN(nVersion), END(nNonce), hashPrevBlock);
 }
 
+uint256 CBlockHeader::GetPOWHash(const MikeSchedule& schedule) const
+{
+    return Mike(BEGIN(nVersion), END(nNonce), schedule);
+}
+
+void CBlockHeader::GetPOWHashes(const CBlockHeader* headers, size_t count, const MikeSchedule& schedule, uint256* hashes)
+{
+    GetPOWHashes(headers, count, schedule, hashes, MIKE_CN_SINGLE);
+}
+
+void CBlockHeader::GetPOWHashes(const CBlockHeader* headers, size_t count, const MikeSchedule& schedule, uint256* hashes, const MikeCnWays& cnWays)
+{
+    const unsigned char* input[MIKE_MAX_LANES];
+    while (count > 0) {
+        const size_t lanes = std::min(count, MIKE_MAX_LANES);
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            input[lane] = reinterpret_cast<const unsigned char*>(&headers[lane].nVersion);
+        }
+        MikeMulti(hashes, input, END(headers[0].nNonce) - BEGIN(headers[0].nVersion), lanes, schedule, cnWays);
+        headers += lanes;
+        hashes += lanes;
+        count -= lanes;
+    }
+}
+
 
 std::string CBlock::ToString() const
 {
@@ -15,6 +15,9 @@
 #include <cstddef>
 #include <type_traits>
 
+struct MikeCnWays;
+struct MikeSchedule;
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -63,6 +66,13 @@ public:
     // Caching lookup/computation of POW hash using mike algorithm
     uint256 GetPOWHash() const;
 
+    // Compute the POW hash with a precomputed schedule for hashPrevBlock
+    uint256 GetPOWHash(const MikeSchedule& schedule) const;
+
+    // Compute the POW hashes of headers which share hashPrevBlock side by side, see MikeMulti
+    static void GetPOWHashes(const CBlockHeader* headers, size_t count, const MikeSchedule& schedule, uint256* hashes);
+    static void GetPOWHashes(const CBlockHeader* headers, size_t count, const MikeSchedule& schedule, uint256* hashes, const MikeCnWays& cnWays);
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
@@ -17,8 +17,10 @@
 #include <index/txindex.h>
 #include <key_io.h>
 #include <node/coinstats.h>
+#include <node/snapshot.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
+#include <powcache.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
@@ -34,6 +36,7 @@
 #include <versionbitsinfo.h>
 #include <warnings.h>
 
+#include <evo/evodb.h>
 #include <evo/specialtx.h>
 #include <evo/cbtx.h>
 
@@ -121,6 +124,7 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
         result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
 
     result.pushKV("chainlock", llmq::chainLocksHandler->HasChainLock(blockindex->nHeight, blockindex->GetBlockHash()));
+    result.pushKV("powhash", GetBlockPOWHash(blockindex).GetHex());
 
     return result;
 }
@@ -177,7 +181,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
 
     result.pushKV("chainlock", chainLock);
     if(powHash)
-        result.pushKV("powhash", block.GetPOWHash().GetHex());
+        result.pushKV("powhash", GetBlockPOWHash(blockindex).GetHex());
     return result;
 }
 
@@ -845,6 +849,7 @@ static UniValue getblockheader(const JSONRPCRequest& request)
             "  \"nTx\" : n,             (numeric) The number of transactions in the block.\n"
             "  \"previousblockhash\" : \"hash\",  (string) The hash of the previous block\n"
             "  \"nextblockhash\" : \"hash\",      (string) The hash of the next block\n"
+            "  \"powhash\" : \"hash\",            (string) The pow hash of the block\n"
             "}\n"
                     },
                     RPCResult{"for verbose=false",
@@ -916,6 +921,7 @@ static UniValue getblockheaders(const JSONRPCRequest& request)
             "  \"chainwork\" : \"0000...1f3\"     (string)  Expected number of hashes required to produce the current chain (in hex)\n"
             "  \"previousblockhash\" : \"hash\",  (string)  The hash of the previous block\n"
             "  \"nextblockhash\" : \"hash\",      (string)  The hash of the next block\n"
+            "  \"powhash\" : \"hash\",            (string)  The pow hash of the block\n"
             "}, {\n"
             "       ...\n"
             "   },\n"
@@ -933,14 +939,9 @@ static UniValue getblockheaders(const JSONRPCRequest& request)
                 },
         }.ToString());
 
-    LOCK(cs_main);
-
     std::string strHash = request.params[0].get_str();
     uint256 hash(uint256S(strHash));
 
-    if (::BlockIndex().count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
     int nCount = MAX_HEADERS_RESULTS;
     if (!request.params[1].isNull())
         nCount = request.params[1].get_int();
@@ -952,29 +953,43 @@ static UniValue getblockheaders(const JSONRPCRequest& request)
     if (!request.params[2].isNull())
         fVerbose = request.params[2].get_bool();
 
-    CBlockIndex* pblockindex = ::BlockIndex()[hash];
+    // The JSON is built after releasing cs_main, as the PoW hashes of headers that aren't
+    // cached yet are computed and written to disk
+    const CBlockIndex* tip;
+    std::vector<const CBlockIndex*> headers;
+    headers.reserve(nCount);
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pblockindex = LookupBlockIndex(hash);
+        if (!pblockindex)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+        tip = ::ChainActive().Tip();
+        for (; pblockindex; pblockindex = ::ChainActive().Next(pblockindex))
+        {
+            headers.push_back(pblockindex);
+            if (--nCount <= 0)
+                break;
+        }
+    }
 
     UniValue arrHeaders(UniValue::VARR);
 
     if (!fVerbose)
     {
-        for (; pblockindex; pblockindex = ::ChainActive().Next(pblockindex))
+        for (const CBlockIndex* pindex : headers)
         {
             CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-            ssBlock << pblockindex->GetBlockHeader();
+            ssBlock << pindex->GetBlockHeader();
             std::string strHex = HexStr(ssBlock);
             arrHeaders.push_back(strHex);
-            if (--nCount <= 0)
-                break;
         }
         return arrHeaders;
     }
 
-    for (; pblockindex; pblockindex = ::ChainActive().Next(pblockindex))
+    for (const CBlockIndex* pindex : headers)
     {
-        arrHeaders.push_back(blockheaderToJSON(::ChainActive().Tip(), pblockindex));
-        if (--nCount <= 0)
-            break;
+        arrHeaders.push_back(blockheaderToJSON(tip, pindex));
     }
 
     return arrHeaders;
@@ -1493,6 +1508,11 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             "  \"pruneheight\" : xxxxxx,        (numeric) lowest-height complete block stored (only present if pruning is enabled)\n"
             "  \"automatic_pruning\" : xx,      (boolean) whether automatic pruning is enabled (only present if pruning is enabled)\n"
             "  \"prune_target_size\" : xxxxxx,  (numeric) the target size used by pruning (only present if automatic pruning is enabled)\n"
+            "  \"snapshot\" : {                 (json object) the snapshot the chainstate was loaded from (only present if loaded with -loadsnapshot)\n"
+            "     \"base_height\" : xxxxxx,     (numeric) the height of the snapshot base\n"
+            "     \"history_height\" : xxxxxx,  (numeric) the height up to which the blocks below the snapshot base have been validated\n"
+            "     \"history_validated\" : xx,   (boolean) whether all blocks below the snapshot base have been validated\n"
+            "  },\n"
             "  \"softforks\" : [                (json array) status of softforks in progress\n"
             "     {\n"
             "        \"id\" : \"xxxx\",           (string) name of softfork\n"
@@ -1560,6 +1580,14 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
             obj.pushKV("prune_target_size",  nPruneTarget);
         }
     }
+    if (pindexSnapshotBase) {
+        const CBlockIndex* pindexHistoryTip = fSnapshotHistoryValidated ? pindexSnapshotBase : GetSnapshotHistoryTip();
+        UniValue snapshot(UniValue::VOBJ);
+        snapshot.pushKV("base_height",       pindexSnapshotBase->nHeight);
+        snapshot.pushKV("history_height",    pindexHistoryTip ? pindexHistoryTip->nHeight : 0);
+        snapshot.pushKV("history_validated", fSnapshotHistoryValidated);
+        obj.pushKV("snapshot",              snapshot);
+    }
 
     const Consensus::Params& consensusParams = Params().GetConsensus();
     UniValue softforks(UniValue::VARR);
@@ -2732,6 +2760,129 @@ static UniValue getblockfilter(const JSONRPCRequest& request)
 }
 
 // clang-format off
+static UniValue dumpsnapshot(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1) {
+        throw std::runtime_error(
+            RPCHelpMan{"dumpsnapshot",
+                "\nWrite the block headers, the UTXO set and the evodb state (masternode lists and LLMQ state)\n"
+                "at the current tip to a snapshot file. A new node can start from it with -loadsnapshot=<file>,\n"
+                "before downloading and validating the blocks below it, if its hash is built into the client\n"
+                "or passed as -loadsnapshothash=<hash>. Those blocks are validated in the background afterwards.\n"
+                "Note this call may take some time.\n",
+                {
+                    {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the output file. If relative, will be prefixed by datadir."},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::STR_HEX, "base_hash", "The hash of the block the snapshot was taken at"},
+                        {RPCResult::Type::NUM, "base_height", "The height of the block the snapshot was taken at"},
+                        {RPCResult::Type::NUM, "coins_written", "The number of coins written to the snapshot"},
+                        {RPCResult::Type::NUM, "evodb_entries_written", "The number of evodb entries written to the snapshot"},
+                        {RPCResult::Type::STR, "path", "The absolute path of the snapshot file"},
+                        {RPCResult::Type::STR_HEX, "hash", "The hash of the snapshot file"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("dumpsnapshot", "\"snapshot.dat\"")
+            + HelpExampleRpc("dumpsnapshot", "\"snapshot.dat\"")
+                },
+            }.ToString());
+    }
+
+    const fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    const fs::path temppath = path.string() + ".incomplete";
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+    }
+
+    CAutoFile file(fsbridge::fopen(temppath, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to open " + temppath.string() + " for writing");
+    }
+
+    // Take the coins and evodb iterators at the same flushed tip, the database
+    // snapshots they hold keep them consistent while new blocks are connected.
+    SnapshotMetadata metadata;
+    std::vector<const CBlockIndex*> vIndex;
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    std::unique_ptr<CDBIterator> pevodbcursor;
+    {
+        LOCK(cs_main);
+        ::ChainstateActive().ForceFlushStateToDisk();
+        const CBlockIndex* tip = ::ChainActive().Tip();
+        CHECK_NONFATAL(tip);
+        if (!tip->pprev) {
+            throw JSONRPCError(RPC_MISC_ERROR, "Cannot write a snapshot of the genesis block");
+        }
+        pcursor.reset(::ChainstateActive().CoinsDB().Cursor());
+        pevodbcursor.reset(evoDb->GetRawDB().NewIterator());
+        CHECK_NONFATAL(pcursor->GetBestBlock() == tip->GetBlockHash());
+
+        memcpy(metadata.pchMessageStart, Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE);
+        metadata.base_blockhash = tip->GetBlockHash();
+        metadata.base_height = tip->nHeight;
+        metadata.base_chain_tx = tip->nChainTx;
+        for (const CBlockIndex* pindex = tip; pindex->pprev; pindex = pindex->pprev) {
+            vIndex.push_back(pindex);
+        }
+    }
+
+    // The counts are only known at the end, the metadata is written again then
+    file << metadata;
+    for (auto it = vIndex.rbegin(); it != vIndex.rend(); ++it) {
+        file << (*it)->GetBlockHeader();
+    }
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
+        }
+        file << key << coin;
+        metadata.coins_count++;
+        pcursor->Next();
+    }
+
+    for (pevodbcursor->SeekToFirst(); pevodbcursor->Valid(); pevodbcursor->Next()) {
+        boost::this_thread::interruption_point();
+        SnapshotRawData key, value;
+        if (!pevodbcursor->GetKey(key) || !pevodbcursor->GetValue(value)) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read evodb");
+        }
+        file << key.data << value.data;
+        metadata.evodb_count++;
+    }
+
+    if (fseek(file.Get(), 0, SEEK_SET) != 0) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to write " + temppath.string());
+    }
+    file << metadata;
+    if (fflush(file.Get()) != 0 || !FileCommit(file.Get())) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to write " + temppath.string());
+    }
+    file.fclose();
+    if (!RenameOver(temppath, path)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to rename " + temppath.string() + " to " + path.string());
+    }
+
+    uint256 hash;
+    if (!HashSnapshotFile(path, hash)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to read back " + path.string());
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("base_hash", metadata.base_blockhash.GetHex());
+    result.pushKV("base_height", metadata.base_height);
+    result.pushKV("coins_written", metadata.coins_count);
+    result.pushKV("evodb_entries_written", metadata.evodb_count);
+    result.pushKV("path", path.string());
+    result.pushKV("hash", hash.GetHex());
+    return result;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
@@ -2764,6 +2915,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           {"action", "scanobjects"} },
     { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash", "filtertype"} },
+    { "blockchain",         "dumpsnapshot",           &dumpsnapshot,           {"path"} },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
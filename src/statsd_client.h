@@ -29,6 +29,14 @@ class StatsdClient {
         void config(const std::string& host, int port, const std::string& ns = DEFAULT_STATSD_NAMESPACE);
         const char* errmsg();
 
+    public:
+        /**
+         * Set up the connection, if -statsenabled. Sending does this on first
+         * use too, which is not thread safe, so call it before starting
+         * threads that send stats.
+         */
+        int init();
+
     public:
         int inc(const std::string& key, float sample_rate = 1.0);
         int dec(const std::string& key, float sample_rate = 1.0);
@@ -53,7 +61,6 @@ class StatsdClient {
                 const std::string& type, float sample_rate);
 
     protected:
-        int init();
         static void cleanup(std::string& key);
 
     protected:
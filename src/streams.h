@@ -198,6 +198,55 @@ public:
     }
 };
 
+/** Minimal stream for reading from memory that is owned elsewhere, such as a
+ * mapped file, without copying it into a buffer first
+ */
+class SpanReader
+{
+private:
+    const int m_type;
+    const int m_version;
+    Span<const unsigned char> m_data;
+
+public:
+    SpanReader(int type, int version, Span<const unsigned char> data)
+        : m_type(type), m_version(version), m_data(data) {}
+
+    template<typename T>
+    SpanReader& operator>>(T&& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    int GetVersion() const { return m_version; }
+    int GetType() const { return m_type; }
+
+    size_t size() const { return m_data.size(); }
+    bool empty() const { return m_data.size() == 0; }
+
+    void read(char* dst, size_t n)
+    {
+        if (n == 0) {
+            return;
+        }
+        if (n > m_data.size()) {
+            throw std::ios_base::failure("SpanReader::read(): end of data");
+        }
+        memcpy(dst, m_data.data(), n);
+        m_data = m_data.subspan(n);
+    }
+
+    void ignore(size_t n)
+    {
+        if (n > m_data.size()) {
+            throw std::ios_base::failure("SpanReader::ignore(): end of data");
+        }
+        m_data = m_data.subspan(n);
+    }
+};
+
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
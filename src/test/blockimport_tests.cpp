@@ -0,0 +1,119 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <clientversion.h>
+#include <consensus/validation.h>
+#include <fs.h>
+#include <node/coinstats.h>
+#include <pow.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** Hash of the UTXO set of the active chainstate */
+uint256 UTXOSetHash()
+{
+    LOCK(cs_main);
+    ::ChainstateActive().ForceFlushStateToDisk();
+    CCoinsStats stats;
+    BOOST_REQUIRE(GetUTXOStats(&::ChainstateActive().CoinsDB(), stats));
+    return stats.hashSerialized;
+}
+
+/** Change the header until its PoW passes, or fails */
+void MineHeader(CBlock& block, bool valid)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    do {
+        ++block.nNonce;
+    } while (CheckProofOfWork(block.GetPOWHash(), block.nBits, consensusParams) != valid);
+}
+
+/** Append a record the way blocks are stored in blk*.dat files */
+void AppendRecord(CDataStream& file, const std::vector<unsigned char>& data)
+{
+    file.write((const char*)Params().MessageStart(), CMessageHeader::MESSAGE_START_SIZE);
+    file << (unsigned int)data.size();
+    file.write((const char*)data.data(), data.size());
+}
+
+void AppendBlock(CDataStream& file, const CBlock& block)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    AppendRecord(file, std::vector<unsigned char>(ss.begin(), ss.end()));
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_SUITE(blockimport_tests)
+
+BOOST_AUTO_TEST_CASE(load_external_block_file_with_invalid_blocks)
+{
+    // Take the blocks and resulting UTXO set of a 100-block chain
+    std::vector<CBlock> blocks;
+    uint256 utxo_hash;
+    {
+        TestChain100Setup setup;
+        LOCK(cs_main);
+        for (int height = 1; height <= ::ChainActive().Height(); ++height) {
+            blocks.emplace_back();
+            BOOST_REQUIRE(ReadBlockFromDisk(blocks.back(), ::ChainActive()[height], Params().GetConsensus()));
+        }
+        utxo_hash = UTXOSetHash();
+    }
+    BOOST_REQUIRE_EQUAL(blocks.size(), 100U);
+
+    RegTestingSetup setup;
+    BOOST_REQUIRE(g_parallel_block_checks);
+
+    // A block with a wrong merkle root, which only CheckBlock catches
+    CBlock bad_merkle = blocks[49];
+    bad_merkle.hashMerkleRoot = uint256S("01");
+    MineHeader(bad_merkle, true);
+    // A block whose header fails the PoW check
+    CBlock bad_pow = blocks[59];
+    MineHeader(bad_pow, false);
+
+    // The invalid blocks are in the same batch as the valid blocks around them
+    CDataStream file(SER_DISK, CLIENT_VERSION);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        if (i == 49) AppendBlock(file, bad_merkle);
+        if (i == 59) AppendBlock(file, bad_pow);
+        if (i == 69) {
+            // Garbage that doesn't deserialize
+            AppendRecord(file, std::vector<unsigned char>(200, 0xff));
+        }
+        AppendBlock(file, blocks[i]);
+    }
+
+    FILE* fileIn = fsbridge::fopen(GetDataDir() / "bootstrap.dat", "wb+");
+    BOOST_REQUIRE(fileIn);
+    BOOST_REQUIRE_EQUAL(fwrite(file.data(), 1, file.size(), fileIn), file.size());
+    rewind(fileIn);
+    // Closes fileIn
+    LoadExternalBlockFile(Params(), fileIn);
+
+    CValidationState state;
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+
+    // The valid blocks are all connected, the invalid ones are not
+    {
+        LOCK(cs_main);
+        BOOST_CHECK_EQUAL(::ChainActive().Height(), 100);
+        BOOST_CHECK_EQUAL(::ChainActive().Tip()->GetBlockHash(), blocks.back().GetHash());
+        const CBlockIndex* pindex_bad_merkle = LookupBlockIndex(bad_merkle.GetHash());
+        BOOST_CHECK(!pindex_bad_merkle || !(pindex_bad_merkle->nStatus & BLOCK_HAVE_DATA));
+        BOOST_CHECK(!::ChainActive().Contains(pindex_bad_merkle));
+        BOOST_CHECK(!LookupBlockIndex(bad_pow.GetHash()));
+    }
+    BOOST_CHECK(UTXOSetHash() == utxo_hash);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,9 +4,12 @@
 
 #include <bls/bls.h>
 #include <bls/bls_batchverifier.h>
+#include <llmq/signing_shares.h>
 #include <random.h>
 #include <test/util/setup_common.h>
 
+#include <ctpl_stl.h>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(bls_tests, BasicTestingSetup)
@@ -311,4 +314,48 @@ BOOST_AUTO_TEST_CASE(batch_verifier_tests)
     Verify(msgs);
 }
 
+static std::vector<llmq::CSigShareToVerify> BuildSigShares(size_t sessionCount, size_t quorumSize, NodeId peerCount)
+{
+    BLSSecretKeyVector skShares(quorumSize);
+    BLSPublicKeyVector pkShares(quorumSize);
+    for (size_t i = 0; i < quorumSize; i++) {
+        skShares[i].MakeNewKey();
+        pkShares[i] = skShares[i].GetPublicKey();
+    }
+
+    std::vector<llmq::CSigShareToVerify> sigShares;
+    for (size_t i = 0; i < sessionCount; i++) {
+        uint256 signHash = InsecureRand256();
+        for (uint16_t member = 0; member < quorumSize; member++) {
+            NodeId nodeId = member % peerCount;
+            sigShares.push_back({nodeId, {signHash, member}, signHash, skShares[member].Sign(signHash), pkShares[member]});
+        }
+    }
+    return sigShares;
+}
+
+BOOST_AUTO_TEST_CASE(sigshares_verify_tests)
+{
+    // enough shares for the calling thread and every thread of the pool to get a shard
+    auto sigShares = BuildSigShares(64, 10, 4);
+    ctpl::thread_pool workerPool(3);
+
+    BOOST_CHECK(llmq::VerifySigShares(sigShares, nullptr).empty());
+    BOOST_CHECK(llmq::VerifySigShares(sigShares, &workerPool).empty());
+
+    // one share of one session signed by the wrong member, which fails the batch of its shard only
+    auto& badShare = sigShares[37 * 10 + 5];
+    CBLSSecretKey otherKey;
+    otherKey.MakeNewKey();
+    badShare.sig = otherKey.Sign(badShare.signHash);
+    const std::set<NodeId> expectedBadSources{badShare.nodeId};
+
+    BOOST_CHECK(llmq::VerifySigShares(sigShares, nullptr) == expectedBadSources);
+    BOOST_CHECK(llmq::VerifySigShares(sigShares, &workerPool) == expectedBadSources);
+
+    // too few shares to be worth sharding, which are verified on the calling thread only
+    std::vector<llmq::CSigShareToVerify> fewSigShares(sigShares.begin() + 36 * 10, sigShares.begin() + 38 * 10);
+    BOOST_CHECK(llmq::VerifySigShares(fewSigShares, &workerPool) == expectedBadSources);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
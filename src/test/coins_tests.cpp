@@ -53,9 +53,9 @@ public:
 
     uint256 GetBestBlock() const override { return hashBestBlock_; }
 
-    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock, bool erase = true) override
     {
-        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ) {
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it = erase ? mapCoins.erase(it) : std::next(it)) {
             if (it->second.flags & CCoinsCacheEntry::DIRTY) {
                 // Same optimization used in CCoinsViewDB is to only write dirty entries.
                 map_[it->first] = it->second.coin;
@@ -64,7 +64,6 @@ public:
                     map_.erase(it->first);
                 }
             }
-            mapCoins.erase(it++);
         }
         if (!hashBlock.IsNull())
             hashBestBlock_ = hashBlock;
@@ -608,7 +607,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
     InsertCoinsMapEntry(map, value, flags);
     BOOST_CHECK(view.BatchWrite(map, {}));
 }
@@ -877,4 +877,85 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_add_fetched)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+
+    // A prefetched coin is cached clean
+    COutPoint outpoint(InsecureRand256(), 0);
+    cache.AddFetchedCoin(outpoint, Coin(CTxOut(VALUE1, CScript() << OP_TRUE), 1, false));
+    cache.SelfTest();
+    auto it = cache.map().find(outpoint);
+    BOOST_CHECK(it != cache.map().end());
+    BOOST_CHECK_EQUAL(it->second.coin.out.nValue, VALUE1);
+    BOOST_CHECK_EQUAL(it->second.flags, 0);
+
+    // It never replaces an entry the cache already has, not even a spent one
+    BOOST_CHECK(cache.SpendCoin(outpoint));
+    cache.AddFetchedCoin(outpoint, Coin(CTxOut(VALUE2, CScript() << OP_TRUE), 1, false));
+    cache.SelfTest();
+    BOOST_CHECK(!cache.HaveCoinInCache(outpoint));
+    it = cache.map().find(outpoint);
+    BOOST_CHECK(it != cache.map().end());
+    BOOST_CHECK_EQUAL(it->second.flags, CCoinsCacheEntry::DIRTY);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_sync_and_trim)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+    cache.SetBestBlock(InsecureRand256());
+
+    std::vector<COutPoint> outpoints;
+    for (uint32_t height = 1; height <= 100; ++height) {
+        COutPoint outpoint(InsecureRand256(), 0);
+        CTxOut txout;
+        txout.nValue = height;
+        txout.scriptPubKey.assign(InsecureRandBits(6), 0);
+        cache.AddCoin(outpoint, Coin(std::move(txout), height, false), false);
+        outpoints.push_back(outpoint);
+    }
+    // A coin that was flushed before and is spent now
+    Coin spent;
+    BOOST_CHECK(cache.SpendCoin(outpoints[0], &spent));
+    BOOST_CHECK(cache.Sync());
+    cache.SelfTest();
+
+    // Everything is written to the base and stays cached, except the spent coin
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 99U);
+    for (const auto& entry : cache.map()) {
+        BOOST_CHECK_EQUAL(entry.second.flags, 0);
+    }
+    Coin coin;
+    BOOST_CHECK(!base.GetCoin(outpoints[0], coin));
+    for (size_t i = 1; i < outpoints.size(); ++i) {
+        BOOST_CHECK(cache.HaveCoinInCache(outpoints[i]));
+        BOOST_CHECK(base.GetCoin(outpoints[i], coin));
+        BOOST_CHECK_EQUAL(coin.nHeight, i + 1);
+    }
+
+    // A dirty coin from an old height survives trimming, clean ones go oldest first
+    COutPoint dirty_outpoint(InsecureRand256(), 0);
+    cache.AddCoin(dirty_outpoint, Coin(CTxOut(1, CScript()), 1, false), false);
+    const size_t empty_usage = CCoinsViewCacheTest(&base).DynamicMemoryUsage();
+    const size_t target_usage = empty_usage + (cache.DynamicMemoryUsage() - empty_usage) / 2;
+    cache.TrimCache(target_usage);
+    cache.SelfTest();
+    BOOST_CHECK_LE(cache.DynamicMemoryUsage(), target_usage);
+    BOOST_CHECK(cache.HaveCoinInCache(dirty_outpoint));
+    BOOST_CHECK(cache.HaveCoinInCache(outpoints.back()));
+    BOOST_CHECK(!cache.HaveCoinInCache(outpoints[1]));
+    uint32_t min_height = std::numeric_limits<uint32_t>::max();
+    for (const auto& entry : cache.map()) {
+        if (entry.first != dirty_outpoint) min_height = std::min(min_height, entry.second.coin.nHeight);
+    }
+    for (size_t i = 1; i < outpoints.size(); ++i) {
+        BOOST_CHECK_EQUAL(cache.HaveCoinInCache(outpoints[i]), i + 1 >= min_height);
+    }
+
+    // Trimmed coins are still served from the base
+    BOOST_CHECK(cache.HaveCoin(outpoints[1]));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
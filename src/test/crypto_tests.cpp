@@ -15,6 +15,8 @@
 #include <crypto/sha256.h>
 #include <crypto/sha3.h>
 #include <crypto/sha512.h>
+#include <crypto/sph_multi.h>
+#include <cryptonote/slow-hash.h>
 #include <random.h>
 #include <util/strencodings.h>
 #include <test/util/setup_common.h>
@@ -880,4 +882,119 @@ BOOST_AUTO_TEST_CASE(sha3_256_tests)
     TestSHA3_256("72c57c359e10684d0517e46653a02d18d29eff803eb009e4d5eb9e95add9ad1a4ac1f38a70296f3a369a16985ca3c957de2084cdc9bdd8994eb59b8815e0debad4ec1f001feac089820db8becdaf896aaf95721e8674e5d476b43bd2b873a7d135cd685f545b438210f9319e4dcd55986c85303c1ddf18dc746fe63a409df0a998ed376eb683e16c09e6e9018504152b3e7628ef350659fb716e058a5263a18823d2f2f6ee6a8091945a48ae1c5cb1694cf2c1fe76ef9177953afe8899cfa2b7fe0603bfa3180937dadfb66fbbdd119bbf8063338aa4a699075a3bfdbae8db7e5211d0917e9665a702fc9b0a0a901d08bea97654162d82a9f05622b060b634244779c33427eb7a29353a5f48b07cbefa72f3622ac5900bef77b71d6b314296f304c8426f451f32049b1f6af156a9dab702e8907d3cd72bb2c50493f4d593e731b285b70c803b74825b3524cda3205a8897106615260ac93c01c5ec14f5b11127783989d1824527e99e04f6a340e827b559f24db9292fcdd354838f9339a5fa1d7f6b2087f04835828b13463dd40927866f16ae33ed501ec0e6c4e63948768c5aeea3e4f6754985954bea7d61088c44430204ef491b74a64bde1358cecb2cad28ee6a3de5b752ff6a051104d88478653339457ac45ba44cbb65f54d1969d047cda746931d5e6a8b48e211416aefd5729f3d60b56b54e7f85aa2f42de3cb69419240c24e67139a11790a709edef2ac52cf35dd0a08af45926ebe9761f498ff83bfe263d6897ee97943a4b982fe3404ef0b4a45e06113c60340e0664f14799bf59cb4b3934b465fabefd87155905ee5309ba41e9e402973311831ea600b16437f71df39ee77130490c4d0227e5d1757fdc66af3ae6b9953053ed9aafca0160209858a7d4dd38fe10e0cb153672d08633ed6c54977aa0a6e67f9ff2f8c9d22dd7b21de08192960fd0e0da68d77c8d810db11dcaa61c725cd4092cbff76c8e1debd8d0361bb3f2e607911d45716f53067bdc0d89dd4889177765166a424e9fc0cb711201099dda213355e6639ac7eb86eca2ae0ab38b7f674f37ef8a6fcca1a6f52f55d9e1dcd631d2c3c82bba129172feb991d5af51afecd9d61a88b6832e4107480e392aed61a8644f551665ebff6b20953b635737a4f895e429fddcfe801f606fbda74b3bf6f5767d0fac14907fcfd0aa1d4c11b9e91b01d68052399b51a29f1ae6acd965109977c14a555cbcbd21ad8cb9f8853506d4bc21c01e62d61d7b21be1b923be54914e6b0a7ca84dd11f1159193e1184568a6134a6bbadf5b4df986edcf2019390ae841cfaa44435e28ce877d3dae4177992fa5d4e5c005876dbe3d1e63bec7dcc0942762b48b1ecc6c1a918409a8a72812a1e245c0c67be6e729c2b49bc6ee4d24a8f63e78e75db45655c26a9a78aff36fcd67117f26b8f654dca664b9f0e30681874cb749e1a692720078856286c2560b0292cc837933423147569350955c9571bf8941ba128fd339cb4268f46b94bc6ee203eb7026813706ea51c4f24c91866fc23a724bf2501327e6ae89c29f8db315dc28d2c7c719514036367e018f4835f63fdecd71f9bdced7132b6c4f8b13c69a517026fcd3622d67cb632320d5e7308f78f4b7cea11f6291b137851dc6cd6366f2785c71c3f237f81a7658b2a8d512b61e0ad5a4710b7b124151689fcb2116063fbff7e9115fed7b93de834970b838e49f8f8ba5f1f874c354078b5810a55ae289a56da563f1da6cd80a3757d6073fa55e016e45ac6cec1f69d871c92fd0ae9670c74249045e6b464787f9504128736309fed205f8df4d90e332908581298d9c75a3fa36ab0c3c9272e62de53ab290c803d67b696fd615c260a47bffad16746f18ba1a10a061bacbea9369693b3c042eec36bed289d7d12e52bca8aa1c2dff88ca7816498d25626d0f1e106ebb0b4a12138e00f3df5b1c2f49d98b1756e69b641b7c6353d99dbff050f4d76842c6cf1c2a4b062fc8e6336fa689b7c9d5c6b4ab8c15a5c20e514ff070a602d85ae52fa7810c22f8eeffd34a095b93342144f7a98d024216b3d68ed7bea047517bfcd83ec83febd1ba0e5858e2bdc1d8b1f7b0f89e90ccc432a3f930cb8209462e64556c5054c56ca2a85f16b32eb83a10459d13516faa4d23302b7607b9bd38dab2239ac9e9440c314433fdfb3ceadab4b4f87415ed6f240e017221f3b5f7ac196cdf54957bec42fe6893994b46de3d27dc7fb58ca88feb5b9e79cf20053d12530ac524337b22a3629bea52f40b06d3e2128f32060f9105847daed81d35f20e2002817434659baff64494c5b5c7f9216bfda38412a0f70511159dc73bb6bae1f8eaa0ef08d99bcb31f94f6be12c29c83df45926430b366c99fca3270c15fc4056398fdf3135b7779e3066a006961d1ac0ad1c83179ce39e87a96b722ec23aabc065badf3e188347a360772ca6a447abac7e6a44f0d4632d52926332e44a0a86bff5ce699fd063bdda3ffd4c41b53ded49fecec67f40599b934e16e3fd1bc063ad7026f8d71bfd4cbaf56599586774723194b692036f1b6bb242e2ffb9c600b5215b412764599476ce475c9e5b396fbcebd6be323dcf4d0048077400aac7500db41dc95fc7f7edbe7c9c2ec5ea89943fe13b42217eef530bbd023671509e12dfce4e1c1c82955d965e6a68aa66f6967dba48feda572db1f099d9a6dc4bc8edade852b5e824a06890dc48a6a6510ecaf8cf7620d757290e3166d431abecc624fa9ac2234d2eb783308ead45544910c633a94964b2ef5fbc409cb8835ac4147d384e12e0a5e13951f7de0ee13eafcb0ca0c04946d7804040c0a3cd088352424b097adb7aad1ca4495952f3e6c0158c02d2bcec33bfda69301434a84d9027ce02c0b9725dad118", "d894b86261436362e64241e61f6b3e6589daf64dc641f60570c4c0bf3b1f2ca3");
 }
 
+static void TestCryptoNight(void (*hasher)(const char*, char*, uint32_t, int), size_t len, uint8_t seed, const std::string& hexout)
+{
+    std::vector<unsigned char> in(len);
+    for (size_t i = 0; i < len; i++) {
+        in[i] = (uint8_t)(i * 7 + seed * 13);
+    }
+    unsigned char out[32];
+    hasher((const char*)in.data(), (char*)out, in.size(), 1);
+    BOOST_CHECK_EQUAL(HexStr(out), hexout);
+}
+
+BOOST_AUTO_TEST_CASE(cryptonight_testvectors)
+{
+    // Whichever cn_slow_hash implementation was autodetected must reproduce the
+    // output of the portable implementation for every variant used by Mike.
+    TestCryptoNight(crypto::cryptonight_dark_hash, 64, 0, "4d80f3fc5d7328d7f5f6ad1619b34c5b04a4e8faba0c466e3e3abbb538a4aa3d");
+    TestCryptoNight(crypto::cryptonight_darklite_hash, 64, 0, "7e7948393ecb369c4c4d1e068c98bfed467e24e6d08e9fcbb02c26b46543b09a");
+    TestCryptoNight(crypto::cryptonight_cnfast_hash, 64, 0, "56dfe58ca2c5e7203e25d39c0be133bd3e4e8f6ce790f29c17a5390802066d7e");
+    TestCryptoNight(crypto::cryptonight_cnlite_hash, 64, 0, "fa29ab40cc7e7d83ed3853c9ef50447eb8379253915ac790ac00e2134a873a8b");
+    TestCryptoNight(crypto::cryptonight_turtle_hash, 64, 0, "a95ad1136b39f248cce96ad51b0d3dca0082be6fe0f1bac889f09de7bfe68f81");
+    TestCryptoNight(crypto::cryptonight_turtlelite_hash, 64, 0, "90a6184c1dfb510d51d0044d72ee76fcbe3c6c11e789a0e677cd5acf7939a944");
+    TestCryptoNight(crypto::cryptonight_dark_hash, 64, 1, "17d5b72d2c0cc3a84fe46652f0bc4c6a600e3420934b2afff821126822f0bdcd");
+    TestCryptoNight(crypto::cryptonight_darklite_hash, 64, 1, "aebfd1741438becab022fd8c5eaa880fbb13a8db4223059a18081cdbfb5b9908");
+    TestCryptoNight(crypto::cryptonight_cnfast_hash, 64, 1, "41c10c0c7fd1adb33ae9bd6d73828bcc777d11ab77433197782026a96f23adfd");
+    TestCryptoNight(crypto::cryptonight_cnlite_hash, 64, 1, "3e59d9a09a3b25e8b1b6e9c97da3fd1f6eaae9c62f582e8f1268600dc7258fd2");
+    TestCryptoNight(crypto::cryptonight_turtle_hash, 64, 1, "a854e659367c1b2a9a5df972e54055acd727bdf7aed39e8faa419b5f9bd8cd36");
+    TestCryptoNight(crypto::cryptonight_turtlelite_hash, 64, 1, "7e5eb400fc51eca0d465dac810f64ff3a9248f141cc3477d741c0f10e63e6ebf");
+    TestCryptoNight(crypto::cryptonight_dark_hash, 80, 2, "3aa2c199c0ba009530b86274cbf78a96b1b8615cd2a0117d0ad9829a5004fb6f");
+    TestCryptoNight(crypto::cryptonight_darklite_hash, 80, 2, "70d861995f873b381f3afc963d810f97dd5af4471efe6294cf597e2fd26278f6");
+    TestCryptoNight(crypto::cryptonight_cnfast_hash, 80, 2, "5c7dcd29370ed7c592bd7d903b63d02c88aef0ae21503e009d1d9623c2cf4db2");
+    TestCryptoNight(crypto::cryptonight_cnlite_hash, 80, 2, "9510e59cdb325de3240d726c077acbf64391a093a3720cc73cca9d25c152a1a9");
+    TestCryptoNight(crypto::cryptonight_turtle_hash, 80, 2, "1081add291889489a7a5b94014c18a57214a78aed5f7fec5f5a53759c4b0dba3");
+    TestCryptoNight(crypto::cryptonight_turtlelite_hash, 80, 2, "b69fb1dbbd1972b61dfaf388353f7c548a24c8684b8bebca2be1aa6ffccdc961");
+}
+
+typedef void (*CryptoNightMultiHasher)(const char* const*, char* const*, uint32_t, size_t, int);
+
+static void TestCryptoNightMulti(void (*hasher)(const char*, char*, uint32_t, int), CryptoNightMultiHasher multiHasher)
+{
+    for (size_t ways = 2; ways <= CN_MAX_WAYS; ways++) {
+        unsigned char in[CN_MAX_WAYS][64];
+        unsigned char out[CN_MAX_WAYS][32];
+        const char* inputs[CN_MAX_WAYS];
+        char* outputs[CN_MAX_WAYS];
+        for (size_t lane = 0; lane < ways; lane++) {
+            for (size_t i = 0; i < sizeof(in[lane]); i++) {
+                in[lane][i] = (uint8_t)(i * 7 + lane * 13 + ways);
+            }
+            inputs[lane] = (const char*)in[lane];
+            outputs[lane] = (char*)out[lane];
+        }
+        multiHasher(inputs, outputs, 64, ways, 1);
+        for (size_t lane = 0; lane < ways; lane++) {
+            unsigned char expected[32];
+            hasher(inputs[lane], (char*)expected, 64, 1);
+            BOOST_CHECK_EQUAL(HexStr(out[lane]), HexStr(expected));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(cryptonight_multi_matches_single)
+{
+    // Every lane of an interleaved hash must match hashing its input on its own
+    TestCryptoNightMulti(crypto::cryptonight_dark_hash, crypto::cryptonight_dark_hash_multi);
+    TestCryptoNightMulti(crypto::cryptonight_darklite_hash, crypto::cryptonight_darklite_hash_multi);
+    TestCryptoNightMulti(crypto::cryptonight_cnfast_hash, crypto::cryptonight_cnfast_hash_multi);
+    TestCryptoNightMulti(crypto::cryptonight_cnlite_hash, crypto::cryptonight_cnlite_hash_multi);
+    TestCryptoNightMulti(crypto::cryptonight_turtle_hash, crypto::cryptonight_turtle_hash_multi);
+    TestCryptoNightMulti(crypto::cryptonight_turtlelite_hash, crypto::cryptonight_turtlelite_hash_multi);
+}
+
+static void TestSphHash512(SphAlgo algo, const std::string& hexout)
+{
+    const uint8_t seed = (uint8_t)algo;
+    unsigned char in[64];
+    for (size_t i = 0; i < sizeof(in); i++) {
+        in[i] = (uint8_t)(i * 7 + seed * 13);
+    }
+    unsigned char out[64];
+    SphHash512_64(algo, out, in, 1);
+    BOOST_CHECK_EQUAL(HexStr(out), hexout);
+
+    // Every lane of a batch, including the ones past the last multiple of four,
+    // must match hashing the same input on its own, also when hashing in place.
+    unsigned char batch[9 * 64];
+    for (size_t i = 0; i < sizeof(batch); i++) {
+        batch[i] = (uint8_t)(i * 7 + seed * 13);
+    }
+    unsigned char single[9 * 64];
+    for (size_t lane = 0; lane < 9; lane++) {
+        SphHash512_64(algo, single + 64 * lane, batch + 64 * lane, 1);
+    }
+    SphHash512_64(algo, batch, batch, 9);
+    BOOST_CHECK(std::equal(batch, batch + sizeof(batch), single));
+    BOOST_CHECK(std::equal(single, single + 64, out));
+}
+
+BOOST_AUTO_TEST_CASE(sph_hash512_testvectors)
+{
+    // Whichever sph implementations were autodetected must reproduce the output
+    // of the portable sph code on the 64 byte inputs of Mike's later stages.
+    TestSphHash512(SphAlgo::BLAKE, "d15093e2453ae94c1ffc362b80e242e239db3106cc9a9f243a17ab4e42bfa54e155bfae3800fbd89a278bb003b29e6f962726dd16e7ed13c450c43de03419c02");
+    TestSphHash512(SphAlgo::BMW, "30569564bc94b20bc5a4cec0d07aeb1a8772d5772b8cec04882a9f6e4ca63f252f52a9cc5337822a4992438cecbe9ed01218effad20a303c3322a9a6805634e4");
+    TestSphHash512(SphAlgo::GROESTL, "c93064f27b1fc93ac9d8ca1f45c8a17c425c3dd31d8a1b0e301a62f538117d44fd484f063dde84699d73351a2360c184c9db7ba0e113d5f78484daae396e1fec");
+    TestSphHash512(SphAlgo::JH, "478e32fd4e1f74e9f0a172fd84a4c94e99f6c3283d982015b9bac6d2b6eac2f20304dc490c3bf43e768054154f41cffd1be3722b7c29b501aa435394d2cf932e");
+    TestSphHash512(SphAlgo::KECCAK, "aa662598e0d17e6122e5cdb114c7abf1ec3b2b77f4b5509463c66309e38442272ab43bdee084ebe4e5b057354e576cc98a588c505ac2c638217bb4dd8f28a7e1");
+    TestSphHash512(SphAlgo::SKEIN, "d61d33c1915a5607c74c03a0b83593c42efe42029b5f00bda72f5df8d88389d1ee7c11f26fd6a1619a575b8b0e4daf684823b4e7b03faf91b7419bf4668f9e71");
+    TestSphHash512(SphAlgo::LUFFA, "fe5ef3fe8263d79324cc26c90df21a6617028ddb9f929cd46282c2e94acc19cd58e6cfd6bfca456034d6ac6fc9cbd627a12eace49eb74772332f818f463654bf");
+    TestSphHash512(SphAlgo::CUBEHASH, "2039d5ecb2cb45bbead77c29e159244782120e18f978e3f78ad2a5ef71d2ae8d7e4797c586b390fbdc616ba1c83a4fc5ceb44c561ec1982b207fba91d3b54d58");
+    TestSphHash512(SphAlgo::SHAVITE, "ed03ee4316e1c52df2501fc6006418f4746c8796083b69059b4fd7c6a572eeeb16d69f6eb94270f27706f4061f9e4f4664e81d3712a14b896c59560765bffa01");
+    TestSphHash512(SphAlgo::SIMD, "a10c740a09f5d2bb8c634cc307eda0734592455e733d28ca7a75c9434b5b4236a49f3847b1e14ce8887c20350c12781b7320d460f4c04b0656f8ee1d66d1dc70");
+    TestSphHash512(SphAlgo::ECHO, "25cf4b18249f095f13df158ec7d5d331057b4dd223c81becfb311fc978ac95918060fc62d10db51707e2687eca3d72fdec65b967e0e61480ac0aebeef379e207");
+    TestSphHash512(SphAlgo::SHA512, "cf5812a059459602291f0d33a653ad326164bbd8a1dd943eeb1145575dc7f4f32e42c6d968fb78e9a866635e1d094d28f871294b6104fe5dd61a84dcef1ecc4c");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
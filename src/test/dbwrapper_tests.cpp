@@ -412,5 +412,34 @@ BOOST_AUTO_TEST_CASE(unicodepath)
     BOOST_CHECK(fs::exists(lockPath));
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_profiles)
+{
+    // Every profile opens a working database
+    for (const DBProfileType type : {DBProfileType::DEFAULT, DBProfileType::CHAINSTATE, DBProfileType::BLOCK_INDEX,
+                                     DBProfileType::EVODB, DBProfileType::LLMQ, DBProfileType::INDEX}) {
+        fs::path ph = GetDataDir() / ("dbwrapper_profile_" + DBProfileName(type));
+        CDBWrapper dbw(ph, (1 << 20), false, true, false, type);
+        for (uint32_t i = 0; i < 1000; ++i) {
+            BOOST_CHECK(dbw.Write(i, uint256S(strprintf("%x", i))));
+        }
+        uint256 res;
+        BOOST_CHECK(dbw.Read(uint32_t{500}, res));
+        BOOST_CHECK_EQUAL(res.ToString(), uint256S("1f4").ToString());
+        BOOST_CHECK(!dbw.Exists(uint32_t{1000}));
+    }
+
+    // Overrides only apply to the named database, invalid ones are ignored
+    const DBProfile evodb_default = GetDBProfile(DBProfileType::EVODB);
+    gArgs.ForceSetArg("-dbprofile", "chainstate:bloombits=0");
+    BOOST_CHECK_EQUAL(GetDBProfile(DBProfileType::CHAINSTATE).bloom_bits, 0);
+    BOOST_CHECK_EQUAL(GetDBProfile(DBProfileType::EVODB).bloom_bits, evodb_default.bloom_bits);
+    gArgs.ForceSetArg("-dbprofile", "evodb:maxfilesize=1048576");
+    BOOST_CHECK_EQUAL(GetDBProfile(DBProfileType::EVODB).max_file_size, 1048576U);
+    gArgs.ForceSetArg("-dbprofile", "evodb:blocksize=0");
+    BOOST_CHECK_EQUAL(GetDBProfile(DBProfileType::EVODB).block_size, evodb_default.block_size);
+    gArgs.ForceSetArg("-dbprofile", "evodb");
+    BOOST_CHECK_EQUAL(GetDBProfile(DBProfileType::EVODB).block_size, evodb_default.block_size);
+    gArgs.ForceRemoveArg("-dbprofile");
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -16,12 +16,21 @@
 #include <script/sign.h>
 #include <script/standard.h>
 #include <spork.h>
+#include <streams.h>
 #include <txmempool.h>
 #include <validation.h>
 
 #include <evo/specialtx.h>
 #include <evo/providertx.h>
 #include <evo/deterministicmns.h>
+#include <evo/evodb.h>
+#include <evo/simplifiedmns.h>
+
+#include <bls/bls_worker.h>
+#include <llmq/blockprocessor.h>
+#include <llmq/commitment.h>
+#include <llmq/snapshot.h>
+#include <llmq/utils.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -215,6 +224,42 @@ static CDeterministicMNCPtr FindPayoutDmn(const CBlock& block)
     return nullptr;
 }
 
+// Creates a commitment for an LLMQ_TEST quorum at pQuorumBaseBlockIndex that is signed by all of its members
+static llmq::CFinalCommitment CreateFinalCommitment(const CBlockIndex* pQuorumBaseBlockIndex, const std::map<uint256, CBLSSecretKey>& operatorKeys, CBLSSecretKey& quorumKeyRet)
+{
+    const auto& llmq_params = llmq::GetLLMQParams(Consensus::LLMQType::LLMQ_TEST);
+    auto members = llmq::CLLMQUtils::GetAllQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex);
+    BOOST_REQUIRE_EQUAL(members.size(), size_t(llmq_params.size));
+
+    llmq::CFinalCommitment qc(llmq_params, pQuorumBaseBlockIndex->GetBlockHash());
+    qc.quorumIndex = pQuorumBaseBlockIndex->nHeight % llmq_params.dkgInterval;
+    std::fill(qc.signers.begin(), qc.signers.end(), true);
+    std::fill(qc.validMembers.begin(), qc.validMembers.end(), true);
+    quorumKeyRet.MakeNewKey();
+    qc.quorumPublicKey = quorumKeyRet.GetPublicKey();
+    qc.quorumVvecHash = InsecureRand256();
+
+    const uint256 commitmentHash = qc.BuildCommitmentHash();
+    std::vector<CBLSSignature> memberSigs;
+    std::vector<CBLSPublicKey> memberPubKeys;
+    for (const auto& dmn : members) {
+        memberSigs.emplace_back(operatorKeys.at(dmn->proTxHash).Sign(commitmentHash));
+        memberPubKeys.emplace_back(dmn->pdmnState->pubKeyOperator.Get());
+    }
+    qc.membersSig = CBLSSignature::AggregateSecure(memberSigs, memberPubKeys, commitmentHash);
+    qc.quorumSig = quorumKeyRet.Sign(commitmentHash);
+    return qc;
+}
+
+static std::vector<uint256> GetProTxHashes(const std::vector<CDeterministicMNCPtr>& mns)
+{
+    std::vector<uint256> ret;
+    for (const auto& dmn : mns) {
+        ret.emplace_back(dmn->proTxHash);
+    }
+    return ret;
+}
+
 static bool CheckTransactionSignature(const CMutableTransaction& tx)
 {
     for (unsigned int i = 0; i < tx.vin.size(); i++) {
@@ -656,5 +701,276 @@ BOOST_FIXTURE_TEST_CASE(dip3_verify_db, TestChainDIP3Setup)
 }
 
 
+BOOST_FIXTURE_TEST_CASE(dip3_verify_commitment_sigs, TestChainDIP3Setup)
+{
+    auto utxos = BuildSimpleUtxoMap(m_coinbase_txns);
+    const auto& llmq_params = llmq::GetLLMQParams(Consensus::LLMQType::LLMQ_TEST);
+
+    // register enough MNs for a quorum and let them confirm
+    std::map<uint256, CBLSSecretKey> operatorKeys;
+    std::vector<CMutableTransaction> txns;
+    for (int i = 0; i < llmq_params.size + 1; i++) {
+        CKey ownerKey;
+        CBLSSecretKey operatorKey;
+        auto tx = CreateProRegTx(utxos, i + 1, GenerateRandomAddress(), coinbaseKey, ownerKey, operatorKey);
+        operatorKeys.emplace(tx.GetHash(), operatorKey);
+        txns.emplace_back(tx);
+    }
+    CreateAndProcessBlock(txns, coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    const int nRegisteredHeight = ::ChainActive().Height();
+
+    // mine up to the next quorum once the MNs are confirmed, and on to the start of its mining window
+    while (::ChainActive().Height() < nRegisteredHeight + 2 || ::ChainActive().Height() % llmq_params.dkgInterval != 0) {
+        CreateAndProcessBlock({}, coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    }
+    const CBlockIndex* pQuorumBaseBlockIndex = ::ChainActive().Tip();
+    while (::ChainActive().Height() < pQuorumBaseBlockIndex->nHeight + llmq_params.dkgMiningWindowStart) {
+        CreateAndProcessBlock({}, coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    }
+    const CBlockIndex* pindex = ::ChainActive().Tip();
+
+    // a valid header that is not connected yet
+    const CBlock nextBlock = CreateBlock({}, coinbaseKey);
+    {
+        CValidationState state;
+        BOOST_REQUIRE(ProcessNewBlockHeaders({nextBlock.GetBlockHeader()}, state, Params()));
+    }
+
+    const CBlockIndex* pNextBlockIndex = WITH_LOCK(cs_main, return LookupBlockIndex(nextBlock.GetHash()));
+    BOOST_REQUIRE(pNextBlockIndex != nullptr);
+
+    {
+        LOCK(cs_main);
+        BOOST_REQUIRE(!::ChainActive().Contains(pNextBlockIndex));
+        CBLSSecretKey quorumKey;
+        auto qc = CreateFinalCommitment(pQuorumBaseBlockIndex, operatorKeys, quorumKey);
+        const uint256 commitmentHash = qc.BuildCommitmentHash();
+
+        CBLSSecretKey otherKey;
+        otherKey.MakeNewKey();
+        auto qcBadQuorumSig = qc;
+        qcBadQuorumSig.quorumSig = otherKey.Sign(commitmentHash);
+
+        // one member signed with a key that isn't its operator key
+        auto qcBadMembersSig = qc;
+        auto members = llmq::CLLMQUtils::GetAllQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex);
+        std::vector<CBLSSignature> memberSigs;
+        std::vector<CBLSPublicKey> memberPubKeys;
+        for (size_t i = 0; i < members.size(); i++) {
+            memberSigs.emplace_back(i == 0 ? otherKey.Sign(commitmentHash) : operatorKeys.at(members[i]->proTxHash).Sign(commitmentHash));
+            memberPubKeys.emplace_back(members[i]->pdmnState->pubKeyOperator.Get());
+        }
+        qcBadMembersSig.membersSig = CBLSSignature::AggregateSecure(memberSigs, memberPubKeys, commitmentHash);
+
+        // rejected before the signatures are looked at
+        auto qcBadSize = qc;
+        qcBadSize.signers.resize(llmq_params.size - 1);
+
+        // not for the quorum that is expected at this height, which ProcessCommitment rejects before looking at it
+        auto qcWrongQuorumHash = qc;
+        qcWrongQuorumHash.quorumHash = pNextBlockIndex->GetBlockHash();
+
+        std::multimap<Consensus::LLMQType, llmq::CFinalCommitment> qcs;
+        for (const auto& c : {qc, qcBadQuorumSig, qcBadMembersSig, qcBadSize, qcWrongQuorumHash, qc}) {
+            qcs.emplace(c.llmqType, c);
+        }
+
+        CBLSWorker worker;
+        llmq::CQuorumBlockProcessor processor(*evoDb, worker);
+
+        // everything falls back to the serial checks as long as the worker isn't running
+        for (const auto& sigsValid : processor.VerifyCommitmentSigs(pindex, qcs)) {
+            BOOST_CHECK(!sigsValid.has_value());
+        }
+
+        worker.Start();
+        // or when the block isn't in the mining phase
+        for (const auto& sigsValid : processor.VerifyCommitmentSigs(pQuorumBaseBlockIndex, qcs)) {
+            BOOST_CHECK(!sigsValid.has_value());
+        }
+        const auto sigsValid = processor.VerifyCommitmentSigs(pindex, qcs);
+        worker.Stop();
+
+        // the parallel results match what ProcessCommitment gets from the serial checks
+        BOOST_REQUIRE_EQUAL(sigsValid.size(), qcs.size());
+        const std::vector<std::optional<bool>> expected{true, false, false, std::nullopt, std::nullopt, true};
+        size_t i = 0;
+        for (const auto& p : qcs) {
+            const auto& c = p.second;
+            BOOST_CHECK(sigsValid[i] == expected[i]);
+            if (sigsValid[i].has_value()) {
+                BOOST_CHECK_EQUAL(c.Verify(pQuorumBaseBlockIndex, true), *expected[i]);
+                BOOST_CHECK(c.Verify(pQuorumBaseBlockIndex, false));
+            }
+            i++;
+        }
+    }
+
+    // Nothing was computed and cached for the header of the wrong quorumHash, so once its block is connected it gets
+    // its real masternode list and quorum members
+    BOOST_REQUIRE(ProcessNewBlock(Params(), std::make_shared<const CBlock>(nextBlock), true, nullptr));
+    deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    BOOST_REQUIRE(::ChainActive().Tip() == pNextBlockIndex);
+    BOOST_CHECK_EQUAL(deterministicMNManager->GetListForBlock(pNextBlockIndex).GetAllMNsCount(), operatorKeys.size());
+    const auto nextMembers = llmq::CLLMQUtils::GetAllQuorumMembers(llmq_params.type, pNextBlockIndex);
+    BOOST_CHECK_EQUAL(nextMembers.size(), size_t(llmq_params.size));
+    BOOST_CHECK(GetProTxHashes(nextMembers) == GetProTxHashes(llmq::CLLMQUtils::ComputeQuorumMembers(llmq_params.type, pNextBlockIndex)));
+}
+
+BOOST_FIXTURE_TEST_CASE(dip3_quorum_members_db, TestChainDIP3Setup)
+{
+    auto utxos = BuildSimpleUtxoMap(m_coinbase_txns);
+    const auto& llmq_params = llmq::GetLLMQParams(Consensus::LLMQType::LLMQ_TEST);
+
+    std::vector<CMutableTransaction> txns;
+    for (int i = 0; i < llmq_params.size + 1; i++) {
+        CKey ownerKey;
+        CBLSSecretKey operatorKey;
+        txns.emplace_back(CreateProRegTx(utxos, i + 1, GenerateRandomAddress(), coinbaseKey, ownerKey, operatorKey));
+    }
+    CreateAndProcessBlock(txns, coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    const int nRegisteredHeight = ::ChainActive().Height();
+
+    // mine up to the next quorum once the MNs are confirmed
+    while (::ChainActive().Height() < nRegisteredHeight + 2 || ::ChainActive().Height() % llmq_params.dkgInterval != 0) {
+        CreateAndProcessBlock({}, coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    }
+    CBlockIndex* pQuorumBaseBlockIndex = ::ChainActive().Tip();
+    const auto members = GetProTxHashes(llmq::CLLMQUtils::GetAllQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex));
+    BOOST_REQUIRE_EQUAL(members.size(), size_t(llmq_params.size));
+
+    // the members were persisted when the quorum's block was connected, other blocks are no quorums
+    std::vector<CDeterministicMNCPtr> dbMembers;
+    BOOST_CHECK(llmq::CLLMQUtils::ReadQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex, dbMembers));
+    BOOST_CHECK(GetProTxHashes(dbMembers) == members);
+    BOOST_CHECK(!llmq::CLLMQUtils::ReadQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex->pprev, dbMembers));
+    BOOST_CHECK(evoDb->CommitRootTransaction());
+    BOOST_CHECK(llmq::CLLMQUtils::ReadQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex, dbMembers));
+    BOOST_CHECK(GetProTxHashes(dbMembers) == members);
+
+    // once they are not cached in memory anymore, the members are loaded from evodb, unless the cache is reset
+    std::reverse(dbMembers.begin(), dbMembers.end());
+    {
+        auto dbTx = evoDb->BeginTransaction();
+        llmq::CLLMQUtils::WriteQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex, dbMembers);
+        dbTx->Commit();
+    }
+    llmq::CLLMQUtils::GetAllQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex->pprev, /* reset_cache */ true);
+    BOOST_CHECK(GetProTxHashes(llmq::CLLMQUtils::GetAllQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex)) == GetProTxHashes(dbMembers));
+    BOOST_CHECK(GetProTxHashes(llmq::CLLMQUtils::GetAllQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex, /* reset_cache */ true)) == members);
+
+    // disconnecting the quorum's block erases them, connecting it again writes them again
+    CValidationState state;
+    BOOST_CHECK(InvalidateBlock(state, Params(), pQuorumBaseBlockIndex));
+    BOOST_CHECK(!llmq::CLLMQUtils::ReadQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex, dbMembers));
+    WITH_LOCK(cs_main, ResetBlockFailureFlags(pQuorumBaseBlockIndex));
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+    BOOST_REQUIRE_EQUAL(::ChainActive().Tip(), pQuorumBaseBlockIndex);
+    BOOST_CHECK(llmq::CLLMQUtils::ReadQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex, dbMembers));
+    BOOST_CHECK(GetProTxHashes(dbMembers) == members);
+
+    // they are kept as long as the quorum may still be used and erased by the first block after that
+    const int nCutoffHeight = pQuorumBaseBlockIndex->nHeight + (llmq_params.keepOldConnections + 1) * llmq_params.dkgInterval;
+    while (::ChainActive().Height() < nCutoffHeight) {
+        CreateAndProcessBlock({}, coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    }
+    BOOST_CHECK(llmq::CLLMQUtils::ReadQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex, dbMembers));
+    CreateAndProcessBlock({}, coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    BOOST_CHECK(!llmq::CLLMQUtils::ReadQuorumMembers(llmq_params.type, pQuorumBaseBlockIndex, dbMembers));
+}
+
+BOOST_FIXTURE_TEST_CASE(dip3_mnlistdiff_cache, TestChainDIP3Setup)
+{
+    auto utxos = BuildSimpleUtxoMap(m_coinbase_txns);
+
+    std::vector<uint256> dmnHashes;
+    std::map<uint256, CBLSSecretKey> operatorKeys;
+    std::vector<CMutableTransaction> txns;
+    for (int i = 0; i < 2; i++) {
+        CKey ownerKey;
+        CBLSSecretKey operatorKey;
+        txns.emplace_back(CreateProRegTx(utxos, i + 1, GenerateRandomAddress(), coinbaseKey, ownerKey, operatorKey));
+        dmnHashes.emplace_back(txns.back().GetHash());
+        operatorKeys.emplace(txns.back().GetHash(), operatorKey);
+    }
+    CreateAndProcessBlock(txns, coinbaseKey);
+    deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    // let the MNs get confirmed, so that their entries only change through the transactions below
+    for (int i = 0; i < 2; i++) {
+        CreateAndProcessBlock({}, coinbaseKey);
+        deterministicMNManager->UpdatedBlockTip(::ChainActive().Tip());
+    }
+
+    // Peers ask for the diffs to the tip from a recent block and from genesis
+    const std::vector<uint256> baseBlockHashes{::ChainActive().Tip()->pprev->GetBlockHash(), uint256()};
+    {
+        LOCK(cs_main);
+        for (const auto& baseBlockHash : baseBlockHashes) {
+            CSimplifiedMNListDiff mnListDiff;
+            std::string strError;
+            BOOST_REQUIRE(BuildSimplifiedMNListDiff(baseBlockHash, ::ChainActive().Tip()->GetBlockHash(), mnListDiff, strError));
+        }
+    }
+
+    auto serialize = [](const CSimplifiedMNListDiff& mnListDiff) {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << mnListDiff;
+        return ss.str();
+    };
+    auto processBlock = [&](const std::vector<CMutableTransaction>& blockTxns) {
+        CreateAndProcessBlock(blockTxns, coinbaseKey);
+        const CBlockIndex* tip = ::ChainActive().Tip();
+        deterministicMNManager->UpdatedBlockTip(tip);
+        UpdateSimplifiedMNListDiffCache(tip);
+
+        // The diffs carried forward to the new tip are the same as the ones built from scratch
+        LOCK(cs_main);
+        for (const auto& baseBlockHash : baseBlockHashes) {
+            CSimplifiedMNListDiff cached, fresh;
+            std::string strError;
+            BOOST_REQUIRE(GetCachedSimplifiedMNListDiff(baseBlockHash, tip->GetBlockHash(), cached));
+            BOOST_REQUIRE(BuildSimplifiedMNListDiff(baseBlockHash, tip->GetBlockHash(), fresh, strError, false));
+            BOOST_CHECK(serialize(cached) == serialize(fresh));
+        }
+        // while the one-block step they were built from is not kept
+        CSimplifiedMNListDiff step;
+        BOOST_CHECK(!GetCachedSimplifiedMNListDiff(tip->pprev->GetBlockHash(), tip->GetBlockHash(), step));
+    };
+
+    CKey ownerKey;
+    CBLSSecretKey operatorKey;
+    processBlock({CreateProRegTx(utxos, 3, GenerateRandomAddress(), coinbaseKey, ownerKey, operatorKey)});
+    processBlock({CreateProUpServTx(utxos, dmnHashes[0], operatorKeys[dmnHashes[0]], 100, CScript(), coinbaseKey)});
+    processBlock({});
+    processBlock({CreateProUpRevTx(utxos, dmnHashes[1], operatorKeys[dmnHashes[1]], coinbaseKey)});
+    // back to the entry of the base block
+    processBlock({CreateProUpServTx(utxos, dmnHashes[0], operatorKeys[dmnHashes[0]], 1, CScript(), coinbaseKey)});
+
+    // Cached quorum rotation infos are keyed by every field of the request and by the tip
+    llmq::CGetQuorumRotationInfo request;
+    request.baseBlockHashes = {baseBlockHashes[0]};
+    request.blockRequestHash = WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash());
+    request.extraShare = false;
+    const uint256 tipHash = request.blockRequestHash;
+    const uint256 key = llmq::GetQuorumRotationInfoCacheKey(request, tipHash);
+    BOOST_CHECK(key == llmq::GetQuorumRotationInfoCacheKey(request, tipHash));
+    BOOST_CHECK(key != llmq::GetQuorumRotationInfoCacheKey(request, baseBlockHashes[0]));
+    auto changed = request;
+    changed.extraShare = true;
+    BOOST_CHECK(key != llmq::GetQuorumRotationInfoCacheKey(changed, tipHash));
+    changed = request;
+    changed.blockRequestHash = baseBlockHashes[0];
+    BOOST_CHECK(key != llmq::GetQuorumRotationInfoCacheKey(changed, tipHash));
+    changed = request;
+    changed.baseBlockHashes.emplace_back(tipHash);
+    BOOST_CHECK(key != llmq::GetQuorumRotationInfoCacheKey(changed, tipHash));
+}
 
 BOOST_AUTO_TEST_SUITE_END()
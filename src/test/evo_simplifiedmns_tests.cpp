@@ -4,7 +4,10 @@
 
 #include <test/util/setup_common.h>
 
+#include <arith_uint256.h>
 #include <bls/bls.h>
+#include <crypto/sha256.h>
+#include <evo/deterministicmns.h>
 #include <evo/simplifiedmns.h>
 #include <netbase.h>
 
@@ -67,4 +70,169 @@ BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
 
     BOOST_CHECK(expectedMerkleRoot == calculatedMerkleRoot);
 }
+BOOST_AUTO_TEST_CASE(simplifiedmns_diff_columns)
+{
+    auto makeDmn = [](uint64_t i) {
+        auto dmn = std::make_shared<CDeterministicMN>(i);
+        // not in the order of insertion
+        dmn->proTxHash = uint256S(strprintf("%064x", i * 41 % 101 + 1));
+        dmn->collateralOutpoint = COutPoint(uint256S(strprintf("%064x", i + 1000)), 0);
+        auto state = std::make_shared<CDeterministicMNState>();
+        state->keyIDOwner.SetHex(strprintf("%040x", i + 1));
+        state->nRegisteredHeight = i;
+        state->confirmedHash = uint256S(strprintf("%064x", i + 2000));
+        dmn->pdmnState = state;
+        return dmn;
+    };
+
+    CDeterministicMNList from(uint256S("01"), 1, 0);
+    for (uint64_t i = 0; i < 20; i++) {
+        from.AddMN(makeDmn(i));
+    }
+    auto columns = from.GetColumns();
+    BOOST_CHECK_EQUAL(columns->size(), 20U);
+    BOOST_CHECK(std::is_sorted(columns->proTxHashes.begin(), columns->proTxHashes.end()));
+    BOOST_CHECK(from.GetColumns() == columns);
+
+    // copies share the columns until they are modified
+    CDeterministicMNList to = from;
+    to.SetBlockHash(uint256S("02"));
+    BOOST_CHECK(to.GetColumns() == columns);
+
+    const auto removed = columns->proTxHashes[3];
+    to.RemoveMN(removed);
+    const auto& penalized = *columns->dmns[5];
+    auto penalizedState = std::make_shared<CDeterministicMNState>(*penalized.pdmnState);
+    penalizedState->nPoSePenalty = 10;
+    to.UpdateMN(penalized, penalizedState);
+    const auto& reconfirmed = *columns->dmns[7];
+    auto reconfirmedState = std::make_shared<CDeterministicMNState>(*reconfirmed.pdmnState);
+    reconfirmedState->confirmedHash = uint256S("03");
+    to.UpdateMN(reconfirmed, reconfirmedState);
+    const auto added = makeDmn(20);
+    to.AddMN(added);
+
+    auto toColumns = to.GetColumns();
+    BOOST_CHECK(toColumns != columns);
+    BOOST_CHECK_EQUAL(toColumns->size(), 20U);
+    BOOST_CHECK(from.GetColumns() == columns);
+
+    // the penalty is not part of the simplified entries
+    auto diff = from.BuildSimplifiedDiff(to);
+    BOOST_CHECK(diff.deletedMNs == std::vector<uint256>{removed});
+    std::set<uint256> changed;
+    for (const auto& sme : diff.mnList) {
+        changed.emplace(sme.proRegTxHash);
+    }
+    BOOST_CHECK(changed == std::set<uint256>({reconfirmed.proTxHash, added->proTxHash}));
+}
+
+// The pointer-based scans the columns replaced
+static int RefLastPaidHeight(const CDeterministicMN& dmn)
+{
+    int height = dmn.pdmnState->nLastPaidHeight;
+    if (dmn.pdmnState->nPoSeRevivedHeight != -1 && dmn.pdmnState->nPoSeRevivedHeight > height) {
+        height = dmn.pdmnState->nPoSeRevivedHeight;
+    } else if (height == 0) {
+        height = dmn.pdmnState->nRegisteredHeight;
+    }
+    return height;
+}
+
+static bool RefCompareByLastPaid(const CDeterministicMNCPtr& a, const CDeterministicMNCPtr& b)
+{
+    int ah = RefLastPaidHeight(*a);
+    int bh = RefLastPaidHeight(*b);
+    if (ah == bh) {
+        return a->proTxHash < b->proTxHash;
+    }
+    return ah < bh;
+}
+
+static CDeterministicMNCPtr RefGetMNPayee(const CDeterministicMNList& mnList)
+{
+    CDeterministicMNCPtr best;
+    mnList.ForEachMNShared(true, [&](const CDeterministicMNCPtr& dmn) {
+        if (!best || RefCompareByLastPaid(dmn, best)) {
+            best = dmn;
+        }
+    });
+    return best;
+}
+
+static std::vector<CDeterministicMNCPtr> RefGetProjectedMNPayees(const CDeterministicMNList& mnList, int nCount)
+{
+    std::vector<CDeterministicMNCPtr> result;
+    mnList.ForEachMNShared(true, [&](const CDeterministicMNCPtr& dmn) {
+        result.emplace_back(dmn);
+    });
+    std::sort(result.begin(), result.end(), RefCompareByLastPaid);
+    result.resize(std::min(nCount, int(result.size())));
+    return result;
+}
+
+static std::vector<CDeterministicMNCPtr> RefCalculateQuorum(const CDeterministicMNList& mnList, size_t maxSize, const uint256& modifier)
+{
+    std::vector<std::pair<arith_uint256, CDeterministicMNCPtr>> scores;
+    mnList.ForEachMNShared(true, [&](const CDeterministicMNCPtr& dmn) {
+        if (dmn->pdmnState->confirmedHash.IsNull()) {
+            return;
+        }
+        uint256 h;
+        CSHA256 sha256;
+        sha256.Write(dmn->pdmnState->confirmedHashWithProRegTxHash.begin(), dmn->pdmnState->confirmedHashWithProRegTxHash.size());
+        sha256.Write(modifier.begin(), modifier.size());
+        sha256.Finalize(h.begin());
+        scores.emplace_back(UintToArith256(h), dmn);
+    });
+    std::sort(scores.rbegin(), scores.rend(), [](const std::pair<arith_uint256, CDeterministicMNCPtr>& a, const std::pair<arith_uint256, CDeterministicMNCPtr>& b) {
+        if (a.first == b.first) {
+            return a.second->collateralOutpoint < b.second->collateralOutpoint;
+        }
+        return a.first < b.first;
+    });
+    std::vector<CDeterministicMNCPtr> result;
+    for (size_t i = 0; i < std::min(maxSize, scores.size()); i++) {
+        result.emplace_back(scores[i].second);
+    }
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(dmnlist_columns_scans)
+{
+    // lots of equal payment heights, banned, revived and unconfirmed masternodes
+    CDeterministicMNList mnList(uint256S("01"), 1000, 0);
+    for (uint64_t i = 0; i < 200; i++) {
+        auto dmn = std::make_shared<CDeterministicMN>(i);
+        dmn->proTxHash = uint256S(strprintf("%064x", i * 97 % 211 + 1));
+        dmn->collateralOutpoint = COutPoint(uint256S(strprintf("%064x", i + 1000)), 0);
+        auto state = std::make_shared<CDeterministicMNState>();
+        state->keyIDOwner.SetHex(strprintf("%040x", i + 1));
+        state->nRegisteredHeight = 100 + i % 7;
+        state->nLastPaidHeight = i % 3 == 0 ? 0 : 500 + i % 11;
+        if (i % 13 == 0) {
+            state->nPoSeRevivedHeight = 505 + i % 4;
+        }
+        if (i % 17 == 0) {
+            state->BanIfNotBanned(600);
+        }
+        if (i % 5 != 0) {
+            state->UpdateConfirmedHash(dmn->proTxHash, uint256S(strprintf("%064x", i + 2000)));
+        }
+        dmn->pdmnState = state;
+        mnList.AddMN(dmn);
+    }
+
+    BOOST_CHECK(mnList.GetMNPayee() == RefGetMNPayee(mnList));
+    for (int nCount : {0, 1, 10, 150, 300}) {
+        BOOST_CHECK(mnList.GetProjectedMNPayees(nCount) == RefGetProjectedMNPayees(mnList, nCount));
+    }
+    for (uint64_t i = 0; i < 10; i++) {
+        const uint256 modifier = uint256S(strprintf("%064x", i * 12345 + 1));
+        for (size_t maxSize : {0, 10, 50, 300}) {
+            BOOST_CHECK(mnList.CalculateQuorum(maxSize, modifier) == RefCalculateQuorum(mnList, maxSize, modifier));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -123,4 +123,55 @@ BOOST_AUTO_TEST_CASE(flatfile_flush)
     BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(0, 1))), 1);
 }
 
+BOOST_AUTO_TEST_CASE(flatfile_map)
+{
+    const auto data_dir = GetDataDir();
+    FlatFileSeq seq(data_dir, "a", 100);
+
+    std::string line1("Line one");
+    std::string line2("Line two");
+    size_t pos2 = GetSerializeSize(line1, CLIENT_VERSION);
+    size_t size2 = GetSerializeSize(line2, CLIENT_VERSION);
+    {
+        CAutoFile file(seq.Open(FlatFilePos(0, 0)), SER_DISK, CLIENT_VERSION);
+        file << line1;
+    }
+
+    // Mapping is disabled by default
+    BOOST_CHECK(!seq.Map(FlatFilePos(0, 0), pos2));
+
+#ifndef WIN32
+    SetMappedFlatFileLimit(1);
+    std::string text;
+    auto mapped = seq.Map(FlatFilePos(0, 0), pos2);
+    BOOST_REQUIRE(mapped);
+    SpanReader(SER_DISK, CLIENT_VERSION, mapped->GetSpan()) >> text;
+    BOOST_CHECK_EQUAL(text, line1);
+    BOOST_CHECK(seq.Map(FlatFilePos(0, 0), pos2) == mapped);
+
+    // Reading past the end of the file fails until it has grown
+    BOOST_CHECK(!seq.Map(FlatFilePos(0, pos2), size2));
+    {
+        CAutoFile file(seq.Open(FlatFilePos(0, pos2)), SER_DISK, CLIENT_VERSION);
+        file << line2;
+    }
+    auto remapped = seq.Map(FlatFilePos(0, pos2), size2);
+    BOOST_REQUIRE(remapped);
+    BOOST_CHECK(remapped != mapped);
+    SpanReader(SER_DISK, CLIENT_VERSION, remapped->GetSpan().subspan(pos2)) >> text;
+    BOOST_CHECK_EQUAL(text, line2);
+
+    // The old mapping stays readable while it is in use
+    SpanReader(SER_DISK, CLIENT_VERSION, mapped->GetSpan()) >> text;
+    BOOST_CHECK_EQUAL(text, line1);
+    BOOST_CHECK_THROW(SpanReader(SER_DISK, CLIENT_VERSION, mapped->GetSpan().subspan(pos2)) >> text, std::ios_base::failure);
+
+    seq.Unmap(FlatFilePos(0, 0));
+    BOOST_CHECK(seq.Map(FlatFilePos(0, 0), pos2) != remapped);
+
+    SetMappedFlatFileLimit(0);
+    BOOST_CHECK(!seq.Map(FlatFilePos(0, 0), pos2));
+#endif
+}
+
 BOOST_AUTO_TEST_SUITE_END()
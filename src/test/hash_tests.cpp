@@ -5,6 +5,7 @@
 #include <clientversion.h>
 #include <crypto/siphash.h>
 #include <hash.h>
+#include <primitives/block.h>
 #include <util/strencodings.h>
 #include <test/util/setup_common.h>
 
@@ -148,4 +149,23 @@ BOOST_AUTO_TEST_CASE(siphash)
     BOOST_CHECK_EQUAL(SipHashUint256(1, 2, ss.GetHash()), 0x79751e980c2a0a35ULL);
 }
 
+BOOST_AUTO_TEST_CASE(mike_schedule)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = InsecureRand256();
+    header.hashMerkleRoot = InsecureRand256();
+    header.nTime = 1650000000;
+    header.nBits = 0x207fffff;
+
+    // A schedule built once for hashPrevBlock gives the same result for every nonce
+    const MikeSchedule schedule(header.hashPrevBlock);
+    BOOST_CHECK_EQUAL(schedule.coreHashIndexes.size(), 11U);
+    BOOST_CHECK_EQUAL(schedule.cnIndexes.size(), 6U);
+    for (int i = 0; i < 3; i++) {
+        header.nNonce = InsecureRand32();
+        BOOST_CHECK_EQUAL(header.GetPOWHash(schedule), header.GetPOWHash());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
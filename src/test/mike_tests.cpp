@@ -0,0 +1,199 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <config/dash-config.h>
+#endif
+
+#include <chainparams.h>
+#include <crypto/sph_multi.h>
+#include <hash.h>
+#include <primitives/block.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(mike_tests, BasicTestingSetup)
+
+// The original vector based HashSelection::getRandomIndexes, kept as a reference
+static std::vector<int> ReferenceRandomIndexes(const uint256& prevBlockHash, std::vector<int> indexes)
+{
+    std::vector<int> groupIndexes;
+    unsigned int totalIndexes = indexes.size();
+    unsigned int indexCount = 0;
+    int i = 63;
+    for (; i >= 0; i--) {
+        unsigned int hashSelection = prevBlockHash.GetNibble(i);
+        if (hashSelection >= totalIndexes) {
+            hashSelection = hashSelection % totalIndexes;
+        }
+        int index = indexes[hashSelection];
+        if (index >= 0) {
+            groupIndexes.push_back(index);
+            indexes[hashSelection] = -1;
+            indexCount++;
+        }
+        if (indexCount == indexes.size()) {
+            break;
+        }
+    }
+    if (i < 0 && indexCount < totalIndexes) {
+        for (unsigned int j = 0; j < indexes.size(); j++) {
+            if (indexes[j] >= 0) {
+                groupIndexes.push_back(indexes[j]);
+            }
+        }
+    }
+    return groupIndexes;
+}
+
+static void CheckSchedule(const uint256& prevBlockHash)
+{
+    const MikeSchedule schedule(prevBlockHash);
+    const std::vector<int> coreHashIndexes = ReferenceRandomIndexes(prevBlockHash, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10});
+    const std::vector<int> cnIndexes = ReferenceRandomIndexes(prevBlockHash, {0, 1, 2, 3, 4, 5});
+    BOOST_CHECK(std::equal(schedule.coreHashIndexes.begin(), schedule.coreHashIndexes.end(), coreHashIndexes.begin(), coreHashIndexes.end()));
+    BOOST_CHECK(std::equal(schedule.cnIndexes.begin(), schedule.cnIndexes.end(), cnIndexes.begin(), cnIndexes.end()));
+}
+
+BOOST_AUTO_TEST_CASE(mike_schedule_matches_reference)
+{
+    // Degenerate hashes exercise the fallback for algorithms no nibble selects
+    CheckSchedule(uint256());
+    CheckSchedule(uint256S("ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff"));
+    CheckSchedule(uint256S("5555555555555555555555555555555555555555555555555555555555555555"));
+    for (int i = 0; i < 1000; i++) {
+        CheckSchedule(InsecureRand256());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(mike_regression_corpus)
+{
+    struct TestHeader {
+        int32_t nVersion;
+        const char* hashPrevBlock;
+        const char* hashMerkleRoot;
+        uint32_t nTime;
+        uint32_t nBits;
+        uint32_t nNonce;
+        const char* powHash;
+    };
+
+    // The mainnet genesis header, followed by headers building on the mainnet
+    // checkpoints and a few edge cases. The expected hashes were computed with
+    // the original HashSelection based implementation.
+    static const TestHeader corpus[] = {
+        {4, "0000000000000000000000000000000000000000000000000000000000000000", "c59206be1307154ab6090c3419137d292f11c2be5585d86447ad0e1ad42de43c",
+         1655239440, 0x20001fff, 140, "001e00af492cad6158de291018e6a2674aa393d983cc9a28898e98c48d3e05c1"},
+        {0x20000000, "ef99ea0231cf5ccee64a5350f79d8b17348f9a72cc1899113c4082c9f6aa1987", "c59206be1307154ab6090c3419137d292f11c2be5585d86447ad0e1ad42de43c",
+         1655239441, 0x20001fff, 0, "08ebde3d7597fc18f319eed98d07ba771f52bb6e1c820cec83b48066dae7a73a"},
+        {0x20000000, "e4d19872655099a6c226cf144182dcf4cfc1986c65a9cf8156201480832b62de", "1c8d5b532167ee48ea9521325cb6ac300f59dddb552768fd5dce95e0b00277c3",
+         1655300000, 0x1e0fffff, 12345, "bcd6a8f3bce05c263a05fdc2d54ddad2a731691faf076e37c0ac7726c097ebec"},
+        {0x20000000, "c4a3904f8d33c7d2c7f8c1b83de6def234951127189ceee59f3fa4a722437272", "9a50fb296b63dafba79e9c51fbe5315ae1c7d413d26209322bc639f002d3233b",
+         1655400000, 0x1e0ffff0, 4294967295U, "811c85dd52b1f4057a2043b15ee7fdd2d25d2ba8cf93afa1425509919cc14419"},
+        {0x20000004, "1c8d5b532167ee48ea9521325cb6ac300f59dddb552768fd5dce95e0b00277c3", "e4d19872655099a6c226cf144182dcf4cfc1986c65a9cf8156201480832b62de",
+         1656000000, 0x1d00ffff, 7, "02f8e191b356b70a02ef70ffd979839db048cd633aef1c7c03a4c9e9935c9721"},
+        {0x20000000, "9a50fb296b63dafba79e9c51fbe5315ae1c7d413d26209322bc639f002d3233b", "c4a3904f8d33c7d2c7f8c1b83de6def234951127189ceee59f3fa4a722437272",
+         1656979667, 0x1c7fffff, 2785, "dc4b16c88eae8710bea14fc9fdccf38ddd1031a19a1095af1f8690d252dfa790"},
+        {1, "ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff", "0000000000000000000000000000000000000000000000000000000000000000",
+         0, 0, 0, "1bd6e0bf7cf3d4dc6d7891aae1ebb18f11845902ac723680da69b7e45bb083e6"},
+        {0x20000000, "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef", "fedcba9876543210fedcba9876543210fedcba9876543210fedcba9876543210",
+         1700000000, 0x1b0404cb, 99999, "9eedbc3b121833c06dfdc966443f965536d444987ba698eea7529485093c438f"},
+    };
+
+    for (const TestHeader& test : corpus) {
+        CBlockHeader header;
+        header.nVersion = test.nVersion;
+        header.hashPrevBlock = uint256S(test.hashPrevBlock);
+        header.hashMerkleRoot = uint256S(test.hashMerkleRoot);
+        header.nTime = test.nTime;
+        header.nBits = test.nBits;
+        header.nNonce = test.nNonce;
+        BOOST_CHECK_EQUAL(header.GetPOWHash().GetHex(), test.powHash);
+        BOOST_CHECK_EQUAL(header.GetPOWHash(MikeSchedule(header.hashPrevBlock)).GetHex(), test.powHash);
+        uint256 powHash;
+        CBlockHeader::GetPOWHashes(&header, 1, MikeSchedule(header.hashPrevBlock), &powHash);
+        BOOST_CHECK_EQUAL(powHash.GetHex(), test.powHash);
+    }
+
+    // The genesis header must match the one built by the chain parameters
+    BOOST_CHECK_EQUAL(Params().GenesisBlock().GetPOWHash().GetHex(), corpus[0].powHash);
+}
+
+BOOST_AUTO_TEST_CASE(mike_multi_matches_single)
+{
+    // Headers of one height share the schedule; six of them fill a full batch of
+    // four lanes and a partial one of two.
+    std::vector<CBlockHeader> headers(MIKE_MAX_LANES + 2);
+    const uint256 prevBlockHash = InsecureRand256();
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i].nVersion = 0x20000000;
+        headers[i].hashPrevBlock = prevBlockHash;
+        headers[i].hashMerkleRoot = InsecureRand256();
+        headers[i].nTime = 1656979667;
+        headers[i].nBits = 0x1c7fffff;
+        headers[i].nNonce = i;
+    }
+
+    const MikeSchedule schedule(prevBlockHash);
+    std::vector<uint256> hashes(headers.size());
+    CBlockHeader::GetPOWHashes(headers.data(), headers.size(), schedule, hashes.data());
+    for (size_t i = 0; i < headers.size(); i++) {
+        BOOST_CHECK_EQUAL(hashes[i], headers[i].GetPOWHash(schedule));
+    }
+
+    // Interleaving the CryptoNight stages must not change the hashes either
+    for (size_t ways = 2; ways <= MIKE_MAX_LANES; ways++) {
+        std::vector<uint256> interleaved(headers.size());
+        CBlockHeader::GetPOWHashes(headers.data(), headers.size(), schedule, interleaved.data(), GetMikeCnWays(ways, std::numeric_limits<size_t>::max()));
+        BOOST_CHECK(interleaved == hashes);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(mike_sph_autodetect)
+{
+    // The SIMD implementations must be selected wherever the build and the CPU
+    // support them, otherwise mike_multi_matches_single doesn't cover them
+    const std::string impl = SphHash512AutoDetect();
+    BOOST_TEST_MESSAGE("sph implementation: " << impl);
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#if defined(ENABLE_AESNI)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && ((ecx >> 9) & 1) && ((ecx >> 25) & 1)) {
+        BOOST_CHECK(impl.find("aesni") != std::string::npos);
+    }
+#endif
+#if defined(ENABLE_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        BOOST_CHECK(impl.find("avx2") != std::string::npos);
+    }
+#endif
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(mike_cn_ways)
+{
+    typedef std::array<uint8_t, MIKE_CN_VARIANTS> Ways;
+    const size_t unlimited = std::numeric_limits<size_t>::max();
+
+    // Without a known cache size nothing is interleaved
+    BOOST_CHECK(GetMikeCnWays(4, 0).ways == MIKE_CN_SINGLE.ways);
+    BOOST_CHECK(GetMikeCnWays(0, unlimited).ways == MIKE_CN_SINGLE.ways);
+    // The ways are capped by the request and by CN_MAX_WAYS
+    BOOST_CHECK(GetMikeCnWays(2, unlimited).ways == Ways({{2, 2, 2, 2, 2, 2}}));
+    BOOST_CHECK(GetMikeCnWays(8, unlimited).ways == Ways({{4, 4, 4, 4, 4, 4}}));
+    // With a 2 MB cache, the scratchpads may take up 1 MB
+    BOOST_CHECK(GetMikeCnWays(4, 2 * 1024 * 1024).ways == Ways({{2, 2, 1, 1, 4, 4}}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
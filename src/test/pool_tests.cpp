@@ -0,0 +1,136 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <memusage.h>
+#include <support/allocators/pool.h>
+#include <test/util/setup_common.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(basic_allocating)
+{
+    auto resource = PoolResource<8, 8>(16);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 16U);
+
+    // first chunk is already allocated, two blocks of 8 bytes fit into it
+    void* block = resource.Allocate(8, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // a freed block is handed out again by the next allocation of that size
+    resource.Deallocate(block, 8, 8);
+    BOOST_CHECK_EQUAL(resource.NumFreeListBytes(), 8U);
+    void* reused = resource.Allocate(8, 8);
+    BOOST_CHECK(block == reused);
+    BOOST_CHECK_EQUAL(resource.NumFreeListBytes(), 0U);
+
+    // the second block still fits into the first chunk, the third one doesn't
+    void* second = resource.Allocate(8, 8);
+    BOOST_CHECK(second != reused);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    void* third = resource.Allocate(8, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+
+    // zero sized allocations take up a block as well
+    void* empty = resource.Allocate(0, 1);
+    BOOST_CHECK(empty != third);
+
+    resource.Deallocate(reused, 8, 8);
+    resource.Deallocate(second, 8, 8);
+    resource.Deallocate(third, 8, 8);
+    resource.Deallocate(empty, 0, 1);
+}
+
+BOOST_AUTO_TEST_CASE(allocate_any_byte)
+{
+    auto resource = PoolResource<128, 8>(1024);
+
+    // Every size up to the maximum block size is served from the chunks, larger
+    // ones and overaligned ones go through operator new
+    std::vector<std::pair<uint8_t*, size_t>> blocks;
+    for (size_t size = 0; size <= 160; ++size) {
+        uint8_t* block = static_cast<uint8_t*>(resource.Allocate(size, 1));
+        std::fill(block, block + size, static_cast<uint8_t>(size));
+        blocks.emplace_back(block, size);
+    }
+    uint8_t* aligned = static_cast<uint8_t*>(resource.Allocate(16, 64));
+    BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(aligned) % 64, 0U);
+
+    // No block overlaps another one
+    for (const auto& [block, size] : blocks) {
+        for (size_t i = 0; i < size; ++i) {
+            BOOST_CHECK_EQUAL(block[i], static_cast<uint8_t>(size));
+        }
+    }
+
+    // Only the blocks of at most 128 bytes came from the chunks
+    size_t pooled_bytes = 0;
+    for (size_t size = 0; size <= 128; ++size) {
+        pooled_bytes += size == 0 ? 8 : (size + 7) / 8 * 8;
+    }
+    BOOST_CHECK_LE(resource.NumAllocatedChunks(), pooled_bytes / resource.ChunkSizeBytes() + 2);
+
+    for (const auto& [block, size] : blocks) {
+        resource.Deallocate(block, size, 1);
+    }
+    resource.Deallocate(aligned, 16, 64);
+}
+
+BOOST_AUTO_TEST_CASE(memusage_test)
+{
+    auto std_map = std::unordered_map<int64_t, int64_t>{};
+
+    using Map = std::unordered_map<int64_t,
+                                   int64_t,
+                                   std::hash<int64_t>,
+                                   std::equal_to<int64_t>,
+                                   PoolAllocator<std::pair<const int64_t, int64_t>,
+                                                 sizeof(std::pair<const int64_t, int64_t>) + sizeof(void*) * 4>>;
+    auto resource = Map::allocator_type::ResourceType(1024);
+
+    {
+        auto resource_map = Map{0, std::hash<int64_t>{}, std::equal_to<int64_t>{}, &resource};
+
+        // can't have the same resource usage
+        BOOST_CHECK(memusage::DynamicUsage(std_map) != memusage::DynamicUsage(resource_map));
+
+        for (size_t i = 0; i < 10000; ++i) {
+            std_map[i];
+            resource_map[i];
+        }
+
+        // Eventually the resource_map should have a much lower memory usage because it has less malloc overhead
+        BOOST_CHECK_LE(memusage::DynamicUsage(resource_map), memusage::DynamicUsage(std_map) * 90 / 100);
+
+        // The usage is made up of the chunks and the buckets, so it grows in whole chunks
+        BOOST_CHECK_GE(memusage::DynamicUsage(resource_map), resource.NumAllocatedChunks() * resource.ChunkSizeBytes());
+
+        // Erasing and reinserting reuses the freed nodes instead of allocating new chunks
+        const size_t chunks = resource.NumAllocatedChunks();
+        const size_t usage = memusage::DynamicUsage(resource_map);
+        for (size_t i = 0; i < 5000; ++i) {
+            resource_map.erase(i);
+        }
+        // The freed nodes no longer count towards the usage
+        BOOST_CHECK_LT(memusage::DynamicUsage(resource_map), usage);
+        for (size_t i = 10000; i < 15000; ++i) {
+            resource_map[i];
+        }
+        BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), chunks);
+
+        // The map behaves like a std::unordered_map
+        for (size_t i = 0; i < 15000; ++i) {
+            BOOST_CHECK_EQUAL(resource_map.count(i), i < 5000 ? 0U : 1U);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
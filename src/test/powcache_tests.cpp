@@ -0,0 +1,197 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <pow.h>
+#include <powcache.h>
+#include <primitives/block.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(powcache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(powcache_insert_get_erase)
+{
+    CPowCache cache(1 << 20, true);
+
+    const uint256 blockHash = InsecureRand256();
+    const uint256 powHash = InsecureRand256();
+    uint256 result;
+
+    BOOST_CHECK(!cache.Get(blockHash, result));
+
+    cache.Insert(blockHash, powHash);
+    BOOST_CHECK(cache.Get(blockHash, result));
+    BOOST_CHECK(result == powHash);
+
+    cache.Erase(blockHash);
+    BOOST_CHECK(!cache.Get(blockHash, result));
+}
+
+BOOST_AUTO_TEST_CASE(powcache_persist_accepted_only)
+{
+    const uint256 acceptedHash = InsecureRand256();
+    const uint256 checkedHash = InsecureRand256();
+    const uint256 powHash = InsecureRand256();
+    uint256 result;
+
+    {
+        CPowCache cache(1 << 20, false, true);
+        cache.Insert(acceptedHash, powHash);
+        cache.Insert(checkedHash, powHash);
+        BOOST_CHECK(cache.Persist(acceptedHash));
+        BOOST_CHECK(!cache.Persist(InsecureRand256()));
+        BOOST_CHECK(cache.Get(checkedHash, result));
+    }
+
+    // Only the hash which was persisted made it to disk
+    CPowCache cache(1 << 20);
+    BOOST_CHECK(cache.Get(acceptedHash, result));
+    BOOST_CHECK(result == powHash);
+    BOOST_CHECK(!cache.Get(checkedHash, result));
+}
+
+BOOST_FIXTURE_TEST_CASE(powcache_read_block_backfill, RegTestingSetup)
+{
+    const CBlockIndex* pindex = WITH_LOCK(cs_main, return ::ChainActive().Genesis());
+    const uint256 powHash = pindex->GetBlockHeader().GetPOWHash();
+    uint256 result;
+
+    // Reading an indexed block whose hash isn't cached writes the hash CheckPOW computed
+    {
+        powCache.reset(new CPowCache(1 << 20, false, true));
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+        powCache.reset();
+    }
+    powCache.reset(new CPowCache(1 << 20));
+    BOOST_CHECK(powCache->Get(pindex->GetBlockHash(), result));
+    BOOST_CHECK(result == powHash);
+
+    // Reading a block by position alone doesn't, as it may not match the index
+    {
+        powCache.reset(new CPowCache(1 << 20, false, true));
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, WITH_LOCK(cs_main, return pindex->GetBlockPos()), Params().GetConsensus()));
+        powCache.reset();
+    }
+    powCache.reset(new CPowCache(1 << 20));
+    BOOST_CHECK(!powCache->Get(pindex->GetBlockHash(), result));
+
+    powCache.reset();
+}
+
+BOOST_AUTO_TEST_CASE(powcache_block_index_backfill)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = InsecureRand256();
+    header.nTime = 1650000000;
+    header.nBits = 0x207fffff;
+    const uint256 blockHash = header.GetHash();
+    CBlockIndex index(header);
+    index.phashBlock = &blockHash;
+
+    // Without a cache the hash is simply computed
+    BOOST_CHECK(GetBlockPOWHash(&index) == header.GetPOWHash());
+
+    // Indexed blocks missing from the cache are hashed once and stored
+    powCache.reset(new CPowCache(1 << 20, true));
+    uint256 result;
+    BOOST_CHECK(!powCache->Get(blockHash, result));
+    BOOST_CHECK(GetBlockPOWHash(&index) == header.GetPOWHash());
+    BOOST_CHECK(powCache->Get(blockHash, result));
+    BOOST_CHECK(result == header.GetPOWHash());
+
+    // Later lookups are served from the cache
+    const uint256 fakeHash = InsecureRand256();
+    powCache->Insert(blockHash, fakeHash);
+    BOOST_CHECK(GetBlockPOWHash(&index) == fakeHash);
+
+    powCache.reset();
+}
+
+BOOST_FIXTURE_TEST_CASE(powcache_parallel_header_checks, RegTestingSetup)
+{
+    powCache.reset(new CPowCache(1 << 20, true));
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    std::vector<CBlockHeader> headers;
+    uint256 prevHash = Params().GenesisBlock().GetHash();
+    for (int i = 0; i < 8; i++) {
+        CBlockHeader header;
+        header.nVersion = 4;
+        header.hashPrevBlock = prevHash;
+        header.hashMerkleRoot = InsecureRand256();
+        header.nTime = Params().GenesisBlock().nTime + i + 1;
+        header.nBits = 0x207fffff;
+        while (!CheckProofOfWork(header.GetPOWHash(), header.nBits, consensusParams)) {
+            ++header.nNonce;
+        }
+        headers.push_back(header);
+        prevHash = header.GetHash();
+    }
+    CBlockHeader badHeader = headers.back();
+    badHeader.hashPrevBlock = prevHash;
+    while (CheckProofOfWork(badHeader.GetPOWHash(), badHeader.nBits, consensusParams)) {
+        ++badHeader.nNonce;
+    }
+    headers.push_back(badHeader);
+
+    // Whatever the contextual checks decide, the parallel stage must have
+    // stored the PoW hash of every header which passed CheckProofOfWork
+    CValidationState state;
+    ProcessNewBlockHeaders(headers, state, Params());
+
+    uint256 powHash;
+    for (size_t i = 0; i + 1 < headers.size(); i++) {
+        BOOST_CHECK(powCache->Get(headers[i].GetHash(), powHash));
+        BOOST_CHECK(powHash == headers[i].GetPOWHash());
+    }
+    BOOST_CHECK(!powCache->Get(badHeader.GetHash(), powHash));
+
+    powCache.reset();
+}
+
+BOOST_FIXTURE_TEST_CASE(powcache_parallel_header_checks_first_serial, RegTestingSetup)
+{
+    powCache.reset(new CPowCache(1 << 20, true));
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+
+    // A batch which doesn't connect to any known block
+    std::vector<CBlockHeader> headers;
+    uint256 prevHash = InsecureRand256();
+    for (int i = 0; i < 8; i++) {
+        CBlockHeader header;
+        header.nVersion = 4;
+        header.hashPrevBlock = prevHash;
+        header.hashMerkleRoot = InsecureRand256();
+        header.nTime = Params().GenesisBlock().nTime + i + 1;
+        header.nBits = 0x207fffff;
+        while (!CheckProofOfWork(header.GetPOWHash(), header.nBits, consensusParams)) {
+            ++header.nNonce;
+        }
+        headers.push_back(header);
+        prevHash = header.GetHash();
+    }
+
+    // It is rejected at the first header, before the rest of it is hashed
+    CValidationState state;
+    CBlockHeader first_invalid;
+    BOOST_CHECK(!ProcessNewBlockHeaders(headers, state, Params(), nullptr, &first_invalid));
+    BOOST_CHECK(first_invalid.GetHash() == headers[0].GetHash());
+
+    uint256 powHash;
+    for (size_t i = 1; i < headers.size(); i++) {
+        BOOST_CHECK(!powCache->Get(headers[i].GetHash(), powHash));
+    }
+
+    powCache.reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,188 @@
+// Copyright (c) 2022 The Vkax Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <coins.h>
+#include <primitives/block.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <atomic>
+#include <future>
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+/** Coins database whose background writes can be held back or made to fail */
+class TestCoinsViewDB : public CCoinsViewDB
+{
+public:
+    using CCoinsViewDB::CCoinsViewDB;
+
+    std::shared_future<void> m_gate{MakeReadyFuture()};
+    std::atomic<bool> m_fail{false};
+
+protected:
+    bool WritePendingCoins(const PendingCoins& pending, const uint256& hashBlock) override
+    {
+        m_gate.wait();
+        if (m_fail) return false;
+        return CCoinsViewDB::WritePendingCoins(pending, hashBlock);
+    }
+
+private:
+    static std::shared_future<void> MakeReadyFuture()
+    {
+        std::promise<void> ready;
+        ready.set_value();
+        return ready.get_future().share();
+    }
+};
+
+COutPoint AddTestCoin(CCoinsViewCache& cache, uint32_t height)
+{
+    COutPoint outpoint(InsecureRand256(), 0);
+    CTxOut txout;
+    txout.nValue = height;
+    txout.scriptPubKey.assign(InsecureRandBits(6), 0);
+    cache.AddCoin(outpoint, Coin(std::move(txout), height, false), false);
+    return outpoint;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(txdb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(coinsdb_pending_reads)
+{
+    gArgs.ForceSetArg("-partialflush", "1");
+    TestCoinsViewDB db(GetDataDir() / "coins_pending", 1 << 20, true, false);
+    CCoinsViewCache cache(&db);
+
+    const uint256 block1 = InsecureRand256();
+    const COutPoint spent = AddTestCoin(cache, 1);
+    cache.SetBestBlock(block1);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(db.HaveCoin(spent));
+    BOOST_CHECK_EQUAL(db.PendingMemoryUsage(), 0U);
+
+    // Hold the background writer back while the next state is queued
+    std::promise<void> release;
+    db.m_gate = release.get_future().share();
+    const uint256 block2 = InsecureRand256();
+    BOOST_CHECK(cache.SpendCoin(spent));
+    const COutPoint added = AddTestCoin(cache, 2);
+    cache.SetBestBlock(block2);
+    BOOST_CHECK(cache.Sync());
+
+    // Reads are served from the pending coins, which count towards the memory usage
+    Coin coin;
+    BOOST_CHECK_EQUAL(db.GetBestBlock(), block2);
+    BOOST_CHECK(!db.HaveCoin(spent));
+    BOOST_CHECK(!db.GetCoin(spent, coin));
+    BOOST_CHECK(db.HaveCoin(added));
+    BOOST_CHECK(db.GetCoin(added, coin));
+    BOOST_CHECK_EQUAL(coin.nHeight, 2U);
+    BOOST_CHECK_GT(db.PendingMemoryUsage(), 0U);
+
+    release.set_value();
+    BOOST_CHECK(db.WaitForPendingWrites());
+    BOOST_CHECK_EQUAL(db.PendingMemoryUsage(), 0U);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    BOOST_CHECK_EQUAL(db.GetBestBlock(), block2);
+    BOOST_CHECK(!db.HaveCoin(spent));
+    BOOST_CHECK(db.GetCoin(added, coin));
+    BOOST_CHECK_EQUAL(coin.nHeight, 2U);
+
+    gArgs.ForceSetArg("-partialflush", "0");
+}
+
+BOOST_AUTO_TEST_CASE(coinsdb_failed_background_write)
+{
+    gArgs.ForceSetArg("-partialflush", "1");
+    TestCoinsViewDB db(GetDataDir() / "coins_failed", 1 << 20, true, false);
+    CCoinsViewCache cache(&db);
+
+    const uint256 block1 = InsecureRand256();
+    cache.SetBestBlock(block1);
+    BOOST_CHECK(cache.Flush());
+
+    db.m_fail = true;
+    const uint256 block2 = InsecureRand256();
+    const COutPoint first = AddTestCoin(cache, 2);
+    cache.SetBestBlock(block2);
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK(!db.WaitForPendingWrites());
+
+    // The failed coins are still served from memory, the database is left
+    // in the middle of the transition from block1 to block2
+    BOOST_CHECK(db.HaveCoin(first));
+    BOOST_CHECK_EQUAL(db.GetBestBlock(), block2);
+    BOOST_CHECK(db.GetHeadBlocks() == std::vector<uint256>({block2, block1}));
+    BOOST_CHECK_GT(db.PendingMemoryUsage(), 0U);
+
+    // The next flush retries the failed write, and fails itself without
+    // touching the cache when the retry does
+    const uint256 block3 = InsecureRand256();
+    const COutPoint second = AddTestCoin(cache, 3);
+    cache.SetBestBlock(block3);
+    BOOST_CHECK(!cache.Sync());
+    BOOST_CHECK(cache.HaveCoinInCache(second));
+    BOOST_CHECK(!db.HaveCoin(second));
+
+    // Once the retry succeeds, both flushes reach the database
+    db.m_fail = false;
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK(db.WaitForPendingWrites());
+    BOOST_CHECK_EQUAL(db.PendingMemoryUsage(), 0U);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    BOOST_CHECK_EQUAL(db.GetBestBlock(), block3);
+    BOOST_CHECK(db.HaveCoin(first));
+    BOOST_CHECK(db.HaveCoin(second));
+
+    gArgs.ForceSetArg("-partialflush", "0");
+}
+
+BOOST_FIXTURE_TEST_CASE(coinsdb_replay_interrupted_background_write, TestChain100Setup)
+{
+    gArgs.ForceSetArg("-partialflush", "1");
+    const CBlockIndex* tip = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    CBlock block;
+    BOOST_REQUIRE(ReadBlockFromDisk(block, tip, Params().GetConsensus()));
+    const COutPoint coinbase_out(block.vtx[0]->GetHash(), 0);
+
+    {
+        // An on-disk coins database at the previous block, whose background
+        // write of the tip never completes before the node goes down
+        TestCoinsViewDB db(GetDataDir() / "chainstate", 1 << 20, false, true);
+        CCoinsViewCache cache(&db);
+        cache.SetBestBlock(tip->pprev->GetBlockHash());
+        BOOST_CHECK(cache.Flush());
+        db.m_fail = true;
+        AddCoins(cache, *block.vtx[0], tip->nHeight);
+        cache.SetBestBlock(tip->GetBlockHash());
+        BOOST_CHECK(cache.Sync());
+        BOOST_CHECK(!db.WaitForPendingWrites());
+    }
+
+    LOCK(cs_main);
+    ::ChainstateActive().InitCoinsDB(/* cache_size_bytes */ 1 << 20, /* in_memory */ false, /* should_wipe */ false);
+    ::ChainstateActive().InitCoinsCache();
+    CCoinsViewDB& coins_db = ::ChainstateActive().CoinsDB();
+    BOOST_CHECK(coins_db.GetBestBlock().IsNull());
+    BOOST_CHECK(coins_db.GetHeadBlocks() == std::vector<uint256>({tip->GetBlockHash(), tip->pprev->GetBlockHash()}));
+    BOOST_CHECK(!coins_db.HaveCoin(coinbase_out));
+
+    // ReplayBlocks rolls the database forward to the tip
+    BOOST_CHECK(::ChainstateActive().ReplayBlocks(Params()));
+    BOOST_CHECK(coins_db.GetHeadBlocks().empty());
+    BOOST_CHECK_EQUAL(coins_db.GetBestBlock(), tip->GetBlockHash());
+    BOOST_CHECK(coins_db.HaveCoin(coinbase_out));
+
+    gArgs.ForceSetArg("-partialflush", "0");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
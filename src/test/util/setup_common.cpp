@@ -10,6 +10,8 @@
 #include <consensus/params.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <crypto/sph_multi.h>
+#include <cryptonote/slow-hash.h>
 #include <index/txindex.h>
 #include <init.h>
 #include <miner.h>
@@ -83,6 +85,8 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     InitLogging();
     LogInstance().StartLogging();
     SHA256AutoDetect();
+    crypto::cn_slow_hash_autodetect();
+    SphHash512AutoDetect();
     ECC_Start();
     BLSInit();
     SetupEnvironment();
@@ -148,6 +152,14 @@ TestingSetup::TestingSetup(const std::string& chainName) : BasicTestingSetup(cha
     constexpr int script_check_threads = 2;
     StartScriptCheckWorkerThreads(script_check_threads);
     g_parallel_script_checks = true;
+    StartPowCheckWorkerThreads(script_check_threads);
+    g_parallel_pow_checks = true;
+    StartBlockCheckWorkerThreads(script_check_threads);
+    g_parallel_block_checks = true;
+    StartCoinPrefetchWorkerThreads(script_check_threads);
+    g_parallel_coin_prefetch = true;
+    StartUndoPrefetchWorkerThreads(script_check_threads);
+    g_parallel_undo_prefetch = true;
 }
 
 TestingSetup::~TestingSetup()
@@ -161,6 +173,14 @@ TestingSetup::~TestingSetup()
     threadGroup.interrupt_all();
     threadGroup.join_all();
     StopScriptCheckWorkerThreads();
+    StopPowCheckWorkerThreads();
+    g_parallel_pow_checks = false;
+    StopBlockCheckWorkerThreads();
+    g_parallel_block_checks = false;
+    StopCoinPrefetchWorkerThreads();
+    g_parallel_coin_prefetch = false;
+    StopUndoPrefetchWorkerThreads();
+    g_parallel_undo_prefetch = false;
     GetMainSignals().FlushBackgroundCallbacks();
     GetMainSignals().UnregisterBackgroundSignalScheduler();
     g_connman.reset();
@@ -2,6 +2,8 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 //
+#include <coins.h>
+#include <memusage.h>
 #include <sync.h>
 #include <test/util/setup_common.h>
 #include <txmempool.h>
@@ -52,17 +54,23 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
         BOOST_TEST_MESSAGE("CCoinsViewCache memory usage: " << view.DynamicMemoryUsage());
     };
 
-    constexpr size_t MAX_COINS_CACHE_BYTES = 1024;
+    // The coins map's PoolResource allocates its first chunk up front, which is
+    // accounted for together with the node of its chunk list. Allow for 1 KiB of
+    // coins and buckets on top of that.
+    const CCoinsMapMemoryResource resource;
+    const size_t POOL_CHUNK_BYTES = memusage::MallocUsage(sizeof(void*) * 3) + memusage::MallocUsage(resource.ChunkSizeBytes());
+    const size_t MAX_COINS_CACHE_BYTES = POOL_CHUNK_BYTES + 1024;
 
-    // Without any coins in the cache, we shouldn't need to flush.
+    // Without any coins in the cache, we shouldn't need to flush yet. The
+    // chunk alone puts us above 90% though.
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(tx_pool, MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 0),
-        CoinsCacheSizeState::OK);
+        CoinsCacheSizeState::LARGE);
 
     // If the initial memory allocations of cacheCoins don't match these common
     // cases, we can't really continue to make assertions about memory usage.
     // End the test early.
-    if (view.DynamicMemoryUsage() != 32 && view.DynamicMemoryUsage() != 16) {
+    if (view.DynamicMemoryUsage() != POOL_CHUNK_BYTES + 32 && view.DynamicMemoryUsage() != POOL_CHUNK_BYTES + 16) {
         // Add a bunch of coins to see that we at least flip over to CRITICAL.
 
         for (int i{0}; i < 1000; ++i) {
@@ -79,13 +87,14 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
     }
 
     print_view_mem_usage(view);
-    BOOST_CHECK_EQUAL(view.DynamicMemoryUsage(), is_64_bit ? 32 : 16);
+    BOOST_CHECK_EQUAL(view.DynamicMemoryUsage(), POOL_CHUNK_BYTES + (is_64_bit ? 32 : 16));
 
     // We should be able to add COINS_UNTIL_CRITICAL coins to the cache before going CRITICAL.
-    // This is contingent not only on the dynamic memory usage of the Coins
-    // that we're adding (COIN_SIZE bytes per), but also on how much memory the
-    // cacheCoins (unordered_map) preallocates.
-    constexpr int COINS_UNTIL_CRITICAL{3};
+    // The nodes are carved out of the chunk which is already accounted for, so
+    // this is contingent on the dynamic memory usage of the Coins that we're
+    // adding (COIN_SIZE bytes per) and on the buckets of cacheCoins
+    // (unordered_map), which the first coin makes it allocate.
+    constexpr int COINS_UNTIL_CRITICAL{11};
 
     for (int i{0}; i < COINS_UNTIL_CRITICAL; ++i) {
         COutPoint res = add_coin(view);
@@ -93,7 +102,7 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
         BOOST_CHECK_EQUAL(view.AccessCoin(res).DynamicMemoryUsage(), COIN_SIZE);
         BOOST_CHECK_EQUAL(
             chainstate.GetCoinsCacheSizeState(tx_pool, MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 0),
-            CoinsCacheSizeState::OK);
+            CoinsCacheSizeState::LARGE);
     }
 
     // Adding some additional coins will push us over the edge to CRITICAL.
@@ -113,14 +122,14 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
     // Passing non-zero max mempool usage should allow us more headroom.
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(tx_pool, MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 1 << 10),
-        CoinsCacheSizeState::OK);
+        CoinsCacheSizeState::LARGE);
 
     for (int i{0}; i < 3; ++i) {
         add_coin(view);
         print_view_mem_usage(view);
         BOOST_CHECK_EQUAL(
             chainstate.GetCoinsCacheSizeState(tx_pool, MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes*/ 1 << 10),
-            CoinsCacheSizeState::OK);
+            CoinsCacheSizeState::LARGE);
     }
 
     // Adding another coin with the additional mempool room will put us >90%
@@ -147,20 +156,20 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
             CoinsCacheSizeState::OK);
     }
 
-    // Flushing the view doesn't take us back to OK because cacheCoins has
-    // preallocated memory that doesn't get reclaimed even after flush.
-
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(tx_pool, MAX_COINS_CACHE_BYTES, 0),
         CoinsCacheSizeState::CRITICAL);
 
+    // Flushing the view reallocates cacheCoins and its pool, so we're back to
+    // the usage of an empty cache.
     view.SetBestBlock(InsecureRand256());
     BOOST_CHECK(view.Flush());
     print_view_mem_usage(view);
 
+    BOOST_CHECK_EQUAL(view.DynamicMemoryUsage(), POOL_CHUNK_BYTES + (is_64_bit ? 32 : 16));
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(tx_pool, MAX_COINS_CACHE_BYTES, 0),
-        CoinsCacheSizeState::CRITICAL);
+        CoinsCacheSizeState::LARGE);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,7 +2,12 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <chainparams.h>
+#include <consensus/validation.h>
 #include <net.h>
+#include <node/coinstats.h>
+#include <script/interpreter.h>
+#include <validation.h>
 
 #include <test/util/setup_common.h>
 
@@ -11,6 +16,64 @@
 
 BOOST_FIXTURE_TEST_SUITE(validation_tests, TestingSetup)
 
+/** Spend output n of tx, which pays to key's P2PK script, to the same script */
+static CMutableTransaction SpendOutput(const CTransactionRef& tx, uint32_t n, const CKey& key, bool sign = true)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(tx->GetHash(), n);
+    spend.vout.resize(1);
+    spend.vout[0].nValue = tx->vout[n].nValue - CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+
+    // Without sign, the signature is well-formed but not for this transaction
+    std::vector<unsigned char> vchSig;
+    const uint256 hash = sign ? SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE) : uint256S("01");
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+    return spend;
+}
+
+/** Spend the first n_inputs outputs of tx, which pay to key's P2PK script, to n_outputs outputs paying to the same script */
+static CMutableTransaction SpendOutputs(const CTransactionRef& tx, uint32_t n_inputs, uint32_t n_outputs, const CKey& key)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    CAmount nValueIn = 0;
+    for (uint32_t n = 0; n < n_inputs; ++n) {
+        spend.vin.emplace_back(COutPoint(tx->GetHash(), n));
+        nValueIn += tx->vout[n].nValue;
+    }
+    spend.vout.resize(n_outputs);
+    for (CTxOut& txout : spend.vout) {
+        txout.nValue = (nValueIn - CENT) / n_outputs;
+        txout.scriptPubKey = scriptPubKey;
+    }
+
+    for (uint32_t n = 0; n < n_inputs; ++n) {
+        std::vector<unsigned char> vchSig;
+        const uint256 hash = SignatureHash(scriptPubKey, spend, n, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(key.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        spend.vin[n].scriptSig << vchSig;
+    }
+    return spend;
+}
+
+/** Hash of the UTXO set of the active chainstate */
+static uint256 UTXOSetHash()
+{
+    LOCK(cs_main);
+    ::ChainstateActive().ForceFlushStateToDisk();
+    CCoinsStats stats;
+    BOOST_REQUIRE(GetUTXOStats(&::ChainstateActive().CoinsDB(), stats));
+    return stats.hashSerialized;
+}
+
 static bool ReturnFalse() { return false; }
 static bool ReturnTrue() { return true; }
 
@@ -27,4 +90,127 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+BOOST_FIXTURE_TEST_CASE(read_raw_block, TestChain100Setup)
+{
+    const CBlockIndex* pindex = WITH_LOCK(cs_main, return ::ChainActive()[50]);
+    CBlock block;
+    BOOST_REQUIRE(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+    CDataStream expected(SER_NETWORK, PROTOCOL_VERSION);
+    expected << block;
+
+    // Same bytes whether read through the file or a mapping of it
+    for (size_t mapped_files : {0, 2}) {
+        SetMappedFlatFileLimit(mapped_files);
+        std::vector<uint8_t> raw;
+        BOOST_REQUIRE(ReadRawBlockFromDisk(raw, pindex, Params().MessageStart()));
+        BOOST_CHECK(MakeUCharSpan(expected) == MakeSpan(raw));
+
+        CBlock block_mapped;
+        BOOST_REQUIRE(ReadBlockFromDisk(block_mapped, pindex, Params().GetConsensus()));
+        BOOST_CHECK_EQUAL(block_mapped.GetHash(), block.GetHash());
+
+        CMessageHeader::MessageStartChars wrong_start = {0};
+        BOOST_CHECK(!ReadRawBlockFromDisk(raw, pindex, wrong_start));
+    }
+    SetMappedFlatFileLimit(0);
+}
+
+BOOST_FIXTURE_TEST_CASE(connect_while_preparing_next_block, TestChain100Setup)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // Each block spends the outputs of the one before it, so the next block's
+    // inputs are looked up by the prefetch threads before the block creating
+    // them is committed. There are more of them than MIN_PREFETCH_INPUTS, or
+    // the prefetch would be skipped.
+    constexpr uint32_t PREFETCH_INPUTS = 20;
+    const CMutableTransaction spend1 = SpendOutputs(m_coinbase_txns[0], 1, PREFETCH_INPUTS, coinbaseKey);
+    const CBlock block1 = CreateAndProcessBlock({spend1}, scriptPubKey);
+    const CMutableTransaction spend2 = SpendOutputs(MakeTransactionRef(spend1), PREFETCH_INPUTS, PREFETCH_INPUTS, coinbaseKey);
+    const CBlock block2 = CreateAndProcessBlock({spend2}, scriptPubKey);
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash()), block2.GetHash());
+    const uint256 utxo_hash = UTXOSetHash();
+
+    // A block on top whose script checks fail, stored without being connected
+    const CMutableTransaction spend3 = SpendOutputs(MakeTransactionRef(spend2), PREFETCH_INPUTS, 1, coinbaseKey);
+    const CMutableTransaction bad_spend = SpendOutput(m_coinbase_txns[1], 0, coinbaseKey, /* sign */ false);
+    auto block3 = std::make_shared<const CBlock>(CreateBlock({spend3, bad_spend}, scriptPubKey));
+    CBlockIndex* pindex3 = nullptr;
+    {
+        LOCK(cs_main);
+        CValidationState state;
+        bool fNewBlock = false;
+        BOOST_CHECK(::ChainstateActive().AcceptBlock(block3, state, Params(), &pindex3, true, nullptr, &fNewBlock));
+        BOOST_CHECK(fNewBlock);
+    }
+
+    // Disconnect the first two blocks, then connect all three in one go:
+    // block2 is prepared while block1's scripts are checked, and block3 while
+    // block2's are
+    CBlockIndex* pindex1 = WITH_LOCK(cs_main, return LookupBlockIndex(block1.GetHash()));
+    CValidationState state;
+    BOOST_CHECK(InvalidateBlock(state, Params(), pindex1));
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Height()), 100);
+    WITH_LOCK(cs_main, ResetBlockFailureFlags(pindex1));
+    BOOST_CHECK(ActivateBestChain(state, Params()));
+
+    // block3 is rejected, and nothing of it was applied while it was prepared
+    LOCK(cs_main);
+    BOOST_CHECK_EQUAL(::ChainActive().Tip()->GetBlockHash(), block2.GetHash());
+    BOOST_CHECK(pindex3->nStatus & BLOCK_FAILED_VALID);
+    BOOST_CHECK_EQUAL(::ChainstateActive().CoinsTip().GetBestBlock(), block2.GetHash());
+    BOOST_CHECK(::ChainstateActive().CoinsTip().HaveCoin(COutPoint(m_coinbase_txns[1]->GetHash(), 0)));
+    BOOST_CHECK(!::ChainstateActive().CoinsTip().HaveCoin(COutPoint(spend1.GetHash(), 0)));
+    for (uint32_t n = 0; n < PREFETCH_INPUTS; ++n) {
+        BOOST_CHECK(::ChainstateActive().CoinsTip().HaveCoin(COutPoint(spend2.GetHash(), n)));
+    }
+    BOOST_CHECK(!::ChainstateActive().CoinsTip().HaveCoin(COutPoint(spend3.GetHash(), 0)));
+    BOOST_CHECK(UTXOSetHash() == utxo_hash);
+}
+
+BOOST_FIXTURE_TEST_CASE(reorg_across_disconnect_batches, TestChain100Setup)
+{
+    const CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    // Disconnecting a branch takes more than two batches of blocks
+    constexpr int REORG_DEPTH = 36;
+
+    // Every block spends the output the block before created, so the
+    // batches restore coins which the block before them spends again
+    auto mine_branch = [&](const CTransactionRef& funding) {
+        CTransactionRef prev = funding;
+        for (int i = 0; i < REORG_DEPTH; ++i) {
+            const CMutableTransaction spend = SpendOutput(prev, 0, coinbaseKey);
+            CreateAndProcessBlock({spend}, scriptPubKey);
+            prev = MakeTransactionRef(spend);
+        }
+        return WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    };
+
+    CBlockIndex* pindexTipA = mine_branch(m_coinbase_txns[0]);
+    const uint256 utxo_hash_a = UTXOSetHash();
+    CBlockIndex* pindexForkA = WITH_LOCK(cs_main, return ::ChainActive()[101]);
+    CValidationState state;
+    BOOST_CHECK(InvalidateBlock(state, Params(), pindexForkA));
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Height()), 100);
+
+    CBlockIndex* pindexTipB = mine_branch(m_coinbase_txns[1]);
+    const uint256 utxo_hash_b = UTXOSetHash();
+    WITH_LOCK(cs_main, ResetBlockFailureFlags(pindexForkA));
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Tip()), pindexTipB);
+
+    // Switch between the branches of the same length, reading the blocks to
+    // disconnect on the undo prefetch threads and serially
+    for (bool parallel : {true, false}) {
+        g_parallel_undo_prefetch = parallel;
+        BOOST_CHECK(PreciousBlock(state, Params(), pindexTipA));
+        BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Tip()), pindexTipA);
+        BOOST_CHECK(UTXOSetHash() == utxo_hash_a);
+        BOOST_CHECK(PreciousBlock(state, Params(), pindexTipB));
+        BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Tip()), pindexTipB);
+        BOOST_CHECK(UTXOSetHash() == utxo_hash_b);
+    }
+    g_parallel_undo_prefetch = true;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
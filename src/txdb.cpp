@@ -5,6 +5,7 @@
 
 #include <txdb.h>
 
+#include <memusage.h>
 #include <pow.h>
 #include <random.h>
 #include <shutdown.h>
@@ -32,6 +33,8 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_SNAPSHOT_BASE = 'S';
+static const char DB_SNAPSHOT_COINS_HASH = 'U';
 
 namespace {
 
@@ -45,19 +48,56 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) : db(ldb_path, nCacheSize, fMemory, fWipe, true)
+CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) : db(ldb_path, nCacheSize, fMemory, fWipe, true, DBProfileType::CHAINSTATE)
 {
 }
 
+CCoinsViewDB::~CCoinsViewDB()
+{
+    {
+        LOCK(cs_pending);
+        m_stop_writer = true;
+    }
+    m_pending_cv.notify_all();
+    // The writer finishes a pending write before it exits
+    if (m_writer_thread.joinable()) {
+        m_writer_thread.join();
+    }
+}
+
+std::shared_ptr<const CCoinsViewDB::PendingCoins> CCoinsViewDB::GetPendingCoins() const
+{
+    LOCK(cs_pending);
+    return m_pending_coins;
+}
+
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    if (auto pending = GetPendingCoins()) {
+        auto it = pending->find(outpoint);
+        if (it != pending->end()) {
+            if (it->second.IsSpent()) return false;
+            coin = it->second;
+            return true;
+        }
+    }
     return db.Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    if (auto pending = GetPendingCoins()) {
+        auto it = pending->find(outpoint);
+        if (it != pending->end()) {
+            return !it->second.IsSpent();
+        }
+    }
     return db.Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        LOCK(cs_pending);
+        if (m_pending_coins) return m_pending_best_block;
+    }
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -65,6 +105,7 @@ uint256 CCoinsViewDB::GetBestBlock() const {
 }
 
 std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
+    WaitForPendingWrites();
     std::vector<uint256> vhashHeadBlocks;
     if (!db.Read(DB_HEAD_BLOCKS, vhashHeadBlocks)) {
         return std::vector<uint256>();
@@ -72,7 +113,28 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     return vhashHeadBlocks;
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+/** Write out batch once it grows beyond batch_size, honoring -dbcrashratio. */
+static void WritePartialBatch(CDBWrapper& db, CDBBatch& batch, size_t batch_size, int crash_simulate)
+{
+    if (batch.SizeEstimate() <= batch_size) return;
+    LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
+    db.WriteBatch(batch);
+    batch.Clear();
+    if (crash_simulate) {
+        static FastRandomContext rng;
+        if (rng.randrange(crash_simulate) == 0) {
+            LogPrintf("Simulating a crash. Goodbye.\n");
+            _Exit(0);
+        }
+    }
+}
+
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase) {
+    // Writes have to reach the database in order
+    if (!FinishPendingWrites()) {
+        return false;
+    }
+
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -97,6 +159,35 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     batch.Erase(DB_BEST_BLOCK);
     batch.Write(DB_HEAD_BLOCKS, Vector(hashBlock, old_tip));
 
+    if (!erase && gArgs.GetBoolArg("-partialflush", DEFAULT_PARTIAL_FLUSH)) {
+        auto pending = std::make_shared<PendingCoins>();
+        size_t pending_usage = 0;
+        for (const auto& entry : mapCoins) {
+            if (entry.second.flags & CCoinsCacheEntry::DIRTY) {
+                pending->emplace(entry.first, entry.second.coin);
+                pending_usage += entry.second.coin.DynamicMemoryUsage();
+            }
+        }
+        pending_usage += memusage::DynamicUsage(*pending);
+        // Commit the marker right away, so that a crash before the background
+        // write completes is rolled forward by ReplayBlocks.
+        if (!db.WriteBatch(batch)) {
+            return false;
+        }
+        LogPrint(BCLog::COINDB, "Queued %u changed transaction outputs (out of %u) for background write\n", (unsigned int)pending->size(), (unsigned int)mapCoins.size());
+        {
+            LOCK(cs_pending);
+            m_pending_coins = std::move(pending);
+            m_pending_usage = pending_usage;
+            m_pending_best_block = hashBlock;
+            if (!m_writer_thread.joinable()) {
+                m_writer_thread = std::thread(&TraceThread<std::function<void()> >, "coinsflush", std::function<void()>(std::bind(&CCoinsViewDB::WriterThread, this)));
+            }
+        }
+        m_pending_cv.notify_all();
+        return true;
+    }
+
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
         if (it->second.flags & CCoinsCacheEntry::DIRTY) {
             CoinEntry entry(&it->first);
@@ -107,20 +198,13 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
-        if (batch.SizeEstimate() > batch_size) {
-            LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
-            db.WriteBatch(batch);
-            batch.Clear();
-            if (crash_simulate) {
-                static FastRandomContext rng;
-                if (rng.randrange(crash_simulate) == 0) {
-                    LogPrintf("Simulating a crash. Goodbye.\n");
-                    _Exit(0);
-                }
-            }
+        if (erase) {
+            CCoinsMap::iterator itOld = it++;
+            mapCoins.erase(itOld);
+        } else {
+            ++it;
         }
+        WritePartialBatch(db, batch, batch_size, crash_simulate);
     }
 
     // In the last batch, mark the database as consistent with hashBlock again.
@@ -133,12 +217,107 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return ret;
 }
 
+bool CCoinsViewDB::WritePendingCoins(const PendingCoins& pending, const uint256& hashBlock)
+{
+    try {
+        CDBBatch batch(db);
+        size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+        int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
+        for (const auto& coin : pending) {
+            CoinEntry entry(&coin.first);
+            if (coin.second.IsSpent())
+                batch.Erase(entry);
+            else
+                batch.Write(entry, coin.second);
+            WritePartialBatch(db, batch, batch_size, crash_simulate);
+        }
+        batch.Erase(DB_HEAD_BLOCKS);
+        batch.Write(DB_BEST_BLOCK, hashBlock);
+        LogPrint(BCLog::COINDB, "Writing final batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
+        if (!db.WriteBatch(batch)) return false;
+        LogPrint(BCLog::COINDB, "Committed %u changed transaction outputs to coin database in the background\n", (unsigned int)pending.size());
+        return true;
+    } catch (const std::runtime_error& e) {
+        LogPrintf("%s: error writing coins: %s\n", __func__, e.what());
+        return false;
+    }
+}
+
+void CCoinsViewDB::WriterThread()
+{
+    while (true) {
+        std::shared_ptr<const PendingCoins> pending;
+        uint256 hashBlock;
+        {
+            WAIT_LOCK(cs_pending, lock);
+            // A pending write is finished before the thread exits, a failed one is left for FinishPendingWrites
+            m_pending_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs_pending) { return (m_pending_coins && !m_pending_failed) || m_stop_writer; });
+            if (!m_pending_coins || m_pending_failed) return;
+            pending = m_pending_coins;
+            hashBlock = m_pending_best_block;
+        }
+
+        bool ret = WritePendingCoins(*pending, hashBlock);
+
+        {
+            LOCK(cs_pending);
+            if (ret) {
+                m_pending_coins.reset();
+                m_pending_usage = 0;
+            } else {
+                // Keep serving the coins from memory, the database is missing them
+                LogPrintf("%s: background write of the coins at %s failed\n", __func__, hashBlock.ToString());
+                m_pending_failed = true;
+            }
+        }
+        m_pending_cv.notify_all();
+    }
+}
+
+bool CCoinsViewDB::WaitForPendingWrites() const
+{
+    WAIT_LOCK(cs_pending, lock);
+    m_pending_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(cs_pending) { return !m_pending_coins || m_pending_failed; });
+    return !m_pending_failed;
+}
+
+bool CCoinsViewDB::FinishPendingWrites()
+{
+    if (WaitForPendingWrites()) return true;
+
+    std::shared_ptr<const PendingCoins> pending;
+    uint256 hashBlock;
+    {
+        LOCK(cs_pending);
+        pending = m_pending_coins;
+        hashBlock = m_pending_best_block;
+    }
+    LogPrintf("%s: retrying the failed write of %u coins at %s\n", __func__, (unsigned int)pending->size(), hashBlock.ToString());
+    if (!WritePendingCoins(*pending, hashBlock)) {
+        return false;
+    }
+    {
+        LOCK(cs_pending);
+        m_pending_coins.reset();
+        m_pending_usage = 0;
+        m_pending_failed = false;
+    }
+    m_pending_cv.notify_all();
+    return true;
+}
+
+size_t CCoinsViewDB::PendingMemoryUsage() const
+{
+    LOCK(cs_pending);
+    return m_pending_usage;
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, false, DBProfileType::BLOCK_INDEX) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -156,12 +335,29 @@ void CBlockTreeDB::ReadReindexing(bool &fReindexing) {
     fReindexing = Exists(DB_REINDEX_FLAG);
 }
 
+bool CBlockTreeDB::WriteSnapshotBase(const uint256& hash) {
+    return Write(DB_SNAPSHOT_BASE, hash);
+}
+
+bool CBlockTreeDB::ReadSnapshotBase(uint256& hash) {
+    return Read(DB_SNAPSHOT_BASE, hash);
+}
+
+bool CBlockTreeDB::WriteSnapshotCoinsHash(const uint256& hash) {
+    return Write(DB_SNAPSHOT_COINS_HASH, hash);
+}
+
+bool CBlockTreeDB::ReadSnapshotCoinsHash(uint256& hash) {
+    return Read(DB_SNAPSHOT_COINS_HASH, hash);
+}
+
 bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
     return Read(DB_LAST_BLOCK, nFile);
 }
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
+    WaitForPendingWrites();
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
@@ -11,9 +11,13 @@
 #include <chain.h>
 #include <primitives/block.h>
 #include <spentindex.h>
+#include <sync.h>
 
+#include <condition_variable>
 #include <memory>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -25,6 +29,8 @@ class uint256;
 static const int64_t nDefaultDbCache = 300;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -partialflush default
+static const bool DEFAULT_PARTIAL_FLUSH = false;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -40,25 +46,63 @@ static const int64_t max_filter_index_cache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
-/** CCoinsView backed by the coin database (chainstate/) */
-class CCoinsViewDB final : public CCoinsView
+/**
+ * CCoinsView backed by the coin database (chainstate/)
+ *
+ * With -partialflush, a BatchWrite that keeps the caller's entries (a
+ * CCoinsViewCache::Sync) only commits the DB_HEAD_BLOCKS marker and hands the
+ * dirty coins to a background thread, which writes them in -dbbatchsize
+ * batches. Until that write completes the coins are served from memory, and
+ * the next BatchWrite waits for it. If the background write fails, the coins
+ * stay in memory and the next BatchWrite retries it, failing itself if the
+ * retry does. A crash in between leaves the same head-blocks state a crash
+ * during a synchronous write would, which ReplayBlocks recovers from.
+ */
+class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
+
+    using PendingCoins = std::unordered_map<COutPoint, Coin, SaltedOutpointHasher>;
+
+    mutable Mutex cs_pending;
+    mutable std::condition_variable m_pending_cv;
+    //! Coins handed to the background writer, immutable while it runs
+    std::shared_ptr<const PendingCoins> m_pending_coins GUARDED_BY(cs_pending);
+    //! Memory used by m_pending_coins
+    size_t m_pending_usage GUARDED_BY(cs_pending){0};
+    uint256 m_pending_best_block GUARDED_BY(cs_pending);
+    //! Set when the background write of m_pending_coins failed
+    bool m_pending_failed GUARDED_BY(cs_pending){false};
+    bool m_stop_writer GUARDED_BY(cs_pending){false};
+    std::thread m_writer_thread;
+
+    std::shared_ptr<const PendingCoins> GetPendingCoins() const;
+    void WriterThread();
+    //! Wait for a background write, and retry it if it failed. Returns false if the retry failed.
+    bool FinishPendingWrites();
+    //! Write coins and mark the database as consistent with hashBlock
+    virtual bool WritePendingCoins(const PendingCoins& pending, const uint256& hashBlock);
+
 public:
     /**
      * @param[in] ldb_path    Location in the filesystem where leveldb data will be stored.
      */
     explicit CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe);
-
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
-    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
     CCoinsViewCursor *Cursor() const override;
 
+    //! Block until a background write has completed. Returns false if it failed.
+    bool WaitForPendingWrites() const;
+    //! Memory used by the coins waiting for a background write
+    size_t PendingMemoryUsage() const;
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
@@ -97,6 +141,12 @@ public:
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindexing);
     void ReadReindexing(bool &fReindexing);
+    //! Block whose chainstate was loaded from a snapshot, if any
+    bool WriteSnapshotBase(const uint256& hash);
+    bool ReadSnapshotBase(uint256& hash);
+    //! Hash of the UTXO set the snapshot came with, as computed by GetUTXOStats
+    bool WriteSnapshotCoinsHash(const uint256& hash);
+    bool ReadSnapshotCoinsHash(uint256& hash);
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
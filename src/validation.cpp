@@ -15,21 +15,28 @@
 #include <consensus/tx_check.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
+#include <cryptonote/slow-hash.h>
 #include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
 #include <index/txindex.h>
 #include <logging.h>
 #include <logging/timer.h>
+#include <node/coinstats.h>
+#include <node/snapshot.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <pow.h>
+#include <powcache.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <reverse_iterator.h>
+#include <saltedhasher.h>
 #include <script/script.h>
 #include <script/sigcache.h>
 #include <shutdown.h>
+#include <threadinterrupt.h>
 #include <timedata.h>
 #include <tinyformat.h>
 #include <txdb.h>
@@ -56,7 +63,10 @@
 
 #include <statsd_client.h>
 
+#include <functional>
 #include <string>
+#include <thread>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp> // Required for boost::this_thread::interruption_point();
@@ -133,6 +143,10 @@ Mutex g_best_block_mutex;
 std::condition_variable g_best_block_cv;
 uint256 g_best_block;
 bool g_parallel_script_checks{false};
+bool g_parallel_pow_checks{false};
+bool g_parallel_block_checks{false};
+bool g_parallel_coin_prefetch{false};
+bool g_parallel_undo_prefetch{false};
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fAddressIndex = false;
@@ -140,6 +154,8 @@ bool fTimestampIndex = false;
 bool fSpentIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
+CBlockIndex *pindexSnapshotBase = nullptr;
+bool fSnapshotHistoryValidated = false;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
@@ -962,28 +978,79 @@ static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessa
     return true;
 }
 
-bool CheckPOW(const CBlock& block, const Consensus::Params& consensusParams)
+bool CheckPOW(const CBlockHeader& block, const Consensus::Params& consensusParams)
 {
-    if (!CheckProofOfWork(block.GetPOWHash(), block.nBits, consensusParams)) {
-        LogPrintf("CheckPOW: CheckProofOfWork failed for %s, retesting without POW cache\n", block.GetHash().ToString());
-        // Retest without POW cache in case cache was corrupted:
+    if (!powCache) {
         return CheckProofOfWork(block.GetPOWHash(), block.nBits, consensusParams);
     }
+
+    const uint256 hash = block.GetHash();
+    uint256 powHash;
+    if (powCache->Get(hash, powHash)) {
+        if (CheckProofOfWork(powHash, block.nBits, consensusParams)) {
+            return true;
+        }
+        LogPrintf("CheckPOW: CheckProofOfWork failed for %s, retesting without POW cache\n", hash.ToString());
+        // Retest without POW cache in case cache was corrupted:
+        powCache->Erase(hash);
+    }
+
+    powHash = block.GetPOWHash();
+    if (!CheckProofOfWork(powHash, block.nBits, consensusParams)) {
+        return false;
+    }
+    // Only remember hashes of headers which passed the check, so that invalid
+    // headers can't be used to churn the cache. They are only written to disk
+    // once AcceptBlockHeader added the header to the block index.
+    powCache->Insert(hash, powHash);
     return true;
 }
 
+/**
+ * Get a block or undo record from a mapped file, together with the given number
+ * of bytes stored behind it. The record size is taken from the header in front
+ * of pos, see WriteBlockToDisk.
+ */
+static std::shared_ptr<const MappedFlatFile> MapRecord(FlatFileSeq seq, const FlatFilePos& pos, size_t trailing, Span<const unsigned char>& record)
+{
+    if (pos.IsNull() || pos.nPos < sizeof(CMessageHeader::MessageStartChars) + sizeof(unsigned int)) {
+        return nullptr;
+    }
+    const FlatFilePos size_pos(pos.nFile, pos.nPos - sizeof(unsigned int));
+    std::shared_ptr<const MappedFlatFile> file = seq.Map(size_pos, sizeof(unsigned int));
+    if (!file) {
+        return nullptr;
+    }
+    const uint32_t record_size = ReadLE32(file->GetSpan().data() + size_pos.nPos);
+    if (record_size > MAX_SIZE) {
+        return nullptr;
+    }
+    // A bogus size is left for the file read to report
+    const size_t size = record_size + trailing;
+    file = seq.Map(pos, size);
+    if (!file) {
+        return nullptr;
+    }
+    record = file->GetSpan().subspan(pos.nPos, size);
+    return file;
+}
+
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
-
     // Read block
     try {
-        filein >> block;
+        Span<const unsigned char> record;
+        if (const auto mapped = MapRecord(BlockFileSeq(), pos, 0, record)) {
+            SpanReader(SER_DISK, CLIENT_VERSION, record) >> block;
+        } else {
+            // Open history file to read
+            CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+            if (filein.IsNull())
+                return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+            filein >> block;
+        }
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -1005,14 +1072,75 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
         blockPos = pindex->GetBlockPos();
     }
 
+    // Blocks indexed before the PoW cache existed have their PoW hash computed by CheckPOW
+    uint256 powHash;
+    const bool fPowHashCached = !powCache || powCache->Get(pindex->GetBlockHash(), powHash);
+
     if (!ReadBlockFromDisk(block, blockPos, consensusParams))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
                 pindex->ToString(), pindex->GetBlockPos().ToString());
+
+    // The block is indexed, so keep its hash for the next read
+    if (!fPowHashCached) {
+        powCache->Persist(pindex->GetBlockHash());
+    }
+    return true;
+}
+
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
+{
+    if (pos.nPos < CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int)) {
+        return error("%s: Invalid position %s", __func__, pos.ToString());
+    }
+
+    Span<const unsigned char> record;
+    if (const auto mapped = MapRecord(BlockFileSeq(), pos, 0, record)) {
+        // The record is preceded by the network magic and its size
+        if (memcmp(record.data() - sizeof(unsigned int) - CMessageHeader::MESSAGE_START_SIZE, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+            return error("%s: Block magic mismatch for %s", __func__, pos.ToString());
+        }
+        block.assign(record.begin(), record.end());
+        return true;
+    }
+
+    FlatFilePos hpos(pos.nFile, pos.nPos - CMessageHeader::MESSAGE_START_SIZE - sizeof(unsigned int));
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blk_start;
+        unsigned int blk_size;
+        filein >> blk_start >> blk_size;
+        if (memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+            return error("%s: Block magic mismatch for %s", __func__, pos.ToString());
+        }
+        if (blk_size > MAX_SIZE) {
+            return error("%s: Block data is larger than maximum deserialization size for %s: %u > %u", __func__, pos.ToString(), blk_size, MAX_SIZE);
+        }
+        block.resize(blk_size);
+        filein.read((char*)block.data(), blk_size);
+    }
+    catch (const std::exception& e) {
+        return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
+    }
+
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start)
+{
+    FlatFilePos blockPos;
+    {
+        LOCK(cs_main);
+        blockPos = pindex->GetBlockPos();
+    }
+
+    return ReadRawBlockFromDisk(block, blockPos, message_start);
+}
+
 double ConvertBitsToDouble(unsigned int nBits)
 {
     int nShift = (nBits >> 24) & 0xff;
@@ -1506,29 +1634,30 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
     return true;
 }
 
-static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+static bool UndoWriteToDisk(const CDataStream& undo_data, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
     CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
     if (fileout.IsNull())
         return error("%s: OpenUndoFile failed", __func__);
 
-    // Write index header
-    unsigned int nSize = GetSerializeSize(fileout, blockundo);
-    fileout << messageStart << nSize;
-
-    // Write undo data
     long fileOutPos = ftell(fileout.Get());
     if (fileOutPos < 0)
         return error("%s: ftell failed", __func__);
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
 
-    // calculate & write checksum
+    // calculate checksum
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
     hasher << hashBlock;
-    hasher << blockundo;
-    fileout << hasher.GetHash();
+    hasher.write(undo_data.data(), undo_data.size());
+
+    // Write index header, undo data and checksum at once
+    CDataStream record(SER_DISK, CLIENT_VERSION);
+    record.reserve(undo_data.size() + 40);
+    record << messageStart << (unsigned int)undo_data.size();
+    pos.nPos = (unsigned int)fileOutPos + record.size();
+    record.write(undo_data.data(), undo_data.size());
+    record << hasher.GetHash();
+    fileout.write(record.data(), record.size());
 
     return true;
 }
@@ -1540,25 +1669,35 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
         return error("%s: no undo data available", __func__);
     }
 
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("%s: OpenUndoFile failed", __func__);
-
     // Read block
     uint256 hashChecksum;
-    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
-    try {
+    uint256 hashComputed;
+    auto read_undo = [&](auto& filein) {
+        CHashVerifier<std::remove_reference_t<decltype(filein)>> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
         verifier << pindex->pprev->GetBlockHash();
         verifier >> blockundo;
         filein >> hashChecksum;
+        hashComputed = verifier.GetHash();
+    };
+    try {
+        Span<const unsigned char> record;
+        if (const auto mapped = MapRecord(UndoFileSeq(), pos, sizeof(uint256), record)) {
+            SpanReader filein(SER_DISK, CLIENT_VERSION, record);
+            read_undo(filein);
+        } else {
+            // Open history file to read
+            CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+            if (filein.IsNull())
+                return error("%s: OpenUndoFile failed", __func__);
+            read_undo(filein);
+        }
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s", __func__, e.what());
     }
 
     // Verify checksum
-    if (hashChecksum != verifier.GetHash())
+    if (hashChecksum != hashComputed)
         return error("%s: Checksum mismatch", __func__);
 
     return true;
@@ -1620,7 +1759,7 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CBlockUndo* pblockundo)
 {
     AssertLockHeld(cs_main);
 
@@ -1635,11 +1774,12 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
 
     bool fClean = true;
 
-    CBlockUndo blockUndo;
-    if (!UndoReadFromDisk(blockUndo, pindex)) {
+    CBlockUndo blockUndoRead;
+    if (!pblockundo && !UndoReadFromDisk(blockUndoRead, pindex)) {
         error("DisconnectBlock(): failure reading undo data");
         return DISCONNECT_FAILED;
     }
+    CBlockUndo& blockUndo = pblockundo ? *pblockundo : blockUndoRead;
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
         error("DisconnectBlock(): block and undo data inconsistent");
@@ -1821,10 +1961,13 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
 {
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull()) {
+        // Serialize once, for both the size and the checksum
+        CDataStream undo_data(SER_DISK, CLIENT_VERSION);
+        undo_data << blockundo;
         FlatFilePos _pos;
-        if (!FindUndoPos(state, pindex->nFile, _pos, ::GetSerializeSize(blockundo, SER_DISK, CLIENT_VERSION) + 40))
+        if (!FindUndoPos(state, pindex->nFile, _pos, undo_data.size() + 40))
             return error("ConnectBlock(): FindUndoPos failed");
-        if (!UndoWriteToDisk(blockundo, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
+        if (!UndoWriteToDisk(undo_data, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
             return AbortNode(state, "Failed to write undo data");
         // rev files are written in block height order, whereas blk files are written as blocks come in (often out of order)
         // we want to flush the rev (undo) file once we've written the last block, which is indicated by the last height
@@ -1856,6 +1999,288 @@ void StopScriptCheckWorkerThreads()
     scriptcheckqueue.StopWorkerThreads();
 }
 
+/**
+ * Closure computing the PoW hash of one header ahead of AcceptBlockHeader.
+ * Hashes which pass CheckProofOfWork are stored in the PoW cache, so that the
+ * serial CheckPOW under cs_main finds them there. A header failing the PoW
+ * check fails the closure, so that the queue skips the rest of the batch.
+ * Rejecting headers is still left to the serial checks, which also take care
+ * of punishing the peer.
+ */
+class CPowCheck
+{
+private:
+    CBlockHeader header;
+    const Consensus::Params* consensusParams;
+
+public:
+    CPowCheck() : consensusParams(nullptr) {}
+    CPowCheck(const CBlockHeader& headerIn, const Consensus::Params& consensusParamsIn) :
+        header(headerIn), consensusParams(&consensusParamsIn) {}
+
+    bool operator()()
+    {
+        // Worker threads keep their CryptoNight scratchpad until they exit
+        static thread_local crypto::slow_hash_thread_guard slowHashGuard;
+
+        const uint256 hash = header.GetHash();
+        uint256 powHash;
+        if (powCache->Get(hash, powHash)) {
+            return true;
+        }
+        powHash = header.GetPOWHash();
+        if (!CheckProofOfWork(powHash, header.nBits, *consensusParams)) {
+            // Stops the queue from hashing the rest of the batch
+            return false;
+        }
+        powCache->Insert(hash, powHash);
+        return true;
+    }
+
+    void swap(CPowCheck& check)
+    {
+        std::swap(header, check.header);
+        std::swap(consensusParams, check.consensusParams);
+    }
+};
+
+static CCheckQueue<CPowCheck> powcheckqueue(16);
+
+void StartPowCheckWorkerThreads(int threads_num)
+{
+    powcheckqueue.StartWorkerThreads(threads_num, "powcheck");
+}
+
+void StopPowCheckWorkerThreads()
+{
+    powcheckqueue.StopWorkerThreads();
+}
+
+/**
+ * Closure running the context-free checks of one block ahead of AcceptBlock.
+ * Blocks which pass CheckBlock remember that in CBlock::fChecked, and their
+ * PoW hash is kept in the PoW cache. Always succeeds: rejecting blocks is left
+ * to the serial checks, so one invalid block doesn't stop the queue from
+ * checking the others.
+ */
+class CBlockCheck
+{
+private:
+    std::shared_ptr<const CBlock> block;
+    const Consensus::Params* consensusParams;
+
+public:
+    CBlockCheck() : consensusParams(nullptr) {}
+    CBlockCheck(const std::shared_ptr<const CBlock>& blockIn, const Consensus::Params& consensusParamsIn) :
+        block(blockIn), consensusParams(&consensusParamsIn) {}
+
+    bool operator()()
+    {
+        // Worker threads keep their CryptoNight scratchpad until they exit
+        static thread_local crypto::slow_hash_thread_guard slowHashGuard;
+
+        CValidationState state;
+        CheckBlock(*block, state, *consensusParams);
+        return true;
+    }
+
+    void swap(CBlockCheck& check)
+    {
+        std::swap(block, check.block);
+        std::swap(consensusParams, check.consensusParams);
+    }
+};
+
+static CCheckQueue<CBlockCheck> blockcheckqueue(16);
+
+void StartBlockCheckWorkerThreads(int threads_num)
+{
+    blockcheckqueue.StartWorkerThreads(threads_num, "blockcheck");
+}
+
+void StopBlockCheckWorkerThreads()
+{
+    blockcheckqueue.StopWorkerThreads();
+}
+
+/**
+ * Closure reading one coin from the coins database ahead of ConnectBlock.
+ * The caller holds cs_main while these run, so neither the database nor the
+ * cache change meanwhile. Read errors are left to the serial fetch in
+ * ConnectBlock, which goes through CCoinsViewErrorCatcher.
+ */
+class CCoinPrefetch
+{
+private:
+    const CCoinsView* view;
+    COutPoint outpoint;
+    Coin* coin;
+
+public:
+    CCoinPrefetch() : view(nullptr), coin(nullptr) {}
+    CCoinPrefetch(const CCoinsView& viewIn, const COutPoint& outpointIn, Coin& coinOut) :
+        view(&viewIn), outpoint(outpointIn), coin(&coinOut) {}
+
+    bool operator()()
+    {
+        try {
+            if (!view->GetCoin(outpoint, *coin)) {
+                coin->Clear();
+            }
+        } catch (const std::runtime_error&) {
+            coin->Clear();
+        }
+        return true;
+    }
+
+    void swap(CCoinPrefetch& check)
+    {
+        std::swap(view, check.view);
+        std::swap(outpoint, check.outpoint);
+        std::swap(coin, check.coin);
+    }
+};
+
+static CCheckQueue<CCoinPrefetch> prefetchqueue(32);
+
+void StartCoinPrefetchWorkerThreads(int threads_num)
+{
+    prefetchqueue.StartWorkerThreads(threads_num, "prefetch");
+}
+
+void StopCoinPrefetchWorkerThreads()
+{
+    prefetchqueue.StopWorkerThreads();
+}
+
+/**
+ * Closure reading the block and undo data of one block ahead of
+ * DisconnectBlock. A block which could not be read is left null, for the
+ * serial read in DisconnectTips to report.
+ */
+class CUndoPrefetch
+{
+private:
+    const CBlockIndex* pindex;
+    FlatFilePos blockPos;
+    CBlock* block;
+    CBlockUndo* blockundo;
+    const Consensus::Params* consensusParams;
+
+public:
+    CUndoPrefetch() : pindex(nullptr), block(nullptr), blockundo(nullptr), consensusParams(nullptr) {}
+    CUndoPrefetch(const CBlockIndex* pindexIn, CBlock& blockOut, CBlockUndo& blockundoOut, const Consensus::Params& consensusParamsIn) EXCLUSIVE_LOCKS_REQUIRED(cs_main) :
+        pindex(pindexIn), blockPos(pindexIn->GetBlockPos()), block(&blockOut), blockundo(&blockundoOut), consensusParams(&consensusParamsIn) {}
+
+    bool operator()()
+    {
+        // Reading a block checks its PoW
+        static thread_local crypto::slow_hash_thread_guard slowHashGuard;
+
+        if (!ReadBlockFromDisk(*block, blockPos, *consensusParams) || block->GetHash() != pindex->GetBlockHash() ||
+                !UndoReadFromDisk(*blockundo, pindex)) {
+            block->SetNull();
+        }
+        return true;
+    }
+
+    void swap(CUndoPrefetch& check)
+    {
+        std::swap(pindex, check.pindex);
+        std::swap(blockPos, check.blockPos);
+        std::swap(block, check.block);
+        std::swap(blockundo, check.blockundo);
+        std::swap(consensusParams, check.consensusParams);
+    }
+};
+
+// Every block is a large read, so hand them out one at a time
+static CCheckQueue<CUndoPrefetch> undoprefetchqueue(1);
+
+void StartUndoPrefetchWorkerThreads(int threads_num)
+{
+    undoprefetchqueue.StartWorkerThreads(threads_num, "undoprefetch");
+}
+
+void StopUndoPrefetchWorkerThreads()
+{
+    undoprefetchqueue.StopWorkerThreads();
+}
+
+/** Don't bother the prefetch threads for blocks with fewer missing inputs */
+static constexpr size_t MIN_PREFETCH_INPUTS = 16;
+
+/**
+ * Read the coins spent by block that are missing from cache from db in
+ * parallel, and add them to cache. ConnectBlock then finds all inputs
+ * in memory instead of doing one database read after another.
+ */
+static void PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& cache, const CCoinsView& db) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (!g_parallel_coin_prefetch) return;
+
+    // Outputs created by the block itself can't be in the database yet
+    std::unordered_set<uint256, StaticSaltedHasher> setBlockTxids;
+    setBlockTxids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        setBlockTxids.emplace(tx->GetHash());
+    }
+
+    std::vector<COutPoint> vOutpoints;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (!setBlockTxids.count(txin.prevout.hash) && !cache.HaveCoinInCache(txin.prevout)) {
+                vOutpoints.emplace_back(txin.prevout);
+            }
+        }
+    }
+    if (vOutpoints.size() < MIN_PREFETCH_INPUTS) return;
+
+    std::vector<Coin> vCoins(vOutpoints.size());
+    std::vector<CCoinPrefetch> vChecks;
+    vChecks.reserve(vOutpoints.size());
+    for (size_t i = 0; i < vOutpoints.size(); ++i) {
+        vChecks.emplace_back(db, vOutpoints[i], vCoins[i]);
+    }
+    CCheckQueueControl<CCoinPrefetch> control(&prefetchqueue);
+    control.Add(vChecks);
+    control.Wait();
+
+    size_t nFound = 0;
+    for (size_t i = 0; i < vOutpoints.size(); ++i) {
+        if (vCoins[i].IsSpent()) continue;
+        cache.AddFetchedCoin(vOutpoints[i], std::move(vCoins[i]));
+        ++nFound;
+    }
+    LogPrint(BCLog::BENCHMARK, "    - Prefetched %u of %u missing inputs\n", nFound, vOutpoints.size());
+}
+
+/**
+ * Read the blocks and undo data of vIndex, on the undo prefetch threads if
+ * they run. Blocks which could not be read are left null.
+ */
+static void ReadBlocksForDisconnect(const std::vector<CBlockIndex*>& vIndex, std::vector<std::shared_ptr<CBlock>>& vBlocks, std::vector<CBlockUndo>& vBlockUndo, const Consensus::Params& consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    vBlocks.clear();
+    vBlockUndo.assign(vIndex.size(), CBlockUndo());
+    std::vector<CUndoPrefetch> vChecks;
+    vChecks.reserve(vIndex.size());
+    for (size_t i = 0; i < vIndex.size(); ++i) {
+        vBlocks.push_back(std::make_shared<CBlock>());
+        vChecks.emplace_back(vIndex[i], *vBlocks[i], vBlockUndo[i], consensusParams);
+    }
+    if (!g_parallel_undo_prefetch || vChecks.size() == 1) {
+        for (CUndoPrefetch& check : vChecks) {
+            check();
+        }
+        return;
+    }
+    CCheckQueueControl<CUndoPrefetch> control(&undoprefetchqueue);
+    control.Add(vChecks);
+    control.Wait();
+}
+
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params, bool fCheckMasternodesUpgraded)
@@ -2141,7 +2566,12 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     bool fDIP0001Active_context = pindex->nHeight >= Params().GetConsensus().DIP0001Height;
 
     // MUST process special txes before updating UTXO to ensure consistency between mempool and block processing
-    if (!ProcessSpecialTxsInBlock(block, pindex, state, view, fJustCheck, fScriptChecks)) {
+    if (m_snapshot_history) {
+        if (!CheckSpecialTxsInMinedBlock(block, pindex, state, view)) {
+            return error("ConnectBlock(VKAX): CheckSpecialTxsInMinedBlock for block %s failed with %s",
+                         pindex->GetBlockHash().ToString(), FormatStateMessage(state));
+        }
+    } else if (!ProcessSpecialTxsInBlock(block, pindex, state, view, fJustCheck, fScriptChecks)) {
         return error("ConnectBlock(VKAX): ProcessSpecialTxsInBlock for block %s failed with %s",
                      pindex->GetBlockHash().ToString(), FormatStateMessage(state));
     }
@@ -2285,6 +2715,12 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
     LogPrint(BCLog::BENCHMARK, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
+    if (fScriptChecks && g_parallel_script_checks && !fJustCheck) {
+        // Let the script check threads work on this block while we get the
+        // next one ready. Nothing of it is committed, so there is nothing to
+        // undo if this block turns out to be invalid.
+        PrepareNextBlock(chainparams);
+    }
     if (!control.Wait())
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
@@ -2301,7 +2737,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     // VKAX : CHECK TRANSACTIONS FOR INSTANTSEND
 
-    if (llmq::RejectConflictingBlocks()) {
+    // InstantSend locks are only known around the current tip, not for the history of a snapshot
+    if (!m_snapshot_history && llmq::RejectConflictingBlocks()) {
         // Require other nodes to comply, send them some data in case they are missing it.
         for (const auto& tx : block.vtx) {
             // skip txes that have no inputs
@@ -2333,7 +2770,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     int64_t nTime5_2 = GetTimeMicros(); nTimeSubsidy += nTime5_2 - nTime5_1;
     LogPrint(BCLog::BENCHMARK, "      - GetBlockSubsidy: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime5_2 - nTime5_1), nTimeSubsidy * MICRO, nTimeSubsidy * MILLI / nBlocksTotal);
 
-    if (!IsBlockValueValid(block, pindex->nHeight, blockReward, strError)) {
+    if (!IsBlockValueValid(block, pindex->nHeight, blockReward, strError, !m_snapshot_history)) {
         return state.DoS(0, error("ConnectBlock(VKAX): %s", strError), REJECT_INVALID, "bad-cb-amount");
     }
 
@@ -2425,6 +2862,8 @@ CoinsCacheSizeState CChainState::GetCoinsCacheSizeState(
         max_coins_cache_size_bytes + std::max<int64_t>(max_mempool_size_bytes - nMempoolUsage, 0);
 
     cacheSize += evoDb->GetMemoryUsage();
+    // Coins handed to the background writer are still held in memory
+    cacheSize += CoinsDB().PendingMemoryUsage();
 
     //! No need to periodic flush if at least this much space still available.
     static constexpr int64_t MAX_BLOCK_COINSDB_USAGE_BYTES = 10 * 1024 * 1024;  // 10MB
@@ -2460,6 +2899,7 @@ bool CChainState::FlushStateToDisk(
     {
         bool fFlushForPrune = false;
         bool fDoFullFlush = false;
+        bool fPartialFlush = false;
         CoinsCacheSizeState cache_state = GetCoinsCacheSizeState(::mempool);
         LOCK(cs_LastBlockFile);
         if (fPruneMode && (fCheckForPruning || nManualPruneHeight > 0) && !fReindex) {
@@ -2499,6 +2939,9 @@ bool CChainState::FlushStateToDisk(
         bool fPeriodicFlush = mode == FlushStateMode::PERIODIC && nNow > nLastFlush + DATABASE_FLUSH_INTERVAL;
         // Combine all conditions that result in a full cache flush.
         fDoFullFlush = (mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
+        // With -partialflush, a flush caused by the cache size or age writes the dirty coins
+        // in the background and keeps the cache warm. Explicit flushes and pruning still drop it.
+        fPartialFlush = fDoFullFlush && mode != FlushStateMode::ALWAYS && !fFlushForPrune && gArgs.GetBoolArg("-partialflush", DEFAULT_PARTIAL_FLUSH);
         // Write blocks and block index to disk.
         if (fDoFullFlush || fPeriodicWrite) {
             // Depend on nMinDiskSpace to ensure we can write block index
@@ -2555,8 +2998,18 @@ bool CChainState::FlushStateToDisk(
                 return AbortNode(state, "Disk space is too low!", _("Disk space is too low!"));
             }
             // Flush the chainstate (which may refer to block index entries).
-            if (!CoinsTip().Flush())
+            if (fPartialFlush) {
+                if (!CoinsTip().Sync())
+                    return AbortNode(state, "Failed to write to coin database");
+                if (fCacheLarge || fCacheCritical) {
+                    // Make room for about half the coins cache budget worth of new coins,
+                    // counting the copy that is being written in the background
+                    const size_t pending_usage = CoinsDB().PendingMemoryUsage();
+                    CoinsTip().TrimCache(nCoinCacheUsage / 2 - std::min(nCoinCacheUsage / 2, pending_usage));
+                }
+            } else if (!CoinsTip().Flush()) {
                 return AbortNode(state, "Failed to write to coin database");
+            }
             if (!evoDb->CommitRootTransaction()) {
                 return AbortNode(state, "Failed to commit EvoDB");
             }
@@ -2678,26 +3131,35 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
     assert(pindexDelete);
     // Read block from disk.
     std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-    CBlock& block = *pblock;
-    if (!ReadBlockFromDisk(block, pindexDelete, chainparams.GetConsensus()))
+    if (!ReadBlockFromDisk(*pblock, pindexDelete, chainparams.GetConsensus()))
         return error("DisconnectTip(): Failed to read block");
+    if (!DisconnectTipOnView(state, chainparams, pblock, nullptr, CoinsTip(), disconnectpool))
+        return false;
+    // Write the chain state to disk, if necessary.
+    return FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED);
+}
+
+bool CChainState::DisconnectTipOnView(CValidationState& state, const CChainParams& chainparams, const std::shared_ptr<CBlock>& pblock, CBlockUndo* blockundo, CCoinsViewCache& view, DisconnectedBlockTransactions* disconnectpool)
+{
+    AssertLockHeld(cs_main);
+
+    CBlockIndex *pindexDelete = m_chain.Tip();
+    assert(pindexDelete);
+    const CBlock& block = *pblock;
     // Apply the block atomically to the chain state.
     int64_t nStart = GetTimeMicros();
     {
         auto dbTx = evoDb->BeginTransaction();
 
-        CCoinsViewCache view(&CoinsTip());
-        assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
-        if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
+        CCoinsViewCache viewBlock(&view);
+        assert(viewBlock.GetBestBlock() == pindexDelete->GetBlockHash());
+        if (DisconnectBlock(block, pindexDelete, viewBlock, blockundo) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
-        bool flushed = view.Flush();
+        bool flushed = viewBlock.Flush();
         assert(flushed);
         dbTx->Commit();
     }
     LogPrint(BCLog::BENCHMARK, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * MILLI);
-    // Write the chain state to disk, if necessary.
-    if (!FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED))
-        return false;
 
     if (disconnectpool) {
         // Save transactions to re-add to mempool at end of reorg
@@ -2721,8 +3183,68 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
     return true;
 }
 
+/** Blocks DisconnectTips reads ahead and disconnects on one coins view before it is applied to CoinsTip() */
+static constexpr size_t MAX_DISCONNECT_BATCH_BLOCKS = 16;
+
+/**
+ * Disconnect m_chain's tip until pindexFork, see DisconnectTip.
+ * Blocks are handled in batches: the block and undo data of a batch are read
+ * at once, in parallel if possible, and the batch is disconnected on a view
+ * of its own. Coins that one block of the batch restores and an earlier one
+ * removes again then never reach CoinsTip(), which only gets the net result.
+ */
+bool CChainState::DisconnectTips(CValidationState& state, const CChainParams& chainparams, const CBlockIndex* pindexFork, DisconnectedBlockTransactions& disconnectpool)
+{
+    AssertLockHeld(cs_main);
+
+    std::vector<CBlockIndex*> vIndex;
+    std::vector<std::shared_ptr<CBlock>> vBlocks;
+    std::vector<CBlockUndo> vBlockUndo;
+    while (m_chain.Tip() && m_chain.Tip() != pindexFork) {
+        vIndex.clear();
+        for (CBlockIndex* pindex = m_chain.Tip(); pindex && pindex != pindexFork && vIndex.size() < MAX_DISCONNECT_BATCH_BLOCKS; pindex = pindex->pprev) {
+            vIndex.push_back(pindex);
+        }
+        int64_t nStart = GetTimeMicros();
+        ReadBlocksForDisconnect(vIndex, vBlocks, vBlockUndo, chainparams.GetConsensus());
+        LogPrint(BCLog::BENCHMARK, "- Read %u blocks to disconnect: %.2fms\n", vIndex.size(), (GetTimeMicros() - nStart) * MILLI);
+
+        // The view only ever holds fully disconnected blocks, so it is applied even if one fails
+        bool fDisconnected = true;
+        CCoinsViewCache view(&CoinsTip());
+        for (size_t i = 0; i < vIndex.size(); ++i) {
+            CBlockUndo* blockundo = &vBlockUndo[i];
+            if (vBlocks[i]->IsNull()) {
+                // Read again to report the error
+                blockundo = nullptr;
+                if (!ReadBlockFromDisk(*vBlocks[i], vIndex[i], chainparams.GetConsensus())) {
+                    fDisconnected = error("DisconnectTip(): Failed to read block");
+                    break;
+                }
+            }
+            if (!DisconnectTipOnView(state, chainparams, vBlocks[i], blockundo, view, &disconnectpool)) {
+                fDisconnected = false;
+                break;
+            }
+        }
+        nStart = GetTimeMicros();
+        bool flushed = view.Flush();
+        assert(flushed);
+        LogPrint(BCLog::BENCHMARK, "- Apply disconnected coins: %.2fms\n", (GetTimeMicros() - nStart) * MILLI);
+        if (!fDisconnected) {
+            return false;
+        }
+
+        // Write the chain state to disk, if necessary.
+        if (!FlushStateToDisk(chainparams, state, FlushStateMode::IF_NEEDED))
+            return false;
+    }
+    return true;
+}
+
 static int64_t nTimeReadFromDisk = 0;
 static int64_t nTimeConnectTotal = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
@@ -2789,6 +3311,27 @@ public:
     }
 };
 
+void CChainState::PrepareNextBlock(const CChainParams& chainparams)
+{
+    const CBlockIndex* pindex = m_next_block_index;
+    std::shared_ptr<const CBlock> pblock = std::move(m_next_block);
+    m_next_block_index = nullptr;
+    m_next_block.reset();
+    if (!pindex) return;
+
+    if (!pblock) {
+        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
+        // Read errors are reported by the ConnectTip of that block
+        if (!ReadBlockFromDisk(*pblockNew, pindex, chainparams.GetConsensus())) return;
+        pblock = pblockNew;
+    }
+    // Caches a positive result in the block, failures are left to its ConnectBlock
+    CValidationState dummy;
+    CheckBlock(*pblock, dummy, chainparams.GetConsensus());
+    PrefetchBlockInputs(*pblock, CoinsTip(), CoinsDB());
+    m_prepared_block = std::move(pblock);
+}
+
 /**
  * Connect a new block to m_chain. pblock is either nullptr or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
@@ -2802,7 +3345,9 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
-    if (!pblock) {
+    if (!pblock && m_prepared_block && m_prepared_block->GetHash() == pindexNew->GetBlockHash()) {
+        pthisBlock = m_prepared_block;
+    } else if (!pblock) {
         std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
         if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
             return AbortNode(state, "Failed to read block");
@@ -2811,15 +3356,22 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
         pthisBlock = pblock;
     }
     const CBlock& blockConnecting = *pthisBlock;
-    // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCHMARK, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    PrefetchBlockInputs(blockConnecting, CoinsTip(), CoinsDB());
+    int64_t nTime2b = GetTimeMicros(); nTimePrefetch += nTime2b - nTime2;
+    LogPrint(BCLog::BENCHMARK, "  - Prefetch inputs: %.2fms [%.2fs]\n", (nTime2b - nTime2) * MILLI, nTimePrefetch * MICRO);
+    nTime2 = nTime2b;
+    // Apply the block atomically to the chain state.
     {
         auto dbTx = evoDb->BeginTransaction();
 
         CCoinsViewCache view(&CoinsTip());
+        m_prepared_block.reset();
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
+        m_next_block_index = nullptr;
+        m_next_block.reset();
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -2874,6 +3426,13 @@ CBlockIndex* CChainState::FindMostWorkChain() {
             pindexNew = *it;
         }
 
+        // A chainstate loaded from a snapshot has no undo data for the snapshot base
+        // and its ancestors, so it can't reorganize to a chain that forks off below it.
+        if (pindexSnapshotBase && pindexNew->GetAncestor(pindexSnapshotBase->nHeight) != pindexSnapshotBase) {
+            setBlockIndexCandidates.erase(pindexNew);
+            continue;
+        }
+
         // Check whether all blocks on the path between the currently active chain and the candidate are valid.
         // Just going until the active chain is an optimization, as we know all blocks in it are valid already.
         CBlockIndex *pindexTest = pindexNew;
@@ -2949,8 +3508,8 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
     // Disconnect active blocks which are no longer in the best chain.
     bool fBlocksDisconnected = false;
     DisconnectedBlockTransactions disconnectpool;
-    while (m_chain.Tip() && m_chain.Tip() != pindexFork) {
-        if (!DisconnectTip(state, chainparams, &disconnectpool)) {
+    if (m_chain.Tip() && m_chain.Tip() != pindexFork) {
+        if (!DisconnectTips(state, chainparams, pindexFork, disconnectpool)) {
             // This is likely a fatal error, but keep the mempool consistent,
             // just in case. Only remove from the mempool in this case.
             UpdateMempoolForReorg(disconnectpool, false);
@@ -2983,6 +3542,10 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
 
         // Connect new blocks.
         for (CBlockIndex *pindexConnect : reverse_iterate(vpindexToConnect)) {
+            if (pindexConnect != pindexMostWork) {
+                m_next_block_index = pindexMostWork->GetAncestor(pindexConnect->nHeight + 1);
+                if (m_next_block_index == pindexMostWork) m_next_block = pblock;
+            }
             if (!ConnectTip(state, chainparams, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
@@ -3207,6 +3770,11 @@ bool CChainState::InvalidateBlock(CValidationState& state, const CChainParams& c
     assert(pindex);
     if (pindex->nHeight == 0) return false;
 
+    // Neither can the blocks up to the base of a snapshot, they can't be disconnected
+    if (WITH_LOCK(cs_main, return pindexSnapshotBase && pindexSnapshotBase->GetAncestor(pindex->nHeight) == pindex)) {
+        return state.Error("cannot invalidate a block before the snapshot base");
+    }
+
     CBlockIndex* to_mark_failed = pindex;
     bool pindex_was_in_chain = false;
     int disconnected = 0;
@@ -3997,8 +4565,12 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState
             return state.DoS(10, error("%s: header %s conflicts with chainlock", __func__, hash.ToString()), REJECT_INVALID, "bad-chainlock");
         }
     }
-    if (pindex == nullptr)
+    if (pindex == nullptr) {
         pindex = AddToBlockIndex(block);
+        if (powCache) {
+            powCache->Persist(hash);
+        }
+    }
 
     if (ppindex)
         *ppindex = pindex;
@@ -4009,25 +4581,62 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, CValidationState
     return true;
 }
 
+static bool AcceptBlockHeaders(std::vector<CBlockHeader>::const_iterator begin, std::vector<CBlockHeader>::const_iterator end, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    for (auto it = begin; it != end; ++it) {
+        CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
+        bool accepted = g_blockman.AcceptBlockHeader(*it, state, chainparams, &pindex);
+        ::ChainstateActive().CheckBlockIndex(chainparams.GetConsensus());
+
+        if (!accepted) {
+            if (first_invalid) *first_invalid = *it;
+            return false;
+        }
+        if (ppindex) {
+            *ppindex = pindex;
+        }
+    }
+    return true;
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
-    {
-        LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
-            CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            bool accepted = g_blockman.AcceptBlockHeader(header, state, chainparams, &pindex);
-            ::ChainstateActive().CheckBlockIndex(chainparams.GetConsensus());
-
-            if (!accepted) {
-                if (first_invalid) *first_invalid = header;
+    if (powCache && g_parallel_pow_checks && headers.size() > 1) {
+        // Accept the first header serially, so that a batch which doesn't
+        // connect to a known block or fails its checks costs a single hash.
+        // Then compute the PoW hashes of the rest of the batch on the worker
+        // threads without holding cs_main. AcceptBlockHeader finds them in
+        // the PoW cache and only has to do the contextual checks.
+        std::vector<CPowCheck> vChecks;
+        {
+            LOCK(cs_main);
+            if (!AcceptBlockHeaders(headers.begin(), headers.begin() + 1, state, chainparams, ppindex, first_invalid)) {
                 return false;
             }
-            if (ppindex) {
-                *ppindex = pindex;
+            vChecks.reserve(headers.size() - 1);
+            for (auto it = headers.begin() + 1; it != headers.end(); ++it) {
+                if (!LookupBlockIndex(it->GetHash())) {
+                    vChecks.emplace_back(*it, chainparams.GetConsensus());
+                }
             }
         }
+        if (!vChecks.empty()) {
+            // The result is ignored, the serial pass below finds the header which failed
+            CCheckQueueControl<CPowCheck> control(&powcheckqueue);
+            control.Add(vChecks);
+            control.Wait();
+        }
+        LOCK(cs_main);
+        if (!AcceptBlockHeaders(headers.begin() + 1, headers.end(), state, chainparams, ppindex, first_invalid)) {
+            return false;
+        }
+    } else {
+        LOCK(cs_main);
+        if (!AcceptBlockHeaders(headers.begin(), headers.end(), state, chainparams, ppindex, first_invalid)) {
+            return false;
+        }
     }
     if (NotifyHeaderTip()) {
         if (::ChainstateActive().IsInitialBlockDownload() && ppindex && *ppindex) {
@@ -4107,9 +4716,14 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
         if (pindex->nChainWork < nMinimumChainWork) return true;
     }
 
+    // Blocks up to a snapshot base are part of the active chain already, they are only
+    // stored for the background validation of the snapshot. A bad copy of one is not held
+    // against the block, which is checked against the snapshot and its header's PoW there.
+    const bool fSnapshotHistory = pindexSnapshotBase && pindexSnapshotBase->GetAncestor(pindex->nHeight) == pindex;
+
     if (!CheckBlock(block, state, chainparams.GetConsensus()) ||
         !ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindex->pprev)) {
-        if (state.IsInvalid() && !state.CorruptionPossible()) {
+        if (state.IsInvalid() && !state.CorruptionPossible() && !fSnapshotHistory) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
             setDirtyBlockIndex.insert(pindex);
         }
@@ -4129,7 +4743,15 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
             state.Error(strprintf("%s: Failed to find position to write new block to disk", __func__));
             return false;
         }
-        ReceivedBlockTransactions(block, pindex, blockPos);
+        if (fSnapshotHistory) {
+            // Its transaction counts came with the snapshot and it is no candidate for the tip
+            pindex->nFile = blockPos.nFile;
+            pindex->nDataPos = blockPos.nPos;
+            pindex->nStatus |= BLOCK_HAVE_DATA;
+            setDirtyBlockIndex.insert(pindex);
+        } else {
+            ReceivedBlockTransactions(block, pindex, blockPos);
+        }
     } catch (const std::runtime_error& e) {
         return AbortNode(state, std::string("System error: ") + e.what());
     }
@@ -4272,6 +4894,8 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
+        BlockFileSeq().Unmap(pos);
+        UndoFileSeq().Unmap(pos);
         fs::remove(BlockFileSeq().FileName(pos));
         fs::remove(UndoFileSeq().FileName(pos));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -4289,6 +4913,10 @@ static void FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPr
 
     // last block to prune is the lesser of (user-specified height, MIN_BLOCKS_TO_KEEP from the tip)
     unsigned int nLastBlockWeCanPrune = std::min((unsigned)nManualPruneHeight, ::ChainActive().Tip()->nHeight - MIN_BLOCKS_TO_KEEP);
+    // and the blocks of a snapshot history that were not validated yet
+    if (const CBlockIndex* pindexHistoryTip = GetSnapshotHistoryTip()) {
+        nLastBlockWeCanPrune = std::min(nLastBlockWeCanPrune, (unsigned)pindexHistoryTip->nHeight);
+    }
     int count=0;
     for (int fileNumber = 0; fileNumber < nLastBlockFile; fileNumber++) {
         if (vinfoBlockFile[fileNumber].nSize == 0 || vinfoBlockFile[fileNumber].nHeightLast > nLastBlockWeCanPrune)
@@ -4337,6 +4965,10 @@ static void FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPruneAfte
     }
 
     unsigned int nLastBlockWeCanPrune = ::ChainActive().Tip()->nHeight - MIN_BLOCKS_TO_KEEP;
+    // Blocks of a snapshot history are kept until they were validated in the background
+    if (const CBlockIndex* pindexHistoryTip = GetSnapshotHistoryTip()) {
+        nLastBlockWeCanPrune = std::min(nLastBlockWeCanPrune, (unsigned)pindexHistoryTip->nHeight);
+    }
     uint64_t nCurrentUsage = CalculateCurrentUsage();
     // We don't check to prune until after we've allocated new space for files
     // So we should leave a buffer under our target to account for another allocation
@@ -4544,6 +5176,16 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_RE
     if (fHavePruned)
         LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
 
+    // Check whether the chainstate was loaded from a snapshot
+    uint256 hashSnapshotBase;
+    if (pblocktree->ReadSnapshotBase(hashSnapshotBase)) {
+        pindexSnapshotBase = LookupBlockIndex(hashSnapshotBase);
+        if (!pindexSnapshotBase)
+            return error("%s: snapshot base block %s not found", __func__, hashSnapshotBase.ToString());
+        LogPrintf("LoadBlockIndexDB(): Chainstate was loaded from a snapshot at height %d\n", pindexSnapshotBase->nHeight);
+        pblocktree->ReadFlag("snapshothistoryvalid", fSnapshotHistoryValidated);
+    }
+
     // Check whether we need to continue reindexing
     bool fReindexing = false;
     pblocktree->ReadReindexing(fReindexing);
@@ -4634,7 +5276,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         uiInterface.ShowProgress(_("Verifying blocks...").translated, percentageDone, false);
         if (pindex->nHeight <= ::ChainActive().Height()-nCheckDepth)
             break;
-        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+        if ((fPruneMode || fHavePruned) && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
             // If pruning, only go back as far as we have data.
             LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
             break;
@@ -4834,6 +5476,8 @@ void UnloadBlockIndex()
         warningcache[b].clear();
     }
     fHavePruned = false;
+    pindexSnapshotBase = nullptr;
+    fSnapshotHistoryValidated = false;
 
     ::ChainstateActive().UnloadBlockIndex();
 }
@@ -4920,6 +5564,437 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return ::ChainstateActive().LoadGenesisBlock(chainparams);
 }
 
+/** Size of the coins cache and evodb batches written while a snapshot is loaded */
+static constexpr size_t SNAPSHOT_LOAD_BATCH_SIZE = 16 << 20;
+
+bool CChainState::LoadSnapshot(const CChainParams& chainparams, const fs::path& path, const uint256& expected_hash)
+{
+    // The snapshot is trusted as a whole through its hash, so neither the PoW of
+    // its headers nor the history behind its coins and evodb state is checked
+    // here, see StartSnapshotHistoryValidation for that. The file is hashed
+    // while it is read, it is only accepted at the end.
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        return error("%s: unable to open snapshot file %s", __func__, path.string());
+    }
+    CHashVerifier<CAutoFile> verifier(&file);
+
+    LOCK(cs_main);
+    const CBlockIndex* pindexGenesis = LookupBlockIndex(chainparams.GetConsensus().hashGenesisBlock);
+    const CBlockIndex* pindexBest = LookupBlockIndex(CoinsTip().GetBestBlock());
+    if (!pindexGenesis || (!CoinsTip().GetBestBlock().IsNull() &&
+            (!pindexBest || (pindexBest != pindexGenesis && pindexBest->GetBlockHash() != chainparams.GetConsensus().hashDevnetGenesisBlock)))) {
+        return error("%s: a snapshot can only be loaded into an empty chainstate", __func__);
+    }
+
+    try {
+        SnapshotMetadata metadata;
+        verifier >> metadata;
+        if (metadata.nVersion != SNAPSHOT_VERSION) {
+            return error("%s: unsupported snapshot version %d", __func__, metadata.nVersion);
+        }
+        if (memcmp(metadata.pchMessageStart, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0) {
+            return error("%s: snapshot was created on another network", __func__);
+        }
+        if (metadata.base_height <= 0) {
+            return error("%s: invalid snapshot base height %d", __func__, metadata.base_height);
+        }
+        uint256 hashExpected = expected_hash;
+        if (hashExpected.IsNull()) {
+            const auto it = chainparams.SnapshotHashes().find(metadata.base_height);
+            if (it == chainparams.SnapshotHashes().end()) {
+                return error("%s: no known snapshot at height %d", __func__, metadata.base_height);
+            }
+            hashExpected = it->second;
+        }
+        LogPrintf("Loading snapshot of block %s at height %d (%u coins, %u evodb entries)\n",
+            metadata.base_blockhash.ToString(), metadata.base_height, metadata.coins_count, metadata.evodb_count);
+
+        pblocktree->WriteFlag("snapshotloading", true);
+
+        // Connect the snapshot headers to our genesis block
+        CBlockIndex* pindex = const_cast<CBlockIndex*>(pindexGenesis);
+        const MapCheckpoints& checkpoints = chainparams.Checkpoints().mapCheckpoints;
+        for (int nHeight = 1; nHeight <= metadata.base_height; nHeight++) {
+            CBlockHeader header;
+            verifier >> header;
+            if (header.hashPrevBlock != pindex->GetBlockHash()) {
+                return error("%s: snapshot header at height %d does not connect", __func__, nHeight);
+            }
+            const auto it = checkpoints.find(nHeight);
+            if (it != checkpoints.end() && it->second != header.GetHash()) {
+                return error("%s: snapshot header at height %d does not match checkpoint", __func__, nHeight);
+            }
+            pindex = m_blockman.AddToBlockIndex(header);
+            if (pindex->nStatus & BLOCK_FAILED_MASK) {
+                return error("%s: snapshot contains invalid block %s", __func__, pindex->GetBlockHash().ToString());
+            }
+        }
+        CBlockIndex* pindexBase = pindex;
+        if (pindexBase->GetBlockHash() != metadata.base_blockhash) {
+            return error("%s: snapshot headers do not lead to its base block", __func__);
+        }
+
+        // Coins
+        CCoinsViewCache& coins = CoinsTip();
+        coins.SetBestBlock(metadata.base_blockhash);
+        for (uint64_t i = 0; i < metadata.coins_count; i++) {
+            COutPoint outpoint;
+            Coin coin;
+            verifier >> outpoint >> coin;
+            if (coin.nHeight > (uint32_t)metadata.base_height || coin.IsSpent()) {
+                return error("%s: invalid coin %s in snapshot", __func__, outpoint.ToString());
+            }
+            coins.AddCoin(outpoint, std::move(coin), false);
+            if (coins.DynamicMemoryUsage() > std::max<size_t>(nCoinCacheUsage, SNAPSHOT_LOAD_BATCH_SIZE) && !coins.Flush()) {
+                return error("%s: failed to write coins", __func__);
+            }
+            if (ShutdownRequested()) {
+                return false;
+            }
+        }
+        if (!coins.Flush()) {
+            return error("%s: failed to write coins", __func__);
+        }
+        // The UTXO set the background validation of the history has to arrive at
+        CCoinsStats stats;
+        if (!GetUTXOStats(&CoinsDB(), stats)) {
+            return error("%s: failed to hash coins", __func__);
+        }
+
+        // Masternode lists and LLMQ state, replacing whatever evodb holds for the genesis block
+        CDBWrapper& evodb = evoDb->GetRawDB();
+        {
+            CDBBatch batch(evodb);
+            std::unique_ptr<CDBIterator> it(evodb.NewIterator());
+            for (it->SeekToFirst(); it->Valid(); it->Next()) {
+                SnapshotRawData key;
+                if (!it->GetKey(key)) {
+                    return error("%s: failed to read evodb", __func__);
+                }
+                batch.Erase(key);
+            }
+            evodb.WriteBatch(batch);
+        }
+        CDBBatch batch(evodb);
+        for (uint64_t i = 0; i < metadata.evodb_count; i++) {
+            SnapshotRawData key, value;
+            verifier >> key.data >> value.data;
+            batch.Write(key, value);
+            if (batch.SizeEstimate() > SNAPSHOT_LOAD_BATCH_SIZE) {
+                evodb.WriteBatch(batch);
+                batch.Clear();
+            }
+        }
+        evodb.WriteBatch(batch, true);
+        if (fgetc(file.Get()) != EOF) {
+            return error("%s: unexpected data at the end of the snapshot", __func__);
+        }
+        // The coins and evodb entries written so far stay behind the "snapshotloading"
+        // flag, which makes the next start ask for -reindex
+        const uint256 hash = verifier.GetHash();
+        if (hash != hashExpected) {
+            return error("%s: snapshot file %s has hash %s, expected %s", __func__, path.string(), hash.ToString(), hashExpected.ToString());
+        }
+
+        // Mark the blocks up to the base as validated and pruned. Blocks we don't know
+        // the transaction count of are counted as one transaction, the base block
+        // accounts for the rest so that its nChainTx matches the snapshot.
+        std::vector<CBlockIndex*> vBlocks;
+        for (pindex = pindexBase; pindex->pprev; pindex = pindex->pprev) {
+            vBlocks.push_back(pindex);
+        }
+        std::reverse(vBlocks.begin(), vBlocks.end());
+        for (CBlockIndex* pindexBlock : vBlocks) {
+            if (pindexBlock->nTx == 0) {
+                pindexBlock->nTx = 1;
+                if (pindexBlock == pindexBase && metadata.base_chain_tx > pindexBlock->pprev->nChainTx) {
+                    pindexBlock->nTx = metadata.base_chain_tx - pindexBlock->pprev->nChainTx;
+                }
+            }
+            pindexBlock->nChainTx = pindexBlock->pprev->nChainTx + pindexBlock->nTx;
+            pindexBlock->RaiseValidity(BLOCK_VALID_SCRIPTS);
+            setDirtyBlockIndex.erase(pindexBlock);
+        }
+        if (!pblocktree->WriteBatchSync({}, nLastBlockFile, std::vector<const CBlockIndex*>(vBlocks.begin(), vBlocks.end()))) {
+            return error("%s: failed to write block index", __func__);
+        }
+        setBlockIndexCandidates.insert(pindexBase);
+
+        fHavePruned = true;
+        pindexSnapshotBase = pindexBase;
+        fSnapshotHistoryValidated = false;
+        if (!pblocktree->WriteFlag("prunedblockfiles", true) || !pblocktree->WriteSnapshotBase(pindexBase->GetBlockHash()) ||
+                !pblocktree->WriteSnapshotCoinsHash(stats.hashSerialized) || !pblocktree->WriteFlag("snapshothistoryvalid", false) ||
+                !pblocktree->WriteFlag("snapshotloading", false)) {
+            return error("%s: failed to write block index", __func__);
+        }
+    } catch (const std::exception& e) {
+        return error("%s: failed to load snapshot: %s", __func__, e.what());
+    }
+
+    LogPrintf("Loaded snapshot, chainstate is at block %s\n", pindexSnapshotBase->GetBlockHash().ToString());
+    return true;
+}
+
+/** Name of the coins database of the chainstate that validates the history of a snapshot */
+static const char* const SNAPSHOT_HISTORY_DB_NAME = "chainstate_history";
+/** Database cache of that chainstate */
+static constexpr size_t SNAPSHOT_HISTORY_DB_CACHE = 8 << 20;
+/** Coins cache of that chainstate, it is flushed when it grows larger */
+static constexpr size_t SNAPSHOT_HISTORY_COINS_CACHE = 64 << 20;
+/** Headers of a snapshot whose PoW hashes are computed on the PoW check threads at once */
+static constexpr size_t SNAPSHOT_HEADERS_BATCH_SIZE = 2000;
+
+/**
+ * Chainstate replaying the blocks up to the snapshot base on top of its own coins database.
+ * Its tip is the last block that was validated, blocks after it are downloaded by
+ * net_processing, see GetSnapshotHistoryTip.
+ */
+static std::unique_ptr<CChainState> g_snapshot_history GUARDED_BY(cs_main);
+static std::thread g_snapshot_history_thread;
+static CThreadInterrupt g_snapshot_history_interrupt;
+
+const CBlockIndex* GetSnapshotHistoryTip()
+{
+    AssertLockHeld(cs_main);
+    return g_snapshot_history ? g_snapshot_history->m_chain.Tip() : nullptr;
+}
+
+/** The chainstate was loaded from an invalid snapshot, refuse to use it until it is rebuilt */
+static void InvalidSnapshotFound(const std::string& strMessage)
+{
+    WITH_LOCK(cs_main, pblocktree->WriteFlag("snapshotinvalid", true));
+    AbortNode(strMessage, _("The snapshot the chainstate was loaded from is invalid. You need to rebuild the database using -reindex"));
+}
+
+/**
+ * Check the headers up to the snapshot base as AcceptBlockHeader would have. LoadSnapshot
+ * only links them and compares them with the checkpoints, hashing all of them would delay
+ * the start of the node by hours. Returns false with a valid state when interrupted.
+ */
+static bool CheckSnapshotHeaders(const CChainParams& chainparams, CValidationState& state)
+{
+    const Consensus::Params& consensusParams = chainparams.GetConsensus();
+
+    std::vector<const CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* pindex = pindexSnapshotBase; pindex->pprev; pindex = pindex->pprev) {
+            vIndex.push_back(pindex);
+        }
+    }
+    std::reverse(vIndex.begin(), vIndex.end());
+
+    for (size_t i = 0; i < vIndex.size(); i += SNAPSHOT_HEADERS_BATCH_SIZE) {
+        const size_t nEnd = std::min(vIndex.size(), i + SNAPSHOT_HEADERS_BATCH_SIZE);
+        if (powCache && g_parallel_pow_checks) {
+            // The result is ignored, the serial pass below finds the header which failed
+            std::vector<CPowCheck> vChecks;
+            vChecks.reserve(nEnd - i);
+            for (size_t j = i; j < nEnd; j++) {
+                vChecks.emplace_back(vIndex[j]->GetBlockHeader(), consensusParams);
+            }
+            CCheckQueueControl<CPowCheck> control(&powcheckqueue);
+            control.Add(vChecks);
+            control.Wait();
+        }
+        for (size_t j = i; j < nEnd; j++) {
+            const CBlockIndex* pindex = vIndex[j];
+            const CBlockHeader header = pindex->GetBlockHeader();
+            if (!CheckBlockHeader(header, state, consensusParams)) {
+                return error("%s: header %s at height %d: %s", __func__, pindex->GetBlockHash().ToString(), pindex->nHeight, FormatStateMessage(state));
+            }
+            if (header.GetBlockTime() <= pindex->pprev->GetMedianTimePast()) {
+                return state.Invalid(error("%s: header %s at height %d has a timestamp before the median time past", __func__, pindex->GetBlockHash().ToString(), pindex->nHeight),
+                                     REJECT_INVALID, "time-too-old");
+            }
+            if (powCache) {
+                powCache->Persist(header.GetHash());
+            }
+        }
+        if (g_snapshot_history_interrupt) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Validate the next block of a snapshot history and connect it to the history chainstate */
+static bool ConnectSnapshotHistoryBlock(CChainState& chainstate, const CBlock& block, CBlockIndex* pindex, const CChainParams& chainparams, CValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    assert(chainstate.m_snapshot_history && pindex->pprev == chainstate.m_chain.Tip());
+
+    // ConnectBlock with fJustCheck skips the PoW and merkle root checks
+    if (!CheckBlock(block, state, chainparams.GetConsensus()) ||
+        !ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindex->pprev)) {
+        return error("%s: %s", __func__, FormatStateMessage(state));
+    }
+    // fJustCheck leaves the block index, undo data and evodb alone, the snapshot came with all of them
+    CCoinsViewCache& coins = chainstate.CoinsTip();
+    if (!chainstate.ConnectBlock(block, state, pindex, coins, chainparams, true)) {
+        return false;
+    }
+    coins.SetBestBlock(pindex->GetBlockHash());
+    chainstate.m_chain.SetTip(pindex);
+
+    if (coins.DynamicMemoryUsage() > SNAPSHOT_HISTORY_COINS_CACHE && !coins.Flush()) {
+        return AbortNode(state, "Failed to write to the snapshot history coins database");
+    }
+    return true;
+}
+
+/**
+ * Validate the history of the snapshot the chainstate was loaded from: check the PoW of
+ * its headers, then replay its blocks from the genesis block as they are downloaded and
+ * check the special transactions of each against the evodb state of the snapshot. The
+ * UTXO set at the snapshot base must then be the one of the snapshot.
+ */
+static void ThreadSnapshotHistory(const CChainParams& chainparams)
+{
+    ScheduleBatchPriority();
+    crypto::slow_hash_thread_guard slowHashGuard;
+
+    CValidationState state;
+    if (WITH_LOCK(cs_main, return g_snapshot_history->m_chain.Height() == 0)) {
+        LogPrintf("Checking the headers of the snapshot\n");
+        if (!CheckSnapshotHeaders(chainparams, state)) {
+            if (state.IsInvalid()) {
+                InvalidSnapshotFound(strprintf("Snapshot header check failed: %s", FormatStateMessage(state)));
+            }
+            return;
+        }
+        LogPrintf("Checked the headers of the snapshot, validating its blocks\n");
+    }
+
+    while (!g_snapshot_history_interrupt) {
+        CBlockIndex* pindex;
+        {
+            LOCK(cs_main);
+            const CBlockIndex* pindexTip = g_snapshot_history->m_chain.Tip();
+            if (pindexTip == pindexSnapshotBase) {
+                break;
+            }
+            pindex = pindexSnapshotBase->GetAncestor(pindexTip->nHeight + 1);
+        }
+        if (!WITH_LOCK(cs_main, return pindex->nStatus & BLOCK_HAVE_DATA)) {
+            // Not downloaded yet
+            g_snapshot_history_interrupt.sleep_for(std::chrono::milliseconds(500));
+            continue;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus())) {
+            AbortNode(strprintf("Failed to read block %s of the snapshot history", pindex->GetBlockHash().ToString()));
+            return;
+        }
+
+        LOCK(cs_main);
+        if (!ConnectSnapshotHistoryBlock(*g_snapshot_history, block, pindex, chainparams, state)) {
+            if (state.IsInvalid() && !state.CorruptionPossible()) {
+                InvalidSnapshotFound(strprintf("Block %s at height %d of the snapshot history is invalid: %s",
+                    pindex->GetBlockHash().ToString(), pindex->nHeight, FormatStateMessage(state)));
+            } else if (!state.IsError()) {
+                AbortNode(strprintf("Failed to validate block %s of the snapshot history: %s", pindex->GetBlockHash().ToString(), FormatStateMessage(state)));
+            }
+            return;
+        }
+        if (pindex->nHeight % 10000 == 0) {
+            LogPrintf("Validated the snapshot history up to height %d\n", pindex->nHeight);
+        }
+    }
+    if (g_snapshot_history_interrupt) {
+        return;
+    }
+
+    CCoinsViewDB* coinsdb;
+    uint256 hashExpected;
+    {
+        LOCK(cs_main);
+        if (!g_snapshot_history->CoinsTip().Flush()) {
+            AbortNode("Failed to write to the snapshot history coins database");
+            return;
+        }
+        coinsdb = &g_snapshot_history->CoinsDB();
+        if (!pblocktree->ReadSnapshotCoinsHash(hashExpected)) {
+            AbortNode("Failed to read the coins hash of the snapshot");
+            return;
+        }
+    }
+    // Only this thread uses the history coins database
+    CCoinsStats stats;
+    if (!GetUTXOStats(coinsdb, stats)) {
+        AbortNode("Failed to hash the snapshot history coins");
+        return;
+    }
+    if (stats.hashSerialized != hashExpected) {
+        InvalidSnapshotFound(strprintf("The UTXO set of the snapshot history has hash %s, the snapshot %s",
+            stats.hashSerialized.ToString(), hashExpected.ToString()));
+        return;
+    }
+
+    LOCK(cs_main);
+    if (!pblocktree->WriteFlag("snapshothistoryvalid", true)) {
+        AbortNode("Failed to write to the block index database");
+        return;
+    }
+    fSnapshotHistoryValidated = true;
+    g_snapshot_history.reset();
+    fs::remove_all(GetDataDir() / SNAPSHOT_HISTORY_DB_NAME);
+    LogPrintf("Validated the history of the snapshot at height %d\n", pindexSnapshotBase->nHeight);
+}
+
+void StartSnapshotHistoryValidation(const CChainParams& chainparams)
+{
+    LOCK(cs_main);
+    if (pindexSnapshotBase == nullptr || fSnapshotHistoryValidated || g_snapshot_history) {
+        return;
+    }
+
+    // Resume from where the last run left off, if it got anywhere on this snapshot's chain
+    const CBlockIndex* pindexGenesis = LookupBlockIndex(chainparams.GetConsensus().hashGenesisBlock);
+    g_snapshot_history = MakeUnique<CChainState>(g_blockman, true);
+    g_snapshot_history->InitCoinsDB(SNAPSHOT_HISTORY_DB_CACHE, false, false, SNAPSHOT_HISTORY_DB_NAME);
+    g_snapshot_history->InitCoinsCache();
+    const CBlockIndex* pindexTip = LookupBlockIndex(g_snapshot_history->CoinsTip().GetBestBlock());
+    if (pindexTip == nullptr || pindexSnapshotBase->GetAncestor(pindexTip->nHeight) != pindexTip) {
+        g_snapshot_history->ResetCoinsViews();
+        g_snapshot_history->InitCoinsDB(SNAPSHOT_HISTORY_DB_CACHE, false, true, SNAPSHOT_HISTORY_DB_NAME);
+        g_snapshot_history->InitCoinsCache();
+        g_snapshot_history->CoinsTip().SetBestBlock(pindexGenesis->GetBlockHash());
+        pindexTip = pindexGenesis;
+    }
+    g_snapshot_history->m_chain.SetTip(const_cast<CBlockIndex*>(pindexTip));
+    LogPrintf("Validating the history of the snapshot at height %d in the background, from height %d\n",
+        pindexSnapshotBase->nHeight, pindexTip->nHeight);
+
+    g_snapshot_history_interrupt.reset();
+    g_snapshot_history_thread = std::thread(&TraceThread<std::function<void()>>, "snaphist", std::function<void()>(std::bind(&ThreadSnapshotHistory, std::cref(chainparams))));
+}
+
+void InterruptSnapshotHistoryValidation()
+{
+    g_snapshot_history_interrupt();
+}
+
+void StopSnapshotHistoryValidation()
+{
+    if (g_snapshot_history_thread.joinable()) {
+        g_snapshot_history_thread.join();
+    }
+    LOCK(cs_main);
+    if (g_snapshot_history) {
+        // Keep the progress for the next start
+        g_snapshot_history->CoinsTip().Flush();
+        g_snapshot_history.reset();
+    }
+}
+
+/** Blocks LoadExternalBlockFile reads ahead while the ones before them are checked */
+static constexpr size_t MAX_IMPORT_BATCH_BLOCKS = 1000;
+static constexpr size_t MAX_IMPORT_BATCH_SIZE = 16 << 20;
+
 void LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos* dbp)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
@@ -4927,54 +6002,37 @@ void LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
-    try {
-        unsigned int nMaxBlockSize = MaxBlockSize();
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*nMaxBlockSize, nMaxBlockSize+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            if (ShutdownRequested()) return;
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
+    // Blocks are read in batches. While one batch is read from the file, the
+    // previous one is checked by the PoW check threads, and is then processed
+    // in file order, exactly as if it was processed right after reading it.
+    using ImportBatch = std::vector<std::pair<std::shared_ptr<CBlock>, FlatFilePos>>;
+    ImportBatch batch;
+    ImportBatch checking;
+    size_t batch_size = 0;
+    const size_t max_batch_blocks = g_parallel_block_checks ? MAX_IMPORT_BATCH_BLOCKS : 1;
+    std::unique_ptr<CCheckQueueControl<CBlockCheck>> control;
+
+    // Process the blocks which are being checked, and start checking the ones
+    // read since. Returns false if the import has to stop.
+    auto process_batch = [&]() -> bool {
+        if (control) {
+            control->Wait();
+            control.reset();
+        }
+        for (auto& entry : checking) {
             try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> buf;
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > nMaxBlockSize)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
-            try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-                CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
-
-                uint256 hash = block.GetHash();
+                std::shared_ptr<CBlock> pblock = entry.first;
+                FlatFilePos* pos = dbp ? &entry.second : nullptr;
+                uint256 hash = pblock->GetHash();
                 {
                     LOCK(cs_main);
                     // detect out of order blocks, and store them for later
-                    if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(block.hashPrevBlock)) {
+                    if (hash != chainparams.GetConsensus().hashGenesisBlock && !LookupBlockIndex(pblock->hashPrevBlock)) {
                         LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
-                                block.hashPrevBlock.ToString());
-                        if (dbp)
-                            mapBlocksUnknownParent.insert(std::make_pair(block.hashPrevBlock, *dbp));
+                                pblock->hashPrevBlock.ToString());
+                        if (pos)
+                            mapBlocksUnknownParent.insert(std::make_pair(pblock->hashPrevBlock, *pos));
                         continue;
                     }
 
@@ -4982,11 +6040,11 @@ void LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
                     CBlockIndex* pindex = LookupBlockIndex(hash);
                     if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
                       CValidationState state;
-                      if (::ChainstateActive().AcceptBlock(pblock, state, chainparams, nullptr, true, dbp, nullptr)) {
+                      if (::ChainstateActive().AcceptBlock(pblock, state, chainparams, nullptr, true, pos, nullptr)) {
                           nLoaded++;
                       }
                       if (state.IsError()) {
-                          break;
+                          return false;
                       }
                     } else if (hash != chainparams.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
                       LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
@@ -4997,7 +6055,7 @@ void LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
                 if (hash == chainparams.GetConsensus().hashGenesisBlock) {
                     CValidationState state;
                     if (!ActivateBestChain(state, chainparams)) {
-                        break;
+                        return false;
                     }
                 }
 
@@ -5034,6 +6092,77 @@ void LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
         }
+
+        checking = std::move(batch);
+        batch.clear();
+        batch_size = 0;
+        if (g_parallel_block_checks && !checking.empty()) {
+            std::vector<CBlockCheck> vChecks;
+            vChecks.reserve(checking.size());
+            for (const auto& entry : checking) {
+                vChecks.emplace_back(std::shared_ptr<const CBlock>(entry.first), chainparams.GetConsensus());
+            }
+            control = std::make_unique<CCheckQueueControl<CBlockCheck>>(&blockcheckqueue);
+            control->Add(vChecks);
+        }
+        return true;
+    };
+
+    try {
+        unsigned int nMaxBlockSize = MaxBlockSize();
+        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+        CBufferedFile blkdat(fileIn, 2*nMaxBlockSize, nMaxBlockSize+8, SER_DISK, CLIENT_VERSION);
+        uint64_t nRewind = blkdat.GetPos();
+        bool fContinue = true;
+        while (fContinue && !blkdat.eof()) {
+            if (ShutdownRequested()) return;
+
+            blkdat.SetPos(nRewind);
+            nRewind++; // start one byte further next time, in case of failure
+            blkdat.SetLimit(); // remove former limit
+            unsigned int nSize = 0;
+            try {
+                // locate a header
+                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+                blkdat.FindByte(chainparams.MessageStart()[0]);
+                nRewind = blkdat.GetPos()+1;
+                blkdat >> buf;
+                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                    continue;
+                // read size
+                blkdat >> nSize;
+                if (nSize < 80 || nSize > nMaxBlockSize)
+                    continue;
+            } catch (const std::exception&) {
+                // no valid block header found; don't complain
+                break;
+            }
+            try {
+                // read block
+                uint64_t nBlockPos = blkdat.GetPos();
+                FlatFilePos pos;
+                if (dbp) {
+                    dbp->nPos = nBlockPos;
+                    pos = *dbp;
+                }
+                blkdat.SetLimit(nBlockPos + nSize);
+                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                blkdat >> *pblock;
+                nRewind = blkdat.GetPos();
+
+                batch.emplace_back(std::move(pblock), pos);
+                batch_size += nSize;
+                if (batch.size() >= max_batch_blocks || batch_size >= MAX_IMPORT_BATCH_SIZE) {
+                    fContinue = process_batch();
+                }
+            } catch (const std::exception& e) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            }
+        }
+        // Process what is still being checked, then what was read last
+        if (fContinue && process_batch()) {
+            process_batch();
+        }
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
@@ -93,6 +93,9 @@ static const bool DEFAULT_PERSIST_MEMPOOL = true;
 /** Default for -syncmempool */
 static const bool DEFAULT_SYNC_MEMPOOL = true;
 
+/** Default for -mmapblockfiles */
+static const unsigned int DEFAULT_MMAP_BLOCK_FILES = 0;
+
 /** Default for -stopatheight */
 static const int DEFAULT_STOPATHEIGHT = 0;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of ::ChainActive().Tip() will not be pruned. */
@@ -135,6 +138,14 @@ extern bool fSpentIndex;
  * False indicates all script checking is done on the main threadMessageHandler thread.
  */
 extern bool g_parallel_script_checks;
+/** Whether there are dedicated threads running that pre-verify the PoW of header batches. */
+extern bool g_parallel_pow_checks;
+/** Whether there are dedicated threads running that check imported blocks ahead of AcceptBlock. */
+extern bool g_parallel_block_checks;
+/** Whether there are dedicated threads running that prefetch the inputs of blocks about to be connected. */
+extern bool g_parallel_coin_prefetch;
+/** Whether there are dedicated threads running that read the blocks and undo data of blocks about to be disconnected. */
+extern bool g_parallel_undo_prefetch;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
@@ -163,6 +174,10 @@ extern CBlockIndex *pindexBestHeader;
 extern bool fHavePruned;
 /** True if we're running in -prune mode. */
 extern bool fPruneMode;
+/** Block whose chainstate was loaded from a snapshot, its ancestors have no block data. */
+extern CBlockIndex *pindexSnapshotBase;
+/** True once the blocks up to pindexSnapshotBase have been validated in the background. */
+extern bool fSnapshotHistoryValidated;
 /** Number of MiB of block files that we're trying to stay below. */
 extern uint64_t nPruneTarget;
 
@@ -219,6 +234,30 @@ void UnloadBlockIndex();
 void StartScriptCheckWorkerThreads(int threads_num);
 /** Stop all of the script checking worker threads */
 void StopScriptCheckWorkerThreads();
+/** Run instances of header PoW checking worker threads */
+void StartPowCheckWorkerThreads(int threads_num);
+/** Stop all of the header PoW checking worker threads */
+void StopPowCheckWorkerThreads();
+/** Run instances of imported block checking worker threads */
+void StartBlockCheckWorkerThreads(int threads_num);
+/** Stop all of the imported block checking worker threads */
+void StopBlockCheckWorkerThreads();
+/** Run instances of block input prefetching worker threads */
+void StartCoinPrefetchWorkerThreads(int threads_num);
+/** Stop all of the block input prefetching worker threads */
+void StopCoinPrefetchWorkerThreads();
+/** Run instances of block and undo data reading worker threads */
+void StartUndoPrefetchWorkerThreads(int threads_num);
+/** Stop all of the block and undo data reading worker threads */
+void StopUndoPrefetchWorkerThreads();
+/** Validate the blocks up to the snapshot base in the background, if the chainstate was loaded from a snapshot */
+void StartSnapshotHistoryValidation(const CChainParams& chainparams);
+/** Interrupt the background validation of the snapshot history */
+void InterruptSnapshotHistoryValidation();
+/** Stop the background validation of the snapshot history, saving its progress */
+void StopSnapshotHistoryValidation();
+/** The last block below the snapshot base that was validated in the background, nullptr if no validation is running */
+const CBlockIndex* GetSnapshotHistoryTip() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256& hash, CTransactionRef& tx, const Consensus::Params& params, uint256& hashBlock, const CBlockIndex* const blockIndex = nullptr);
 /**
@@ -351,6 +390,9 @@ void InitScriptExecutionCache();
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/** Read the serialized block as stored, without parsing or checking it */
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
+bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
@@ -561,10 +603,27 @@ private:
     //! Manages the UTXO set, which is a reflection of the contents of `m_chain`.
     std::unique_ptr<CoinsViews> m_coins_views;
 
+    /**
+     * The block ActivateBestChainStep connects after the current one, and the
+     * block itself if it is already in memory. ConnectBlock prepares it while
+     * the script checks of the current block run, see PrepareNextBlock.
+     */
+    const CBlockIndex* m_next_block_index GUARDED_BY(cs_main){nullptr};
+    std::shared_ptr<const CBlock> m_next_block GUARDED_BY(cs_main);
+    //! The prepared block, picked up by the ConnectTip connecting it
+    std::shared_ptr<const CBlock> m_prepared_block GUARDED_BY(cs_main);
+
 public:
-    CChainState(BlockManager& blockman) : m_blockman(blockman) {}
+    CChainState(BlockManager& blockman, bool snapshot_history = false) : m_blockman(blockman), m_snapshot_history(snapshot_history) {}
     CChainState();
 
+    /**
+     * Set for the chainstate that validates the blocks below a snapshot base in the
+     * background. Their special transactions are checked against the evodb state the
+     * snapshot came with instead of being applied to it, see CheckSpecialTxsInMinedBlock.
+     */
+    const bool m_snapshot_history{false};
+
     /**
      * Initialize the CoinsViews UTXO set database management data structures. The in-memory
      * cache is initialized separately.
@@ -667,7 +726,8 @@ public:
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
-    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    //! blockundo, if given, is the undo data of the block read ahead and is consumed
+    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CBlockUndo* blockundo = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Apply the effects of a block disconnection on the UTXO set.
@@ -682,6 +742,14 @@ public:
     /** Replay blocks that aren't fully applied to the database. */
     bool ReplayBlocks(const CChainParams& params);
     bool LoadGenesisBlock(const CChainParams& chainparams);
+    /**
+     * Replace an empty chainstate with the one of a snapshot file written by dumpsnapshot.
+     * The file must hash to expected_hash, or to the hash pinned in the chainparams for its
+     * base height if expected_hash is null. Blocks up to the snapshot base are downloaded and
+     * validated in the background afterwards, see StartSnapshotHistoryValidation. They have
+     * no undo data, so the chain can't be reorganized or invalidated below the snapshot base.
+     */
+    bool LoadSnapshot(const CChainParams& chainparams, const fs::path& path, const uint256& expected_hash);
     bool AddGenesisBlock(const CChainParams& chainparams, const CBlock& block, CValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     void PruneBlockIndexCandidates();
@@ -715,6 +783,12 @@ public:
 private:
     bool ActivateBestChainStep(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    //! Load, check and prefetch the inputs of m_next_block_index ahead of its ConnectTip
+    void PrepareNextBlock(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    //! Disconnect the tip, whose block and optionally undo data were read already, on top of view
+    bool DisconnectTipOnView(CValidationState& state, const CChainParams& chainparams, const std::shared_ptr<CBlock>& pblock, CBlockUndo* blockundo, CCoinsViewCache& view, DisconnectedBlockTransactions* disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    //! Disconnect blocks down to pindexFork in batches, reading ahead and sharing one coins view per batch
+    bool DisconnectTips(CValidationState& state, const CChainParams& chainparams, const CBlockIndex* pindexFork, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     void InvalidBlockFound(CBlockIndex* pindex, const CValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     CBlockIndex* FindMostWorkChain() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Vkax Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test dumpsnapshot and starting a node from a snapshot with -loadsnapshot.
+
+- Generate blocks on node0 and write a snapshot of its chainstate.
+- Start node1 from the snapshot and check that its UTXO set matches.
+- Connect the nodes and check that node1 follows new blocks and validates the
+  blocks below the snapshot base in the background.
+- Check that a snapshot without a known hash or with the wrong hash is rejected.
+- Check that the chain can't be reorganized below the snapshot base.
+- Check that a node started from a tampered snapshot shuts down once the
+  history validation finds it out, and refuses to start again.
+"""
+
+import os
+
+from test_framework.messages import hash256
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.test_node import ErrorMatch
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+    connect_nodes,
+    wait_until,
+)
+
+class SnapshotTest(BitcoinTestFramework):
+
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 3
+
+    def setup_network(self):
+        self.setup_nodes()
+
+    def run_test(self):
+        node0 = self.nodes[0]
+        node0.generatetoaddress(150, node0.get_deterministic_priv_key().address)
+
+        self.log.info("Write a snapshot on node0")
+        snapshot = node0.dumpsnapshot("snapshot.dat")
+        assert_equal(snapshot['base_hash'], node0.getbestblockhash())
+        assert_equal(snapshot['base_height'], 150)
+        assert_equal(snapshot['coins_written'], node0.gettxoutsetinfo()['txouts'])
+        assert os.path.exists(snapshot['path'])
+        assert_raises_rpc_error(-8, "already exists", node0.dumpsnapshot, "snapshot.dat")
+
+        self.log.info("Reject a snapshot without a known hash")
+        self.stop_node(1)
+        self.nodes[1].assert_start_raises_init_error(
+            ["-loadsnapshot=" + snapshot['path']],
+            "Error loading snapshot", match=ErrorMatch.PARTIAL_REGEX)
+
+        self.log.info("Reject a snapshot with the wrong hash")
+        self.nodes[1].assert_start_raises_init_error(
+            ["-loadsnapshot=" + snapshot['path'], "-loadsnapshothash=" + "00" * 32],
+            "Error loading snapshot", match=ErrorMatch.PARTIAL_REGEX)
+        # The file is only found not to match once it has been read, which leaves
+        # a partially loaded chainstate behind
+        self.nodes[1].assert_start_raises_init_error(
+            [], "Loading a snapshot was interrupted", match=ErrorMatch.PARTIAL_REGEX)
+        self.start_node(1, ["-reindex"])
+        self.stop_node(1)
+
+        self.log.info("Start node1 from the snapshot")
+        self.start_node(1, ["-loadsnapshot=" + snapshot['path'], "-loadsnapshothash=" + snapshot['hash']])
+        node1 = self.nodes[1]
+        assert_equal(node1.getbestblockhash(), snapshot['base_hash'])
+        assert_equal(node1.gettxoutsetinfo()['hash_serialized_2'], node0.gettxoutsetinfo()['hash_serialized_2'])
+        assert_equal(node1.getblockheader(node0.getblockhash(10))['height'], 10)
+        assert_raises_rpc_error(-1, "pruned", node1.getblock, node0.getblockhash(10))
+
+        self.log.info("Follow new blocks from the snapshot")
+        connect_nodes(node0, 1)
+        node0.generatetoaddress(10, node0.get_deterministic_priv_key().address)
+        self.sync_blocks()
+        assert_equal(node1.gettxoutsetinfo()['hash_serialized_2'], node0.gettxoutsetinfo()['hash_serialized_2'])
+
+        self.log.info("Validate the blocks below the snapshot base in the background")
+        wait_until(lambda: node1.getblockchaininfo()['snapshot']['history_validated'])
+        assert_equal(node1.getblockchaininfo()['snapshot']['history_height'], 150)
+        assert_equal(node1.getblock(node0.getblockhash(10))['height'], 10)
+
+        self.log.info("Keep the loaded chainstate across restarts")
+        self.restart_node(1)
+        assert_equal(node1.getbestblockhash(), node0.getbestblockhash())
+
+        self.log.info("Refuse to reorganize below the snapshot base")
+        assert_raises_rpc_error(-20, "snapshot base", node1.invalidateblock, snapshot['base_hash'])
+        assert_raises_rpc_error(-20, "snapshot base", node1.invalidateblock, node0.getblockhash(100))
+        tip = node1.getbestblockhash()
+        connect_nodes(node0, 1)
+        node0.invalidateblock(node0.getblockhash(140))
+        node0.generatetoaddress(30, node0.get_deterministic_priv_key().address)
+        fork_tip = node0.getbestblockhash()
+        wait_until(lambda: any(t['hash'] == fork_tip and t['status'] == 'valid-headers' for t in node1.getchaintips()))
+        assert_equal(node1.getbestblockhash(), tip)
+
+        self.log.info("Shut down once the history shows the snapshot is invalid")
+        with open(snapshot['path'], 'rb') as f:
+            data = bytearray(f.read())
+        # Flip a byte of the txid of the first coin, after the metadata and the headers
+        data[68 + 80 * 150] ^= 0xff
+        tampered_path = os.path.join(self.options.tmpdir, "tampered.dat")
+        with open(tampered_path, 'wb') as f:
+            f.write(data)
+        tampered_hash = hash256(bytes(data))[::-1].hex()
+        self.stop_node(2)
+        self.start_node(2, ["-loadsnapshot=" + tampered_path, "-loadsnapshothash=" + tampered_hash])
+        assert 'snapshot' in self.nodes[2].getblockchaininfo()
+        connect_nodes(self.nodes[2], 1)
+        self.nodes[2].wait_until_stopped()
+        self.nodes[2].assert_start_raises_init_error(
+            [], "The snapshot the chainstate was loaded from is invalid", match=ErrorMatch.PARTIAL_REGEX)
+
+if __name__ == '__main__':
+    SnapshotTest().main()